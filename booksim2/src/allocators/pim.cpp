@@ -36,7 +36,7 @@
 PIM::PIM( Module *parent, const string& name,
 	  int inputs, int outputs, int iters ) :
   DenseAllocator( parent, name, inputs, outputs ),
-  _PIM_iter(iters)
+  _PIM_iter(iters), _random( _ctx, FullName( ), RandomAlloc )
 {
 }
 
@@ -61,7 +61,7 @@ void PIM::Allocate( )
     for ( output = 0; output < _outputs; ++output ) {
       
       // A random arbiter between input requests
-      input_offset  = RandomInt( _inputs - 1 );
+      input_offset  = _random.Int( _inputs - 1 );
       
       for ( int i = 0; i < _inputs; ++i ) {
 	input = ( i + input_offset ) % _inputs;  
@@ -83,7 +83,7 @@ void PIM::Allocate( )
     for ( input = 0; input < _inputs; ++input ) {
       
       // A random arbiter between output grants
-      output_offset  = RandomInt( _outputs - 1 );
+      output_offset  = _random.Int( _outputs - 1 );
       
       for ( int o = 0; o < _outputs; ++o ) {
 	output = ( o + output_offset ) % _outputs;
@@ -31,9 +31,11 @@
 #include <vector>
 
 #include "allocator.hpp"
+#include "random_utils.hpp"
 
 class PIM : public DenseAllocator {
   int _PIM_iter;
+  RandomStream _random;
 
 public:
   PIM( Module *parent, const string& name,
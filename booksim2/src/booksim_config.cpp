@@ -282,6 +282,16 @@ BookSimConfig::BookSimConfig( )
 
   _int_map["seed"]            = 0; //random seed for simulation, e.g. traffic 
   AddStrField("seed", ""); // workaround to allow special "time" value
+  _int_map["random_streams"]  = 0; //per-module counter-based random streams, independent of evaluation order
+  _int_map["noc_calendar"]    = 0; //only step routers and channels with pending flits or credits (cycle-exact)
+
+  //sampled simulation: detailed windows (warm-up + measured) alternate with functional
+  //windows that deliver packets after a latency drawn from recent detailed ones
+  _int_map["noc_sampling"]               = 0;
+  _int_map["sampling_warmup_cycles"]     = 1000;
+  _int_map["sampling_detailed_cycles"]   = 10000;
+  _int_map["sampling_functional_cycles"] = 90000;
+  _int_map["sampling_history"]           = 16; //latencies kept per (src, dest) pair
 
   _int_map["print_activity"] = 0;
 
@@ -0,0 +1,49 @@
+// $Id$
+
+/*
+ Copyright (c) 2007-2015, Trustees of The Leland Stanford Junior University
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+ Redistributions in binary form must reproduce the above copyright notice, this
+ list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "booksim_context.hpp"
+
+BookSimContext::BookSimContext( InterconnectInterface * icnt )
+  : icnt( icnt ), print_activity( false ),
+    k( 0 ), n( 0 ), c( 0 ), x( 0 ), y( 0 ), nodes( 0 ),
+    trace( false ), watch_out( 0 ),
+    num_vcs( 0 ),
+    read_req_begin_vc( 0 ), read_req_end_vc( 0 ),
+    write_req_begin_vc( 0 ), write_req_end_vc( 0 ),
+    read_reply_begin_vc( 0 ), read_reply_end_vc( 0 ),
+    write_reply_begin_vc( 0 ), write_reply_end_vc( 0 ),
+    random_streams( false ), random_stream_seed( 0 ),
+    route_table_nodes( -1 ), route_table_k( -1 ), route_table_n( -1 ),
+    route_tables_ok( false ),
+    anynet_routing_table( 0 ),
+    dragonfly_p( 0 ), dragonfly_a( 0 ), dragonfly_g( 0 ),
+    flatfly_xcount( 0 ), flatfly_ycount( 0 ), flatfly_xrouter( 0 ), flatfly_yrouter( 0 ),
+    cmesh_cx( 0 ), cmesh_cy( 0 ),
+    cmesh_node_shift_x( 0 ), cmesh_node_shift_y( 0 ), cmesh_port_shift_y( 0 )
+{
+}
@@ -0,0 +1,116 @@
+// $Id$
+
+/*
+ Copyright (c) 2007-2015, Trustees of The Leland Stanford Junior University
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+ Redistributions in binary form must reproduce the above copyright notice, this
+ list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _BOOKSIM_CONTEXT_HPP_
+#define _BOOKSIM_CONTEXT_HPP_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stack>
+#include <iostream>
+
+#include "random_utils.hpp"
+
+class InterconnectInterface;
+class Router;
+class Flit;
+class Credit;
+class PacketReplyInfo;
+class OutputSet;
+
+class BookSimContext;
+
+typedef void (*tRoutingFunction)( BookSimContext *, const Router *, const Flit *, int in_channel, OutputSet *, bool );
+
+// State of one simulated interconnect that used to be process-wide. Each
+// InterconnectInterface owns a context, so several independently configured
+// networks can coexist. They can be stepped from different threads only with
+// random_streams on; otherwise their draws share the generator in
+// random_utils.cpp. There is no current context: every module keeps a pointer
+// to the context it was built in (Module::GetContext), and free functions such
+// as routing functions are handed it by their callers.
+class BookSimContext {
+
+public:
+
+  BookSimContext( InterconnectInterface * icnt = 0 );
+
+  InterconnectInterface * icnt;
+
+  bool print_activity;
+
+  int k; // radix
+  int n; // dimension
+  int c; // concentration
+  int x; // x dimension count
+  int y; // y dimension count
+
+  int nodes;
+
+  bool trace; // generate nocviewer trace
+  std::ostream * watch_out;
+
+  // Routing functions and the VC classes they route into
+  std::map<std::string, tRoutingFunction> routing_function_map;
+  int num_vcs;
+  int read_req_begin_vc, read_req_end_vc;
+  int write_req_begin_vc, write_req_end_vc;
+  int read_reply_begin_vc, read_reply_end_vc;
+  int write_reply_begin_vc, write_reply_end_vc;
+
+  // Per-node streams for routing decisions made at injection
+  std::vector<RandomStream> inject_random;
+
+  // RandomStream draws; only stream-based interconnects are independent of
+  // the others in the process (see random_utils.cpp)
+  bool random_streams;
+  unsigned long long random_stream_seed;
+
+  // k-ary n-cube route tables (see routefunc.cpp) and the size they were
+  // built for
+  int route_table_nodes, route_table_k, route_table_n;
+  bool route_tables_ok;
+  std::vector<int> node_coords;
+  std::vector<unsigned char> dor_mesh_port;
+  std::vector<unsigned char> dor_torus_hop;
+
+  // Topology parameters read by the routing functions of some networks
+  std::map<int, int> * anynet_routing_table;
+  int dragonfly_p, dragonfly_a, dragonfly_g;
+  int flatfly_xcount, flatfly_ycount, flatfly_xrouter, flatfly_yrouter;
+  int cmesh_cx, cmesh_cy;
+  int cmesh_node_shift_x, cmesh_node_shift_y, cmesh_port_shift_y;
+
+  // Flit, credit and reply pools; every object is recycled by the network
+  // that allocated it
+  std::stack<Flit *> all_flits, free_flits;
+  std::stack<Credit *> all_credits, free_credits;
+  std::stack<PacketReplyInfo *> all_replies, free_replies;
+};
+
+#endif
@@ -66,10 +66,31 @@ public:
     return _vc[vc]->RemoveFlit( );
   }
   
+  // Copies the next flit of a multicast packet; it stays buffered for the next branches
+  inline Flit *CopyFlit( int vc )
+  {
+    return _vc[vc]->CopyFlit( );
+  }
+  
   inline Flit *FrontFlit( int vc ) const
   {
     return _vc[vc]->FrontFlit( );
   }
+
+  inline void SetMulticastBranches( int vc, const vector<OutputSet> & route_sets, const vector<uint64_t> & dests )
+  {
+    _vc[vc]->SetMulticastBranches(route_sets, dests);
+  }
+
+  inline bool IsReplicating( int vc ) const
+  {
+    return _vc[vc]->IsReplicating( );
+  }
+
+  inline void NextBranch( int vc )
+  {
+    _vc[vc]->NextBranch( );
+  }
   
   inline bool Empty( int vc ) const
   {
@@ -63,9 +63,7 @@ BufferState::BufferPolicy * BufferState::BufferPolicy::New(Configuration const &
 {
   BufferPolicy * sp = NULL;
   string buffer_policy = config.GetStr("buffer_policy");
-  if(buffer_policy == "private") {
-    sp = new PrivateBufferPolicy(config, parent, name);
-  } else if(buffer_policy == "shared") {
+  if(buffer_policy == "shared") {
     sp = new SharedBufferPolicy(config, parent, name);
   } else if(buffer_policy == "limited") {
     sp = new LimitedSharedBufferPolicy(config, parent, name);
@@ -83,50 +81,6 @@ BufferState::BufferPolicy * BufferState::BufferPolicy::New(Configuration const &
   return sp;
 }
 
-BufferState::PrivateBufferPolicy::PrivateBufferPolicy(Configuration const & config, BufferState * parent, const string & name)
-  : BufferPolicy(config, parent, name)
-{
-  int const vcs = config.GetInt( "num_vcs" );
-  int const buf_size = config.GetInt("buf_size");
-  if(buf_size <= 0) {
-    _vc_buf_size = config.GetInt("vc_buf_size");
-  } else {
-    _vc_buf_size = buf_size / vcs;
-  }
-  assert(_vc_buf_size > 0);
-}
-
-// add 2 buffers for each extra cycle of interchiplet link latency
-void BufferState::PrivateBufferPolicy::IncVcBufferSize(int lat){
-  _vc_buf_size += 2*lat;
-}
-
-void BufferState::PrivateBufferPolicy::SendingFlit(Flit const * const f)
-{
-  int const vc = f->vc;
-  if(_buffer_state->OccupancyFor(vc) > _vc_buf_size) {
-    ostringstream err;
-    err << "Buffer overflow for VC " << vc;
-    Error(err.str());
-  }
-}
-
-bool BufferState::PrivateBufferPolicy::IsFullFor(int vc) const
-{
-  return (_buffer_state->OccupancyFor(vc) >= _vc_buf_size);
-}
-
-int BufferState::PrivateBufferPolicy::AvailableFor(int vc) const
-{
-  std::cout << "vc buf = " << _vc_buf_size << std::endl;
-  return _vc_buf_size - _buffer_state->OccupancyFor(vc);
-}
-
-int BufferState::PrivateBufferPolicy::LimitFor(int vc) const
-{
-  return _vc_buf_size;
-}
-
 BufferState::SharedBufferPolicy::SharedBufferPolicy(Configuration const & config, BufferState * parent, const string & name)
   : BufferPolicy(config, parent, name), _shared_buf_occupancy(0)
 {
@@ -551,7 +505,26 @@ BufferState::BufferState( const Configuration& config, Module *parent, const str
     _size = _vcs * config.GetInt("vc_buf_size");
   }
 
-  _buffer_policy = BufferPolicy::New(config, this, "policy");
+  if(_vcs > Credit::max_vcs) {
+    ostringstream err;
+    err << "Credits support at most " << Credit::max_vcs << " VCs";
+    Error(err.str());
+  }
+
+  _private_bufs = (config.GetStr("buffer_policy") == "private");
+  if(_private_bufs) {
+    int const buf_size = config.GetInt("buf_size");
+    if(buf_size <= 0) {
+      _vc_buf_size = config.GetInt("vc_buf_size");
+    } else {
+      _vc_buf_size = buf_size / _vcs;
+    }
+    assert(_vc_buf_size > 0);
+    _buffer_policy = NULL;
+  } else {
+    _vc_buf_size = -1;
+    _buffer_policy = BufferPolicy::New(config, this, "policy");
+  }
 
   _wait_for_tail_credit = config.GetInt( "wait_for_tail_credit" );
 
@@ -579,10 +552,9 @@ void BufferState::ProcessCredit( Credit const * const c )
 {
   assert( c );
 
-  set<int>::iterator iter = c->vc.begin();
-  while(iter != c->vc.end()) {
+  for(uint64_t mask = c->vc_mask; mask; mask &= mask - 1) {
 
-    int const vc = *iter;
+    int const vc = Credit::FirstVC(mask);
 
     assert( ( vc >= 0 ) && ( vc < _vcs ) );
 
@@ -616,9 +588,9 @@ void BufferState::ProcessCredit( Credit const * const c )
     --_class_occupancy[cl];
 #endif
 
-    _buffer_policy->FreeSlotFor(vc);
-
-    ++iter;
+    if(!_private_bufs) {
+      _buffer_policy->FreeSlotFor(vc);
+    }
   }
 }
 
@@ -636,7 +608,15 @@ void BufferState::SendingFlit( Flit const * const f )
 
   ++_vc_occupancy[vc];
   
-  _buffer_policy->SendingFlit(f);
+  if(_private_bufs) {
+    if(_vc_occupancy[vc] > _vc_buf_size) {
+      ostringstream err;
+      err << "Buffer overflow for VC " << vc;
+      Error(err.str());
+    }
+  } else {
+    _buffer_policy->SendingFlit(f);
+  }
   
 #ifdef TRACK_BUFFERS
   _outstanding_classes[vc].push(f->cl);
@@ -666,7 +646,9 @@ void BufferState::TakeBuffer( int vc, int tag )
   }
   _in_use_by[vc] = tag;
   _tail_sent[vc] = false;
-  _buffer_policy->TakeBuffer(vc);
+  if(!_private_bufs) {
+    _buffer_policy->TakeBuffer(vc);
+  }
 }
 
 void BufferState::Display( ostream & os ) const
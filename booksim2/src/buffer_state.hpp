@@ -57,19 +57,6 @@ class BufferState : public Module {
 			      BufferState * parent, const string & name);
   };
   
-  class PrivateBufferPolicy : public BufferPolicy {
-  protected:
-    int _vc_buf_size;
-  public:
-    PrivateBufferPolicy(Configuration const & config, BufferState * parent, 
-			const string & name);
-    virtual void SendingFlit(Flit const * const f);
-    virtual bool IsFullFor(int vc = 0) const;
-    virtual int AvailableFor(int vc = 0) const;
-    virtual int LimitFor(int vc = 0) const;
-    virtual void IncVcBufferSize(int lat);
-  };
-  
   class SharedBufferPolicy : public BufferPolicy {
   protected:
     int _buf_size;
@@ -170,6 +157,10 @@ class BufferState : public Module {
   vector<int> _vc_occupancy;
   int  _vcs;
   
+  // buffer_policy = private is handled inline with a fixed per-VC limit;
+  // _buffer_policy is only instantiated for the sharing policies
+  bool _private_bufs;
+  int  _vc_buf_size;
   BufferPolicy * _buffer_policy;
   
   vector<int> _in_use_by;
@@ -191,7 +182,9 @@ public:
   ~BufferState();
 
   inline void SetMinLatency(int min_latency) {
-    _buffer_policy->SetMinLatency(min_latency);
+    if(!_private_bufs) {
+      _buffer_policy->SetMinLatency(min_latency);
+    }
   }
 
   void ProcessCredit( Credit const * const c );
@@ -204,12 +197,23 @@ public:
     return (_occupancy == _size);
   }
   inline bool IsFullFor( int vc = 0 ) const {
+    if(_private_bufs) {
+      assert((vc >= 0) && (vc < _vcs));
+      return (_vc_occupancy[vc] >= _vc_buf_size);
+    }
     return _buffer_policy->IsFullFor(vc);
   }
   inline int AvailableFor( int vc = 0 ) const {
+    if(_private_bufs) {
+      assert((vc >= 0) && (vc < _vcs));
+      return _vc_buf_size - _vc_occupancy[vc];
+    }
     return _buffer_policy->AvailableFor(vc);
   }
   inline int LimitFor( int vc = 0 ) const {
+    if(_private_bufs) {
+      return _vc_buf_size;
+    }
     return _buffer_policy->LimitFor(vc);
   }
   inline bool IsEmptyFor(int vc = 0) const {
@@ -234,8 +238,13 @@ public:
     return _vc_occupancy[vc];
   }
   
+  // add 2 buffers for each extra cycle of interchiplet link latency
   inline void IncVcBufferSize(int lat){
-    _buffer_policy->IncVcBufferSize(lat);
+    if(_private_bufs) {
+      _vc_buf_size += 2*lat;
+    } else {
+      _buffer_policy->IncVcBufferSize(lat);
+    }
   }
 
 #ifdef TRACK_BUFFERS
@@ -67,17 +67,22 @@ public:
   virtual void Evaluate() {}
   virtual void WriteOutputs();
 
+  // Module woken when data leaves the channel (see ActivityCalendar)
+  void SetReceiver(TimedModule * receiver) { _receiver = receiver; }
+  virtual bool IsIdle() const { return !_input && !_output && _wait_queue.empty(); }
+
 protected:
   int _delay;
   T * _input;
   T * _output;
+  TimedModule * _receiver;
   queue<pair<simTime, T *> > _wait_queue; // the fifo needed for the channel's latency
 
 };
 
 template<typename T>
 Channel<T>::Channel(Module * parent, string const & name)
-  : TimedModule(parent, name), _delay(1), _input(0), _output(0) {
+  : TimedModule(parent, name), _delay(1), _input(0), _output(0), _receiver(0) {
 }
 
 template<typename T>
@@ -91,6 +96,9 @@ void Channel<T>::SetLatency(int cycles) {
 template<typename T>
 void Channel<T>::Send(T * data) {
   _input = data;
+  if(data) {
+    Wake();
+  }
 }
 
 template<typename T>
@@ -126,6 +134,9 @@ void Channel<T>::WriteOutputs() {
   _output = item.second;
   assert(_output);
   _wait_queue.pop();
+  if(_receiver) {
+    _receiver->Wake();
+  }
 }
 
 #endif
@@ -32,9 +32,8 @@
 
 #include "booksim.hpp"
 #include "credit.hpp"
+#include "booksim_context.hpp"
 
-stack<Credit *> Credit::_all;
-stack<Credit *> Credit::_free;
 
 Credit::Credit()
 {
@@ -43,37 +42,38 @@ Credit::Credit()
 
 void Credit::Reset()
 {
-  vc.clear();
+  vc_mask = 0;
   head = false;
   tail = false;
   id   = -1;
 }
 
-Credit * Credit::New() {
+Credit * Credit::New( BookSimContext * ctx ) {
   Credit * c;
-  if(_free.empty()) {
+  if(ctx->free_credits.empty()) {
     c = new Credit();
-    _all.push(c);
+    ctx->all_credits.push(c);
   } else {
-    c = _free.top();
+    c = ctx->free_credits.top();
     c->Reset();
-    _free.pop();
+    ctx->free_credits.pop();
   }
   return c;
 }
 
-void Credit::Free() {
-  _free.push(this);
+void Credit::Free( BookSimContext * ctx ) {
+  ctx->free_credits.push(this);
 }
 
-void Credit::FreeAll() {
-  while(!_all.empty()) {
-    delete _all.top();
-    _all.pop();
+void Credit::FreeAll( BookSimContext * ctx ) {
+  while(!ctx->all_credits.empty()) {
+    delete ctx->all_credits.top();
+    ctx->all_credits.pop();
   }
+  ctx->free_credits = stack<Credit *>();
 }
 
 
-int Credit::OutStanding(){
-  return _all.size()-_free.size();
+int Credit::OutStanding( BookSimContext const * ctx ){
+  return ctx->all_credits.size()-ctx->free_credits.size();
 }
@@ -28,14 +28,35 @@
 #ifndef _CREDIT_HPP_
 #define _CREDIT_HPP_
 
-#include <set>
 #include <stack>
+#include <cassert>
+#include <stdint.h>
+
+class BookSimContext;
 
 class Credit {
 
 public:
 
-  set<int> vc;
+  // one bit per VC being credited; limits networks to max_vcs VCs
+  static int const max_vcs = 64;
+  uint64_t vc_mask;
+
+  inline void AddVC(int vc) {
+    assert((vc >= 0) && (vc < max_vcs));
+    vc_mask |= (uint64_t)1 << vc;
+  }
+  inline bool Empty() const {
+    return (vc_mask == 0);
+  }
+  inline int NumVCs() const {
+    return __builtin_popcountll(vc_mask);
+  }
+  // lowest credited VC; iterate with vc_mask &= vc_mask - 1
+  static inline int FirstVC(uint64_t mask) {
+    assert(mask);
+    return __builtin_ctzll(mask);
+  }
 
   // these are only used by the event router
   bool head, tail;
@@ -43,15 +64,13 @@ public:
 
   void Reset();
   
-  static Credit * New();
-  void Free();
-  static void FreeAll();
-  static int OutStanding();
+  static Credit * New( BookSimContext * ctx );
+  void Free( BookSimContext * ctx );
+  static void FreeAll( BookSimContext * ctx );
+  static int OutStanding( BookSimContext const * ctx );
 private:
 
-  static stack<Credit *> _all;
-  static stack<Credit *> _free;
-
+  // pooled in the BookSimContext of the interconnect that allocated them
   Credit();
   ~Credit() {}
 
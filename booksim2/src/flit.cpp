@@ -37,8 +37,6 @@
 #include "booksim.hpp"
 #include "flit.hpp"
 
-stack<Flit *> Flit::_all;
-stack<Flit *> Flit::_free;
 
 ostream& operator<<( ostream& os, const Flit& f )
 {
@@ -48,6 +46,9 @@ ostream& operator<<( ostream& os, const Flit& f )
      << " Head: " << f.head
      << " Tail: " << f.tail << endl;
   os << "  Source: " << f.src << "  Dest: " << f.dest << " Intm: "<<f.intm<<endl;
+  if(f.mcast) {
+    os << "  Multicast dests: 0x" << hex << f.mcast_dests << dec << endl;
+  }
   os << "  Creation time: " << f.ctime << " Injection time: " << f.itime << " Arrival time: " << f.atime << " Phase: "<<f.ph<< endl;
   os << "  VC: " << f.vc << endl;
   return os;
@@ -71,37 +72,48 @@ void Flit::Reset()
   id        = -1 ;
   pid       = -1 ;
   hops      = 0 ;
+#ifndef _NO_WATCH_
   watch     = false ;
+#endif
   record    = false ;
   intm = 0;
   src = -1;
   dest = -1;
+  mcast = false;
+  mcast_dests = 0;
   pri = 0;
   intm =-1;
   ph = -1;
   data = 0;
 }  
 
-Flit * Flit::New() {
+Flit * Flit::New( BookSimContext * ctx ) {
   Flit * f;
-  if(_free.empty()) {
+  if(ctx->free_flits.empty()) {
     f = new Flit;
-    _all.push(f);
+    ctx->all_flits.push(f);
   } else {
-    f = _free.top();
+    f = ctx->free_flits.top();
     f->Reset();
-    _free.pop();
+    ctx->free_flits.pop();
   }
   return f;
 }
 
-void Flit::Free() {
-  _free.push(this);
+Flit * Flit::Copy( BookSimContext * ctx ) const {
+  Flit * f = New( ctx );
+  *f = *this;
+  return f;
+}
+
+void Flit::Free( BookSimContext * ctx ) {
+  ctx->free_flits.push(this);
 }
 
-void Flit::FreeAll() {
-  while(!_all.empty()) {
-    delete _all.top();
-    _all.pop();
+void Flit::FreeAll( BookSimContext * ctx ) {
+  while(!ctx->all_flits.empty()) {
+    delete ctx->all_flits.top();
+    ctx->all_flits.pop();
   }
+  ctx->free_flits = stack<Flit *>();
 }
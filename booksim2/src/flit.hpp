@@ -68,10 +68,19 @@ public:
   int  src;
   int  dest;
 
+  // Multicast packets: all their flits have mcast set, and head flits carry the
+  // destinations (bit per node) of the copy they lead; dest is the lowest one
+  bool     mcast;
+  uint64_t mcast_dests;
+
   int  pri;
 
   int  hops;
+#ifdef _NO_WATCH_
+  static const bool watch = false;
+#else
   bool watch;
+#endif
   int  subnetwork;
   
   // intermediate destination (if any)
@@ -88,18 +97,17 @@ public:
 
   void Reset();
 
-  static Flit * New();
-  void Free();
-  static void FreeAll();
+  static Flit * New( BookSimContext * ctx );
+  Flit * Copy( BookSimContext * ctx ) const;
+  void Free( BookSimContext * ctx );
+  static void FreeAll( BookSimContext * ctx );
 
 private:
 
+  // pooled in the BookSimContext of the interconnect that allocated them
   Flit();
   ~Flit() {}
 
-  static stack<Flit *> _all;
-  static stack<Flit *> _free;
-
 };
 
 ostream& operator<<( ostream& os, const Flit& f );
@@ -31,29 +31,38 @@
 #include <vector>
 #include <iostream>
 
-/*all declared in main.cpp*/
+#include "booksim_context.hpp"
 
-class InterconnectInterface;
-extern InterconnectInterface *nocInterface;
+/*all declared in main.cpp*/
 
 typedef long long int simTime;
-simTime GetSimTime();
+// Current cycle of the interconnect of ctx, -1 before it is created
+simTime GetSimTime( BookSimContext const * ctx );
 
 class Stats;
 Stats * GetStats(const std::string & name);
 
-extern bool gPrintActivity;
+// Short names for the state of the interconnect (BookSimContext) being
+// simulated; they expand to the _ctx in scope, a member of every Module
+// and a parameter of the free functions that need it
+#define gPrintActivity (_ctx->print_activity)
 
-extern int gK;
-extern int gN;
-extern int gC;
-extern int gX;
-extern int gY;
+#define gK (_ctx->k)
+#define gN (_ctx->n)
+#define gC (_ctx->c)
+#define gX (_ctx->x)
+#define gY (_ctx->y)
 
-extern int gNodes;
+#define gNodes (_ctx->nodes)
 
-extern bool gTrace;
+// Built with _NO_WATCH_, viewer traces and flit watching (Flit::watch) are
+// constant-false, so every check on the hot path folds away
+#ifdef _NO_WATCH_
+static bool const gTrace = false;
+#else
+#define gTrace (_ctx->trace)
+#endif
 
-extern std::ostream * gWatchOut;
+#define gWatchOut (_ctx->watch_out)
 
 #endif
@@ -29,12 +29,15 @@
 #include <vector>
 #include <cassert>
 #include <limits>
+#include <sstream>
 #include "random_utils.hpp"
 #include "injection.hpp"
 
 using namespace std;
 
-InjectionProcess::InjectionProcess(int nodes, double rate)
+int InjectionProcess::_instances = 0;
+
+InjectionProcess::InjectionProcess(BookSimContext * ctx, int nodes, double rate)
   : _nodes(nodes), _rate(rate)
 {
   if(nodes <= 0) {
@@ -46,6 +49,12 @@ InjectionProcess::InjectionProcess(int nodes, double rate)
 	 << endl;
     exit(-1);
   }
+  int const instance = _instances++;
+  for(int n = 0; n < nodes; ++n) {
+    ostringstream name;
+    name << "injection_" << instance << "/node_" << n;
+    _random.push_back(RandomStream(ctx, name.str(), RandomInject));
+  }
 }
 
 void InjectionProcess::reset()
@@ -53,7 +62,7 @@ void InjectionProcess::reset()
 
 }
 
-InjectionProcess * InjectionProcess::New(string const & inject, int nodes, 
+InjectionProcess * InjectionProcess::New(BookSimContext * ctx, string const & inject, int nodes, 
 					 double load, 
 					 Configuration const * const config)
 {
@@ -75,7 +84,7 @@ InjectionProcess * InjectionProcess::New(string const & inject, int nodes,
 
   InjectionProcess * result = NULL;
   if(process_name == "bernoulli") {
-    result = new BernoulliInjectionProcess(nodes, load);
+    result = new BernoulliInjectionProcess(ctx, nodes, load);
   } else if(process_name == "on_off") {
     bool missing_params = false;
     double alpha = numeric_limits<double>::quiet_NaN();
@@ -124,7 +133,7 @@ InjectionProcess * InjectionProcess::New(string const & inject, int nodes,
 	initial[n] = RandomInt(1);
       }
     }
-    result = new OnOffInjectionProcess(nodes, load, alpha, beta, r1, initial);
+    result = new OnOffInjectionProcess(ctx, nodes, load, alpha, beta, r1, initial);
   } else {
     cout << "Invalid injection process: " << inject << endl;
     exit(-1);
@@ -134,8 +143,8 @@ InjectionProcess * InjectionProcess::New(string const & inject, int nodes,
 
 //=============================================================
 
-BernoulliInjectionProcess::BernoulliInjectionProcess(int nodes, double rate)
-  : InjectionProcess(nodes, rate)
+BernoulliInjectionProcess::BernoulliInjectionProcess(BookSimContext * ctx, int nodes, double rate)
+  : InjectionProcess(ctx, nodes, rate)
 {
 
 }
@@ -143,15 +152,15 @@ BernoulliInjectionProcess::BernoulliInjectionProcess(int nodes, double rate)
 bool BernoulliInjectionProcess::test(int source)
 {
   assert((source >= 0) && (source < _nodes));
-  return (RandomFloat() < _rate);
+  return (_random[source].Float() < _rate);
 }
 
 //=============================================================
 
-OnOffInjectionProcess::OnOffInjectionProcess(int nodes, double rate, 
+OnOffInjectionProcess::OnOffInjectionProcess(BookSimContext * ctx, int nodes, double rate, 
 					     double alpha, double beta, 
 					     double r1, vector<int> initial)
-  : InjectionProcess(nodes, rate), 
+  : InjectionProcess(ctx, nodes, rate), 
     _alpha(alpha), _beta(beta), _r1(r1), _initial(initial)
 {
   assert(alpha <= 1.0);
@@ -183,8 +192,8 @@ bool OnOffInjectionProcess::test(int source)
 
   // advance state
   _state[source] = 
-    _state[source] ? (RandomFloat() >= _beta) : (RandomFloat() < _alpha);
+    _state[source] ? (_random[source].Float() >= _beta) : (_random[source].Float() < _alpha);
 
   // generate packet
-  return _state[source] && (RandomFloat() < _r1);
+  return _state[source] && (_random[source].Float() < _r1);
 }
@@ -29,6 +29,7 @@
 #define _INJECTION_HPP_
 
 #include "config_utils.hpp"
+#include "random_utils.hpp"
 
 using namespace std;
 
@@ -36,18 +37,20 @@ class InjectionProcess {
 protected:
   int _nodes;
   double _rate;
-  InjectionProcess(int nodes, double rate);
+  vector<RandomStream> _random; // one per source node
+  static int _instances;
+  InjectionProcess(BookSimContext * ctx, int nodes, double rate);
 public:
   virtual ~InjectionProcess() {}
   virtual bool test(int source) = 0;
   virtual void reset();
-  static InjectionProcess * New(string const & inject, int nodes, double load, 
+  static InjectionProcess * New(BookSimContext * ctx, string const & inject, int nodes, double load, 
 				Configuration const * const config = NULL);
 };
 
 class BernoulliInjectionProcess : public InjectionProcess {
 public:
-  BernoulliInjectionProcess(int nodes, double rate);
+  BernoulliInjectionProcess(BookSimContext * ctx, int nodes, double rate);
   virtual bool test(int source);
 };
 
@@ -59,7 +62,7 @@ private:
   vector<int> _initial;
   vector<int> _state;
 public:
-  OnOffInjectionProcess(int nodes, double rate, double alpha, double beta, 
+  OnOffInjectionProcess(BookSimContext * ctx, int nodes, double rate, double alpha, double beta, 
 			double r1, vector<int> initial);
   virtual void reset();
   virtual bool test(int source);
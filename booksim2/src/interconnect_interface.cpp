@@ -58,7 +58,7 @@ InterconnectInterface* InterconnectInterface::New(const char* const config_file)
   return icnt_interface;
 }
 
-InterconnectInterface::InterconnectInterface()
+InterconnectInterface::InterconnectInterface() : _context(this), _ctx(&_context)
 {
 }
 
@@ -74,9 +74,14 @@ void InterconnectInterface::CreateInterconnect()
 {
   nocCurCycle = 0;
 
-  InitializeRoutingMap(*_icnt_config);
+  InitializeRoutingMap(_ctx, *_icnt_config);
 
   gPrintActivity = (_icnt_config->GetInt("print_activity") > 0);
+#ifdef _NO_WATCH_
+  if((_icnt_config->GetInt("viewer_trace") > 0) || (_icnt_config->GetStr("watch_out") != "")) {
+    cout << "WARNING: viewer_trace and watch_out are ignored, BookSim was built with _NO_WATCH_" << endl;
+  }
+#else
   gTrace = (_icnt_config->GetInt("viewer_trace") > 0);
 
   string watch_out_file = _icnt_config->GetStr( "watch_out" );
@@ -87,6 +92,7 @@ void InterconnectInterface::CreateInterconnect()
   } else {
     gWatchOut = new ofstream(watch_out_file.c_str());
   }
+#endif
 
   _subnets = _icnt_config->GetInt("subnets");
   assert(_subnets);
@@ -98,7 +104,7 @@ void InterconnectInterface::CreateInterconnect()
   for (int i = 0; i < _subnets; ++i) {
     ostringstream name;
     name << "network_" << i;
-    _net[i] = Network::New( *_icnt_config, name.str() );
+    _net[i] = Network::New( _ctx, *_icnt_config, name.str() );
   }
 
   // assert(_icnt_config->GetStr("sim_type") == "gpgpusim");
@@ -162,6 +168,21 @@ uint64_t InterconnectInterface::ManuallyGeneratePacket(int source, int dest, int
     return packId;
   }
 
+uint64_t InterconnectInterface::ManuallyGenerateMulticastPacket(int source, const int* dests, int numDests, int size, simTime ctime, uint64_t addr, bool llcEvent, BookSimNetwork *nocAddr){
+  uint64_t destMask = 0;
+  for (int i = 0; i < numDests; i++) {
+    assert(dests[i] >= 0 && dests[i] < 64);
+    destMask |= 1ULL << dests[i];
+  }
+  outStandingPackets += __builtin_popcountll(destMask);
+  return _traffic_manager->_ManuallyGenerateMulticastPacket(source, destMask, size, ctime, addr, llcEvent, nocAddr);
+}
+
+bool InterconnectInterface::SupportsMulticast() const
+{
+  return _traffic_manager->SupportsMulticast();
+}
+
 void InterconnectInterface::UpdateStats()
 {
   _traffic_manager->UpdateStats();
@@ -176,6 +197,7 @@ void InterconnectInterface::DisplayStats()
 
     _traffic_manager->_UpdateOverallStats();
     _traffic_manager->DisplayOverallStats(*_overall_stats_out);
+    _traffic_manager->DisplaySamplingStats(*_overall_stats_out);
 
     double skippedPerc = (100.0*skippedSteps)/(skippedSteps+nonSkippedSteps);
           *_overall_stats_out << "Number of non-skipped steps = " << nonSkippedSteps << std::endl
@@ -217,7 +239,7 @@ int cntprints = 0;
 
 void InterconnectInterface::Step(){
 #ifndef _NO_OPT_
-  if(outStandingPackets == 0){
+  if(outStandingPackets == 0 && !_traffic_manager->HasGhostPackets()){
     skippedSteps++;
     _traffic_manager->incrTime(); // TODO: do I really need that or is it OK if the noc has a different clock?
     return;
@@ -241,11 +263,11 @@ void InterconnectInterface::RegisterCallbacksInterface(Callback_t *readDone, Cal
 }
 
 
-void InterconnectInterface::CallbackEverything(uint64_t pid, BookSimNetwork *nocAddr){
+void InterconnectInterface::CallbackEverything(uint64_t pid, int dest, BookSimNetwork *nocAddr){
   outStandingPackets--;
   for (auto& iter: ReturnReadData) {
     if(iter.first == nocAddr){
-      iter.second->operator()(0, pid, 1);
+      iter.second->operator()(dest, pid, 1);
       return;
     }
   }
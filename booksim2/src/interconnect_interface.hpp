@@ -56,10 +56,14 @@ public:
   void CreateInterconnect();
   
   uint64_t ManuallyGeneratePacket(int source, int dest, int size, simTime ctime, uint64_t addr, bool llcEvent, BookSimNetwork *nocAddr);
+  // A single packet that routers replicate along the DOR tree; the callback fires once per destination
+  uint64_t ManuallyGenerateMulticastPacket(int source, const int* dests, int numDests, int size, simTime ctime, uint64_t addr, bool llcEvent, BookSimNetwork *nocAddr);
+  bool SupportsMulticast() const;
   void Step();
 
   void RegisterCallbacksInterface(booksim::TransactionCompleteCB *readDone, booksim::TransactionCompleteCB *writeDone, BookSimNetwork *nocAddr);
-  void CallbackEverything(uint64_t pid, BookSimNetwork *nocAddr);
+  // dest is the node the packet was delivered to (the first callback argument), or -1 if unknown
+  void CallbackEverything(uint64_t pid, int dest, BookSimNetwork *nocAddr);
   
   void Init();
   void UpdateStats();
@@ -73,8 +77,14 @@ public:
   void setNocCurCycle(simTime cycle){nocCurCycle = cycle;}
   int getCntStepCalls(){return cntStepCalls;}
   int getNodes();
+  // Topology and routing state of this interconnect
+  BookSimContext* GetContext(){return _ctx;}
 
 protected:
+  // Passed down explicitly to the networks and the traffic manager, which
+  // hand it to their modules
+  BookSimContext _context;
+  BookSimContext * const _ctx;
   uint64_t nocCurCycle;
   class _BoundaryBufferItem {
     public:
@@ -60,13 +60,11 @@
 //Global declarations
 //////////////////////
 
-InterconnectInterface *nocInterface;
-
-simTime GetSimTime() {
-  return (nocInterface != nullptr) ? nocInterface->GetIcntTime() : -1;
+simTime GetSimTime(BookSimContext const * ctx) {
+  return (ctx && ctx->icnt) ? ctx->icnt->GetIcntTime() : -1;
 }
 
-void setWatchOut(string watch_out_file){
+void setWatchOut(BookSimContext * _ctx, string watch_out_file){
   if(watch_out_file == "") {
         gWatchOut = NULL;
     } else if(watch_out_file == "-") {
@@ -88,19 +86,3 @@ Stats * GetStats(const std::string & name) {
 return 0;
 }
 
-/* printing activity factor*/
-bool gPrintActivity;
-
-int gK;//radix
-int gN;//dimension
-int gC;//concentration
-int gX;//x dimension count
-int gY;//y dimension count
-
-
-int gNodes;
-
-//generate nocviewer trace
-bool gTrace;
-
-ostream * gWatchOut;
@@ -38,7 +38,8 @@
 #include "booksim.hpp"
 #include "module.hpp"
 
-Module::Module( Module *parent, const string& name )
+Module::Module( Module *parent, const string& name, BookSimContext * ctx )
+  : _ctx( parent ? parent->_ctx : ctx )
 {
   _name = name;
 
@@ -29,6 +29,7 @@
 #define _MODULE_HPP_
 
 #include "booksim.hpp"
+#include "globals.hpp"
 
 #include <string>
 #include <vector>
@@ -42,11 +43,18 @@ private:
   vector<Module *> _children;
 
 protected:
+  // Interconnect the module belongs to; inherited from the parent, and given
+  // explicitly to modules at the top of the hierarchy
+  BookSimContext * const _ctx;
+
   void _AddChild( Module *child );
 
 public:
-  Module( Module *parent, const string& name );
+  Module( Module *parent, const string& name, BookSimContext * ctx = 0 );
   virtual ~Module( ) { }
+
+  inline BookSimContext * GetContext( ) const { return _ctx; }
+  inline simTime GetSimTime( ) const { return ::GetSimTime( _ctx ); }
   
   inline const string & Name() const { return _name; }
   inline const string & FullName() const { return _fullname; }
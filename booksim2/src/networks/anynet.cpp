@@ -56,10 +56,10 @@
 #include <limits>
 #include <algorithm>
 //this is a hack, I can't easily get the routing talbe out of the network
-map<int, int>* global_routing_table;
+#define global_routing_table (_ctx->anynet_routing_table)
 
-AnyNet::AnyNet( const Configuration &config, const string & name )
-  :  Network( config, name ){
+AnyNet::AnyNet( BookSimContext * ctx, const Configuration &config, const string & name )
+  :  Network( ctx, config, name ){
 
   router_list.resize(2);
   _ComputeSize( config );
@@ -225,11 +225,11 @@ void AnyNet::_BuildNet( const Configuration &config ){
 }
 
 
-void AnyNet::RegisterRoutingFunctions() {
+void AnyNet::RegisterRoutingFunctions( BookSimContext * _ctx ) {
   gRoutingFunctionMap["min_anynet"] = &min_anynet;
 }
 
-void min_anynet( const Router *r, const Flit *f, int in_channel, 
+void min_anynet( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 		 OutputSet *outputs, bool inject ){
   int out_port=-1;
   if(!inject){
@@ -56,17 +56,17 @@ class AnyNet : public Network {
   void route(int r_start);
 
 public:
-  AnyNet( const Configuration &config, const string & name );
+  AnyNet( BookSimContext * ctx, const Configuration &config, const string & name );
   ~AnyNet();
 
   int GetN( ) const{ return -1;}
   int GetK( ) const{ return -1;}
 
-  static void RegisterRoutingFunctions();
+  static void RegisterRoutingFunctions( BookSimContext * _ctx );
   double Capacity( ) const {return -1;}
   void InsertRandomFaults( const Configuration &config ){}
 };
 
-void min_anynet( const Router *r, const Flit *f, int in_channel, 
+void min_anynet( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 		      OutputSet *outputs, bool inject );
 #endif
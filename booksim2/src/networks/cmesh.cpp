@@ -47,21 +47,22 @@
 #include "misc_utils.hpp"
 #include "cmesh.hpp"
 
-int CMesh::_cX = 0 ;
-int CMesh::_cY = 0 ;
-int CMesh::_memo_NodeShiftX = 0 ;
-int CMesh::_memo_NodeShiftY = 0 ;
-int CMesh::_memo_PortShiftY = 0 ;
-
-CMesh::CMesh( const Configuration& config, const string & name ) 
-  : Network(config, name) 
+// read by the static routing functions, kept with the interconnect
+#define _cX (_ctx->cmesh_cx)
+#define _cY (_ctx->cmesh_cy)
+#define _memo_NodeShiftX (_ctx->cmesh_node_shift_x)
+#define _memo_NodeShiftY (_ctx->cmesh_node_shift_y)
+#define _memo_PortShiftY (_ctx->cmesh_port_shift_y)
+
+CMesh::CMesh( BookSimContext * ctx, const Configuration &config, const string & name ) 
+  : Network( ctx, config, name ) 
 {
   _ComputeSize( config );
   _Alloc();
   _BuildNet(config);
 }
 
-void CMesh::RegisterRoutingFunctions() {
+void CMesh::RegisterRoutingFunctions( BookSimContext * _ctx ) {
   gRoutingFunctionMap["dor_cmesh"] = &dor_cmesh;
   gRoutingFunctionMap["dor_no_express_cmesh"] = &dor_no_express_cmesh;
   gRoutingFunctionMap["xy_yx_cmesh"] = &xy_yx_cmesh;
@@ -313,7 +314,7 @@ void CMesh::_BuildNet( const Configuration& config ) {
 //
 // ----------------------------------------------------------------------
 
-int CMesh::NodeToRouter( int address ) {
+int CMesh::NodeToRouter( BookSimContext * _ctx, int address ) {
 
   int y  = (address /  (_cX*gK))/_cY ;
   int x  = (address %  (_cX*gK))/_cY ;
@@ -322,7 +323,7 @@ int CMesh::NodeToRouter( int address ) {
   return router ;
 }
 
-int CMesh::NodeToPort( int address ) {
+int CMesh::NodeToPort( BookSimContext * _ctx, int address ) {
   
   const int maskX  = _cX - 1 ;
   const int maskY  = _cY - 1 ;
@@ -340,7 +341,7 @@ int CMesh::NodeToPort( int address ) {
 // ----------------------------------------------------------------------
 
 // Concentrated Mesh: X-Y
-int cmesh_xy( int cur, int dest ) {
+int cmesh_xy( BookSimContext * _ctx, int cur, int dest ) {
 
   const int POSITIVE_X = 0 ;
   const int NEGATIVE_X = 1 ;
@@ -397,7 +398,7 @@ int cmesh_xy( int cur, int dest ) {
 }
 
 // Concentrated Mesh: Y-X
-int cmesh_yx( int cur, int dest ) {
+int cmesh_yx( BookSimContext * _ctx, int cur, int dest ) {
   const int POSITIVE_X = 0 ;
   const int NEGATIVE_X = 1 ;
   const int POSITIVE_Y = 2 ;
@@ -452,7 +453,7 @@ int cmesh_yx( int cur, int dest ) {
   return 0;
 }
 
-void xy_yx_cmesh( const Router *r, const Flit *f, int in_channel, 
+void xy_yx_cmesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 		  OutputSet *outputs, bool inject )
 {
 
@@ -485,12 +486,12 @@ void xy_yx_cmesh( const Router *r, const Flit *f, int in_channel,
     int cur_router = r->GetID();
 
     // Destination Router
-    int dest_router = CMesh::NodeToRouter( f->dest ) ;  
+    int dest_router = CMesh::NodeToRouter( _ctx, f->dest ) ;  
 
     if (dest_router == cur_router) {
 
       // Forward to processing element
-      out_port = CMesh::NodeToPort( f->dest );      
+      out_port = CMesh::NodeToPort( _ctx, f->dest );      
 
     } else {
 
@@ -502,14 +503,14 @@ void xy_yx_cmesh( const Router *r, const Flit *f, int in_channel,
 
       // randomly select dimension order at first hop
       bool x_then_y = ((in_channel < gC) ?
-		       (RandomInt(1) > 0) :
+		       (RouteRandom(_ctx, r, f).Int(1) > 0) :
 		       (f->vc < (vcBegin + available_vcs)));
 
       if(x_then_y) {
-	out_port = cmesh_xy( cur_router, dest_router );
+	out_port = cmesh_xy( _ctx, cur_router, dest_router );
 	vcEnd -= available_vcs;
       } else {
-	out_port = cmesh_yx( cur_router, dest_router );
+	out_port = cmesh_yx( _ctx, cur_router, dest_router );
 	vcBegin += available_vcs;
       }
     }
@@ -530,7 +531,7 @@ void xy_yx_cmesh( const Router *r, const Flit *f, int in_channel,
 //
 // ----------------------------------------------------------------------
 
-int cmesh_xy_no_express( int cur, int dest ) {
+int cmesh_xy_no_express( BookSimContext * _ctx, int cur, int dest ) {
   
   const int POSITIVE_X = 0 ;
   const int NEGATIVE_X = 1 ;
@@ -562,7 +563,7 @@ int cmesh_xy_no_express( int cur, int dest ) {
   return 0;
 }
 
-int cmesh_yx_no_express( int cur, int dest ) {
+int cmesh_yx_no_express( BookSimContext * _ctx, int cur, int dest ) {
 
   const int POSITIVE_X = 0 ;
   const int NEGATIVE_X = 1 ;
@@ -593,7 +594,7 @@ int cmesh_yx_no_express( int cur, int dest ) {
   return 0;
 }
 
-void xy_yx_no_express_cmesh( const Router *r, const Flit *f, int in_channel, 
+void xy_yx_no_express_cmesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 			     OutputSet *outputs, bool inject )
 {
   // ( Traffic Class , Routing Order ) -> Virtual Channel Range
@@ -625,12 +626,12 @@ void xy_yx_no_express_cmesh( const Router *r, const Flit *f, int in_channel,
     int cur_router = r->GetID();
 
     // Destination Router
-    int dest_router = CMesh::NodeToRouter( f->dest );  
+    int dest_router = CMesh::NodeToRouter( _ctx, f->dest );  
 
     if (dest_router == cur_router) {
 
       // Forward to processing element
-      out_port = CMesh::NodeToPort( f->dest );
+      out_port = CMesh::NodeToPort( _ctx, f->dest );
 
     } else {
 
@@ -642,14 +643,14 @@ void xy_yx_no_express_cmesh( const Router *r, const Flit *f, int in_channel,
 
       // randomly select dimension order at first hop
       bool x_then_y = ((in_channel < gC) ?
-		       (RandomInt(1) > 0) :
+		       (RouteRandom(_ctx, r, f).Int(1) > 0) :
 		       (f->vc < (vcBegin + available_vcs)));
 
       if(x_then_y) {
-	out_port = cmesh_xy_no_express( cur_router, dest_router );
+	out_port = cmesh_xy_no_express( _ctx, cur_router, dest_router );
 	vcEnd -= available_vcs;
       } else {
-	out_port = cmesh_yx_no_express( cur_router, dest_router );
+	out_port = cmesh_yx_no_express( _ctx, cur_router, dest_router );
 	vcBegin += available_vcs;
       }
     }
@@ -662,7 +663,7 @@ void xy_yx_no_express_cmesh( const Router *r, const Flit *f, int in_channel,
 //============================================================
 //
 //=====
-int cmesh_next( int cur, int dest ) {
+int cmesh_next( BookSimContext * _ctx, int cur, int dest ) {
 
   const int POSITIVE_X = 0 ;
   const int NEGATIVE_X = 1 ;
@@ -720,7 +721,7 @@ int cmesh_next( int cur, int dest ) {
   return -1;
 }
 
-void dor_cmesh( const Router *r, const Flit *f, int in_channel, 
+void dor_cmesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 		OutputSet *outputs, bool inject )
 {
   // ( Traffic Class , Routing Order ) -> Virtual Channel Range
@@ -752,17 +753,17 @@ void dor_cmesh( const Router *r, const Flit *f, int in_channel,
     int cur_router = r->GetID();
 
     // Destination Router
-    int dest_router = CMesh::NodeToRouter( f->dest ) ;  
+    int dest_router = CMesh::NodeToRouter( _ctx, f->dest ) ;  
   
     if (dest_router == cur_router) {
 
       // Forward to processing element
-      out_port = CMesh::NodeToPort( f->dest ) ;
+      out_port = CMesh::NodeToPort( _ctx, f->dest ) ;
 
     } else {
 
       // Forward to neighbouring router
-      out_port = cmesh_next( cur_router, dest_router );
+      out_port = cmesh_next( _ctx, cur_router, dest_router );
     }
   }
 
@@ -774,7 +775,7 @@ void dor_cmesh( const Router *r, const Flit *f, int in_channel,
 //============================================================
 //
 //=====
-int cmesh_next_no_express( int cur, int dest ) {
+int cmesh_next_no_express( BookSimContext * _ctx, int cur, int dest ) {
 
   const int POSITIVE_X = 0 ;
   const int NEGATIVE_X = 1 ;
@@ -804,7 +805,7 @@ int cmesh_next_no_express( int cur, int dest ) {
   return -1;
 }
 
-void dor_no_express_cmesh( const Router *r, const Flit *f, int in_channel, 
+void dor_no_express_cmesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 			   OutputSet *outputs, bool inject )
 {
   // ( Traffic Class , Routing Order ) -> Virtual Channel Range
@@ -836,17 +837,17 @@ void dor_no_express_cmesh( const Router *r, const Flit *f, int in_channel,
     int cur_router = r->GetID();
 
     // Destination Router
-    int dest_router = CMesh::NodeToRouter( f->dest ) ;  
+    int dest_router = CMesh::NodeToRouter( _ctx, f->dest ) ;  
   
     if (dest_router == cur_router) {
 
       // Forward to processing element
-      out_port = CMesh::NodeToPort( f->dest );
+      out_port = CMesh::NodeToPort( _ctx, f->dest );
 
     } else {
 
       // Forward to neighbouring router
-      out_port = cmesh_next_no_express( cur_router, dest_router );
+      out_port = cmesh_next_no_express( _ctx, cur_router, dest_router );
     }
   }
 
@@ -46,24 +46,17 @@
 
 class CMesh : public Network {
 public:
-  CMesh( const Configuration &config, const string & name );
+  CMesh( BookSimContext * ctx, const Configuration &config, const string & name );
   int GetN() const;
   int GetK() const;
 
-  static int NodeToRouter( int address ) ;
-  static int NodeToPort( int address ) ;
+  static int NodeToRouter( BookSimContext * _ctx, int address ) ;
+  static int NodeToPort( BookSimContext * _ctx, int address ) ;
 
-  static void RegisterRoutingFunctions() ;
+  static void RegisterRoutingFunctions( BookSimContext * _ctx );
 
 private:
 
-  static int _cX ;
-  static int _cY ;
-
-  static int _memo_NodeShiftX ;
-  static int _memo_NodeShiftY ;
-  static int _memo_PortShiftY ;
-
   void _ComputeSize( const Configuration &config );
   void _BuildNet( const Configuration& config );
 
@@ -80,16 +73,16 @@ private:
 //
 // Routing Functions
 //
-void xy_yx_cmesh( const Router *r, const Flit *f, int in_channel, 
+void xy_yx_cmesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 		  OutputSet *outputs, bool inject ) ;
 
-void xy_yx_no_express_cmesh( const Router *r, const Flit *f, int in_channel, 
+void xy_yx_no_express_cmesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 			     OutputSet *outputs, bool inject ) ;
 
-void dor_cmesh( const Router *r, const Flit *f, int in_channel, 
+void dor_cmesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 		OutputSet *outputs, bool inject ) ;
 
-void dor_no_express_cmesh( const Router *r, const Flit *f, int in_channel, 
+void dor_no_express_cmesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 			   OutputSet *outputs, bool inject ) ;
 
 #endif
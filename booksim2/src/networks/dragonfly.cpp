@@ -37,10 +37,13 @@
 
 #define DRAGON_LATENCY
 
-int gP, gA, gG;
+// dragonfly parameters of the interconnect (see BookSimContext)
+#define gP (_ctx->dragonfly_p)
+#define gA (_ctx->dragonfly_a)
+#define gG (_ctx->dragonfly_g)
 
 //calculate the hop count between src and estination
-int dragonflynew_hopcnt(int src, int dest) 
+int dragonflynew_hopcnt(BookSimContext * _ctx, int src, int dest) 
 {
   int hopcnt;
   int dest_grp_ID, src_grp_ID; 
@@ -102,7 +105,7 @@ int dragonflynew_hopcnt(int src, int dest)
 
 
 //packet output port based on the source, destination and current location
-int dragonfly_port(int rID, int source, int dest){
+int dragonfly_port(BookSimContext * _ctx, int rID, int source, int dest){
   int _grp_num_routers= gA;
   int _grp_num_nodes =_grp_num_routers*gP;
 
@@ -146,8 +149,8 @@ int dragonfly_port(int rID, int source, int dest){
 }
 
 
-DragonFlyNew::DragonFlyNew( const Configuration &config, const string & name ) :
-  Network( config, name )
+DragonFlyNew::DragonFlyNew( BookSimContext * ctx, const Configuration &config, const string & name ) :
+  Network( ctx, config, name )
 {
 
   _ComputeSize( config );
@@ -400,20 +403,20 @@ double DragonFlyNew::Capacity( ) const
   return (double)_k / 8.0;
 }
 
-void DragonFlyNew::RegisterRoutingFunctions(){
+void DragonFlyNew::RegisterRoutingFunctions( BookSimContext * _ctx ) {
 
   gRoutingFunctionMap["min_dragonflynew"] = &min_dragonflynew;
   gRoutingFunctionMap["ugal_dragonflynew"] = &ugal_dragonflynew;
 }
 
 
-void min_dragonflynew( const Router *r, const Flit *f, int in_channel, 
+void min_dragonflynew( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 		       OutputSet *outputs, bool inject )
 {
   outputs->Clear( );
 
   if(inject) {
-    int inject_vc= RandomInt(gNumVCs-1);
+    int inject_vc= RouteRandom(_ctx, r, f).Int(gNumVCs-1);
     outputs->AddRange(-1, inject_vc, inject_vc);
     return;
   }
@@ -438,7 +441,7 @@ void min_dragonflynew( const Router *r, const Flit *f, int in_channel,
   } 
 
 
-  out_port = dragonfly_port(rID, f->src, dest);
+  out_port = dragonfly_port(_ctx, rID, f->src, dest);
 
   //optical dateline
   if (out_port >=gP + (gA-1)) {
@@ -447,7 +450,7 @@ void min_dragonflynew( const Router *r, const Flit *f, int in_channel,
   
   out_vc = f->ph;
   if (debug)
-    *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+    *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 	       << "	through output port : " << out_port 
 	       << " out vc: " << out_vc << endl;
   outputs->AddRange( out_port, out_vc, out_vc );
@@ -455,7 +458,7 @@ void min_dragonflynew( const Router *r, const Flit *f, int in_channel,
 
 
 //Basic adaptive routign algorithm for the dragonfly
-void ugal_dragonflynew( const Router *r, const Flit *f, int in_channel, 
+void ugal_dragonflynew( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 			OutputSet *outputs, bool inject )
 {
   //need 3 VCs for deadlock freedom
@@ -463,7 +466,7 @@ void ugal_dragonflynew( const Router *r, const Flit *f, int in_channel,
   assert(gNumVCs==3);
   outputs->Clear( );
   if(inject) {
-    int inject_vc= RandomInt(gNumVCs-1);
+    int inject_vc= RouteRandom(_ctx, r, f).Int(gNumVCs-1);
     outputs->AddRange(-1, inject_vc, inject_vc);
     return;
   }
@@ -502,7 +505,7 @@ void ugal_dragonflynew( const Router *r, const Flit *f, int in_channel,
       f->ph = 2;
     } else {
       //select a random node
-      f->intm =RandomInt(_network_size - 1);
+      f->intm =RouteRandom(_ctx, r, f).Int(_network_size - 1);
       intm_grp_ID = (int)(f->intm/_grp_num_nodes);
       if (debug){
 	cout<<"Intermediate node "<<f->intm<<" grp id "<<intm_grp_ID<<endl;
@@ -513,11 +516,11 @@ void ugal_dragonflynew( const Router *r, const Flit *f, int in_channel,
 	f->ph = 1;
       } else {
 	//congestion metrics using queue length, obtained by GetUsedCredit()
-	min_router_output = dragonfly_port(rID, f->src, f->dest); 
+	min_router_output = dragonfly_port(_ctx, rID, f->src, f->dest); 
       	min_queue_size = max(r->GetUsedCredit(min_router_output), 0) ; 
 
       
-	nonmin_router_output = dragonfly_port(rID, f->src, f->intm);
+	nonmin_router_output = dragonfly_port(_ctx, rID, f->src, f->intm);
 	nonmin_queue_size = max(r->GetUsedCredit(nonmin_router_output), 0);
 
 	//congestion comparison, could use hopcnt instead of 1 and 2
@@ -541,11 +544,11 @@ void ugal_dragonflynew( const Router *r, const Flit *f, int in_channel,
 
   //port assignement based on the phase
   if(f->ph == 0){
-    out_port = dragonfly_port(rID, f->src, f->intm);
+    out_port = dragonfly_port(_ctx, rID, f->src, f->intm);
   } else if(f->ph == 1){
-    out_port = dragonfly_port(rID, f->src, f->dest);
+    out_port = dragonfly_port(_ctx, rID, f->src, f->dest);
   } else if(f->ph == 2){
-    out_port = dragonfly_port(rID, f->src, f->dest);
+    out_port = dragonfly_port(_ctx, rID, f->src, f->dest);
   } else {
     assert(false);
   }
@@ -54,21 +54,21 @@ class DragonFlyNew : public Network {
 
  
 public:
-  DragonFlyNew( const Configuration &config, const string & name );
+  DragonFlyNew( BookSimContext * ctx, const Configuration &config, const string & name );
 
   int GetN( ) const;
   int GetK( ) const;
 
   double Capacity( ) const;
-  static void RegisterRoutingFunctions();
+  static void RegisterRoutingFunctions( BookSimContext * _ctx );
   void InsertRandomFaults( const Configuration &config );
 
 };
-int dragonfly_port(int rID, int source, int dest);
+int dragonfly_port(BookSimContext * _ctx, int rID, int source, int dest);
 
-void ugal_dragonflynew( const Router *r, const Flit *f, int in_channel,
+void ugal_dragonflynew( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel,
 		       OutputSet *outputs, bool inject );
-void min_dragonflynew( const Router *r, const Flit *f, int in_channel, 
+void min_dragonflynew( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 		       OutputSet *outputs, bool inject );
 
 #endif 
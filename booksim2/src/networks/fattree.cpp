@@ -55,8 +55,8 @@
 
  //#define FATTREE_DEBUG
 
-FatTree::FatTree( const Configuration& config,const string & name )
-  : Network( config ,name)
+FatTree::FatTree( BookSimContext * ctx, const Configuration &config, const string & name )
+  : Network( ctx, config, name )
 {
   
 
@@ -86,7 +86,7 @@ void FatTree::_ComputeSize( const Configuration& config )
 }
 
 
-void FatTree::RegisterRoutingFunctions() {
+void FatTree::RegisterRoutingFunctions( BookSimContext * _ctx ) {
 
 }
 
@@ -63,8 +63,8 @@ class FatTree : public Network {
 
 public:
 
-  FatTree( const Configuration& config ,const string & name );
-  static void RegisterRoutingFunctions() ;
+  FatTree( BookSimContext * ctx, const Configuration &config, const string & name );
+  static void RegisterRoutingFunctions( BookSimContext * _ctx );
 
   //
   // Methods to Assit Routing Functions
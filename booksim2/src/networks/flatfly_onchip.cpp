@@ -60,13 +60,14 @@
 
 //#define DEBUG_FLATFLY
 
-static int _xcount;
-static int _ycount;
-static int _xrouter;
-static int _yrouter;
-
-FlatFlyOnChip::FlatFlyOnChip( const Configuration &config, const string & name ) :
-  Network( config, name )
+// read by the routing functions, kept with the interconnect (see BookSimContext)
+#define _xcount (_ctx->flatfly_xcount)
+#define _ycount (_ctx->flatfly_ycount)
+#define _xrouter (_ctx->flatfly_xrouter)
+#define _yrouter (_ctx->flatfly_yrouter)
+
+FlatFlyOnChip::FlatFlyOnChip( BookSimContext * ctx, const Configuration &config, const string & name ) :
+  Network( ctx, config, name )
 {
 
   _ComputeSize( config );
@@ -315,7 +316,7 @@ double FlatFlyOnChip::Capacity( ) const
 }
 
 
-void FlatFlyOnChip::RegisterRoutingFunctions(){
+void FlatFlyOnChip::RegisterRoutingFunctions( BookSimContext * _ctx ) {
 
   
   gRoutingFunctionMap["ran_min_flatfly"] = &min_flatfly;
@@ -329,7 +330,7 @@ void FlatFlyOnChip::RegisterRoutingFunctions(){
 }
 
 //The initial XY or YX minimal routing direction is chosen adaptively
-void adaptive_xyyx_flatfly( const Router *r, const Flit *f, int in_channel, 
+void adaptive_xyyx_flatfly( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 		  OutputSet *outputs, bool inject )
 { 
   // ( Traffic Class , Routing Order ) -> Virtual Channel Range
@@ -357,7 +358,7 @@ void adaptive_xyyx_flatfly( const Router *r, const Flit *f, int in_channel,
 
   } else {
 
-    int dest = flatfly_transformation(f->dest);
+    int dest = flatfly_transformation(_ctx, f->dest);
     int targetr = (int)(dest/gC);
 
     if(targetr==r->GetID()){ //if we are at the final router, yay, output to client
@@ -369,8 +370,8 @@ void adaptive_xyyx_flatfly( const Router *r, const Flit *f, int in_channel,
       int const available_vcs = (vcEnd - vcBegin + 1) / 2;
       assert(available_vcs > 0);
 
-      int out_port_xy =  flatfly_outport(dest, r->GetID());
-      int out_port_yx =  flatfly_outport_yx(dest, r->GetID());
+      int out_port_xy =  flatfly_outport(_ctx, dest, r->GetID());
+      int out_port_yx =  flatfly_outport_yx(_ctx, dest, r->GetID());
 
       // Route order (XY or YX) determined when packet is injected
       //  into the network, adaptively
@@ -383,7 +384,7 @@ void adaptive_xyyx_flatfly( const Router *r, const Flit *f, int in_channel,
 	} else if(credit_xy < credit_yx) {
 	  x_then_y = true;
 	} else {
-	  x_then_y = (RandomInt(1) > 0);
+	  x_then_y = (RouteRandom(_ctx, r, f).Int(1) > 0);
 	}
       } else {
 	x_then_y =  (f->vc < (vcBegin + available_vcs));
@@ -406,7 +407,7 @@ void adaptive_xyyx_flatfly( const Router *r, const Flit *f, int in_channel,
 }
 
 //The initial XY or YX minimal routing direction is chosen randomly
-void xyyx_flatfly( const Router *r, const Flit *f, int in_channel, 
+void xyyx_flatfly( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 		  OutputSet *outputs, bool inject )
 { 
   // ( Traffic Class , Routing Order ) -> Virtual Channel Range
@@ -434,7 +435,7 @@ void xyyx_flatfly( const Router *r, const Flit *f, int in_channel,
 
   } else {
 
-    int dest = flatfly_transformation(f->dest);
+    int dest = flatfly_transformation(_ctx, f->dest);
     int targetr = (int)(dest/gC);
 
     if(targetr==r->GetID()){ //if we are at the final router, yay, output to client
@@ -448,14 +449,14 @@ void xyyx_flatfly( const Router *r, const Flit *f, int in_channel,
 
       // randomly select dimension order at first hop
       bool x_then_y = ((in_channel < gC) ?
-		       (RandomInt(1) > 0) : 
+		       (RouteRandom(_ctx, r, f).Int(1) > 0) : 
 		       (f->vc < (vcBegin + available_vcs)));
 
       if(x_then_y) {
-	out_port = flatfly_outport(dest, r->GetID());
+	out_port = flatfly_outport(_ctx, dest, r->GetID());
 	vcEnd -= available_vcs;
       } else {
-	out_port = flatfly_outport_yx(dest, r->GetID());
+	out_port = flatfly_outport_yx(_ctx, dest, r->GetID());
 	vcBegin += available_vcs;
       }
     }
@@ -467,7 +468,7 @@ void xyyx_flatfly( const Router *r, const Flit *f, int in_channel,
   outputs->AddRange( out_port , vcBegin, vcEnd );
 }
 
-int flatfly_outport_yx(int dest, int rID) {
+int flatfly_outport_yx(BookSimContext * _ctx, int dest, int rID) {
   int dest_rID = (int) (dest / gC);
   int _dim   = gN;
   int output = -1, dID, sID;
@@ -499,7 +500,7 @@ int flatfly_outport_yx(int dest, int rID) {
   return -1;
 }
 
-void valiant_flatfly( const Router *r, const Flit *f, int in_channel, 
+void valiant_flatfly( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 		  OutputSet *outputs, bool inject )
 {
   // ( Traffic Class , Routing Order ) -> Virtual Channel Range
@@ -529,21 +530,21 @@ void valiant_flatfly( const Router *r, const Flit *f, int in_channel,
 
     if ( in_channel < gC ){
       f->ph = 0;
-      f->intm = RandomInt( powi( gK, gN )*gC-1);
+      f->intm = RouteRandom(_ctx, r, f).Int( powi( gK, gN )*gC-1);
     }
 
-    int intm = flatfly_transformation(f->intm);
-    int dest = flatfly_transformation(f->dest);
+    int intm = flatfly_transformation(_ctx, f->intm);
+    int dest = flatfly_transformation(_ctx, f->dest);
 
     if((int)(intm/gC) == r->GetID() || (int)(dest/gC)== r->GetID()){
       f->ph = 1;
     }
 
     if(f->ph == 0) {
-      out_port = flatfly_outport(intm, r->GetID());
+      out_port = flatfly_outport(_ctx, intm, r->GetID());
     } else {
       assert(f->ph == 1);
-      out_port = flatfly_outport(dest, r->GetID());
+      out_port = flatfly_outport(_ctx, dest, r->GetID());
     }
 
     if((int)(dest/gC) != r->GetID()) {
@@ -568,7 +569,7 @@ void valiant_flatfly( const Router *r, const Flit *f, int in_channel,
   outputs->AddRange( out_port , vcBegin, vcEnd );
 }
 
-void min_flatfly( const Router *r, const Flit *f, int in_channel, 
+void min_flatfly( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 		  OutputSet *outputs, bool inject )
 {
   // ( Traffic Class , Routing Order ) -> Virtual Channel Range
@@ -596,7 +597,7 @@ void min_flatfly( const Router *r, const Flit *f, int in_channel,
 
   } else {
 
-    int dest  = flatfly_transformation(f->dest);
+    int dest  = flatfly_transformation(_ctx, f->dest);
     int targetr= (int)(dest/gC);
     //int xdest = ((int)(dest/gC)) % gK;
     //int xcurr = ((r->GetID())) % gK;
@@ -607,7 +608,7 @@ void min_flatfly( const Router *r, const Flit *f, int in_channel,
     if(targetr==r->GetID()){ //if we are at the final router, yay, output to client
       out_port = dest % gC;
     } else{ //else select a dimension at random
-      out_port = flatfly_outport(dest, r->GetID());
+      out_port = flatfly_outport(_ctx, dest, r->GetID());
     }
 
   }
@@ -623,7 +624,7 @@ void min_flatfly( const Router *r, const Flit *f, int in_channel,
 
 
 //same as ugal except uses xyyx routing
-void ugal_xyyx_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
+void ugal_xyyx_flatfly_onchip( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel,
 			  OutputSet *outputs, bool inject )
 {
   // ( Traffic Class , Routing Order ) -> Virtual Channel Range
@@ -651,7 +652,7 @@ void ugal_xyyx_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
 
   } else {
 
-    int dest  = flatfly_transformation(f->dest);
+    int dest  = flatfly_transformation(_ctx, f->dest);
 
     int rID =  r->GetID();
     int _concentration = gC;
@@ -694,7 +695,7 @@ void ugal_xyyx_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
     if (dest >= rID*_concentration && dest < (rID+1)*_concentration) {
       if (f->ph == 1) {
 	f->ph = 2;
-	dest = flatfly_transformation(f->dest);
+	dest = flatfly_transformation(_ctx, f->dest);
 	if (debug)   cout << "      done routing to intermediate ";
       }
       else  {
@@ -711,16 +712,16 @@ void ugal_xyyx_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
 
       // randomly select dimension order at first hop
       bool x_then_y = ((in_channel < gC) ?
-		       (RandomInt(1) > 0) : 
+		       (RouteRandom(_ctx, r, f).Int(1) > 0) : 
 		       (f->vc < (vcBegin + xy_available_vcs)));
 
       if (f->ph == 0) {
 	//find the min port and min distance
-	_min_hop = find_distance(flatfly_transformation(f->src),dest);
+	_min_hop = find_distance(_ctx, flatfly_transformation(_ctx, f->src),dest);
 	if(x_then_y){
-	  tmp_out_port =  flatfly_outport(dest, rID);
+	  tmp_out_port =  flatfly_outport(_ctx, dest, rID);
 	} else {
-	  tmp_out_port =  flatfly_outport_yx(dest, rID);
+	  tmp_out_port =  flatfly_outport_yx(_ctx, dest, rID);
 	}
 	if (f->watch){
 	  cout << " MIN tmp_out_port: " << tmp_out_port;
@@ -729,12 +730,12 @@ void ugal_xyyx_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
 	_min_queucnt =   r->GetUsedCredit(tmp_out_port);
 
 	//find the nonmin router, nonmin port, nonmin count
-	_ran_intm = find_ran_intm(flatfly_transformation(f->src), dest);
-	_nonmin_hop = find_distance(flatfly_transformation(f->src),_ran_intm) +    find_distance(_ran_intm, dest);
+	_ran_intm = find_ran_intm(_ctx, RouteRandom(_ctx, r, f), flatfly_transformation(_ctx, f->src), dest);
+	_nonmin_hop = find_distance(_ctx, flatfly_transformation(_ctx, f->src),_ran_intm) +    find_distance(_ctx, _ran_intm, dest);
 	if(x_then_y){
-	  tmp_out_port =  flatfly_outport(_ran_intm, rID);
+	  tmp_out_port =  flatfly_outport(_ctx, _ran_intm, rID);
 	} else {
-	  tmp_out_port =  flatfly_outport_yx(_ran_intm, rID);
+	  tmp_out_port =  flatfly_outport_yx(_ctx, _ran_intm, rID);
 	}
 
 	if (f->watch){
@@ -762,19 +763,19 @@ void ugal_xyyx_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
 	  dest = f->intm;
 	  if (dest >= rID*_concentration && dest < (rID+1)*_concentration) {
 	    f->ph = 2;
-	    dest = flatfly_transformation(f->dest);
+	    dest = flatfly_transformation(_ctx, f->dest);
 	  }
 	}
       }
 
       //dest here should be == intm if ph==1, or dest == dest if ph == 2
       if(x_then_y){
-	out_port =  flatfly_outport(dest, rID);
+	out_port =  flatfly_outport(_ctx, dest, rID);
 	if(out_port >= gC) {
 	  vcEnd -= xy_available_vcs;
 	}
       } else {
-	out_port =  flatfly_outport_yx(dest, rID);
+	out_port =  flatfly_outport_yx(_ctx, dest, rID);
 	if(out_port >= gC) {
 	  vcBegin += xy_available_vcs;
 	}
@@ -822,7 +823,7 @@ void ugal_xyyx_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
 
 
 //ugal now uses modified comparison, modefied getcredit
-void ugal_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
+void ugal_flatfly_onchip( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel,
 			  OutputSet *outputs, bool inject )
 {
   // ( Traffic Class , Routing Order ) -> Virtual Channel Range
@@ -850,7 +851,7 @@ void ugal_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
 
   } else {
 
-    int dest  = flatfly_transformation(f->dest);
+    int dest  = flatfly_transformation(_ctx, f->dest);
 
     int rID =  r->GetID();
     int _concentration = gC;
@@ -894,7 +895,7 @@ void ugal_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
 
       if (f->ph == 1) {
 	f->ph = 2;
-	dest = flatfly_transformation(f->dest);
+	dest = flatfly_transformation(_ctx, f->dest);
 	if (debug)   cout << "      done routing to intermediate ";
       }
       else  {
@@ -907,21 +908,21 @@ void ugal_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
     if (!found) {
 
       if (f->ph == 0) {
-	_min_hop = find_distance(flatfly_transformation(f->src),dest);
-	_ran_intm = find_ran_intm(flatfly_transformation(f->src), dest);
-	tmp_out_port =  flatfly_outport(dest, rID);
+	_min_hop = find_distance(_ctx, flatfly_transformation(_ctx, f->src),dest);
+	_ran_intm = find_ran_intm(_ctx, RouteRandom(_ctx, r, f), flatfly_transformation(_ctx, f->src), dest);
+	tmp_out_port =  flatfly_outport(_ctx, dest, rID);
 	if (f->watch){
-	  *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+	  *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 		     << " MIN tmp_out_port: " << tmp_out_port;
 	}
 
 	_min_queucnt =   r->GetUsedCredit(tmp_out_port);
 
-	_nonmin_hop = find_distance(flatfly_transformation(f->src),_ran_intm) +    find_distance(_ran_intm, dest);
-	tmp_out_port =  flatfly_outport(_ran_intm, rID);
+	_nonmin_hop = find_distance(_ctx, flatfly_transformation(_ctx, f->src),_ran_intm) +    find_distance(_ctx, _ran_intm, dest);
+	tmp_out_port =  flatfly_outport(_ctx, _ran_intm, rID);
 
 	if (f->watch){
-	  *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+	  *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 		     << " NONMIN tmp_out_port: " << tmp_out_port << endl;
 	}
 	if (_ran_intm >= rID*_concentration && _ran_intm < (rID+1)*_concentration) {
@@ -946,13 +947,13 @@ void ugal_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
 	  dest = f->intm;
 	  if (dest >= rID*_concentration && dest < (rID+1)*_concentration) {
 	    f->ph = 2;
-	    dest = flatfly_transformation(f->dest);
+	    dest = flatfly_transformation(_ctx, f->dest);
 	  }
 	}
       }
 
       // find minimal correct dimension to route through
-      out_port =  flatfly_outport(dest, rID);
+      out_port =  flatfly_outport(_ctx, dest, rID);
 
       // if we haven't reached our destination, restrict VCs appropriately to avoid routing deadlock
       if(out_port >= gC) {
@@ -995,7 +996,7 @@ void ugal_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
 
 
 // partially non-interfering (i.e., packets ordered by hash of destination) UGAL
-void ugal_pni_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
+void ugal_pni_flatfly_onchip( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel,
 			      OutputSet *outputs, bool inject )
 {
   // ( Traffic Class , Routing Order ) -> Virtual Channel Range
@@ -1023,7 +1024,7 @@ void ugal_pni_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
 
   } else {
 
-    int dest  = flatfly_transformation(f->dest);
+    int dest  = flatfly_transformation(_ctx, f->dest);
 
     int rID =  r->GetID();
     int _concentration = gC;
@@ -1067,7 +1068,7 @@ void ugal_pni_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
 
       if (f->ph == 1) {
 	f->ph = 2;
-	dest = flatfly_transformation(f->dest);
+	dest = flatfly_transformation(_ctx, f->dest);
 	if (debug)   cout << "      done routing to intermediate ";
       }
       else  {
@@ -1080,21 +1081,21 @@ void ugal_pni_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
     if (!found) {
 
       if (f->ph == 0) {
-	_min_hop = find_distance(flatfly_transformation(f->src),dest);
-	_ran_intm = find_ran_intm(flatfly_transformation(f->src), dest);
-	tmp_out_port =  flatfly_outport(dest, rID);
+	_min_hop = find_distance(_ctx, flatfly_transformation(_ctx, f->src),dest);
+	_ran_intm = find_ran_intm(_ctx, RouteRandom(_ctx, r, f), flatfly_transformation(_ctx, f->src), dest);
+	tmp_out_port =  flatfly_outport(_ctx, dest, rID);
 	if (f->watch){
-	  *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+	  *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 		     << " MIN tmp_out_port: " << tmp_out_port;
 	}
 
 	_min_queucnt =   r->GetUsedCredit(tmp_out_port);
 
-	_nonmin_hop = find_distance(flatfly_transformation(f->src),_ran_intm) +    find_distance(_ran_intm, dest);
-	tmp_out_port =  flatfly_outport(_ran_intm, rID);
+	_nonmin_hop = find_distance(_ctx, flatfly_transformation(_ctx, f->src),_ran_intm) +    find_distance(_ctx, _ran_intm, dest);
+	tmp_out_port =  flatfly_outport(_ctx, _ran_intm, rID);
 
 	if (f->watch){
-	  *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+	  *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 		     << " NONMIN tmp_out_port: " << tmp_out_port << endl;
 	}
 	if (_ran_intm >= rID*_concentration && _ran_intm < (rID+1)*_concentration) {
@@ -1119,13 +1120,13 @@ void ugal_pni_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
 	  dest = f->intm;
 	  if (dest >= rID*_concentration && dest < (rID+1)*_concentration) {
 	    f->ph = 2;
-	    dest = flatfly_transformation(f->dest);
+	    dest = flatfly_transformation(_ctx, f->dest);
 	  }
 	}
       }
 
       // find minimal correct dimension to route through
-      out_port =  flatfly_outport(dest, rID);
+      out_port =  flatfly_outport(_ctx, dest, rID);
 
       // if we haven't reached our destination, restrict VCs appropriately to avoid routing deadlock
       if(out_port >= gC) {
@@ -1169,7 +1170,7 @@ void ugal_pni_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
 
     assert(inject ? (f->ph == -1) : (f->ph == 1 || f->ph == 2));
 
-    int next_coord = flatfly_transformation(f->dest);
+    int next_coord = flatfly_transformation(_ctx, f->dest);
     if(inject) {
       next_coord /= gC;
       next_coord %= gK;
@@ -1201,7 +1202,7 @@ void ugal_pni_flatfly_onchip( const Router *r, const Flit *f, int in_channel,
 //=============================================================^M
 // UGAL : calculate distance (hop cnt)  between src and destination
 //=============================================================^M
-int find_distance (int src, int dest) {
+int find_distance (BookSimContext * _ctx, int src, int dest) {
   int dist = 0;
   int _dim   = gN;
   
@@ -1229,7 +1230,7 @@ int find_distance (int src, int dest) {
 //=============================================================^M
 // UGAL : find random node for load balancing
 //=============================================================^M
-int find_ran_intm (int src, int dest) {
+int find_ran_intm (BookSimContext * _ctx, RandomStream & rng, int src, int dest) {
   int _dim   = gN;
   int _dim_size;
   int _ran_dest = 0;
@@ -1241,7 +1242,7 @@ int find_ran_intm (int src, int dest) {
   src = (int) (src / gC);
   dest = (int) (dest / gC);
   
-  _ran_dest = RandomInt(gC - 1);
+  _ran_dest = rng.Int(gC - 1);
   if (debug) cout << " ............ _ran_dest : " << _ran_dest << endl;
   for (int d=0;d < _dim; d++) {
     
@@ -1253,7 +1254,7 @@ int find_ran_intm (int src, int dest) {
     } else {
       // src and dest are in the same dimension "d" + 1
       // ==> thus generate a random destination within
-      _ran_dest += RandomInt(gK - 1) * _dim_size;
+      _ran_dest += rng.Int(gK - 1) * _dim_size;
       if (debug) 
 	cout << "    different  dimension : " << d << " int node : " << _ran_dest << " _dim_size: " << _dim_size << endl;
     }
@@ -1272,7 +1273,7 @@ int find_ran_intm (int src, int dest) {
 // given the dimension and destination
 //=============================================================
 // starting from DIM 0 (x first)
-int flatfly_outport(int dest, int rID) {
+int flatfly_outport(BookSimContext * _ctx, int dest, int rID) {
   int dest_rID = (int) (dest / gC);
   int _dim   = gN;
   int output = -1, dID, sID;
@@ -1306,7 +1307,7 @@ int flatfly_outport(int dest, int rID) {
   return -1;
 }
 
-int flatfly_transformation(int dest){
+int flatfly_transformation(BookSimContext * _ctx, int dest){
   //the magic of destination transformation
 
   //destination transformation, translate how the nodes are actually arranged
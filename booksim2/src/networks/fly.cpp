@@ -34,8 +34,8 @@
 
 //#define DEBUG_FLY
 
-KNFly::KNFly( const Configuration &config, const string & name ) :
-Network( config, name )
+KNFly::KNFly( BookSimContext * ctx, const Configuration &config, const string & name ) :
+Network( ctx, config, name )
 {
   _ComputeSize( config );
   _Alloc( );
@@ -42,11 +42,11 @@ class KNFly : public Network {
   int _InChannel( int stage, int addr, int port ) const;
  
 public:
-  KNFly( const Configuration &config, const string & name );
+  KNFly( BookSimContext * ctx, const Configuration &config, const string & name );
 
   int GetN( ) const;
   int GetK( ) const;
-  static void RegisterRoutingFunctions(){};
+  static void RegisterRoutingFunctions( BookSimContext * _ctx ) {};
   double Capacity( ) const;
 };
 
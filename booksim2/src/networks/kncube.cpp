@@ -43,8 +43,8 @@
  //#include "iq_router.hpp"
 
 
-KNCube::KNCube( const Configuration &config, const string & name, bool mesh ) :
-Network( config, name )
+KNCube::KNCube( BookSimContext * ctx, const Configuration &config, const string & name, bool mesh ) :
+Network( ctx, config, name )
 {
   _mesh = mesh;
 
@@ -74,7 +74,7 @@ void KNCube::_ComputeSize( const Configuration &config )
   _nodes = _size;
 }
 
-void KNCube::RegisterRoutingFunctions() {
+void KNCube::RegisterRoutingFunctions( BookSimContext * _ctx ) {
 
 }
 void KNCube::_BuildNet( const Configuration &config )
@@ -49,8 +49,8 @@ class KNCube : public Network {
   int _RightNode( int node, int dim );
 
 public:
-  KNCube( const Configuration &config, const string & name, bool mesh );
-  static void RegisterRoutingFunctions();
+  KNCube( BookSimContext * ctx, const Configuration &config, const string & name, bool mesh );
+  static void RegisterRoutingFunctions( BookSimContext * _ctx );
 
   int GetN( ) const;
   int GetK( ) const;
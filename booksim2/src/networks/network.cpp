@@ -49,8 +49,8 @@
 #include "dragonfly.hpp"
 
 
-Network::Network( const Configuration &config, const string & name ) :
-  TimedModule( 0, name )
+Network::Network( BookSimContext * ctx, const Configuration &config, const string & name ) :
+  TimedModule( 0, name, ctx ), _calendar( 0 )
 {
   _size     = -1; 
   _nodes    = -1; 
@@ -60,6 +60,7 @@ Network::Network( const Configuration &config, const string & name ) :
 
 Network::~Network( )
 {
+  delete _calendar;
   for ( int r = 0; r < _size; ++r ) {
     if ( _routers[r] ) delete _routers[r];
   }
@@ -77,40 +78,40 @@ Network::~Network( )
   }
 }
 
-Network * Network::New(const Configuration & config, const string & name)
+Network * Network::New( BookSimContext * ctx, const Configuration &config, const string & name)
 {
   const string topo = config.GetStr( "topology" );
   Network * n = NULL;
   if ( topo == "torus" ) {
-    KNCube::RegisterRoutingFunctions() ;
-    n = new KNCube( config, name, false );
+    KNCube::RegisterRoutingFunctions( ctx ) ;
+    n = new KNCube( ctx, config, name, false );
   } else if ( topo == "mesh" ) {
-    KNCube::RegisterRoutingFunctions() ;
-    n = new KNCube( config, name, true );
+    KNCube::RegisterRoutingFunctions( ctx ) ;
+    n = new KNCube( ctx, config, name, true );
   } else if ( topo == "cmesh" ) {
-    CMesh::RegisterRoutingFunctions() ;
-    n = new CMesh( config, name );
+    CMesh::RegisterRoutingFunctions( ctx ) ;
+    n = new CMesh( ctx, config, name );
   } else if ( topo == "fly" ) {
-    KNFly::RegisterRoutingFunctions() ;
-    n = new KNFly( config, name );
+    KNFly::RegisterRoutingFunctions( ctx ) ;
+    n = new KNFly( ctx, config, name );
   } else if ( topo == "qtree" ) {
-    QTree::RegisterRoutingFunctions() ;
-    n = new QTree( config, name );
+    QTree::RegisterRoutingFunctions( ctx ) ;
+    n = new QTree( ctx, config, name );
   } else if ( topo == "tree4" ) {
-    Tree4::RegisterRoutingFunctions() ;
-    n = new Tree4( config, name );
+    Tree4::RegisterRoutingFunctions( ctx ) ;
+    n = new Tree4( ctx, config, name );
   } else if ( topo == "fattree" ) {
-    FatTree::RegisterRoutingFunctions() ;
-    n = new FatTree( config, name );
+    FatTree::RegisterRoutingFunctions( ctx ) ;
+    n = new FatTree( ctx, config, name );
   } else if ( topo == "flatfly" ) {
-    FlatFlyOnChip::RegisterRoutingFunctions() ;
-    n = new FlatFlyOnChip( config, name );
+    FlatFlyOnChip::RegisterRoutingFunctions( ctx ) ;
+    n = new FlatFlyOnChip( ctx, config, name );
   } else if ( topo == "anynet"){
-    AnyNet::RegisterRoutingFunctions() ;
-    n = new AnyNet(config, name);
+    AnyNet::RegisterRoutingFunctions( ctx ) ;
+    n = new AnyNet( ctx, config, name);
   } else if ( topo == "dragonflynew"){
-    DragonFlyNew::RegisterRoutingFunctions() ;
-    n = new DragonFlyNew(config, name);
+    DragonFlyNew::RegisterRoutingFunctions( ctx ) ;
+    n = new DragonFlyNew( ctx, config, name);
   } else {
     cerr << "Unknown topology: " << topo << endl;
   }
@@ -123,6 +124,10 @@ Network * Network::New(const Configuration & config, const string & name)
   if ( n && ( config.GetInt( "link_failures" ) > 0 ) ) {
     n->InsertRandomFaults( config );
   }
+
+  if ( n && ( config.GetInt( "noc_calendar" ) > 0 ) ) {
+    n->EnableCalendar( );
+  }
   return n;
 }
 
@@ -181,8 +186,23 @@ void Network::_Alloc( )
   }
 }
 
+void Network::EnableCalendar( )
+{
+  assert( !_calendar );
+  _calendar = new ActivityCalendar;
+  for(deque<TimedModule *>::const_iterator iter = _timed_modules.begin();
+      iter != _timed_modules.end();
+      ++iter) {
+    _calendar->Add( *iter );
+  }
+}
+
 void Network::ReadInputs( )
 {
+  if ( _calendar ) {
+    _calendar->ReadInputs( );
+    return;
+  }
   for(deque<TimedModule *>::const_iterator iter = _timed_modules.begin();
       iter != _timed_modules.end();
       ++iter) {
@@ -192,6 +212,10 @@ void Network::ReadInputs( )
 
 void Network::Evaluate( )
 {
+  if ( _calendar ) {
+    _calendar->Evaluate( );
+    return;
+  }
   for(deque<TimedModule *>::const_iterator iter = _timed_modules.begin();
       iter != _timed_modules.end();
       ++iter) {
@@ -201,6 +225,10 @@ void Network::Evaluate( )
 
 void Network::WriteOutputs( )
 {
+  if ( _calendar ) {
+    _calendar->WriteOutputs( );
+    return;
+  }
   for(deque<TimedModule *>::const_iterator iter = _timed_modules.begin();
       iter != _timed_modules.end();
       ++iter) {
@@ -66,6 +66,7 @@ protected:
   vector<CreditChannel *> _chan_cred;
 
   deque<TimedModule *> _timed_modules;
+  ActivityCalendar * _calendar; // if set, only modules with pending work are stepped
 
   vector<int> endpointRouters; // routers that can only be used as destinations, and not as intermediate hops (unless its a hop to another endpoint router)
 
@@ -76,10 +77,10 @@ protected:
 
   std::vector<int>* outstandingFlits; // counter indicating the outstanding flits in each router
 public:
-  Network( const Configuration &config, const string & name );
+  Network( BookSimContext * ctx, const Configuration &config, const string & name );
   virtual ~Network( );
 
-  static Network *New( const Configuration &config, const string & name );
+  static Network *New( BookSimContext * ctx, const Configuration &config, const string & name );
 
   virtual void WriteFlit( Flit *f, int source );
   virtual Flit *ReadFlit( int dest );
@@ -116,6 +117,8 @@ public:
   const vector<Router *> & GetRouters(){return _routers;}
   Router * GetRouter(int index) {return _routers[index];}
   int NumRouters() const {return _size;}
+  void EnableCalendar( );
+  size_t NumScheduledModules() const {return _calendar ? _calendar->NumScheduled() : _timed_modules.size();}
   void setOutstandingFlits(std::vector<int> *outstandingFlits);
   void ReadInterChipletLinks( const Configuration &config );
 #ifdef EXTRA_STATS
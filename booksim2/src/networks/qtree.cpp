@@ -45,8 +45,8 @@
 #include "qtree.hpp"
 #include "misc_utils.hpp"
 
-QTree::QTree( const Configuration& config, const string & name )
-: Network ( config, name )
+QTree::QTree( BookSimContext * ctx, const Configuration &config, const string & name )
+: Network ( ctx, config, name )
 {
   _ComputeSize( config );
   _Alloc( );
@@ -76,7 +76,7 @@ void QTree::_ComputeSize( const Configuration& config )
 
 }
 
-void QTree::RegisterRoutingFunctions(){
+void QTree::RegisterRoutingFunctions( BookSimContext * _ctx ) {
 
 }
 
@@ -58,8 +58,8 @@ class QTree : public Network {
 
 public:
 
-  QTree( const Configuration& config, const string & name );
-  static void RegisterRoutingFunctions() ;
+  QTree( BookSimContext * ctx, const Configuration &config, const string & name );
+  static void RegisterRoutingFunctions( BookSimContext * _ctx );
 
   static int HeightFromID( int id );
   static int PosFromID( int id );
@@ -52,8 +52,8 @@
 #include "tree4.hpp"
 #include "misc_utils.hpp"
 
-Tree4::Tree4( const Configuration& config, const string & name )
-: Network ( config, name )
+Tree4::Tree4( BookSimContext * ctx, const Configuration &config, const string & name )
+: Network ( ctx, config, name )
 {
   _ComputeSize( config );
   _Alloc( );
@@ -82,7 +82,7 @@ void Tree4::_ComputeSize( const Configuration& config )
     * ( 2 * _k );                // Connectivity of Middle Routers
 }
 
-void Tree4::RegisterRoutingFunctions(){
+void Tree4::RegisterRoutingFunctions( BookSimContext * _ctx ) {
 
 }
 
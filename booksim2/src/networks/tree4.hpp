@@ -61,8 +61,8 @@ class Tree4 : public Network {
 
 public:
 
-  Tree4( const Configuration& config, const string & name );
-  static void RegisterRoutingFunctions() ;
+  Tree4( BookSimContext * ctx, const Configuration &config, const string & name );
+  static void RegisterRoutingFunctions( BookSimContext * _ctx );
   
   static int HeightFromID( int id );
   static int PosFromID( int id );
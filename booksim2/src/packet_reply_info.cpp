@@ -27,31 +27,30 @@
 
 #include "packet_reply_info.hpp"
 
-stack<PacketReplyInfo*> PacketReplyInfo::_all;
-stack<PacketReplyInfo*> PacketReplyInfo::_free;
 
-PacketReplyInfo * PacketReplyInfo::New()
+PacketReplyInfo * PacketReplyInfo::New( BookSimContext * ctx )
 {
   PacketReplyInfo * pr;
-  if(_free.empty()) {
+  if(ctx->free_replies.empty()) {
     pr = new PacketReplyInfo();
-    _all.push(pr);
+    ctx->all_replies.push(pr);
   } else {
-    pr = _free.top();
-    _free.pop();
+    pr = ctx->free_replies.top();
+    ctx->free_replies.pop();
   }
   return pr;
 }
 
-void PacketReplyInfo::Free()
+void PacketReplyInfo::Free( BookSimContext * ctx )
 {
-  _free.push(this);
+  ctx->free_replies.push(this);
 }
 
-void PacketReplyInfo::FreeAll()
+void PacketReplyInfo::FreeAll( BookSimContext * ctx )
 {
-  while(!_all.empty()) {
-    delete _all.top();
-    _all.pop();
+  while(!ctx->all_replies.empty()) {
+    delete ctx->all_replies.top();
+    ctx->all_replies.pop();
   }
+  ctx->free_replies = stack<PacketReplyInfo*>();
 }
@@ -41,15 +41,13 @@ public:
   bool record;
   Flit::FlitType type;
 
-  static PacketReplyInfo* New();
-  void Free();
-  static void FreeAll();
+  static PacketReplyInfo* New( BookSimContext * ctx );
+  void Free( BookSimContext * ctx );
+  static void FreeAll( BookSimContext * ctx );
 
 private:
 
-  static stack<PacketReplyInfo*> _all;
-  static stack<PacketReplyInfo*> _free;
-
+  // pooled in the BookSimContext of the interconnect that allocated them
   PacketReplyInfo() {}
   ~PacketReplyInfo() {}
 };
@@ -32,7 +32,7 @@
 #include "iq_router.hpp"
 
 Power_Module::Power_Module(Network * n , const Configuration &config)
-  : Module( 0, "power_module" ){
+  : Module( 0, "power_module", n->GetContext( ) ){
 
   
   string pfile = config.GetStr("tech_file");
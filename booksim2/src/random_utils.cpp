@@ -26,6 +26,7 @@
 */
 
 #include "random_utils.hpp"
+#include "globals.hpp"
 #include <algorithm>
 #include <cassert>
 
@@ -44,3 +45,83 @@ void RestoreRandomState( std::vector<long> const & save_x, std::vector<double> c
   assert(save_u.size() == KK);
   std::copy(save_u.begin(), save_u.end(), ran_u);
 }
+
+// Set per interconnect; with streams disabled, draws come from the
+// process-wide generator above and depend on every network in the process
+#define gRandomStreams (_ctx->random_streams)
+#define gRandomStreamSeed (_ctx->random_stream_seed)
+
+void RandomStreamsInit( BookSimContext * _ctx, long seed, bool enable ) {
+  gRandomStreams = enable;
+  gRandomStreamSeed = seed;
+}
+
+// 64-bit FNV-1a
+static unsigned long long HashOwner( std::string const & owner ) {
+  unsigned long long h = 0xcbf29ce484222325ULL;
+  for(size_t i = 0; i < owner.size(); ++i) {
+    h = (h ^ (unsigned char)owner[i]) * 0x100000001b3ULL;
+  }
+  return h;
+}
+
+// Philox4x32 with 10 rounds (Salmon et al., SC'11)
+static void Philox4x32( unsigned ctr[4], unsigned key[2] ) {
+  unsigned k0 = key[0], k1 = key[1];
+  for(int r = 0; r < 10; ++r) {
+    unsigned long long p0 = 0xD2511F53ULL * ctr[0];
+    unsigned long long p1 = 0xCD9E8D57ULL * ctr[2];
+    unsigned c0 = (unsigned)(p1 >> 32) ^ ctr[1] ^ k0;
+    unsigned c2 = (unsigned)(p0 >> 32) ^ ctr[3] ^ k1;
+    ctr[1] = (unsigned)p1;
+    ctr[3] = (unsigned)p0;
+    ctr[0] = c0;
+    ctr[2] = c2;
+    k0 += 0x9E3779B9;
+    k1 += 0xBB67AE85;
+  }
+}
+
+RandomStream::RandomStream( BookSimContext const * ctx, std::string const & owner, int purpose )
+  : _ctx(ctx), _purpose(purpose), _cycle(-1), _block(0), _avail(0)
+{
+  unsigned long long h = HashOwner(owner);
+  _key[0] = (unsigned)h;
+  _key[1] = (unsigned)(h >> 32);
+}
+
+unsigned RandomStream::_Next( ) {
+  long long const cycle = GetSimTime(_ctx);
+  if(cycle != _cycle) {
+    _cycle = cycle;
+    _block = 0;
+    _avail = 0;
+  }
+  if(_avail == 0) {
+    unsigned key[2] = { _key[0] ^ (unsigned)gRandomStreamSeed,
+                        _key[1] ^ (unsigned)(gRandomStreamSeed >> 32) };
+    _out[0] = (unsigned)cycle;
+    _out[1] = (unsigned)((unsigned long long)cycle >> 32);
+    _out[2] = _block++;
+    _out[3] = _purpose;
+    Philox4x32(_out, key);
+    _avail = 4;
+  }
+  return _out[--_avail];
+}
+
+unsigned long RandomStream::IntLong( ) {
+  return gRandomStreams ? _Next() : RandomIntLong();
+}
+
+int RandomStream::Int( int max ) {
+  return gRandomStreams ? (int)(_Next() % (unsigned)(max+1)) : RandomInt(max);
+}
+
+double RandomStream::Float( ) {
+  if(!gRandomStreams) {
+    return RandomFloat();
+  }
+  unsigned long long bits = ((unsigned long long)_Next() << 32) | _Next();
+  return (bits >> 11) * (1.0 / 9007199254740992.0);
+}
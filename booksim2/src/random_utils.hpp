@@ -28,6 +28,7 @@
 #ifndef _RANDOM_UTILS_HPP_
 #define _RANDOM_UTILS_HPP_
 
+#include <string>
 #include <vector>
 
 // interface to Knuth's RANARRAY RNG
@@ -66,4 +67,42 @@ void SaveRandomState( std::vector<long> & save_x, std::vector<double> & save_u )
 // Restores the generator state from previously saved values
 void RestoreRandomState( std::vector<long> const & save_x, std::vector<double> const & save_u );
 
+// Per-module random streams. Each stream is a counter-based generator
+// (Philox4x32-10) keyed by (seed, owner, purpose) whose counter is
+// (cycle, draws so far this cycle), so the values a module sees do not
+// depend on the order in which modules are evaluated, or on which thread
+// evaluates them. Owners are named by a string that is stable across runs
+// (e.g., the module's FullName()).
+//
+// Streams are disabled by default (random_streams = 0); then every stream
+// draws from the global generator above, which reproduces earlier results.
+enum RandomPurpose { RandomRoute, RandomAlloc, RandomInject, RandomTraffic, RandomSubnet, RandomSample };
+
+class BookSimContext;
+
+void RandomStreamsInit( BookSimContext * ctx, long seed, bool enable );
+
+class RandomStream {
+private:
+  BookSimContext const * _ctx; // interconnect whose clock and seed drive the stream
+  unsigned _key[2];
+  unsigned _purpose;
+  long long _cycle;    // cycle of the last draw
+  unsigned _block;     // Philox blocks generated in _cycle
+  unsigned _out[4];
+  int _avail;          // unused words in _out
+
+  unsigned _Next( );
+
+public:
+  RandomStream( BookSimContext const * ctx = 0, const std::string & owner = "", int purpose = 0 );
+
+  unsigned long IntLong( );
+  // Returns a random integer in the range [0,max]
+  int Int( int max );
+  // Returns a random floating-point value in the range [0,1)
+  double Float( );
+  double Float( double max ) { return Float( ) * max; }
+};
+
 #endif
@@ -39,6 +39,7 @@
 #include <map>
 #include <cstdlib>
 #include <cassert>
+#include <sstream>
 
 #include "booksim.hpp"
 #include "routefunc.hpp"
@@ -52,27 +53,93 @@
 
 
 
-map<string, tRoutingFunction> gRoutingFunctionMap;
-
-/* Global information used by routing functions */
-
-int gNumVCs;
-
 /* Add more functions here
  *
  */
 
+// Per-interconnect state used by the routing functions lives in
+// BookSimContext; these name the tables kept there
+#define gInjectRandom (_ctx->inject_random)
+#define gRouteTableNodes (_ctx->route_table_nodes)
+#define gRouteTableK (_ctx->route_table_k)
+#define gRouteTableN (_ctx->route_table_n)
+#define gRouteTablesOk (_ctx->route_tables_ok)
+#define gNodeCoords (_ctx->node_coords)     // [node*gN+dim] -> coordinate
+#define gDorMeshPort (_ctx->dor_mesh_port)  // [cur*gNodes+dest] -> output port
+#define gDorTorusHop (_ctx->dor_torus_hop)  // [cur*gNodes+dest] -> see dor_next_torus
+
+RandomStream & RouteRandom( BookSimContext * _ctx, const Router *r, const Flit *f )
+{
+  if ( r ) {
+    return r->GetRandom( );
+  }
+  if ( gInjectRandom.empty( ) ) {
+    for ( int n = 0; n < gNodes; ++n ) {
+      ostringstream name;
+      name << "node_" << n;
+      gInjectRandom.push_back( RandomStream( _ctx, name.str( ), RandomRoute ) );
+    }
+  }
+  assert( ( f->src >= 0 ) && ( f->src < gNodes ) );
+  return gInjectRandom[f->src];
+}
+
 // ============================================================
-//  Balfour-Schultz
-int gReadReqBeginVC, gReadReqEndVC;
-int gWriteReqBeginVC, gWriteReqEndVC;
-int gReadReplyBeginVC, gReadReplyEndVC;
-int gWriteReplyBeginVC, gWriteReplyEndVC;
+//  Route tables for k-ary n-cubes: DOR only depends on the (router,
+//  destination) pair, so instead of decomposing node IDs with divisions
+//  by gK on every head flit, the result is looked up in tables built the
+//  first time a mesh/torus routing function needs them
+// ===
+
+// tables take gNodes^2 bytes, larger networks compute routes as before
+static const int gMaxRouteTableNodes = 4096;
+
+static void _ResetRouteTables( BookSimContext * _ctx )
+{
+  gRouteTableNodes = gNodes;
+  gRouteTableK = gK;
+  gRouteTableN = gN;
+  gRouteTablesOk = ( gNodes > 0 ) && ( gNodes <= gMaxRouteTableNodes ) &&
+    ( gN < 32 ) && ( gNodes == powi( gK, gN ) );
+  gDorMeshPort.clear( );
+  gDorTorusHop.clear( );
+  gNodeCoords.clear( );
+  if ( gRouteTablesOk ) {
+    gNodeCoords.resize( gNodes * gN );
+    for ( int node = 0; node < gNodes; ++node ) {
+      int rest = node;
+      for ( int dim = 0; dim < gN; ++dim ) {
+	gNodeCoords[node*gN+dim] = rest % gK;
+	rest /= gK;
+      }
+    }
+  }
+}
+
+static inline bool RouteTablesReady( BookSimContext * _ctx )
+{
+  if ( ( gRouteTableNodes != gNodes ) || ( gRouteTableK != gK ) || ( gRouteTableN != gN ) ) {
+    _ResetRouteTables( _ctx );
+  }
+  return gRouteTablesOk;
+}
+
+// Coordinate of node in dimension dim
+static inline int node_coord( BookSimContext * _ctx, int node, int dim )
+{
+  if ( RouteTablesReady( _ctx ) ) {
+    return gNodeCoords[node*gN+dim];
+  }
+  for ( ; dim > 0; --dim ) {
+    node /= gK;
+  }
+  return node % gK;
+}
 
 // ============================================================
 //  QTree: Nearest Common Ancestor
 // ===
-void qtree_nca( const Router *r, const Flit *f,
+void qtree_nca( BookSimContext * _ctx, const Router *r, const Flit *f,
 		int in_channel, OutputSet* outputs, bool inject)
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
@@ -123,7 +190,7 @@ void qtree_nca( const Router *r, const Flit *f,
 // ============================================================
 //  Tree4: Nearest Common Ancestor w/ Adaptive Routing Up
 // ===
-void tree4_anca( const Router *r, const Flit *f,
+void tree4_anca( BookSimContext * _ctx, const Router *r, const Flit *f,
 		 int in_channel, OutputSet* outputs, bool inject)
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
@@ -161,7 +228,7 @@ void tree4_anca( const Router *r, const Flit *f,
     
     if ( rH == 0 ) {
       dest /= 16;
-      out_port = 2 * dest + RandomInt(1);
+      out_port = 2 * dest + RouteRandom( _ctx, r, f ).Int(1);
     } else if ( rH == 1 ) {
       dest /= 4;
       if ( dest / 4 == rP / 2 )
@@ -193,7 +260,7 @@ void tree4_anca( const Router *r, const Flit *f,
 // ============================================================
 //  Tree4: Nearest Common Ancestor w/ Random Routing Up
 // ===
-void tree4_nca( const Router *r, const Flit *f,
+void tree4_nca( BookSimContext * _ctx, const Router *r, const Flit *f,
 		int in_channel, OutputSet* outputs, bool inject)
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
@@ -229,18 +296,18 @@ void tree4_nca( const Router *r, const Flit *f,
     
     if ( rH == 0 ) {
       dest /= 16;
-      out_port = 2 * dest + RandomInt(1);
+      out_port = 2 * dest + RouteRandom( _ctx, r, f ).Int(1);
     } else if ( rH == 1 ) {
       dest /= 4;
       if ( dest / 4 == rP / 2 )
 	out_port = dest % 4;
       else
-	out_port = gK + RandomInt(gK-1);
+	out_port = gK + RouteRandom( _ctx, r, f ).Int(gK-1);
     } else {
       if ( dest/4 == rP )
 	out_port = dest % 4;
       else
-	out_port = gK + RandomInt(1);
+	out_port = gK + RouteRandom( _ctx, r, f ).Int(1);
     }
     
     //  cout << "Router("<<rH<<","<<rP<<"): id= " << f->id << " dest= " << f->dest << " out_port = "
@@ -256,7 +323,7 @@ void tree4_nca( const Router *r, const Flit *f,
 // ============================================================
 //  FATTREE: Nearest Common Ancestor w/ Random  Routing Up
 // ===
-void fattree_nca( const Router *r, const Flit *f,
+void fattree_nca( BookSimContext * _ctx, const Router *r, const Flit *f,
                int in_channel, OutputSet* outputs, bool inject)
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
@@ -309,7 +376,7 @@ void fattree_nca( const Router *r, const Flit *f,
     } else {
       //up ports are numbered last
       assert(in_channel<gK);//came from a up channel
-      out_port = gK+RandomInt(gK-1);
+      out_port = gK+RouteRandom( _ctx, r, f ).Int(gK-1);
     }
   }  
   outputs->Clear( );
@@ -320,7 +387,7 @@ void fattree_nca( const Router *r, const Flit *f,
 // ============================================================
 //  FATTREE: Nearest Common Ancestor w/ Adaptive Routing Up
 // ===
-void fattree_anca( const Router *r, const Flit *f,
+void fattree_anca( BookSimContext * _ctx, const Router *r, const Flit *f,
                 int in_channel, OutputSet* outputs, bool inject)
 {
 
@@ -377,8 +444,8 @@ void fattree_anca( const Router *r, const Flit *f,
       //up ports are numbered last
       assert(in_channel<gK);//came from a up channel
       out_port = gK;
-      int random1 = RandomInt(gK-1); // Chose two ports out of the possible at random, compare loads, choose one.
-      int random2 = RandomInt(gK-1);
+      int random1 = RouteRandom( _ctx, r, f ).Int(gK-1); // Chose two ports out of the possible at random, compare loads, choose one.
+      int random2 = RouteRandom( _ctx, r, f ).Int(gK-1);
       if (r->GetUsedCredit(out_port + random1) > r->GetUsedCredit(out_port + random2)){
 	out_port = out_port + random2;
       }else{
@@ -399,9 +466,9 @@ void fattree_anca( const Router *r, const Flit *f,
 //         pick xy or yx min routing adaptively at the source router
 // ===
 
-int dor_next_mesh( int cur, int dest, bool descending = false );
+int dor_next_mesh( BookSimContext * _ctx, int cur, int dest, bool descending = false );
 
-void adaptive_xy_yx_mesh( const Router *r, const Flit *f, 
+void adaptive_xy_yx_mesh( BookSimContext * _ctx, const Router *r, const Flit *f, 
 		 int in_channel, OutputSet *outputs, bool inject )
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
@@ -437,8 +504,8 @@ void adaptive_xy_yx_mesh( const Router *r, const Flit *f,
     int const available_vcs = (vcEnd - vcBegin + 1) / 2;
     assert(available_vcs > 0);
     
-    int out_port_xy = dor_next_mesh( r->GetID(), f->dest, false );
-    int out_port_yx = dor_next_mesh( r->GetID(), f->dest, true );
+    int out_port_xy = dor_next_mesh( _ctx, r->GetID(), f->dest, false );
+    int out_port_yx = dor_next_mesh( _ctx, r->GetID(), f->dest, true );
 
     // Route order (XY or YX) determined when packet is injected
     //  into the network, adaptively
@@ -453,7 +520,7 @@ void adaptive_xy_yx_mesh( const Router *r, const Flit *f,
       } else if(credit_xy < credit_yx) {
 	x_then_y = true;
       } else {
-	x_then_y = (RandomInt(1) > 0);
+	x_then_y = (RouteRandom( _ctx, r, f ).Int(1) > 0);
       }
     }
     
@@ -473,7 +540,7 @@ void adaptive_xy_yx_mesh( const Router *r, const Flit *f,
   
 }
 
-void xy_yx_mesh( const Router *r, const Flit *f, 
+void xy_yx_mesh( BookSimContext * _ctx, const Router *r, const Flit *f, 
 		 int in_channel, OutputSet *outputs, bool inject )
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
@@ -513,13 +580,13 @@ void xy_yx_mesh( const Router *r, const Flit *f,
     //  into the network
     bool x_then_y = ((in_channel < 2*gN) ?
 		     (f->vc < (vcBegin + available_vcs)) :
-		     (RandomInt(1) > 0));
+		     (RouteRandom( _ctx, r, f ).Int(1) > 0));
 
     if(x_then_y) {
-      out_port = dor_next_mesh( r->GetID(), f->dest, false );
+      out_port = dor_next_mesh( _ctx, r->GetID(), f->dest, false );
       vcEnd -= available_vcs;
     } else {
-      out_port = dor_next_mesh( r->GetID(), f->dest, true );
+      out_port = dor_next_mesh( _ctx, r->GetID(), f->dest, true );
       vcBegin += available_vcs;
     }
 
@@ -537,7 +604,7 @@ void xy_yx_mesh( const Router *r, const Flit *f,
 
 //=============================================================
 
-int dor_next_mesh( int cur, int dest, bool descending )
+static int _dor_next_mesh( BookSimContext * _ctx, int cur, int dest, bool descending )
 {
   if ( cur == dest ) {
     return 2*gN;  // Eject
@@ -568,9 +635,50 @@ int dor_next_mesh( int cur, int dest, bool descending )
   }
 }
 
+int dor_next_mesh( BookSimContext * _ctx, int cur, int dest, bool descending )
+{
+  if ( descending || !RouteTablesReady( _ctx ) ) {
+    return _dor_next_mesh( _ctx, cur, dest, descending );
+  }
+  if ( gDorMeshPort.empty( ) ) {
+    gDorMeshPort.resize( gNodes * gNodes );
+    for ( int c = 0; c < gNodes; ++c ) {
+      for ( int d = 0; d < gNodes; ++d ) {
+	gDorMeshPort[c*gNodes+d] = _dor_next_mesh( _ctx, c, d, false );
+      }
+    }
+  }
+  return gDorMeshPort[cur*gNodes+dest];
+}
+
 //=============================================================
 
-void dor_next_torus( int cur, int dest, int in_port,
+// Torus table entries: bits 0-4 hold the first dimension left to correct
+// (gN to eject), bits 5-6 which direction is shorter in it (0: right,
+// 1: tie, 2: left) and bit 7 whether the route crosses the 0/k-1 dateline
+static void _BuildDorTorusTable( BookSimContext * _ctx )
+{
+  gDorTorusHop.resize( gNodes * gNodes );
+  for ( int c = 0; c < gNodes; ++c ) {
+    for ( int d = 0; d < gNodes; ++d ) {
+      int dim_left = 0;
+      while ( ( dim_left < gN ) && ( node_coord( _ctx, c, dim_left ) == node_coord( _ctx, d, dim_left ) ) ) {
+	++dim_left;
+      }
+      unsigned char hop = dim_left;
+      if ( dim_left < gN ) {
+	int const cc = node_coord( _ctx, c, dim_left );
+	int const dc = node_coord( _ctx, d, dim_left );
+	int const dist2 = gK - 2 * ( ( dc - cc + gK ) % gK );
+	hop |= ( ( dist2 > 0 ) ? 0 : ( ( dist2 == 0 ) ? 1 : 2 ) ) << 5;
+	hop |= ( cc > dc ) << 7;
+      }
+      gDorTorusHop[c*gNodes+d] = hop;
+    }
+  }
+}
+
+void dor_next_torus( BookSimContext * _ctx, RandomStream & rng, int cur, int dest, int in_port,
 		     int *out_port, int *partition,
 		     bool balance = false )
 {
@@ -578,6 +686,29 @@ void dor_next_torus( int cur, int dest, int in_port,
   int dir;
   int dist2;
 
+  if ( !balance && RouteTablesReady( _ctx ) ) {
+    if ( gDorTorusHop.empty( ) ) {
+      _BuildDorTorusTable( _ctx );
+    }
+    unsigned char const hop = gDorTorusHop[cur*gNodes+dest];
+    dim_left = hop & 0x1f;
+    if ( dim_left == gN ) {
+      *out_port = 2*gN;  // Eject
+    } else if ( (in_port/2) != dim_left ) {
+      // Turning into a new dimension, same decisions as below
+      int const shorter = ( hop >> 5 ) & 0x3;
+      dir = ( ( shorter == 0 ) || ( ( shorter == 1 ) && ( rng.Int( 1 ) ) ) ) ? 0 : 1;
+      *out_port = 2*dim_left + dir;
+      if ( partition ) {
+	// fixed dateline between nodes k-1 and 0
+	*partition = ( hop >> 7 ) & 0x1;
+      }
+    } else {
+      *out_port = in_port ^ 0x1;
+    }
+    return;
+  }
+
   for ( dim_left = 0; dim_left < gN; ++dim_left ) {
     if ( ( cur % gK ) != ( dest % gK ) ) { break; }
     cur /= gK; dest /= gK;
@@ -592,7 +723,7 @@ void dor_next_torus( int cur, int dest, int in_port,
       dist2 = gK - 2 * ( ( dest - cur + gK ) % gK );
       
       if ( ( dist2 > 0 ) || 
-	   ( ( dist2 == 0 ) && ( RandomInt( 1 ) ) ) ) {
+	   ( ( dist2 == 0 ) && ( rng.Int( 1 ) ) ) ) {
 	*out_port = 2*dim_left;     // Right
 	dir = 0;
       } else {
@@ -614,7 +745,7 @@ void dor_next_torus( int cur, int dest, int in_port,
 		      ( ( dir == 1 ) && ( cur >  (gK-1)/2 ) && ( dest <= (gK-1)/2 ) ) ) {
 	    *partition = 0;
 	  } else {
-	    *partition = RandomInt( 1 ); // use either VC set
+	    *partition = rng.Int( 1 ); // use either VC set
 	  }
 	} else {
 	  // Deterministic, fixed dateline between nodes k-1 and 0
@@ -640,9 +771,9 @@ void dor_next_torus( int cur, int dest, int in_port,
 
 //=============================================================
 
-void dim_order_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
+void dim_order_mesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
 {
-  int out_port = inject ? -1 : dor_next_mesh( r->GetID( ), f->dest );
+  int out_port = inject ? -1 : dor_next_mesh( _ctx, r->GetID( ), f->dest );
   
   int vcBegin = 0, vcEnd = gNumVCs-1;
   if ( f->type == Flit::READ_REQUEST ) {
@@ -661,7 +792,7 @@ void dim_order_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *
   assert(((f->vc >= vcBegin) && (f->vc <= vcEnd)) || (inject && (f->vc < 0)));
 
   if ( !inject && f->watch ) {
-    *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+    *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 	       << "Adding VC range [" 
 	       << vcBegin << "," 
 	       << vcEnd << "]"
@@ -679,9 +810,9 @@ void dim_order_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *
 
 //=============================================================
 
-void dim_order_ni_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
+void dim_order_ni_mesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
 {
-  int out_port = inject ? -1 : dor_next_mesh( r->GetID( ), f->dest );
+  int out_port = inject ? -1 : dor_next_mesh( _ctx, r->GetID( ), f->dest );
   
   int vcBegin = 0, vcEnd = gNumVCs-1;
   if ( f->type == Flit::READ_REQUEST ) {
@@ -711,7 +842,7 @@ void dim_order_ni_mesh( const Router *r, const Flit *f, int in_channel, OutputSe
   }
   
   if( !inject && f->watch ) {
-    *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+    *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 	       << "Adding VC range [" 
 	       << vcBegin << "," 
 	       << vcEnd << "]"
@@ -729,9 +860,9 @@ void dim_order_ni_mesh( const Router *r, const Flit *f, int in_channel, OutputSe
 
 //=============================================================
 
-void dim_order_pni_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
+void dim_order_pni_mesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
 {
-  int out_port = inject ? -1 : dor_next_mesh( r->GetID(), f->dest );
+  int out_port = inject ? -1 : dor_next_mesh( _ctx, r->GetID(), f->dest );
   
   int vcBegin = 0, vcEnd = gNumVCs-1;
   if ( f->type == Flit::READ_REQUEST ) {
@@ -766,7 +897,7 @@ void dim_order_pni_mesh( const Router *r, const Flit *f, int in_channel, OutputS
   }
 
   if( !inject && f->watch ) {
-    *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+    *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 	       << "Adding VC range [" 
 	       << vcBegin << "," 
 	       << vcEnd << "]"
@@ -786,7 +917,7 @@ void dim_order_pni_mesh( const Router *r, const Flit *f, int in_channel, OutputS
 
 // Random intermediate in the minimal quadrant defined
 // by the source and destination
-int rand_min_intr_mesh( int src, int dest )
+int rand_min_intr_mesh( BookSimContext * _ctx, RandomStream & rng, int src, int dest )
 {
   int dist;
 
@@ -797,9 +928,9 @@ int rand_min_intr_mesh( int src, int dest )
     dist = ( dest % gK ) - ( src % gK );
 
     if ( dist > 0 ) {
-      intm += offset * ( ( src % gK ) + RandomInt( dist ) );
+      intm += offset * ( ( src % gK ) + rng.Int( dist ) );
     } else {
-      intm += offset * ( ( dest % gK ) + RandomInt( -dist ) );
+      intm += offset * ( ( dest % gK ) + rng.Int( -dist ) );
     }
 
     offset *= gK;
@@ -811,7 +942,7 @@ int rand_min_intr_mesh( int src, int dest )
 
 //=============================================================
 
-void romm_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
+void romm_mesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
   if ( f->type == Flit::READ_REQUEST ) {
@@ -839,14 +970,14 @@ void romm_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *outpu
 
     if ( in_channel == 2*gN ) {
       f->ph   = 0;  // Phase 0
-      f->intm = rand_min_intr_mesh( f->src, f->dest );
+      f->intm = rand_min_intr_mesh( _ctx, RouteRandom( _ctx, r, f ), f->src, f->dest );
     } 
 
     if ( ( f->ph == 0 ) && ( r->GetID( ) == f->intm ) ) {
       f->ph = 1; // Go to phase 1
     }
 
-    out_port = dor_next_mesh( r->GetID( ), (f->ph == 0) ? f->intm : f->dest );
+    out_port = dor_next_mesh( _ctx, r->GetID( ), (f->ph == 0) ? f->intm : f->dest );
 
     // at the destination router, we don't need to separate VCs by phase
     if(r->GetID() != f->dest) {
@@ -872,7 +1003,7 @@ void romm_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *outpu
 
 //=============================================================
 
-void romm_ni_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
+void romm_ni_mesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
   if ( f->type == Flit::READ_REQUEST ) {
@@ -911,14 +1042,14 @@ void romm_ni_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *ou
 
     if ( in_channel == 2*gN ) {
       f->ph   = 0;  // Phase 0
-      f->intm = rand_min_intr_mesh( f->src, f->dest );
+      f->intm = rand_min_intr_mesh( _ctx, RouteRandom( _ctx, r, f ), f->src, f->dest );
     } 
 
     if ( ( f->ph == 0 ) && ( r->GetID( ) == f->intm ) ) {
       f->ph = 1; // Go to phase 1
     }
 
-    out_port = dor_next_mesh( r->GetID( ), (f->ph == 0) ? f->intm : f->dest );
+    out_port = dor_next_mesh( _ctx, r->GetID( ), (f->ph == 0) ? f->intm : f->dest );
 
   }
 
@@ -929,7 +1060,7 @@ void romm_ni_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *ou
 
 //=============================================================
 
-void min_adapt_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
+void min_adapt_mesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
   if ( f->type == Flit::READ_REQUEST ) {
@@ -968,11 +1099,11 @@ void min_adapt_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *
   }
   
   // DOR for the escape channel (VC 0), low priority 
-  int out_port = dor_next_mesh( r->GetID( ), f->dest );    
+  int out_port = dor_next_mesh( _ctx, r->GetID( ), f->dest );    
   outputs->AddRange( out_port, 0, vcBegin, vcBegin );
   
   if ( f->watch ) {
-      *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+      *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 		  << "Adding VC range [" 
 		  << vcBegin << "," 
 		  << vcBegin << "]"
@@ -989,11 +1120,13 @@ void min_adapt_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *
     int dest = f->dest;
     
     for ( int n = 0; n < gN; ++n ) {
-      if ( ( cur % gK ) != ( dest % gK ) ) { 
+      int const cur_n = node_coord( _ctx, cur, n );
+      int const dest_n = node_coord( _ctx, dest, n );
+      if ( cur_n != dest_n ) { 
 	// Add minimal direction in dimension 'n'
-	if ( ( cur % gK ) < ( dest % gK ) ) { // Right
+	if ( cur_n < dest_n ) { // Right
 	  if ( f->watch ) {
-	    *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+	    *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 			<< "Adding VC range [" 
 		       << (vcBegin+1) << "," 
 			<< vcEnd << "]"
@@ -1007,7 +1140,7 @@ void min_adapt_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *
 	  outputs->AddRange( 2*n, vcBegin+1, vcEnd, 1 ); 
 	} else { // Left
 	  if ( f->watch ) {
-	    *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+	    *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 			<< "Adding VC range [" 
 		       << (vcBegin+1) << "," 
 			<< vcEnd << "]"
@@ -1021,15 +1154,13 @@ void min_adapt_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *
 	  outputs->AddRange( 2*n + 1, vcBegin+1, vcEnd, 1 ); 
 	}
       }
-      cur  /= gK;
-      dest /= gK;
     }
   } 
 }
 
 //=============================================================
 
-void planar_adapt_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
+void planar_adapt_mesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
   if ( f->type == Flit::READ_REQUEST ) {
@@ -1084,7 +1215,7 @@ void planar_adapt_mesh( const Router *r, const Flit *f, int in_channel, OutputSe
     assert( n < gN );
 
     if ( f->watch ) {
-      *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+      *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 		  << "PLANAR ADAPTIVE: flit " << f->id 
 		  << " in adaptive plane " << n << "." << endl;
     }
@@ -1101,7 +1232,7 @@ void planar_adapt_mesh( const Router *r, const Flit *f, int in_channel, OutputSe
 	fault = false;
 
 	if ( f->watch ) {
-	  *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+	  *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 		      << "PLANAR ADAPTIVE: increasing in dimension " << n
 		      << "." << endl;
 	}
@@ -1115,7 +1246,7 @@ void planar_adapt_mesh( const Router *r, const Flit *f, int in_channel, OutputSe
 	fault = false;
 
 	if ( f->watch ) {
-	  *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+	  *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 		      << "PLANAR ADAPTIVE: decreasing in dimension " << n
 		      << "." << endl;
 	}
@@ -1154,7 +1285,7 @@ void planar_adapt_mesh( const Router *r, const Flit *f, int in_channel, OutputSe
       }
 
       if ( f->watch ) {
-	*gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+	*gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 		    << "PLANAR ADAPTIVE: avoiding 180 in dimension " << n
 		    << "." << endl;
       }
@@ -1176,7 +1307,7 @@ void planar_adapt_mesh( const Router *r, const Flit *f, int in_channel, OutputSe
 	d1_min_c = 2*n + 1;
 	atedge = true;
       } else {
-	d1_min_c = 2*n + RandomInt( 1 ); // random misroute
+	d1_min_c = 2*n + RouteRandom( _ctx, r, f ).Int( 1 ); // random misroute
 
 	if ( d1_min_c  == in_channel ) { // don't 180
 	  d1_min_c = in_channel ^ 1;
@@ -1204,7 +1335,7 @@ void planar_adapt_mesh( const Router *r, const Flit *f, int in_channel, OutputSe
   Even if it were, this should really use f->ph instead of introducing a single-
   use field.
 
-void limited_adapt_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
+void limited_adapt_mesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
 {
   outputs->Clear( );
 
@@ -1262,7 +1393,7 @@ void limited_adapt_mesh( const Router *r, const Flit *f, int in_channel, OutputS
       }
       
     } else {
-      outputs->AddRange( dor_next_mesh( cur, dest ),
+      outputs->AddRange( dor_next_mesh( _ctx, cur, dest ),
 			 vcEnd, vcEnd, 0 );
     }
     
@@ -1273,7 +1404,7 @@ void limited_adapt_mesh( const Router *r, const Flit *f, int in_channel, OutputS
 */
 //=============================================================
 
-void valiant_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
+void valiant_mesh( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
   if ( f->type == Flit::READ_REQUEST ) {
@@ -1301,14 +1432,14 @@ void valiant_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *ou
 
     if ( in_channel == 2*gN ) {
       f->ph   = 0;  // Phase 0
-      f->intm = RandomInt( gNodes - 1 );
+      f->intm = RouteRandom( _ctx, r, f ).Int( gNodes - 1 );
     }
 
     if ( ( f->ph == 0 ) && ( r->GetID( ) == f->intm ) ) {
       f->ph = 1; // Go to phase 1
     }
 
-    out_port = dor_next_mesh( r->GetID( ), (f->ph == 0) ? f->intm : f->dest );
+    out_port = dor_next_mesh( _ctx, r->GetID( ), (f->ph == 0) ? f->intm : f->dest );
 
     // at the destination router, we don't need to separate VCs by phase
     if(r->GetID() != f->dest) {
@@ -1334,7 +1465,7 @@ void valiant_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *ou
 
 //=============================================================
 
-void valiant_torus( const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
+void valiant_torus( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
   if ( f->type == Flit::READ_REQUEST ) {
@@ -1363,7 +1494,7 @@ void valiant_torus( const Router *r, const Flit *f, int in_channel, OutputSet *o
     int phase;
     if ( in_channel == 2*gN ) {
       phase   = 0;  // Phase 0
-      f->intm = RandomInt( gNodes - 1 );
+      f->intm = RouteRandom( _ctx, r, f ).Int( gNodes - 1 );
     } else {
       phase = f->ph / 2;
     }
@@ -1374,7 +1505,7 @@ void valiant_torus( const Router *r, const Flit *f, int in_channel, OutputSet *o
     }
   
     int ring_part;
-    dor_next_torus( r->GetID( ), (phase == 0) ? f->intm : f->dest, in_channel,
+    dor_next_torus( _ctx, RouteRandom( _ctx, r, f ), r->GetID( ), (phase == 0) ? f->intm : f->dest, in_channel,
 		    &out_port, &ring_part, false );
 
     f->ph = 2 * phase + ring_part;
@@ -1412,7 +1543,7 @@ void valiant_torus( const Router *r, const Flit *f, int in_channel, OutputSet *o
 
 //=============================================================
 
-void valiant_ni_torus( const Router *r, const Flit *f, int in_channel, 
+void valiant_ni_torus( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 		       OutputSet *outputs, bool inject )
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
@@ -1453,7 +1584,7 @@ void valiant_ni_torus( const Router *r, const Flit *f, int in_channel,
     int phase;
     if ( in_channel == 2*gN ) {
       phase   = 0;  // Phase 0
-      f->intm = RandomInt( gNodes - 1 );
+      f->intm = RouteRandom( _ctx, r, f ).Int( gNodes - 1 );
     } else {
       phase = f->ph / 2;
     }
@@ -1464,7 +1595,7 @@ void valiant_ni_torus( const Router *r, const Flit *f, int in_channel,
     }
   
     int ring_part;
-    dor_next_torus( r->GetID( ), (f->ph == 0) ? f->intm : f->dest, in_channel,
+    dor_next_torus( _ctx, RouteRandom( _ctx, r, f ), r->GetID( ), (f->ph == 0) ? f->intm : f->dest, in_channel,
 		    &out_port, &ring_part, false );
 
     f->ph = 2 * phase + ring_part;
@@ -1494,7 +1625,7 @@ void valiant_ni_torus( const Router *r, const Flit *f, int in_channel,
     }
 
     if (f->watch) {
-      *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+      *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 		 << "Adding VC range [" 
 		 << vcBegin << "," 
 		 << vcEnd << "]"
@@ -1514,7 +1645,7 @@ void valiant_ni_torus( const Router *r, const Flit *f, int in_channel,
 
 //=============================================================
 
-void dim_order_torus( const Router *r, const Flit *f, int in_channel, 
+void dim_order_torus( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 		      OutputSet *outputs, bool inject )
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
@@ -1544,7 +1675,7 @@ void dim_order_torus( const Router *r, const Flit *f, int in_channel,
     int cur  = r->GetID( );
     int dest = f->dest;
 
-    dor_next_torus( cur, dest, in_channel,
+    dor_next_torus( _ctx, RouteRandom( _ctx, r, f ), cur, dest, in_channel,
 		    &out_port, &f->ph, false );
 
 
@@ -1562,7 +1693,7 @@ void dim_order_torus( const Router *r, const Flit *f, int in_channel,
     }
 
     if ( f->watch ) {
-      *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+      *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 		 << "Adding VC range [" 
 		 << vcBegin << "," 
 		 << vcEnd << "]"
@@ -1582,7 +1713,7 @@ void dim_order_torus( const Router *r, const Flit *f, int in_channel,
 
 //=============================================================
 
-void dim_order_ni_torus( const Router *r, const Flit *f, int in_channel, 
+void dim_order_ni_torus( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 			 OutputSet *outputs, bool inject )
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
@@ -1612,7 +1743,7 @@ void dim_order_ni_torus( const Router *r, const Flit *f, int in_channel,
     int cur  = r->GetID( );
     int dest = f->dest;
 
-    dor_next_torus( cur, dest, in_channel,
+    dor_next_torus( _ctx, RouteRandom( _ctx, r, f ), cur, dest, in_channel,
 		    &out_port, NULL, false );
 
     // at the destination router, we don't need to separate VCs by destination
@@ -1627,7 +1758,7 @@ void dim_order_ni_torus( const Router *r, const Flit *f, int in_channel,
     }
 
     if ( f->watch ) {
-      *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+      *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 		 << "Adding VC range [" 
 		 << vcBegin << "," 
 		 << vcEnd << "]"
@@ -1647,7 +1778,7 @@ void dim_order_ni_torus( const Router *r, const Flit *f, int in_channel,
 
 //=============================================================
 
-void dim_order_bal_torus( const Router *r, const Flit *f, int in_channel, 
+void dim_order_bal_torus( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 			  OutputSet *outputs, bool inject )
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
@@ -1677,7 +1808,7 @@ void dim_order_bal_torus( const Router *r, const Flit *f, int in_channel,
     int cur  = r->GetID( );
     int dest = f->dest;
 
-    dor_next_torus( cur, dest, in_channel,
+    dor_next_torus( _ctx, RouteRandom( _ctx, r, f ), cur, dest, in_channel,
 		    &out_port, &f->ph, true );
 
     // at the destination router, we don't need to separate VCs by ring partition
@@ -1695,7 +1826,7 @@ void dim_order_bal_torus( const Router *r, const Flit *f, int in_channel,
     }
 
     if ( f->watch ) {
-      *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+      *gWatchOut << GetSimTime(_ctx) << " | " << r->FullName() << " | "
 		 << "Adding VC range [" 
 		 << vcBegin << "," 
 		 << vcEnd << "]"
@@ -1715,7 +1846,7 @@ void dim_order_bal_torus( const Router *r, const Flit *f, int in_channel,
 
 //=============================================================
 
-void min_adapt_torus( const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
+void min_adapt_torus( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
   if ( f->type == Flit::READ_REQUEST ) {
@@ -1760,8 +1891,10 @@ void min_adapt_torus( const Router *r, const Flit *f, int in_channel, OutputSet
     // Minimal adaptive for all other channels
     
     for ( int n = 0; n < gN; ++n ) {
-      if ( ( cur % gK ) != ( dest % gK ) ) {
-	int dist2 = gK - 2 * ( ( ( dest % gK ) - ( cur % gK ) + gK ) % gK );
+      int const cur_n = node_coord( _ctx, cur, n );
+      int const dest_n = node_coord( _ctx, dest, n );
+      if ( cur_n != dest_n ) {
+	int dist2 = gK - 2 * ( ( dest_n - cur_n + gK ) % gK );
 	
 	if ( dist2 > 0 ) { /*) || 
 			     ( ( dist2 == 0 ) && ( RandomInt( 1 ) ) ) ) {*/
@@ -1770,19 +1903,16 @@ void min_adapt_torus( const Router *r, const Flit *f, int in_channel, OutputSet
 	  outputs->AddRange( 2*n + 1, vcBegin+3, vcBegin+3, 1 ); // Left
 	}
       }
-
-      cur  /= gK;
-      dest /= gK;
     }
     
     // DOR for the escape channel (VCs 0-1), low priority --- 
     // trick the algorithm with the in channel.  want VC assignment
     // as if we had injected at this node
-    dor_next_torus( r->GetID( ), f->dest, 2*gN,
+    dor_next_torus( _ctx, RouteRandom( _ctx, r, f ), r->GetID( ), f->dest, 2*gN,
 		    &out_port, &f->ph, false );
   } else {
     // DOR for the escape channel (VCs 0-1), low priority 
-    dor_next_torus( cur, dest, in_channel,
+    dor_next_torus( _ctx, RouteRandom( _ctx, r, f ), cur, dest, in_channel,
 		    &out_port, &f->ph, false );
   }
 
@@ -1795,7 +1925,7 @@ void min_adapt_torus( const Router *r, const Flit *f, int in_channel, OutputSet
 
 //=============================================================
 
-void dest_tag_fly( const Router *r, const Flit *f, int in_channel, 
+void dest_tag_fly( BookSimContext * _ctx, const Router *r, const Flit *f, int in_channel, 
 		   OutputSet *outputs, bool inject )
 {
   int vcBegin = 0, vcEnd = gNumVCs-1;
@@ -1842,7 +1972,7 @@ void dest_tag_fly( const Router *r, const Flit *f, int in_channel,
 
 //=============================================================
 
-void chaos_torus( const Router *r, const Flit *f, 
+void chaos_torus( BookSimContext * _ctx, const Router *r, const Flit *f, 
 		  int in_channel, OutputSet *outputs, bool inject )
 {
   outputs->Clear( );
@@ -1881,7 +2011,7 @@ void chaos_torus( const Router *r, const Flit *f,
 
 //=============================================================
 
-void chaos_mesh( const Router *r, const Flit *f, 
+void chaos_mesh( BookSimContext * _ctx, const Router *r, const Flit *f, 
 		  int in_channel, OutputSet *outputs, bool inject )
 {
   outputs->Clear( );
@@ -1914,7 +2044,7 @@ void chaos_mesh( const Router *r, const Flit *f,
 
 //=============================================================
 
-void InitializeRoutingMap( const Configuration & config )
+void InitializeRoutingMap( BookSimContext * _ctx, const Configuration & config )
 {
 
   gNumVCs = config.GetInt( "num_vcs" );
@@ -33,16 +33,23 @@
 #include "outputset.hpp"
 #include "config_utils.hpp"
 
-typedef void (*tRoutingFunction)( const Router *, const Flit *, int in_channel, OutputSet *, bool );
-
-void InitializeRoutingMap( const Configuration & config );
-
-extern map<string, tRoutingFunction> gRoutingFunctionMap;
-
-extern int gNumVCs;
-extern int gReadReqBeginVC, gReadReqEndVC;
-extern int gWriteReqBeginVC, gWriteReqEndVC;
-extern int gReadReplyBeginVC, gReadReplyEndVC;
-extern int gWriteReplyBeginVC, gWriteReplyEndVC;
+void InitializeRoutingMap( BookSimContext * _ctx, const Configuration & config );
+
+// Random stream for routing decisions: the router's own, or the source
+// node's when the function is called at injection (r == NULL)
+RandomStream & RouteRandom( BookSimContext * _ctx, const Router *r, const Flit *f );
+
+// Routing state of the interconnect (see BookSimContext and globals.hpp)
+#define gRoutingFunctionMap (_ctx->routing_function_map)
+
+#define gNumVCs (_ctx->num_vcs)
+#define gReadReqBeginVC (_ctx->read_req_begin_vc)
+#define gReadReqEndVC (_ctx->read_req_end_vc)
+#define gWriteReqBeginVC (_ctx->write_req_begin_vc)
+#define gWriteReqEndVC (_ctx->write_req_end_vc)
+#define gReadReplyBeginVC (_ctx->read_reply_begin_vc)
+#define gReadReplyEndVC (_ctx->read_reply_end_vc)
+#define gWriteReplyBeginVC (_ctx->write_reply_begin_vc)
+#define gWriteReplyEndVC (_ctx->write_reply_end_vc)
 
 #endif
@@ -60,8 +60,8 @@ ChaosRouter::ChaosRouter( const Configuration& config,
   // Routing
 
   string rf = config.GetStr("routing_function") + "_" + config.GetStr("topology");
-  map<string, tRoutingFunction>::iterator rf_iter = gRoutingFunctionMap.find(rf);
-  if(rf_iter == gRoutingFunctionMap.end()) {
+  map<string, tRoutingFunction>::iterator rf_iter = _ctx->routing_function_map.find(rf);
+  if(rf_iter == _ctx->routing_function_map.end()) {
     Error("Invalid routing function: " + rf);
   }
   _rf = rf_iter->second;
@@ -152,7 +152,7 @@ void ChaosRouter::ReadInputs( )
 	  } else {
 	    _input_state[input] = filling;
 	  }
-	  _rf( this, f, input, _input_route[input], false );
+	  _rf( _ctx, this, f, input, _input_route[input], false );
 	} else {
 	  cout << *f;
 	  Error( "Empty buffer received non-head flit!" );
@@ -219,7 +219,7 @@ void ChaosRouter::ReadInputs( )
 	Error( "Next queue count fell below zero!" );
       }
 
-      c->Free();
+      c->Free(_ctx);
     }
   }
 }
@@ -282,7 +282,7 @@ int ChaosRouter::_InputForOutput( int output ) const
   // return an input that prefers this output
 
   int  input;
-  int  offset = RandomInt( _inputs - 1 );
+  int  offset = _random.Int( _inputs - 1 );
   bool match  = false;
 
   for ( int i = 0; ( i < _inputs ) && ( !match ); ++i ) {
@@ -334,7 +334,7 @@ int ChaosRouter::_MultiQueueForOutput( int output ) const
   // Don't deroute MQs to the ejection channel
   if ( ( mq_oldest == -1 ) && isfull && 
        ( !_IsEjectionChan( output ) ) ) {
-    r = RandomInt( _multi_queue_size - 1 );
+    r = _random.Int( _multi_queue_size - 1 );
 
     // Find first routable multi-queue
     for ( int i = 0; i < _multi_queue_size; ++i ) {
@@ -526,7 +526,7 @@ void ChaosRouter::_OutputAdvance( )
 	mq = _input_mq_match[i];
 
 	if ( f->head ) {
-	  _rf( this, f, i, _mq_route[mq], false );
+	  _rf( _ctx, this, f, i, _mq_route[mq], false );
 	  _mq_age[mq] = 0;
 
 	  if ( _multi_state[mq] == empty ) {
@@ -573,15 +573,15 @@ void ChaosRouter::_OutputAdvance( )
 	    _input_state[i] = filling;
 	    f2 = _input_frame[i].front( );
 	    // update routes
-	    _rf( this, f2, i, _input_route[i], false );
+	    _rf( _ctx, this, f2, i, _input_route[i], false );
 	  }
 	  
 	  _input_output_match[i] = -1;
 	  _input_mq_match[i]     = -1;
 	}
 	
-	c = Credit::New( );
-	c->vc.insert(0);
+	c = Credit::New(_ctx);
+	c->AddVC(0);
 	_credit_queue[i].push( c );
       }
     }
@@ -56,8 +56,8 @@ EventRouter::EventRouter( const Configuration& config,
   // Routing
 
   string rf = config.GetStr("routing_function") + "_" + config.GetStr("topology");
-  map<string, tRoutingFunction>::iterator rf_iter = gRoutingFunctionMap.find(rf);
-  if(rf_iter == gRoutingFunctionMap.end()) {
+  map<string, tRoutingFunction>::iterator rf_iter = _ctx->routing_function_map.find(rf);
+  if(rf_iter == _ctx->routing_function_map.end()) {
     Error("Invalid routing function: " + rf);
   }
   _rf = rf_iter->second;
@@ -470,8 +470,8 @@ void EventRouter::_ArrivalArb( int output )
     c = _out_cred_buffer[output].front( );
     _out_cred_buffer[output].pop( );
     
-    assert( c->vc.size() == 1 );
-    int vc = *c->vc.begin();
+    assert( c->NumVCs() == 1 );
+    int vc = Credit::FirstVC(c->vc_mask);
 
     EventNextVCState::eNextVCState state = 
       _output_state[output]->GetState( vc );
@@ -517,7 +517,7 @@ void EventRouter::_ArrivalArb( int output )
       }
     }
 
-    c->Free();
+    c->Free(_ctx);
   }
 
   // Now process arrival events
@@ -670,8 +670,8 @@ void EventRouter::_TransportArb( int input )
       }
     }
 
-    c = Credit::New( );
-    c->vc.insert(f->vc);
+    c = Credit::New(_ctx);
+    c->AddVC(f->vc);
     c->head          = f->head;
     c->tail          = f->tail;
     c->id            = f->id;
@@ -74,8 +74,8 @@ IQRouter::IQRouter( Configuration const & config, Module *parent,
 
   // Routing
   string const rf = config.GetStr("routing_function") + "_" + config.GetStr("topology");
-  map<string, tRoutingFunction>::const_iterator rf_iter = gRoutingFunctionMap.find(rf);
-  if(rf_iter == gRoutingFunctionMap.end()) {
+  map<string, tRoutingFunction>::const_iterator rf_iter = _ctx->routing_function_map.find(rf);
+  if(rf_iter == _ctx->routing_function_map.end()) {
     Error("Invalid routing function: " + rf);
   }
   _rf = rf_iter->second;
@@ -290,6 +290,26 @@ void IQRouter::WriteOutputs( )
   _SendCredits( );
 }
 
+bool IQRouter::IsIdle( ) const
+{
+  // Router::Evaluate() leaves the pipeline alone while no flits are
+  // outstanding here; a new flit wakes the router through its input channel
+  if ( _active && ( outstandingFlit[0][_id] != 0 ) ) {
+    return false;
+  }
+  for ( int output = 0; output < _outputs; ++output ) {
+    if ( !_output_buffer[output].empty( ) ) {
+      return false;
+    }
+  }
+  for ( int input = 0; input < _inputs; ++input ) {
+    if ( !_credit_buffer[input].empty( ) ) {
+      return false;
+    }
+  }
+  return true;
+}
+
 
 //------------------------------------------------------------------------------
 // read inputs
@@ -395,6 +415,9 @@ void IQRouter::_InputQueuing( )
 		     << ")." << endl;
 	}
 	cur_buf->SetRouteSet(vc, &f->la_route_set);
+	if(f->mcast) {
+	  _SetupMulticast(input, vc, f);
+	}
 	cur_buf->SetState(vc, VC::vc_alloc);
 	if(_speculative) {
 	  _sw_alloc_vcs.push_back(make_pair(-1, make_pair(make_pair(input, vc),
@@ -439,8 +462,8 @@ void IQRouter::_InputQueuing( )
     BufferState * const dest_buf = _next_buf[output];
     
 #ifdef TRACK_FLOWS
-    for(set<int>::const_iterator iter = c->vc.begin(); iter != c->vc.end(); ++iter) {
-      int const vc = *iter;
+    for(uint64_t mask = c->vc_mask; mask; mask &= mask - 1) {
+      int const vc = Credit::FirstVC(mask);
       assert(!_outstanding_classes[output][vc].empty());
       int cl = _outstanding_classes[output][vc].front();
       _outstanding_classes[output][vc].pop();
@@ -450,7 +473,7 @@ void IQRouter::_InputQueuing( )
 #endif
 
     dest_buf->ProcessCredit(c);
-    c->Free();
+    c->Free(_ctx);
     _proc_credits.pop_front();
   }
 }
@@ -535,6 +558,9 @@ void IQRouter::_RouteUpdate( )
     }
 
     cur_buf->Route(vc, _rf, this, f, input);
+    if(f->mcast) {
+      _SetupMulticast(input, vc, f);
+    }
     cur_buf->SetState(vc, VC::vc_alloc);
     if(_speculative) {
       _sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second, -1)));
@@ -1029,7 +1055,7 @@ void IQRouter::_SWHoldUpdate( )
     assert(!cur_buf->Empty(vc));
     assert(cur_buf->GetState(vc) == VC::active);
     
-    Flit * const f = cur_buf->FrontFlit(vc);
+    Flit * f = cur_buf->FrontFlit(vc);
     assert(f);
     assert(f->vc == vc);
 
@@ -1069,14 +1095,22 @@ void IQRouter::_SWHoldUpdate( )
 		   << "." << endl;
       }
       
-      cur_buf->RemoveFlit(vc);
+      // All but the last branch of a multicast packet get copies, and the
+      // flits stay buffered (no credits) until that one
+      bool const copy = cur_buf->IsReplicating(vc);
+      if(copy) {
+	f = cur_buf->CopyFlit(vc);
+	++outstandingFlit[0][_id]; // the copy leaves from this router too
+      } else {
+	cur_buf->RemoveFlit(vc);
 
 #ifdef TRACK_FLOWS
-      --_stored_flits[f->cl][input];
-      if(f->tail) --_active_packets[f->cl][input];
+	--_stored_flits[f->cl][input];
+	if(f->tail) --_active_packets[f->cl][input];
 #endif
 
-      _bufferMonitor->read(input, f) ;
+	_bufferMonitor->read(input, f) ;
+      }
       
       f->hops++;
       f->vc = match_vc;
@@ -1109,7 +1143,7 @@ void IQRouter::_SWHoldUpdate( )
 			 << "." << endl;
 	    }
 	    int in_channel = channel->GetSinkPort();
-	    _rf(router, f, in_channel, &f->la_route_set, false);
+	    _rf(_ctx, router, f, in_channel, &f->la_route_set, false);
 	  }
 	} else {
 	  f->la_route_set.Clear();
@@ -1125,12 +1159,29 @@ void IQRouter::_SWHoldUpdate( )
 
       _crossbar_flits.push_back(make_pair(-1, make_pair(f, make_pair(expanded_input, expanded_output))));
       
-      if(_out_queue_credits.count(input) == 0) {
-	_out_queue_credits.insert(make_pair(input, Credit::New()));
+      if(!copy) {
+	if(_out_queue_credits.count(input) == 0) {
+	  _out_queue_credits.insert(make_pair(input, Credit::New(_ctx)));
+	}
+	_out_queue_credits.find(input)->second->AddVC(vc);
       }
-      _out_queue_credits.find(input)->second->vc.insert(vc);
       
-      if(cur_buf->Empty(vc)) {
+      if(copy && f->tail) {
+	_switch_hold_vc[expanded_input] = -1;
+	_switch_hold_in[expanded_input] = -1;
+	_switch_hold_out[expanded_output] = -1;
+	// Done with this branch, start over from the head for the next one
+	cur_buf->NextBranch(vc);
+	cur_buf->SetState(vc, VC::vc_alloc);
+	if(_speculative) {
+	  _sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
+							  -1)));
+	}
+	if(_vc_allocator) {
+	  _vc_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
+							  -1)));
+	}
+      } else if(cur_buf->Empty(vc)) {
 	if(f->watch) {
 	  *gWatchOut << GetSimTime() << " | " << FullName() << " | "
 		     << "  Cancelling held connection from input " << input
@@ -1174,6 +1225,9 @@ void IQRouter::_SWHoldUpdate( )
 			 << ")." << endl;
 	    }
 	    cur_buf->SetRouteSet(vc, &nf->la_route_set);
+	    if(nf->mcast) {
+	      _SetupMulticast(input, vc, nf);
+	    }
 	    cur_buf->SetState(vc, VC::vc_alloc);
 	    if(_speculative) {
 	      _sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
@@ -1857,7 +1911,7 @@ void IQRouter::_SWAllocUpdate( )
     assert((cur_buf->GetState(vc) == VC::active) ||
 	   (_speculative && (cur_buf->GetState(vc) == VC::vc_alloc)));
     
-    Flit * const f = cur_buf->FrontFlit(vc);
+    Flit * f = cur_buf->FrontFlit(vc);
     assert(f);
     assert(f->vc == vc);
 
@@ -1979,14 +2033,22 @@ void IQRouter::_SWAllocUpdate( )
 		   << "." << endl;
       }
 
-      cur_buf->RemoveFlit(vc);
+      // All but the last branch of a multicast packet get copies, and the
+      // flits stay buffered (no credits) until that one
+      bool const copy = cur_buf->IsReplicating(vc);
+      if(copy) {
+	f = cur_buf->CopyFlit(vc);
+	++outstandingFlit[0][_id]; // the copy leaves from this router too
+      } else {
+	cur_buf->RemoveFlit(vc);
 
 #ifdef TRACK_FLOWS
-      --_stored_flits[f->cl][input];
-      if(f->tail) --_active_packets[f->cl][input];
+	--_stored_flits[f->cl][input];
+	if(f->tail) --_active_packets[f->cl][input];
 #endif
 
-      _bufferMonitor->read(input, f) ;
+	_bufferMonitor->read(input, f) ;
+      }
 
       f->hops++;
       f->vc = match_vc;
@@ -2019,7 +2081,7 @@ void IQRouter::_SWAllocUpdate( )
 			 << "." << endl;
 	    }
 	    int in_channel = channel->GetSinkPort();
-	    _rf(router, f, in_channel, &f->la_route_set, false);
+	    _rf(_ctx, router, f, in_channel, &f->la_route_set, false);
 	  }
 	} else {
 	  f->la_route_set.Clear();
@@ -2035,12 +2097,26 @@ void IQRouter::_SWAllocUpdate( )
 
       _crossbar_flits.push_back(make_pair(-1, make_pair(f, make_pair(expanded_input, expanded_output))));
 
-      if(_out_queue_credits.count(input) == 0) {
-	_out_queue_credits.insert(make_pair(input, Credit::New()));
+      if(!copy) {
+	if(_out_queue_credits.count(input) == 0) {
+	  _out_queue_credits.insert(make_pair(input, Credit::New(_ctx)));
+	}
+	_out_queue_credits.find(input)->second->AddVC(vc);
       }
-      _out_queue_credits.find(input)->second->vc.insert(vc);
 
-      if(cur_buf->Empty(vc)) {
+      if(copy && f->tail) {
+	// Done with this branch, start over from the head for the next one
+	cur_buf->NextBranch(vc);
+	cur_buf->SetState(vc, VC::vc_alloc);
+	if(_speculative) {
+	  _sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
+							  -1)));
+	}
+	if(_vc_allocator) {
+	  _vc_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
+							  -1)));
+	}
+      } else if(cur_buf->Empty(vc)) {
 	if(f->tail) {
 	  cur_buf->SetState(vc, VC::idle);
 	}
@@ -2062,6 +2138,9 @@ void IQRouter::_SWAllocUpdate( )
 			 << ")." << endl;
 	    }
 	    cur_buf->SetRouteSet(vc, &nf->la_route_set);
+	    if(nf->mcast) {
+	      _SetupMulticast(input, vc, nf);
+	    }
 	    cur_buf->SetState(vc, VC::vc_alloc);
 	    if(_speculative) {
 	      _sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
@@ -2227,7 +2306,7 @@ void IQRouter::_OutputQueuing( )
 
     Credit * const c = iter->second;
     assert(c);
-    assert(!c->vc.empty());
+    assert(!c->Empty());
 
     _credit_buffer[input].push(c);
   }
@@ -2360,7 +2439,7 @@ void IQRouter::_UpdateNOQ(int input, int vc, Flit const * f) {
   if(router) {
     int in_channel = channel->GetSinkPort();
     OutputSet nos;
-    _rf(router, f, in_channel, &nos, false);
+    _rf(_ctx, router, f, in_channel, &nos, false);
     sl = nos.GetSet();
     assert(sl.size() == 1);
     OutputSet::sSetElement const & se = *sl.begin();
@@ -2386,6 +2465,52 @@ void IQRouter::_UpdateNOQ(int input, int vc, Flit const * f) {
   }
 }
 
+// Multicast packets are replicated along the tree of (deterministic) routes to
+// their destinations: each destination is routed on its own, destinations that
+// leave through the same output port form a branch, and the input VC sends the
+// packet on each branch in turn, as if they were back-to-back packets.
+void IQRouter::_SetupMulticast(int input, int vc, Flit * f)
+{
+  assert(f->head && f->mcast && f->mcast_dests);
+  if(_noq) {
+    Error("Multicast packets are not supported with NOQ.");
+  }
+
+  vector<OutputSet> route_sets;
+  vector<uint64_t> dests;
+  vector<int> ports;
+  int const dest = f->dest;
+  for(uint64_t left = f->mcast_dests; left; left &= left - 1) {
+    int const d = __builtin_ctzll(left);
+    f->dest = d;
+    OutputSet route_set;
+    _rf(_ctx, this, f, input, &route_set, false);
+    set<OutputSet::sSetElement> const & sl = route_set.GetSet();
+    if(sl.size() != 1) {
+      Error("Multicast packets require a deterministic routing function.");
+    }
+    int const port = sl.begin()->output_port;
+    size_t b = 0;
+    while((b < ports.size()) && (ports[b] != port)) ++b;
+    if(b == ports.size()) {
+      ports.push_back(port);
+      route_sets.push_back(route_set);
+      dests.push_back(0);
+    }
+    dests[b] |= 1ULL << d;
+  }
+  f->dest = dest;
+
+  if(f->watch) {
+    *gWatchOut << GetSimTime() << " | " << FullName() << " | "
+	       << "Replicating multicast packet " << f->pid
+	       << " at input " << input
+	       << " to " << ports.size() << " output port(s)"
+	       << "." << endl;
+  }
+  _buf[input]->SetMulticastBranches(vc, route_sets, dests);
+}
+
 void IQRouter::IncVcBufferSize(int output, int lat){
   _next_buf[output]->IncVcBufferSize(lat);
 }
\ No newline at end of file
@@ -141,6 +141,8 @@ class IQRouter : public Router {
   
   void _UpdateNOQ(int input, int vc, Flit const * f);
 
+  void _SetupMulticast(int input, int vc, Flit * f);
+
   // ----------------------------------------
   //
   //   Router Power Modellingyes
@@ -162,6 +164,7 @@ public:
 
   virtual void ReadInputs( );
   virtual void WriteOutputs( );
+  virtual bool IsIdle( ) const;
   
   void Display( ostream & os = cout ) const;
 
@@ -58,8 +58,9 @@ int const Router::STALL_CROSSBAR_CONFLICT = -6;
 Router::Router( const Configuration& config,
 		Module *parent, const string & name, int id,
 		int inputs, int outputs ) :
-TimedModule( parent, name ), _id( id ), _inputs( inputs ), _outputs( outputs ),
-   _partial_internal_cycles(0.0)
+TimedModule( parent, name ), _id( id ),
+   _inputs( inputs ), _outputs( outputs ),
+   _partial_internal_cycles(0.0), _random( _ctx, FullName( ), RandomRoute )
 {
   _crossbar_delay   = ( config.GetInt( "st_prepare_delay" ) + 
 			config.GetInt( "st_final_delay" ) );
@@ -95,6 +96,7 @@ void Router::AddInputChannel( FlitChannel *channel, CreditChannel *backchannel )
   _input_channels.push_back( channel );
   _input_credits.push_back( backchannel );
   channel->SetSink( this, _input_channels.size() - 1 ) ;
+  channel->SetReceiver( this );
 }
 
 void Router::AddOutputChannel( FlitChannel *channel, CreditChannel *backchannel )
@@ -103,6 +105,9 @@ void Router::AddOutputChannel( FlitChannel *channel, CreditChannel *backchannel
   _output_credits.push_back( backchannel );
   _channel_faults.push_back( false );
   channel->SetSource( this, _output_channels.size() - 1 ) ;
+  if ( backchannel ) {
+    backchannel->SetReceiver( this );
+  }
 }
 
 void Router::Evaluate( )
@@ -37,6 +37,7 @@
 #include "flitchannel.hpp"
 #include "channel.hpp"
 #include "config_utils.hpp"
+#include "random_utils.hpp"
 
 typedef Channel<Credit> CreditChannel;
 
@@ -72,6 +73,9 @@ protected:
   vector<CreditChannel *> _output_credits;
   vector<bool>            _channel_faults;
 
+  // random decisions made by this router and its routing function
+  mutable RandomStream _random;
+
 #ifdef TRACK_FLOWS
   vector<vector<int> > _received_flits;
   vector<int>          _received_flits_per_router;
@@ -123,6 +127,7 @@ public:
   bool IsFaultyOutput( int c ) const;
 
   inline int GetID( ) const {return _id;}
+  inline RandomStream & GetRandom( ) const {return _random;}
 
 
   virtual int GetUsedCredit(int o) const = 0;
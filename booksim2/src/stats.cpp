@@ -56,6 +56,7 @@ void Stats::Clear( )
   _sample_squared_sum = 0.0;
 
   _hist.assign(_num_bins, 0);
+  _pending.clear();
 
   _min = numeric_limits<double>::quiet_NaN();
   _max = -numeric_limits<double>::quiet_NaN();
@@ -65,11 +66,13 @@ void Stats::Clear( )
 
 double Stats::Average( ) const
 {
+  _Flush();
   return _sample_sum / (double)_num_samples;
 }
 
 double Stats::Variance( ) const
 {
+  _Flush();
   return (_sample_squared_sum * (double)_num_samples - _sample_sum * _sample_sum) / ((double)_num_samples * (double)_num_samples);
 }
 
@@ -85,11 +88,13 @@ double Stats::Max( ) const
 
 double Stats::Sum( ) const
 {
+  _Flush();
   return _sample_sum;
 }
 
 double Stats::SquaredSum( ) const
 {
+  _Flush();
   return _sample_squared_sum;
 }
 
@@ -101,17 +106,44 @@ int Stats::NumSamples( ) const
 void Stats::AddSample( double val )
 {
   ++_num_samples;
-  _sample_sum += val;
 
   // NOTE: the negation ensures that NaN values are handled correctly!
   _max = !(val <= _max) ? val : _max;
   _min = !(val >= _min) ? val : _min;
 
-  //double clamp between 0 and num_bins-1
-  int b = (int)fmax(floor( val / _bin_size ), 0.0);
-  b = (b >= _num_bins) ? (_num_bins - 1) : b;
+  if(_pending.size() == _batch_size) {
+    _Flush();
+  }
+  _pending.push_back(val);
+}
 
-  _hist[b]++;
+void Stats::_Flush( ) const
+{
+  size_t const n = _pending.size();
+  if(n == 0) {
+    return;
+  }
+  double const * const v = &_pending[0];
+
+  // bin indices first, in a loop without stores to _hist so it vectorizes.
+  // Clamping to [0, num_bins-1] before truncating gives the same bin as
+  // clamping floor(val / bin_size), NaN included, without calling floor
+  int b[_batch_size];
+  double const top = (double)(_num_bins - 1);
+  for(size_t i = 0; i < n; ++i) {
+    double x = v[i] / _bin_size;
+    x = (x > 0.0) ? x : 0.0;
+    x = (x < top) ? x : top;
+    b[i] = (int)x;
+  }
+
+  // summed in arrival order, so results match adding samples one at a time
+  for(size_t i = 0; i < n; ++i) {
+    _sample_sum += v[i];
+    _sample_squared_sum += v[i] * v[i];
+    _hist[b[i]]++;
+  }
+  _pending.clear();
 }
 
 void Stats::Display( ostream & os ) const
@@ -120,6 +152,7 @@ void Stats::Display( ostream & os ) const
 }
 
 ostream & operator<<(ostream & os, const Stats & s) {
+  s._Flush();
   vector<int> const & v = s._hist;
   os << "[ ";
   for(size_t i = 0; i < v.size(); ++i) {
@@ -32,8 +32,8 @@
 
 class Stats : public Module {
   int    _num_samples;
-  double _sample_sum;
-  double _sample_squared_sum;
+  mutable double _sample_sum;
+  mutable double _sample_squared_sum;
 
   //bool _reset;
   double _min;
@@ -42,7 +42,14 @@ class Stats : public Module {
   int    _num_bins;
   double _bin_size;
 
-  vector<int> _hist;
+  mutable vector<int> _hist;
+
+  // Samples not yet added to _sample_sum and _hist; the count, min and max
+  // are always current since the traffic manager reads Max() per flit
+  static const size_t _batch_size = 64;
+  mutable vector<double> _pending;
+
+  void _Flush( ) const;
 
 public:
   Stats( Module *parent, const string &name,
@@ -63,7 +70,7 @@ public:
     AddSample( (double)val );
   }
 
-  int GetBin(int b){ return _hist[b];}
+  int GetBin(int b){ _Flush(); return _hist[b];}
 
   void Display( ostream & os = cout ) const;
 
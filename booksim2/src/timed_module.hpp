@@ -28,17 +28,120 @@
 #ifndef _TIMED_MODULE_HPP_
 #define _TIMED_MODULE_HPP_
 
+#include <vector>
+#include <algorithm>
+
 #include "module.hpp"
 
+class ActivityCalendar;
+
 class TimedModule : public Module {
+  friend class ActivityCalendar;
+
+  ActivityCalendar * _calendar;
+  int _order;       // position in the calendar's visiting order
+  bool _scheduled;
+  bool _woken;      // received an input this cycle
 
 public:
-  TimedModule(Module * parent, string const & name) : Module(parent, name) {}
+  TimedModule(Module * parent, string const & name, BookSimContext * ctx = 0) : Module(parent, name, ctx), 
+    _calendar(0), _order(0), _scheduled(false), _woken(false) {}
   virtual ~TimedModule() {}
   
   virtual void ReadInputs() = 0;
   virtual void Evaluate() = 0;
   virtual void WriteOutputs() = 0;
+
+  // True if ReadInputs/Evaluate/WriteOutputs would do nothing until the
+  // module receives a new input (see ActivityCalendar)
+  virtual bool IsIdle() const { return false; }
+
+  inline void Wake();
+};
+
+// Event-driven stepping of a set of timed modules. Only scheduled modules are
+// visited; a module is scheduled when woken by an input (a channel when data
+// is sent on it, a router when one of its channels delivers a flit or credit)
+// and is dropped once it is idle after WriteOutputs(). Modules are visited in
+// the order they were added, so stepping is cycle-exact with visiting every
+// module every cycle.
+class ActivityCalendar {
+  std::vector<TimedModule *> _active;
+  bool _sorted;
+
+  static bool _Before(TimedModule const * a, TimedModule const * b) {
+    return a->_order < b->_order;
+  }
+
+  inline void _Sort() {
+    if(!_sorted) {
+      std::sort(_active.begin(), _active.end(), _Before);
+      _sorted = true;
+    }
+  }
+
+public:
+  ActivityCalendar() : _sorted(true) {}
+
+  void Add(TimedModule * m) {
+    m->_calendar = this;
+    m->_order = _active.size();
+    Schedule(m);
+  }
+
+  inline void Schedule(TimedModule * m) {
+    m->_woken = true;
+    if(!m->_scheduled) {
+      m->_scheduled = true;
+      if(!_active.empty() && (_active.back()->_order > m->_order)) {
+        _sorted = false;
+      }
+      _active.push_back(m);
+    }
+  }
+
+  size_t NumScheduled() const { return _active.size(); }
+
+  // Modules woken during a phase are not visited until the next phase:
+  // waking only happens when a module's inputs change, and a module that
+  // was idle has nothing to do in the phase that woke it.
+  void ReadInputs() {
+    _Sort();
+    for(size_t i = 0, n = _active.size(); i < n; ++i) {
+      _active[i]->ReadInputs();
+    }
+  }
+
+  void Evaluate() {
+    _Sort();
+    for(size_t i = 0, n = _active.size(); i < n; ++i) {
+      _active[i]->Evaluate();
+    }
+  }
+
+  void WriteOutputs() {
+    _Sort();
+    for(size_t i = 0, n = _active.size(); i < n; ++i) {
+      _active[i]->WriteOutputs();
+    }
+    size_t k = 0;
+    for(size_t i = 0; i < _active.size(); ++i) {
+      TimedModule * const m = _active[i];
+      if(m->_woken || !m->IsIdle()) {
+        m->_woken = false;
+        _active[k++] = m;
+      } else {
+        m->_scheduled = false;
+      }
+    }
+    _active.resize(k);
+  }
 };
 
+inline void TimedModule::Wake() {
+  if(_calendar) {
+    _calendar->Schedule(this);
+  }
+}
+
 #endif
@@ -31,13 +31,21 @@
 #include "random_utils.hpp"
 #include "traffic.hpp"
 
-TrafficPattern::TrafficPattern(int nodes)
+int TrafficPattern::_instances = 0;
+
+TrafficPattern::TrafficPattern(BookSimContext * ctx, int nodes)
 : _nodes(nodes)
 {
   if(nodes <= 0) {
     cout << "Error: Traffic patterns require at least one node." << endl;
     exit(-1);
   }
+  int const instance = _instances++;
+  for(int n = 0; n < nodes; ++n) {
+    ostringstream name;
+    name << "traffic_" << instance << "/node_" << n;
+    _random.push_back(RandomStream(ctx, name.str(), RandomTraffic));
+  }
 }
 
 void TrafficPattern::reset()
@@ -45,7 +53,7 @@ void TrafficPattern::reset()
 
 }
 
-TrafficPattern * TrafficPattern::New(string const & pattern, int nodes, 
+TrafficPattern * TrafficPattern::New(BookSimContext * ctx, string const & pattern, int nodes, 
 				     Configuration const * const config)
 {
   string pattern_name;
@@ -66,13 +74,13 @@ TrafficPattern * TrafficPattern::New(string const & pattern, int nodes,
   
   TrafficPattern * result = NULL;
   if(pattern_name == "bitcomp") {
-    result = new BitCompTrafficPattern(nodes);
+    result = new BitCompTrafficPattern(ctx, nodes);
   } else if(pattern_name == "transpose") {
-    result = new TransposeTrafficPattern(nodes);
+    result = new TransposeTrafficPattern(ctx, nodes);
   } else if(pattern_name == "bitrev") {
-    result = new BitRevTrafficPattern(nodes);
+    result = new BitRevTrafficPattern(ctx, nodes);
   } else if(pattern_name == "shuffle") {
-    result = new ShuffleTrafficPattern(nodes);
+    result = new ShuffleTrafficPattern(ctx, nodes);
   } else if(pattern_name == "randperm") {
     int perm_seed = -1;
     if(params.empty()) {
@@ -90,18 +98,18 @@ TrafficPattern * TrafficPattern::New(string const & pattern, int nodes,
     } else {
       perm_seed = atoi(params[0].c_str());
     }
-    result = new RandomPermutationTrafficPattern(nodes, perm_seed);
+    result = new RandomPermutationTrafficPattern(ctx, nodes, perm_seed);
   } else if(pattern_name == "uniform") {
-    result = new UniformRandomTrafficPattern(nodes);
+    result = new UniformRandomTrafficPattern(ctx, nodes);
   } else if(pattern_name == "background") {
     vector<int> excludes = tokenize_int(params[0]);
-    result = new UniformBackgroundTrafficPattern(nodes, excludes);
+    result = new UniformBackgroundTrafficPattern(ctx, nodes, excludes);
   } else if(pattern_name == "diagonal") {
-    result = new DiagonalTrafficPattern(nodes);
+    result = new DiagonalTrafficPattern(ctx, nodes);
   } else if(pattern_name == "asymmetric") {
-    result = new AsymmetricTrafficPattern(nodes);
+    result = new AsymmetricTrafficPattern(ctx, nodes);
   } else if(pattern_name == "taper64") {
-    result = new Taper64TrafficPattern(nodes);
+    result = new Taper64TrafficPattern(ctx, nodes);
   } else if(pattern_name == "bad_dragon") {
     bool missing_params = false;
     int k = -1;
@@ -128,7 +136,7 @@ TrafficPattern * TrafficPattern::New(string const & pattern, int nodes,
       cout << "Error: Missing parameters for dragonfly bad permutation traffic pattern: " << pattern << endl;
       exit(-1);
     }
-    result = new BadPermDFlyTrafficPattern(nodes, k, n);
+    result = new BadPermDFlyTrafficPattern(ctx, nodes, k, n);
   } else if((pattern_name == "tornado") || (pattern_name == "neighbor") ||
 	    (pattern_name == "badperm_yarc")) {
     bool missing_params = false;
@@ -167,11 +175,11 @@ TrafficPattern * TrafficPattern::New(string const & pattern, int nodes,
       exit(-1);
     }
     if(pattern_name == "tornado") {
-      result = new TornadoTrafficPattern(nodes, k, n, xr);
+      result = new TornadoTrafficPattern(ctx, nodes, k, n, xr);
     } else if(pattern_name == "neighbor") {
-      result = new NeighborTrafficPattern(nodes, k, n, xr);
+      result = new NeighborTrafficPattern(ctx, nodes, k, n, xr);
     } else if(pattern_name == "badperm_yarc") {
-      result = new BadPermYarcTrafficPattern(nodes, k, n, xr);
+      result = new BadPermYarcTrafficPattern(ctx, nodes, k, n, xr);
     }
   } else if(pattern_name == "hotspot") {
     if(params.empty()) {
@@ -190,7 +198,7 @@ TrafficPattern * TrafficPattern::New(string const & pattern, int nodes,
     } else {
       rates.resize(hotspots.size(), 1);
     }
-    result = new HotSpotTrafficPattern(nodes, hotspots, rates);
+    result = new HotSpotTrafficPattern(ctx, nodes, hotspots, rates);
   } else {
     cout << "Error: Unknown traffic pattern: " << pattern << endl;
     exit(-1);
@@ -198,14 +206,14 @@ TrafficPattern * TrafficPattern::New(string const & pattern, int nodes,
   return result;
 }
 
-PermutationTrafficPattern::PermutationTrafficPattern(int nodes)
-  : TrafficPattern(nodes)
+PermutationTrafficPattern::PermutationTrafficPattern(BookSimContext * ctx, int nodes)
+  : TrafficPattern(ctx, nodes)
 {
   
 }
 
-BitPermutationTrafficPattern::BitPermutationTrafficPattern(int nodes)
-  : PermutationTrafficPattern(nodes)
+BitPermutationTrafficPattern::BitPermutationTrafficPattern(BookSimContext * ctx, int nodes)
+  : PermutationTrafficPattern(ctx, nodes)
 {
   if((nodes & -nodes) != nodes) {
     cout << "Error: Bit permutation traffic patterns require the number of "
@@ -214,8 +222,8 @@ BitPermutationTrafficPattern::BitPermutationTrafficPattern(int nodes)
   }
 }
 
-BitCompTrafficPattern::BitCompTrafficPattern(int nodes)
-  : BitPermutationTrafficPattern(nodes)
+BitCompTrafficPattern::BitCompTrafficPattern(BookSimContext * ctx, int nodes)
+  : BitPermutationTrafficPattern(ctx, nodes)
 {
   
 }
@@ -227,8 +235,8 @@ int BitCompTrafficPattern::dest(int source)
   return ~source & mask;
 }
 
-TransposeTrafficPattern::TransposeTrafficPattern(int nodes)
-  : BitPermutationTrafficPattern(nodes), _shift(0)
+TransposeTrafficPattern::TransposeTrafficPattern(BookSimContext * ctx, int nodes)
+  : BitPermutationTrafficPattern(ctx, nodes), _shift(0)
 {
   while(nodes >>= 1) {
     ++_shift;
@@ -249,8 +257,8 @@ int TransposeTrafficPattern::dest(int source)
   return (((source >> _shift) & mask_lo) | ((source << _shift) & mask_hi));
 }
 
-BitRevTrafficPattern::BitRevTrafficPattern(int nodes)
-  : BitPermutationTrafficPattern(nodes)
+BitRevTrafficPattern::BitRevTrafficPattern(BookSimContext * ctx, int nodes)
+  : BitPermutationTrafficPattern(ctx, nodes)
 {
   
 }
@@ -266,8 +274,8 @@ int BitRevTrafficPattern::dest(int source)
   return result;
 }
 
-ShuffleTrafficPattern::ShuffleTrafficPattern(int nodes)
-  : BitPermutationTrafficPattern(nodes)
+ShuffleTrafficPattern::ShuffleTrafficPattern(BookSimContext * ctx, int nodes)
+  : BitPermutationTrafficPattern(ctx, nodes)
 {
 
 }
@@ -279,15 +287,15 @@ int ShuffleTrafficPattern::dest(int source)
   return ((shifted & (_nodes - 1)) | bool(shifted & _nodes));
 }
 
-DigitPermutationTrafficPattern::DigitPermutationTrafficPattern(int nodes, int k,
+DigitPermutationTrafficPattern::DigitPermutationTrafficPattern(BookSimContext * ctx, int nodes, int k,
 							       int n, int xr)
-  : PermutationTrafficPattern(nodes), _k(k), _n(n), _xr(xr)
+  : PermutationTrafficPattern(ctx, nodes), _k(k), _n(n), _xr(xr)
 {
   
 }
 
-TornadoTrafficPattern::TornadoTrafficPattern(int nodes, int k, int n, int xr)
-  : DigitPermutationTrafficPattern(nodes, k, n, xr)
+TornadoTrafficPattern::TornadoTrafficPattern(BookSimContext * ctx, int nodes, int k, int n, int xr)
+  : DigitPermutationTrafficPattern(ctx, nodes, k, n, xr)
 {
 
 }
@@ -307,8 +315,8 @@ int TornadoTrafficPattern::dest(int source)
   return result;
 }
 
-NeighborTrafficPattern::NeighborTrafficPattern(int nodes, int k, int n, int xr)
-  : DigitPermutationTrafficPattern(nodes, k, n, xr)
+NeighborTrafficPattern::NeighborTrafficPattern(BookSimContext * ctx, int nodes, int k, int n, int xr)
+  : DigitPermutationTrafficPattern(ctx, nodes, k, n, xr)
 {
 
 }
@@ -328,9 +336,9 @@ int NeighborTrafficPattern::dest(int source)
   return result;
 }
 
-RandomPermutationTrafficPattern::RandomPermutationTrafficPattern(int nodes, 
+RandomPermutationTrafficPattern::RandomPermutationTrafficPattern(BookSimContext * ctx, int nodes, 
 								 int seed)
-  : TrafficPattern(nodes)
+  : TrafficPattern(ctx, nodes)
 {
   _dest.resize(nodes);
   randomize(seed);
@@ -371,14 +379,14 @@ int RandomPermutationTrafficPattern::dest(int source)
   return _dest[source];
 }
 
-RandomTrafficPattern::RandomTrafficPattern(int nodes)
-  : TrafficPattern(nodes)
+RandomTrafficPattern::RandomTrafficPattern(BookSimContext * ctx, int nodes)
+  : TrafficPattern(ctx, nodes)
 {
 
 }
 
-UniformRandomTrafficPattern::UniformRandomTrafficPattern(int nodes)
-  : RandomTrafficPattern(nodes)
+UniformRandomTrafficPattern::UniformRandomTrafficPattern(BookSimContext * ctx, int nodes)
+  : RandomTrafficPattern(ctx, nodes)
 {
 
 }
@@ -386,11 +394,11 @@ UniformRandomTrafficPattern::UniformRandomTrafficPattern(int nodes)
 int UniformRandomTrafficPattern::dest(int source)
 {
   assert((source >= 0) && (source < _nodes));
-  return RandomInt(_nodes - 1);
+  return _random[source].Int(_nodes - 1);
 }
 
-UniformBackgroundTrafficPattern::UniformBackgroundTrafficPattern(int nodes, vector<int> excluded_nodes)
-  : RandomTrafficPattern(nodes)
+UniformBackgroundTrafficPattern::UniformBackgroundTrafficPattern(BookSimContext * ctx, int nodes, vector<int> excluded_nodes)
+  : RandomTrafficPattern(ctx, nodes)
 {
   for(size_t i = 0; i < excluded_nodes.size(); ++i) {
     int const node = excluded_nodes[i];
@@ -406,14 +414,14 @@ int UniformBackgroundTrafficPattern::dest(int source)
   int result;
 
   do {
-    result = RandomInt(_nodes - 1);
+    result = _random[source].Int(_nodes - 1);
   } while(_excluded.count(result) > 0);
 
   return result;
 }
 
-DiagonalTrafficPattern::DiagonalTrafficPattern(int nodes)
-  : RandomTrafficPattern(nodes)
+DiagonalTrafficPattern::DiagonalTrafficPattern(BookSimContext * ctx, int nodes)
+  : RandomTrafficPattern(ctx, nodes)
 {
 
 }
@@ -421,11 +429,11 @@ DiagonalTrafficPattern::DiagonalTrafficPattern(int nodes)
 int DiagonalTrafficPattern::dest(int source)
 {
   assert((source >= 0) && (source < _nodes));
-  return ((RandomInt(2) == 0) ? ((source + 1) % _nodes) : source);
+  return ((_random[source].Int(2) == 0) ? ((source + 1) % _nodes) : source);
 }
 
-AsymmetricTrafficPattern::AsymmetricTrafficPattern(int nodes)
-  : RandomTrafficPattern(nodes)
+AsymmetricTrafficPattern::AsymmetricTrafficPattern(BookSimContext * ctx, int nodes)
+  : RandomTrafficPattern(ctx, nodes)
 {
 
 }
@@ -434,11 +442,11 @@ int AsymmetricTrafficPattern::dest(int source)
 {
   assert((source >= 0) && (source < _nodes));
   int const half = _nodes / 2;
-  return (source % half) + (RandomInt(1) ? half : 0);
+  return (source % half) + (_random[source].Int(1) ? half : 0);
 }
 
-Taper64TrafficPattern::Taper64TrafficPattern(int nodes)
-  : RandomTrafficPattern(nodes)
+Taper64TrafficPattern::Taper64TrafficPattern(BookSimContext * ctx, int nodes)
+  : RandomTrafficPattern(ctx, nodes)
 {
   if(nodes != 64) {
     cout << "Error: Tthe Taper64 traffic pattern requires the number of nodes "
@@ -450,15 +458,15 @@ Taper64TrafficPattern::Taper64TrafficPattern(int nodes)
 int Taper64TrafficPattern::dest(int source)
 {
   assert((source >= 0) && (source < _nodes));
-  if(RandomInt(1)) {
-    return ((64 + source + 8 * (RandomInt(2) - 1) + (RandomInt(2) - 1)) % 64);
+  if(_random[source].Int(1)) {
+    return ((64 + source + 8 * (_random[source].Int(2) - 1) + (_random[source].Int(2) - 1)) % 64);
   } else {
-    return RandomInt(_nodes - 1);
+    return _random[source].Int(_nodes - 1);
   }
 }
 
-BadPermDFlyTrafficPattern::BadPermDFlyTrafficPattern(int nodes, int k, int n)
-  : DigitPermutationTrafficPattern(nodes, k, n, 1)
+BadPermDFlyTrafficPattern::BadPermDFlyTrafficPattern(BookSimContext * ctx, int nodes, int k, int n)
+  : DigitPermutationTrafficPattern(ctx, nodes, k, n, 1)
 {
   
 }
@@ -470,12 +478,12 @@ int BadPermDFlyTrafficPattern::dest(int source)
   int const grp_size_routers = 2 * _k;
   int const grp_size_nodes = grp_size_routers * _k;
 
-  return ((RandomInt(grp_size_nodes - 1) + ((source / grp_size_nodes) + 1) * grp_size_nodes) % _nodes);
+  return ((_random[source].Int(grp_size_nodes - 1) + ((source / grp_size_nodes) + 1) * grp_size_nodes) % _nodes);
 }
 
-BadPermYarcTrafficPattern::BadPermYarcTrafficPattern(int nodes, int k, int n, 
+BadPermYarcTrafficPattern::BadPermYarcTrafficPattern(BookSimContext * ctx, int nodes, int k, int n, 
 						     int xr)
-  : DigitPermutationTrafficPattern(nodes, k, n, xr)
+  : DigitPermutationTrafficPattern(ctx, nodes, k, n, xr)
 {
 
 }
@@ -484,12 +492,12 @@ int BadPermYarcTrafficPattern::dest(int source)
 {
   assert((source >= 0) && (source < _nodes));
   int const row = source / (_xr * _k);
-  return RandomInt((_xr * _k) - 1) * (_xr * _k) + row;
+  return _random[source].Int((_xr * _k) - 1) * (_xr * _k) + row;
 }
 
-HotSpotTrafficPattern::HotSpotTrafficPattern(int nodes, vector<int> hotspots, 
+HotSpotTrafficPattern::HotSpotTrafficPattern(BookSimContext * ctx, int nodes, vector<int> hotspots, 
 					     vector<int> rates)
-  : TrafficPattern(nodes), _hotspots(hotspots), _rates(rates), _max_val(-1)
+  : TrafficPattern(ctx, nodes), _hotspots(hotspots), _rates(rates), _max_val(-1)
 {
   assert(!_hotspots.empty());
   size_t const size = _hotspots.size();
@@ -511,7 +519,7 @@ int HotSpotTrafficPattern::dest(int source)
     return _hotspots[0];
   }
 
-  int pct = RandomInt(_max_val);
+  int pct = _random[source].Int(_max_val);
 
   for(size_t i = 0; i < (_hotspots.size() - 1); ++i) {
     int const limit = _rates[i];
@@ -31,34 +31,37 @@
 #include <vector>
 #include <set>
 #include "config_utils.hpp"
+#include "random_utils.hpp"
 
 using namespace std;
 
 class TrafficPattern {
 protected:
   int _nodes;
-  TrafficPattern(int nodes);
+  vector<RandomStream> _random; // one per source node
+  static int _instances;
+  TrafficPattern(BookSimContext * ctx, int nodes);
 public:
   virtual ~TrafficPattern() {}
   virtual void reset();
   virtual int dest(int source) = 0;
-  static TrafficPattern * New(string const & pattern, int nodes, 
+  static TrafficPattern * New(BookSimContext * ctx, string const & pattern, int nodes, 
 			      Configuration const * const config = NULL);
 };
 
 class PermutationTrafficPattern : public TrafficPattern {
 protected:
-  PermutationTrafficPattern(int nodes);
+  PermutationTrafficPattern(BookSimContext * ctx, int nodes);
 };
 
 class BitPermutationTrafficPattern : public PermutationTrafficPattern {
 protected:
-  BitPermutationTrafficPattern(int nodes);
+  BitPermutationTrafficPattern(BookSimContext * ctx, int nodes);
 };
 
 class BitCompTrafficPattern : public BitPermutationTrafficPattern {
 public:
-  BitCompTrafficPattern(int nodes);
+  BitCompTrafficPattern(BookSimContext * ctx, int nodes);
   virtual int dest(int source);
 };
 
@@ -66,19 +69,19 @@ class TransposeTrafficPattern : public BitPermutationTrafficPattern {
 protected:
   int _shift;
 public:
-  TransposeTrafficPattern(int nodes);
+  TransposeTrafficPattern(BookSimContext * ctx, int nodes);
   virtual int dest(int source);
 };
 
 class BitRevTrafficPattern : public BitPermutationTrafficPattern {
 public:
-  BitRevTrafficPattern(int nodes);
+  BitRevTrafficPattern(BookSimContext * ctx, int nodes);
   virtual int dest(int source);
 };
 
 class ShuffleTrafficPattern : public BitPermutationTrafficPattern {
 public:
-  ShuffleTrafficPattern(int nodes);
+  ShuffleTrafficPattern(BookSimContext * ctx, int nodes);
   virtual int dest(int source);
 };
 
@@ -87,18 +90,18 @@ protected:
   int _k;
   int _n;
   int _xr;
-  DigitPermutationTrafficPattern(int nodes, int k, int n, int xr = 1);
+  DigitPermutationTrafficPattern(BookSimContext * ctx, int nodes, int k, int n, int xr = 1);
 };
 
 class TornadoTrafficPattern : public DigitPermutationTrafficPattern {
 public:
-  TornadoTrafficPattern(int nodes, int k, int n, int xr = 1);
+  TornadoTrafficPattern(BookSimContext * ctx, int nodes, int k, int n, int xr = 1);
   virtual int dest(int source);
 };
 
 class NeighborTrafficPattern : public DigitPermutationTrafficPattern {
 public:
-  NeighborTrafficPattern(int nodes, int k, int n, int xr = 1);
+  NeighborTrafficPattern(BookSimContext * ctx, int nodes, int k, int n, int xr = 1);
   virtual int dest(int source);
 };
 
@@ -107,18 +110,18 @@ private:
   vector<int> _dest;
   inline void randomize(int seed);
 public:
-  RandomPermutationTrafficPattern(int nodes, int seed);
+  RandomPermutationTrafficPattern(BookSimContext * ctx, int nodes, int seed);
   virtual int dest(int source);
 };
 
 class RandomTrafficPattern : public TrafficPattern {
 protected:
-  RandomTrafficPattern(int nodes);
+  RandomTrafficPattern(BookSimContext * ctx, int nodes);
 };
 
 class UniformRandomTrafficPattern : public RandomTrafficPattern {
 public:
-  UniformRandomTrafficPattern(int nodes);
+  UniformRandomTrafficPattern(BookSimContext * ctx, int nodes);
   virtual int dest(int source);
 };
 
@@ -126,37 +129,37 @@ class UniformBackgroundTrafficPattern : public RandomTrafficPattern {
 private:
   set<int> _excluded;
 public:
-  UniformBackgroundTrafficPattern(int nodes, vector<int> excluded_nodes);
+  UniformBackgroundTrafficPattern(BookSimContext * ctx, int nodes, vector<int> excluded_nodes);
   virtual int dest(int source);
 };
 
 class DiagonalTrafficPattern : public RandomTrafficPattern {
 public:
-  DiagonalTrafficPattern(int nodes);
+  DiagonalTrafficPattern(BookSimContext * ctx, int nodes);
   virtual int dest(int source);
 };
 
 class AsymmetricTrafficPattern : public RandomTrafficPattern {
 public:
-  AsymmetricTrafficPattern(int nodes);
+  AsymmetricTrafficPattern(BookSimContext * ctx, int nodes);
   virtual int dest(int source);
 };
 
 class Taper64TrafficPattern : public RandomTrafficPattern {
 public:
-  Taper64TrafficPattern(int nodes);
+  Taper64TrafficPattern(BookSimContext * ctx, int nodes);
   virtual int dest(int source);
 };
 
 class BadPermDFlyTrafficPattern : public DigitPermutationTrafficPattern {
 public:
-  BadPermDFlyTrafficPattern(int nodes, int k, int n);
+  BadPermDFlyTrafficPattern(BookSimContext * ctx, int nodes, int k, int n);
   virtual int dest(int source);
 };
 
 class BadPermYarcTrafficPattern : public DigitPermutationTrafficPattern {
 public:
-  BadPermYarcTrafficPattern(int nodes, int k, int n, int xr = 1);
+  BadPermYarcTrafficPattern(BookSimContext * ctx, int nodes, int k, int n, int xr = 1);
   virtual int dest(int source);
 };
 
@@ -166,7 +169,7 @@ private:
   vector<int> _rates;
   int _max_val;
 public:
-  HotSpotTrafficPattern(int nodes, vector<int> hotspots, 
+  HotSpotTrafficPattern(BookSimContext * ctx, int nodes, vector<int> hotspots, 
 			vector<int> rates = vector<int>());
   virtual int dest(int source);
 };
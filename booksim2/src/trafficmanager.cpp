@@ -71,7 +71,7 @@ TrafficManager * TrafficManager::New(Configuration const & config,
 }
 
 TrafficManager::TrafficManager( const Configuration &config, const vector<Network *> & net, InterconnectInterface* parentInterface )
-    : Module( 0, "traffic_manager" ), _net(net), _empty_network(false), _deadlock_timer(0), _reset_time(0), _drain_time(-1), _cur_id(0), _cur_pid(0), _time(0)
+    : Module( 0, "traffic_manager", parentInterface->GetContext( ) ), _net(net), _empty_network(false), _deadlock_timer(0), _reset_time(0), _drain_time(-1), _cur_id(0), _cur_pid(0), _time(0)
 {
     parent = parentInterface;
     _nodes = _net[0]->NumNodes( );
@@ -246,8 +246,8 @@ TrafficManager::TrafficManager( const Configuration &config, const vector<Networ
     _injection_process.resize(_classes);
 
     for(int c = 0; c < _classes; ++c) {
-        _traffic_pattern[c] = TrafficPattern::New(_traffic[c], _nodes, &config);
-        _injection_process[c] = InjectionProcess::New(injection_process[c], _nodes, _load[c], &config);
+        _traffic_pattern[c] = TrafficPattern::New(_ctx, _traffic[c], _nodes, &config);
+        _injection_process[c] = InjectionProcess::New(_ctx, injection_process[c], _nodes, _load[c], &config);
     }
 
     // ============ Injection VC states  ============ 
@@ -300,11 +300,58 @@ TrafficManager::TrafficManager( const Configuration &config, const vector<Networ
     _total_in_flight_flits.resize(_classes);
     _measured_in_flight_flits.resize(_classes);
     _retired_packets.resize(_classes);
+    _retired_mcast_packets.resize(_classes);
+
+    // Routers keep a multicast packet buffered until every branch got a copy,
+    // so it must fit in a VC; only the IQ router replicates packets
+    _mcast_max_size = (config.GetInt("buf_size") <= 0) ? config.GetInt("vc_buf_size") : 0;
+#if defined(_SKIP_STEP_) || defined(_EMPTY_STEP_)
+    _mcast_supported = false;
+#else
+    _mcast_supported = (config.GetStr("router") == "iq") && !_noq && (_nodes <= 64) &&
+        (config.GetInt("packet_size") <= _mcast_max_size);
+#endif
 
     _packet_seq_no.resize(_nodes);
+    for (int n = 0; n < _nodes; ++n) {
+        ostringstream name;
+        name << "node_" << n;
+        _subnet_random.push_back(RandomStream(_ctx, name.str(), RandomSubnet));
+    }
     _repliesPending.resize(_nodes);
     _requestsOutstanding.resize(_nodes);
 
+    // ============ Sampled simulation ============
+
+    _sampling = (config.GetInt("noc_sampling") != 0);
+    _sampling_warmup = config.GetInt("sampling_warmup_cycles");
+    _sampling_detailed = config.GetInt("sampling_detailed_cycles");
+    _sampling_functional = config.GetInt("sampling_functional_cycles");
+    _sampling_history = config.GetInt("sampling_history");
+    if(_sampling) {
+#if defined(_SKIP_STEP_) || defined(_EMPTY_STEP_)
+        Error("noc_sampling needs the detailed network (built without SKIP_STEP and EMPTY_STEP)");
+#endif
+        if((_sampling_warmup < 0) || (_sampling_detailed <= 0) || (_sampling_functional <= 0) || (_sampling_history <= 0)) {
+            Error("noc_sampling needs sampling_detailed_cycles, sampling_functional_cycles and sampling_history > 0, and sampling_warmup_cycles >= 0");
+        }
+        _sampling_pair_lat.resize(_nodes * _nodes);
+        _sampling_pair_next.resize(_nodes * _nodes, 0);
+    }
+    _sampling_phase = sampling_warmup;
+    _sampling_phase_end = _sampling_warmup;
+    _sampling_warmup_start = 0;
+    _sampling_functional_start = -1;
+    _sampling_random = RandomStream(_ctx, "traffic_manager", RandomSample);
+    _sampling_win_open = false;
+    _sampling_win_start = _sampling_win_end = 0;
+    _sampling_win_lat = 0.0;
+    _sampling_win_packets = _sampling_win_accepted = 0;
+    _sampling_plat_stats = new Stats(this, "sampling_plat_stat", 1.0, 1000);
+    _sampling_accepted_stats = new Stats(this, "sampling_accepted_stat", 0.001, 1000);
+    _sampling_detailed_steps = _sampling_skipped_steps = 0;
+    _sampling_detailed_packets = _sampling_functional_packets = _sampling_ghost_packets = 0;
+
     _hold_switch_for_packet = config.GetInt("hold_switch_for_packet");
 
     // ============ Simulation parameters ============ 
@@ -325,6 +372,7 @@ TrafficManager::TrafficManager( const Configuration &config, const vector<Networ
       seed = config.GetInt("seed");
     }
     RandomSeed(seed);
+    RandomStreamsInit(_ctx, seed, config.GetInt("random_streams") > 0);
 
     _measure_latency = (config.GetStr("sim_type") == "latency");
 
@@ -388,6 +436,11 @@ TrafficManager::TrafficManager( const Configuration &config, const vector<Networ
     for(size_t i = 0; i < watch_packets.size(); ++i) {
         _packets_to_watch.insert(watch_packets[i]);
     }
+#ifdef _NO_WATCH_
+    if(!_flits_to_watch.empty() || !_packets_to_watch.empty()) {
+        cout << "WARNING: watch lists are ignored, BookSim was built with _NO_WATCH_" << endl;
+    }
+#endif
 
     string stats_out_file = config.GetStr( "stats_out" );
     if(stats_out_file == "") {
@@ -643,6 +696,9 @@ TrafficManager::~TrafficManager( )
         }
     }
   
+    delete _sampling_plat_stats;
+    delete _sampling_accepted_stats;
+
     for ( int c = 0; c < _classes; ++c ) {
         delete _plat_stats[c];
         delete _nlat_stats[c];
@@ -683,9 +739,9 @@ TrafficManager::~TrafficManager( )
     if(_max_credits_out) delete _max_credits_out;
 #endif
 
-    PacketReplyInfo::FreeAll();
-    Flit::FreeAll();
-    Credit::FreeAll();
+    PacketReplyInfo::FreeAll(_ctx);
+    Flit::FreeAll(_ctx);
+    Credit::FreeAll(_ctx);
 }
 
 void TrafficManager::Init()
@@ -694,7 +750,7 @@ void TrafficManager::Init()
     _requestsOutstanding.assign(_nodes, 0);
     for (int i=0;i<_nodes;i++) {
         while(!_repliesPending[i].empty()) {
-            _repliesPending[i].front()->Free();
+            _repliesPending[i].front()->Free(_ctx);
             _repliesPending[i].pop_front();
         }
     }
@@ -730,12 +786,20 @@ void TrafficManager::_RetireFlit( Flit *f, int dest )
     #endif
     _deadlock_timer = 0;
 
-    assert(_total_in_flight_flits[f->cl].count(f->id) > 0);
-    _total_in_flight_flits[f->cl].erase(f->id);
+    if(f->mcast) {
+        map<int, int>::iterator iter = _mcast_in_flight_flits.find(f->id);
+        assert(iter != _mcast_in_flight_flits.end());
+        if(--iter->second == 0) {
+            _mcast_in_flight_flits.erase(iter);
+        }
+    } else {
+        assert(_total_in_flight_flits[f->cl].count(f->id) > 0);
+        _total_in_flight_flits[f->cl].erase(f->id);
   
-    if(f->record) {
-        assert(_measured_in_flight_flits[f->cl].count(f->id) > 0);
-        _measured_in_flight_flits[f->cl].erase(f->id);
+        if(f->record) {
+            assert(_measured_in_flight_flits[f->cl].count(f->id) > 0);
+            _measured_in_flight_flits[f->cl].erase(f->id);
+        }
     }
 
     if ( f->watch ) { 
@@ -773,6 +837,13 @@ void TrafficManager::_RetireFlit( Flit *f, int dest )
         Flit * head;
         if(f->head) {
             head = f;
+        } else if(f->mcast) {
+            map<pair<int, int>, Flit *>::iterator iter = _retired_mcast_packets[f->cl].find(make_pair(f->pid, dest));
+            assert(iter != _retired_mcast_packets[f->cl].end());
+            head = iter->second;
+            _retired_mcast_packets[f->cl].erase(iter);
+            assert(head->head);
+            assert(f->pid == head->pid);
         } else {
             map<int, Flit *>::iterator iter = _retired_packets[f->cl].find(f->pid);
             assert(iter != _retired_packets[f->cl].end());
@@ -795,7 +866,7 @@ void TrafficManager::_RetireFlit( Flit *f, int dest )
 
         //code the source of request, look carefully, its tricky ;)
         if (f->type == Flit::READ_REQUEST || f->type == Flit::WRITE_REQUEST) {
-            PacketReplyInfo* rinfo = PacketReplyInfo::New();
+            PacketReplyInfo* rinfo = PacketReplyInfo::New(_ctx);
             rinfo->source = f->src;
             rinfo->time = f->atime;
             rinfo->record = f->record;
@@ -828,17 +899,25 @@ void TrafficManager::_RetireFlit( Flit *f, int dest )
                 _pair_nlat[f->cl][f->src*_nodes+dest]->AddSample( (double) (f->atime - head->itime) );
             }
         }
+
+        if(_sampling && f->record) {
+            _SamplingRecordLatency(f->src, dest, head->ctime, f->atime);
+        }
     
         if(f != head) {
-            head->Free();
+            head->Free(_ctx);
         }
     
     }
   
     if(f->head && !f->tail) {
-        _retired_packets[f->cl].insert(make_pair(f->pid, f));
+        if(f->mcast) {
+            _retired_mcast_packets[f->cl].insert(make_pair(make_pair(f->pid, dest), f));
+        } else {
+            _retired_packets[f->cl].insert(make_pair(f->pid, f));
+        }
     } else {
-        f->Free();
+        f->Free(_ctx);
     }
 }
 
@@ -852,19 +931,34 @@ void TrafficManager::_Step( )
             _in_flight_packets.erase(itPack.first);
 
             auto it = _in_flight_req_address.find(itPack.first);
-            parent->CallbackEverything(it->second.second, it->second.first);
+            parent->CallbackEverything(it->second.second, -1, it->second.first);
             _in_flight_req_address.erase(it);
         }
     }
 #endif
 
 
+    if(_sampling) {
+        _SamplingStep();
+    }
+
 // leave this on if _EMPTY_STEP_ but not if _SKIP_STEP_
 #ifndef _SKIP_STEP_
     bool flits_in_flight = false;
     for(int c = 0; c < _classes; ++c) {
         flits_in_flight |= !_total_in_flight_flits[c].empty(); // check that there is at least one flit waiting in a class
     }
+    flits_in_flight |= !_mcast_in_flight_flits.empty();
+    if(_sampling) {
+        if(!flits_in_flight && (_sampling_phase == sampling_functional)) {
+            // the last detailed window has drained; like the idle steps
+            // skipped by InterconnectInterface::Step, only time advances
+            ++_sampling_skipped_steps;
+            ++_time;
+            return;
+        }
+        ++_sampling_detailed_steps;
+    }
     if(flits_in_flight && (_deadlock_timer++ >= _deadlock_warn_timeout)){
         _deadlock_timer = 0;
         cout << "WARNING: Possible network deadlock.\n";
@@ -918,8 +1012,8 @@ void TrafficManager::_Step( )
             Credit * const c = _net[subnet]->ReadCredit( n ); // read the credit given by the local RNI
             if ( c ) { 
 #ifdef TRACK_FLOWS
-                for(set<int>::const_iterator iter = c->vc.begin(); iter != c->vc.end(); ++iter) {
-                    int const vc = *iter;
+                for(uint64_t mask = c->vc_mask; mask; mask &= mask - 1) {
+                    int const vc = Credit::FirstVC(mask);
                     assert(!_outstanding_classes[n][subnet][vc].empty());
                     int cl = _outstanding_classes[n][subnet][vc].front();
                     _outstanding_classes[n][subnet][vc].pop();
@@ -928,7 +1022,7 @@ void TrafficManager::_Step( )
                 }
 #endif
                 _buf_states[n][subnet]->ProcessCredit(c);
-                c->Free();
+                c->Free(_ctx);
             }
         }
         /* Read the inputs for everything in _time_modules which includes every channel in the network, 
@@ -1014,7 +1108,7 @@ void TrafficManager::_Step( )
                     if(cf->head && cf->vc == -1) { // Find first available VC
         
                         OutputSet route_set;
-                        _rf(NULL, cf, -1, &route_set, true); //
+                        _rf(_ctx, NULL, cf, -1, &route_set, true); //
                         set<OutputSet::sSetElement> const & os = route_set.GetSet();
                         assert(os.size() == 1);
                         OutputSet::sSetElement const & se = *os.begin();
@@ -1033,7 +1127,7 @@ void TrafficManager::_Step( )
                             // first hop, we have to temporarily set cf's VC to be non-negative 
                             // in order to avoid seting of an assertion in the routing function.
                             cf->vc = vc_start;
-                            _rf(router, cf, in_channel, &cf->la_route_set, false); // Lookahead route info:  OutputSet la_route_set;
+                            _rf(_ctx, router, cf, in_channel, &cf->la_route_set, false); // Lookahead route info:  OutputSet la_route_set;
                             cf->vc = -1;
 
                             if(cf->watch) {
@@ -1130,7 +1224,7 @@ void TrafficManager::_Step( )
                                 int in_channel = inject->GetSinkPort();
                                 //( const Router *, const Flit *, int in_channel, OutputSet *, bool );
                                 // sig faults here
-                                _rf(router, f, in_channel/*the output of inject*/, &f->la_route_set, false); // sets lookahead (la_route_set)
+                                _rf(_ctx, router, f, in_channel/*the output of inject*/, &f->la_route_set, false); // sets lookahead (la_route_set)
                                 if(f->watch) {
                                     *gWatchOut << GetSimTime() << " | "
                                             << "node" << n << " | "
@@ -1239,8 +1333,8 @@ void TrafficManager::_Step( )
                 }
                 // if there is a flit waiting to be ejected, I need to create a new credit --
                 // and distribute it to the upstream router
-                Credit * const c = Credit::New();
-                c->vc.insert(f->vc);
+                Credit * const c = Credit::New(_ctx);
+                c->AddVC(f->vc);
                 _net[subnet]->WriteCredit(c, n);
 	
 #ifdef TRACK_FLOWS
@@ -1248,11 +1342,23 @@ void TrafficManager::_Step( )
 #endif
 	
                 _RetireFlit(f, n); // here the flit is also deleted from the total_in_flight_flits
-                if (f->tail == true){
+                if (f->tail && _sampling && _sampling_ghosts.erase(f->pid)) {
+                    // ghost packets replayed by sampled simulation have no callback
+                } else if (f->tail == true){
                         auto it = _in_flight_req_address.find(f->pid);
                         // _in_flight_req_address.insert(make_pair(pid,make_pair(nocAddr,addr) ));
-                        parent->CallbackEverything(f->pid, it->second.first);
-                        _in_flight_req_address.erase(it);  
+                        parent->CallbackEverything(f->pid, n, it->second.first);
+                        if(!f->mcast) {
+                            _in_flight_req_address.erase(it);  
+                        } else {
+                            // multicast packets complete once per destination
+                            map<uint64_t, int>::iterator dit = _mcast_dests_left.find(f->pid);
+                            assert(dit != _mcast_dests_left.end());
+                            if(--dit->second == 0) {
+                                _mcast_dests_left.erase(dit);
+                                _in_flight_req_address.erase(it);
+                            }
+                        }
                 }
 
             }
@@ -1275,6 +1381,9 @@ void TrafficManager::_Step( )
 
 bool TrafficManager::_PacketsOutstanding( ) const
 {
+    if(!_mcast_in_flight_flits.empty()) {
+        return true;
+    }
     for ( int c = 0; c < _classes; ++c ) {
         if ( _measure_stats[c] ) {
             if ( _measured_in_flight_flits[c].empty() ) {
@@ -2126,16 +2235,36 @@ void TrafficManager::printInjectedPackets() {
 }
 
 uint64_t TrafficManager::_ManuallyGeneratePacket(int source, int dest, int size, simTime ctime, uint64_t addr, bool llcEvent, BookSimNetwork *nocAddr){
+    return _GenerateZsimPacket(source, dest, 0, size, ctime, addr, llcEvent, nocAddr);
+}
+
+uint64_t TrafficManager::_ManuallyGenerateMulticastPacket(int source, uint64_t dests, int size, simTime ctime, uint64_t addr, bool llcEvent, BookSimNetwork *nocAddr){
+    if(!_mcast_supported) {
+        Error("Multicast packets need the IQ router, no NOQ, at most 64 nodes and packets that fit in a VC buffer");
+    }
+    if(size > _mcast_max_size) {
+        ostringstream err;
+        err << "Multicast packet of " << size << " flits does not fit in a VC buffer (" << _mcast_max_size << " flits)";
+        Error(err.str());
+    }
+    assert(dests);
+    return _GenerateZsimPacket(source, __builtin_ctzll(dests), dests, size, ctime, addr, llcEvent, nocAddr);
+}
+
+uint64_t TrafficManager::_GenerateZsimPacket(int source, int dest, uint64_t mcast_dests, int size, simTime ctime, uint64_t addr, bool llcEvent, BookSimNetwork *nocAddr){
     // The packets here are used by zsim, so no warmup stage is needed.
     // In running stage, record is always one and the packets are also
     // inserted in the _measured_in_flight_flits vector as well.
+    // nocAddr is NULL for the ghost packets replayed by sampled simulation;
+    // they only load the network, are not recorded and get no callback.
     if (ctime < 0){
         ctime = _time;
     }
-    int result = _injection_process[0]->test(source) ? 1 : 0;
-    _requestsOutstanding[source]++;
+    bool const ghost = (nocAddr == NULL);
+    int const num_dests = mcast_dests ? __builtin_popcountll(mcast_dests) : 1;
+    _requestsOutstanding[source] += num_dests; // retired once per destination
 
-    if (result != 0){
+    if (!ghost && _injection_process[0]->test(source)){
         _packet_seq_no[source]++;
     }
 
@@ -2146,17 +2275,23 @@ uint64_t TrafficManager::_ManuallyGeneratePacket(int source, int dest, int size,
     // int size = _GetNextPacketSize(cl); //input size 
     uint64_t pid = _cur_pid++;
 
-    _in_flight_req_address.insert(make_pair(pid,make_pair(nocAddr,addr) ));
+    if(ghost) {
+        _sampling_ghosts.insert(pid);
+    } else {
+        _in_flight_req_address.insert(make_pair(pid,make_pair(nocAddr,addr) ));
+    }
     assert(_cur_pid);
-    bool record = true; 
+    bool record = !ghost; 
 
+#ifndef _NO_WATCH_
 #ifdef PRINT_ALL //print all packets
     bool watch = 1;
 #else
     bool watch =  gWatchOut && (_packets_to_watch.count(pid) > 0);
+#endif
 #endif
     int subnetwork = ((packet_type == Flit::ANY_TYPE) ? 
-                      RandomInt(_subnets-1) :
+                      _subnet_random[source].Int(_subnets-1) :
                       _subnet[packet_type]);
   
 
@@ -2168,28 +2303,50 @@ uint64_t TrafficManager::_ManuallyGeneratePacket(int source, int dest, int size,
     int zll = (abs(dst_x-src_x) + abs(dst_y-src_y) + 1)*(4) + (5-1) + 50; // hoplatency = 4, flits/packet = 5, hack = 3
 
     _in_flight_packets.insert(make_pair(pid, zll));
+    assert(!mcast_dests);
 #else
+    if(_sampling && !ghost) {
+        if((_sampling_phase == sampling_functional) &&
+           _SamplingFunctionalPacket(pid, source, dest, mcast_dests, size)) {
+            return pid;
+        }
+        ++_sampling_detailed_packets;
+    }
+
+    if(mcast_dests) {
+        _mcast_dests_left.insert(make_pair(pid, num_dests));
+    }
 
 
     for ( int i = 0; i < size; ++i ) { // input size
-        Flit * f  = Flit::New(); //generate a new flit 
+        Flit * f  = Flit::New(_ctx); //generate a new flit 
         f->id     = _cur_id++;
         assert(_cur_id);
         f->pid    = pid;
+#ifndef _NO_WATCH_
         f->watch  = watch | (gWatchOut && (_flits_to_watch.count(f->id) > 0));
+#endif
         f->subnetwork = subnetwork;
         f->src    = source;
         f->ctime  = ctime; // the packet carries the _time that was created 
         f->record = record;
         f->cl     = cl;
         f->llcEvent = llcEvent;
+        f->mcast = (mcast_dests != 0);
 
 
         //contains all the newly generated flits. 
         // Note that this assignment happens BEFORE the f->head, f->dest, f->pri etc  are set
-        _total_in_flight_flits[f->cl].insert(make_pair(f->id, f)); 
+        if(f->mcast) {
+            // copies are made on the way, each destination retires one
+            _mcast_in_flight_flits.insert(make_pair(f->id, num_dests));
+        } else {
+            _total_in_flight_flits[f->cl].insert(make_pair(f->id, f)); 
+        }
         if(record) { 
-            _measured_in_flight_flits[f->cl].insert(make_pair(f->id, f));
+            if(!f->mcast) {
+                _measured_in_flight_flits[f->cl].insert(make_pair(f->id, f));
+            }
             #ifdef CALC_INJECTION_RATE
             cnt_msr_flits[f->src]++;
             cnt_msr_flit_total++;
@@ -2209,6 +2366,7 @@ uint64_t TrafficManager::_ManuallyGeneratePacket(int source, int dest, int size,
             f->head = true;
             //packets are only generated to nodes smaller or equal to limit
             f->dest = dest;
+            f->mcast_dests = mcast_dests;
         } else {
             f->head = false;
             f->dest = -1; // destination -1 when body flit
@@ -2232,15 +2390,256 @@ uint64_t TrafficManager::_ManuallyGeneratePacket(int source, int dest, int size,
     }
 
 #ifdef EXTRA_STATS
-    ++_createdPackets[source][dest];
+    uint64_t dests_left = mcast_dests;
+    do {
+        int d = dest;
+        if(dests_left) {
+            d = __builtin_ctzll(dests_left);
+            dests_left &= dests_left - 1;
+        }
+        ++_createdPackets[source][d];
+        if(llcEvent){
+            ++_createdPacketsLLC[source][d];
+        } else {
+            ++_createdPacketsRest[source][d];
+        }
+    } while(dests_left);
     _createdFlits[source] += size;
-    if(llcEvent){
-        ++_createdPacketsLLC[source][dest];
-    } else {
-        ++_createdPacketsRest[source][dest];
-    }
 #endif
     outstandingFlits[subnetwork][source] += size;
     return pid;
 #endif
 }
+
+//------------------------------------------------------------------------------
+// sampled simulation
+//------------------------------------------------------------------------------
+
+// Called at the start of every step: moves between phases and delivers the
+// functional packets that are due
+void TrafficManager::_SamplingStep( )
+{
+    while(_time >= _sampling_phase_end) {
+        if(_sampling_phase == sampling_functional) {
+            _SamplingCloseWindow();
+            _sampling_phase = sampling_warmup;
+            _sampling_warmup_start = _time;
+            _sampling_phase_end = _time + _sampling_warmup;
+            for(deque<SamplingInjection>::const_iterator iter = _sampling_recent.begin();
+                iter != _sampling_recent.end(); ++iter) {
+                if(iter->done > _time) {
+                    _GenerateZsimPacket(iter->src, iter->dest, 0, iter->size, _time, 0, false, NULL);
+                    ++_sampling_ghost_packets;
+                }
+            }
+            _sampling_recent.clear();
+        } else if(_sampling_phase == sampling_warmup) {
+            _sampling_phase = sampling_detailed;
+            _sampling_phase_end = _time + _sampling_detailed;
+            _sampling_win_open = true;
+            _sampling_win_start = _time;
+            _sampling_win_end = _sampling_phase_end;
+            _sampling_win_lat = 0.0;
+            _sampling_win_packets = 0;
+            _sampling_win_accepted = 0;
+        } else {
+            _sampling_phase = sampling_functional;
+            _sampling_functional_start = _time;
+            _sampling_phase_end = _time + _sampling_functional;
+        }
+    }
+
+    while(!_sampling_deliveries.empty() && (_sampling_deliveries.top().time <= _time)) {
+        SamplingDelivery const d = _sampling_deliveries.top();
+        _sampling_deliveries.pop();
+        --_requestsOutstanding[d.src];
+        auto it = _in_flight_req_address.find(d.pid);
+        assert(it != _in_flight_req_address.end());
+        parent->CallbackEverything(d.pid, d.dest, it->second.first);
+        map<uint64_t, int>::iterator dit = _mcast_dests_left.find(d.pid);
+        if(dit == _mcast_dests_left.end()) {
+            _in_flight_req_address.erase(it);
+        } else if(--dit->second == 0) {
+            _mcast_dests_left.erase(dit);
+            _in_flight_req_address.erase(it);
+        }
+    }
+}
+
+// Schedules the delivery of a packet created in a functional window; false if
+// no latency was measured yet for one of its destinations, and the packet has
+// to be simulated in detail
+bool TrafficManager::_SamplingFunctionalPacket( uint64_t pid, int source, int dest, uint64_t mcast_dests, int size )
+{
+    uint64_t dests_left = mcast_dests;
+    do {
+        int d = dest;
+        if(dests_left) {
+            d = __builtin_ctzll(dests_left);
+            dests_left &= dests_left - 1;
+        }
+        if(_sampling_pair_lat[source*_nodes+d].empty()) {
+            return false;
+        }
+    } while(dests_left);
+
+    SamplingDelivery delivery;
+    dests_left = mcast_dests;
+    do {
+        int d = dest;
+        if(dests_left) {
+            d = __builtin_ctzll(dests_left);
+            dests_left &= dests_left - 1;
+        }
+        vector<int> const & lat = _sampling_pair_lat[source*_nodes+d];
+        delivery.time = _time + lat[_sampling_random.Int(lat.size() - 1)];
+        delivery.pid = pid;
+        delivery.src = source;
+        delivery.dest = d;
+        _sampling_deliveries.push(delivery);
+    } while(dests_left);
+
+    if(mcast_dests) {
+        _mcast_dests_left.insert(make_pair(pid, __builtin_popcountll(mcast_dests)));
+    } else if(_sampling_warmup > 0) {
+        // multicast packets are not replayed; packets older than a warm-up
+        // are assumed to have left the network
+        while(!_sampling_recent.empty() && (_sampling_recent.front().time + _sampling_warmup < _time)) {
+            _sampling_recent.pop_front();
+        }
+        SamplingInjection inj;
+        inj.time = _time;
+        inj.done = delivery.time;
+        inj.src = source;
+        inj.dest = dest;
+        inj.size = size;
+        _sampling_recent.push_back(inj);
+    }
+    ++_sampling_functional_packets;
+    return true;
+}
+
+// Packets created in a warm-up or measured window refresh the latency history
+// (the ones a functional window had to simulate in detail saw an unloaded
+// network); packets of the measured window also go into its batch mean
+void TrafficManager::_SamplingRecordLatency( int source, int dest, simTime ctime, simTime atime )
+{
+    int const lat = atime - ctime;
+    bool const detailed = (ctime >= _sampling_warmup_start) &&
+        ((_sampling_functional_start < _sampling_warmup_start) || (ctime < _sampling_functional_start));
+    if(detailed) {
+        int const p = source*_nodes+dest;
+        if((int)_sampling_pair_lat[p].size() < _sampling_history) {
+            _sampling_pair_lat[p].push_back(lat);
+        } else {
+            _sampling_pair_lat[p][_sampling_pair_next[p]] = lat;
+            _sampling_pair_next[p] = (_sampling_pair_next[p] + 1) % _sampling_history;
+        }
+    }
+
+    if(_sampling_win_open) {
+        if((ctime >= _sampling_win_start) && (ctime < _sampling_win_end)) {
+            _sampling_win_lat += lat;
+            ++_sampling_win_packets;
+        }
+        if((atime >= _sampling_win_start) && (atime < _sampling_win_end)) {
+            ++_sampling_win_accepted;
+        }
+    }
+}
+
+// Samples the open window would add if it were closed now; false if there is
+// no open window or it is empty, and has_plat is false if none of its packets
+// was delivered yet
+bool TrafficManager::_SamplingWindowSample( double & plat, bool & has_plat, double & accepted ) const
+{
+    if(!_sampling_win_open) {
+        return false;
+    }
+    simTime const end = min(_time, _sampling_win_end);
+    if(end <= _sampling_win_start) {
+        return false;
+    }
+    has_plat = (_sampling_win_packets > 0);
+    plat = has_plat ? (_sampling_win_lat / _sampling_win_packets) : 0.0;
+    accepted = (double)_sampling_win_accepted / (double)((end - _sampling_win_start) * _nodes);
+    return true;
+}
+
+// Packets of a window are collected until the next warm-up, so the ones
+// still in flight when the window ends are counted too
+void TrafficManager::_SamplingCloseWindow( )
+{
+    double plat = 0.0, accepted = 0.0;
+    bool has_plat = false;
+    if(_SamplingWindowSample(plat, has_plat, accepted)) {
+        if(has_plat) {
+            _sampling_plat_stats->AddSample(plat);
+        }
+        _sampling_accepted_stats->AddSample(accepted);
+    }
+    _sampling_win_open = false;
+}
+
+// 95% confidence interval half-width of the mean of n samples with the given
+// population variance
+static double _SamplingHalfWidth( int n, double var )
+{
+    static double const t95[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                  2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                  2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+    assert(n >= 2);
+    double const t = (n - 1 <= 30) ? t95[n - 2] : 1.960;
+    // the sample variance is n/(n-1) of the population variance
+    return t * sqrt(max(var, 0.0) / (double)(n - 1));
+}
+
+// Can be called mid-run: the open window is included as if it were closed
+// now, but it stays open and keeps collecting packets
+void TrafficManager::DisplaySamplingStats( ostream & os ) const
+{
+    if(!_sampling) {
+        return;
+    }
+
+    uint64_t const steps = _sampling_detailed_steps + _sampling_skipped_steps;
+    os << "====== Sampled simulation ======" << endl
+       << "Detailed steps = " << _sampling_detailed_steps
+       << " ( " << (steps ? (100.0 * _sampling_detailed_steps) / steps : 0.0) << " % )" << endl
+       << "Packets simulated in detail = " << _sampling_detailed_packets << endl
+       << "Packets simulated functionally = " << _sampling_functional_packets << endl
+       << "Ghost packets replayed = " << _sampling_ghost_packets << endl;
+
+    double open_plat = 0.0, open_accepted = 0.0;
+    bool open_has_plat = false;
+    bool const open = _SamplingWindowSample(open_plat, open_has_plat, open_accepted);
+    double const open_sample[] = { open_plat, open_accepted };
+    bool const has_open[] = { open && open_has_plat, open };
+
+    Stats const * const est[] = { _sampling_plat_stats, _sampling_accepted_stats };
+    char const * const label[] = { "Packet latency estimate", "Accepted packet rate estimate" };
+    for(int i = 0; i < 2; ++i) {
+        int n = est[i]->NumSamples();
+        double sum = est[i]->Sum();
+        double squared_sum = est[i]->SquaredSum();
+        if(has_open[i]) {
+            ++n;
+            sum += open_sample[i];
+            squared_sum += open_sample[i] * open_sample[i];
+        }
+        os << label[i] << " = ";
+        if(n == 0) {
+            os << "n/a (no measured windows)" << endl;
+            continue;
+        }
+        double const avg = sum / (double)n;
+        if(n == 1) {
+            os << avg << " (1 window, no confidence interval)" << endl;
+        } else {
+            double const hw = _SamplingHalfWidth(n, squared_sum / (double)n - avg * avg);
+            os << avg << " +/- " << hw
+               << " (95% CI, " << n << " windows, +/- "
+               << (avg ? 100.0 * hw / avg : 0.0) << " %)" << endl;
+        }
+    }
+}
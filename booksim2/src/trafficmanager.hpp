@@ -30,6 +30,8 @@
 
 #include <list>
 #include <map>
+#include <deque>
+#include <queue>
 #include <unordered_map>
 #include <set>
 #include <cassert>
@@ -136,10 +138,72 @@ protected:
   vector<map<int, Flit *> > _measured_in_flight_flits;
   vector<map<int, Flit *> > _retired_packets;
 
+  // Multicast packets are replicated in the routers, so their flits are only
+  // counted here: flit id -> copies left to retire. Heads waiting for their
+  // tails are kept per (pid, dest), and pid -> destinations left to deliver to
+  bool _mcast_supported;
+  int _mcast_max_size;
+  map<int, int> _mcast_in_flight_flits;
+  vector<map<pair<int, int>, Flit *> > _retired_mcast_packets;
+  map<uint64_t, int> _mcast_dests_left;
+
 #if defined(_SKIP_STEP_) || defined(_EMPTY_STEP_)
   map<uint64_t, int> _in_flight_packets;
 #endif
 
+  // ============ Sampled simulation (noc_sampling) ============
+  // Detailed windows (a warm-up, then a measured window) alternate with
+  // functional windows in which packets skip the network and are delivered
+  // after a latency drawn from the latencies recently measured for their
+  // (src, dest) pair (pairs with no measurement yet are still simulated in
+  // detail). Each warm-up starts by replaying, as ghost packets with no
+  // callback, the unicast packets of the functional window that would still
+  // be in flight, so buffers are loaded when measurement starts.
+  // Every measured window adds one sample (batch mean) to the estimates.
+
+  enum eSamplingPhase { sampling_warmup, sampling_detailed, sampling_functional };
+
+  struct SamplingInjection {
+    simTime time, done;
+    int src, dest, size;
+  };
+  struct SamplingDelivery {
+    simTime time;
+    uint64_t pid;
+    int src, dest;
+    bool operator>(SamplingDelivery const & d) const {
+      return (time != d.time) ? (time > d.time) : ((pid != d.pid) ? (pid > d.pid) : (dest > d.dest));
+    }
+  };
+
+  bool _sampling;
+  eSamplingPhase _sampling_phase;
+  simTime _sampling_phase_end;
+  simTime _sampling_warmup_start, _sampling_functional_start;
+  int _sampling_warmup;
+  int _sampling_detailed;
+  int _sampling_functional;
+  int _sampling_history; // latencies kept per (src, dest) pair
+
+  RandomStream _sampling_random;
+  vector<vector<int> > _sampling_pair_lat; // [src*_nodes+dest], ring of recent latencies
+  vector<int> _sampling_pair_next;
+
+  deque<SamplingInjection> _sampling_recent;
+  priority_queue<SamplingDelivery, vector<SamplingDelivery>, greater<SamplingDelivery> > _sampling_deliveries;
+  set<uint64_t> _sampling_ghosts; // ghost pids still in the network
+
+  bool _sampling_win_open;
+  simTime _sampling_win_start, _sampling_win_end;
+  double _sampling_win_lat;
+  int _sampling_win_packets; // created in the window, with their latency
+  int _sampling_win_accepted; // delivered in the window
+
+  Stats * _sampling_plat_stats; // per-window average packet latency
+  Stats * _sampling_accepted_stats; // per-window accepted packets/node/cycle
+  uint64_t _sampling_detailed_steps, _sampling_skipped_steps;
+  uint64_t _sampling_detailed_packets, _sampling_functional_packets, _sampling_ghost_packets;
+
   bool _empty_network;
 
   bool _hold_switch_for_packet;
@@ -149,6 +213,7 @@ protected:
   int _subnets;
 
   vector<int> _subnet;
+  vector<RandomStream> _subnet_random; // per source node
 
   // ============ deadlock ==========
 
@@ -300,6 +365,13 @@ protected:
   bool _PacketsOutstanding( ) const;
   
   void _GeneratePacket( int source, int size, int cl, int time );
+  uint64_t _GenerateZsimPacket( int source, int dest, uint64_t mcast_dests, int size, simTime ctime, uint64_t addr, bool llcEvent, BookSimNetwork *nocAddr );
+
+  void _SamplingStep( );
+  bool _SamplingFunctionalPacket( uint64_t pid, int source, int dest, uint64_t mcast_dests, int size );
+  void _SamplingRecordLatency( int source, int dest, simTime ctime, simTime atime );
+  bool _SamplingWindowSample( double & plat, bool & has_plat, double & accepted ) const;
+  void _SamplingCloseWindow( );
 
   virtual void _ClearStats( );
 
@@ -321,6 +393,12 @@ public:
   int getNodes(){ return _nodes;}
   void _ManuallyInjectPacket(int source, int dest, int size, int ctime);
   uint64_t _ManuallyGeneratePacket(int source, int dest, int size, simTime ctime, uint64_t addr, bool llcEvent, BookSimNetwork *nocAddr);
+  // One packet to all the nodes in dests (bit per node); delivered once per destination
+  uint64_t _ManuallyGenerateMulticastPacket(int source, uint64_t dests, int size, simTime ctime, uint64_t addr, bool llcEvent, BookSimNetwork *nocAddr);
+  inline bool SupportsMulticast() const { return _mcast_supported; }
+  inline bool HasGhostPackets() const { return !_sampling_ghosts.empty(); }
+  // Latency/throughput estimates of sampled simulation with confidence intervals
+  void DisplaySamplingStats( ostream & os ) const;
 
   static TrafficManager * New(Configuration const & config, 
 			      vector<Network *> const & net, InterconnectInterface* parentInterface);
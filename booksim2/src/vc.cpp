@@ -49,7 +49,7 @@ VC::VC( const Configuration& config, int outputs,
 	Module *parent, const string& name )
   : Module( parent, name ), 
     _state(idle), _out_port(-1), _out_vc(-1), _pri(0), _watched(false), 
-    _expected_pid(-1), _last_id(-1), _last_pid(-1)
+    _expected_pid(-1), _last_id(-1), _last_pid(-1), _mcast_branch(0), _mcast_next(0)
 {
   _lookahead_routing = !config.GetInt("routing_delay");
   _route_set = _lookahead_routing ? NULL : new OutputSet( );
@@ -111,10 +111,20 @@ Flit *VC::RemoveFlit( )
 {
   Flit *f = NULL;
   if ( !_buffer.empty( ) ) {
+    assert(!IsReplicating());
     f = _buffer.front( );
     _buffer.pop_front( );
     _last_id = f->id;
     _last_pid = f->pid;
+    if ( !_mcast_dests.empty( ) ) {
+      // last branch of a multicast packet, the original flits go there
+      _StampBranch(f);
+      if ( f->tail ) {
+	_mcast_route_sets.clear();
+	_mcast_dests.clear();
+	_mcast_branch = 0;
+      }
+    }
     UpdatePriority();
   } else {
     Error("Trying to remove flit from empty buffer.");
@@ -122,6 +132,53 @@ Flit *VC::RemoveFlit( )
   return f;
 }
 
+void VC::SetMulticastBranches( const vector<OutputSet> & route_sets, const vector<uint64_t> & dests )
+{
+  assert(!route_sets.empty() && (route_sets.size() == dests.size()));
+  _mcast_route_sets = route_sets;
+  _mcast_dests = dests;
+  _mcast_branch = 0;
+  _mcast_next = 0;
+  _SetBranchRoute();
+}
+
+Flit *VC::CopyFlit( )
+{
+  assert(IsReplicating());
+  assert(_mcast_next < _buffer.size());
+  Flit * f = _buffer[_mcast_next++]->Copy(_ctx);
+  _StampBranch(f);
+  return f;
+}
+
+void VC::NextBranch( )
+{
+  assert(IsReplicating());
+  ++_mcast_branch;
+  _mcast_next = 0;
+  _SetBranchRoute();
+}
+
+void VC::_SetBranchRoute( )
+{
+  if(_lookahead_routing) {
+    _route_set = &_mcast_route_sets[_mcast_branch];
+  } else {
+    *_route_set = _mcast_route_sets[_mcast_branch];
+  }
+  _out_port = -1;
+  _out_vc = -1;
+}
+
+// Head flits lead the copy of one branch, so they only carry its destinations
+void VC::_StampBranch( Flit *f ) const
+{
+  if(f->head) {
+    f->mcast_dests = _mcast_dests[_mcast_branch];
+    f->dest = __builtin_ctzll(f->mcast_dests);
+  }
+}
+
 
 
 void VC::SetState( eVCState s )
@@ -187,7 +244,7 @@ void VC::UpdatePriority()
 
 void VC::Route( tRoutingFunction rf, const Router* router, const Flit* f, int in_channel )
 {
-  rf( router, f, in_channel, _route_set, false );
+  rf( _ctx, router, f, in_channel, _route_set, false );
   _out_port = -1;
   _out_vc = -1;
 }
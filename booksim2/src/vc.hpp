@@ -29,6 +29,7 @@
 #define _VC_HPP_
 
 #include <deque>
+#include <vector>
 
 #include "flit.hpp"
 #include "outputset.hpp"
@@ -70,6 +71,17 @@ private:
 
   bool _lookahead_routing;
 
+  // Multicast replication, see IQRouter::_SetupMulticast: the packet at the
+  // front is sent once per branch, and its flits are copied for all but the
+  // last branch, so they stay buffered until then
+  vector<OutputSet> _mcast_route_sets;
+  vector<uint64_t> _mcast_dests;
+  size_t _mcast_branch;
+  size_t _mcast_next; // buffer index of the next flit to copy
+
+  void _SetBranchRoute( );
+  void _StampBranch( Flit *f ) const;
+
 public:
   
   VC( const Configuration& config, int outputs,
@@ -79,7 +91,7 @@ public:
   void AddFlit( Flit *f );
   inline Flit *FrontFlit( ) const
   {
-    return _buffer.empty() ? NULL : _buffer.front();
+    return (_buffer.size() > _mcast_next) ? _buffer[_mcast_next] : NULL;
   }
   
   Flit *RemoveFlit( );
@@ -87,9 +99,20 @@ public:
   
   inline bool Empty( ) const
   {
-    return _buffer.empty( );
+    return _buffer.size() <= _mcast_next;
   }
 
+  void SetMulticastBranches( const vector<OutputSet> & route_sets, const vector<uint64_t> & dests );
+
+  // True while sending a multicast packet on any branch but the last
+  inline bool IsReplicating( ) const
+  {
+    return _mcast_branch + 1 < _mcast_dests.size();
+  }
+
+  Flit *CopyFlit( );
+  void NextBranch( );
+
   inline VC::eVCState GetState( ) const
   {
     return _state;
@@ -24,13 +24,107 @@
  */
 
 #include "access_tracing.h"
-#include "bithacks.h"
+#include <errno.h>
+#include <fcntl.h>
 #include <hdf5.h>
 #include <hdf5_hl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "bithacks.h"
 
 #define PT_CHUNKSIZE (1024*256u)  // 256K records (~6MB)
+#define FLAT_BLOCK_RECORDS (1024*16u)  // 16K records (384KB), smaller since flat writers have a buffer per core
+#define FLATZ_MAX_RECORD_BYTES 32  // 10+10+5+3 bytes for the four varints, rounded up
+
+TraceFormat ParseTraceFormat(const char* str) {
+    if (strcmp(str, "HDF5") == 0) return TRACE_HDF5;
+    if (strcmp(str, "Flat") == 0) return TRACE_FLAT;
+    if (strcmp(str, "FlatZ") == 0) return TRACE_FLATZ;
+    panic("Invalid trace format %s, valid formats are HDF5, Flat and FlatZ", str);
+}
+
+const char* TraceFormatName(TraceFormat fmt) {
+    switch (fmt) {
+        case TRACE_HDF5: return "HDF5";
+        case TRACE_FLAT: return "Flat";
+        case TRACE_FLATZ: return "FlatZ";
+        default: panic("Invalid trace format %d", fmt);
+    }
+}
+
+/* Varint coding for TRACE_FLATZ */
+
+static inline uint8_t* putVarint(uint8_t* p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    *p++ = v;
+    return p;
+}
+
+static inline const uint8_t* getVarint(const uint8_t* p, uint64_t& v) {
+    uint64_t res = 0;
+    uint32_t shift = 0;
+    while (*p & 0x80) {
+        res |= ((uint64_t)(*p++ & 0x7f)) << shift;
+        shift += 7;
+    }
+    res |= ((uint64_t)*p++) << shift;
+    v = res;
+    return p;
+}
+
+static inline uint64_t zigzag(int64_t v) { return (((uint64_t)v) << 1) ^ (v >> 63); }
+static inline int64_t unzigzag(uint64_t v) { return (v >> 1) ^ -((int64_t)(v & 1)); }
+
+static void pwriteAll(int fd, const void* data, size_t bytes, uint64_t offset, const char* fname) {
+    const char* p = (const char*) data;
+    while (bytes) {
+        ssize_t res = pwrite(fd, p, bytes, offset);
+        if (res <= 0) panic("Write to trace file %s failed: %s", fname, strerror(errno));
+        p += res;
+        bytes -= res;
+        offset += res;
+    }
+}
+
+/* Reader */
+
+AccessTraceReader::AccessTraceReader(std::string _fname, lock_t* _h5Lock) : fname(_fname.c_str()), h5Lock(_h5Lock) {
+    mapBase = nullptr;
+    mapSize = 0;
+    nextBlock = nullptr;
+    decodeBuf = nullptr;
+
+    FILE* f = fopen(fname.c_str(), "r");
+    if (!f) panic("Could not open trace file %s", fname.c_str());
+    uint32_t magic = 0;
+    size_t magicRead = fread(&magic, sizeof(magic), 1, f);
+    fclose(f);
 
-AccessTraceReader::AccessTraceReader(std::string _fname) : fname(_fname.c_str()) {
+    if (magicRead == 1 && magic == FLAT_TRACE_MAGIC) {
+        openFlat();
+    } else {
+        lockH5();
+        openHdf5();
+        unlockH5();
+    }
+}
+
+AccessTraceReader::~AccessTraceReader() {
+    if (mapBase) {
+        munmap((void*)mapBase, mapSize);
+        if (decodeBuf) gm_free(decodeBuf);
+    } else if (buf) {
+        gm_free(buf);
+    }
+}
+
+void AccessTraceReader::openHdf5() {
+    format = TRACE_HDF5;
     hid_t fid = H5Fopen(fname.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
     if (fid == H5I_INVALID_HID) panic("Could not open HDF5 file %s", fname.c_str());
 
@@ -66,13 +160,50 @@ AccessTraceReader::AccessTraceReader(std::string _fname) : fname(_fname.c_str())
     H5Fclose(fid);
 }
 
+void AccessTraceReader::openFlat() {
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0) panic("Could not open trace file %s", fname.c_str());
+    struct stat st;
+    if (fstat(fd, &st) != 0) panic("Could not stat trace file %s", fname.c_str());
+    mapSize = st.st_size;
+    if (mapSize < sizeof(FlatTraceHeader)) panic("Trace file %s is truncated", fname.c_str());
+    void* m = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (m == MAP_FAILED) panic("Could not mmap trace file %s: %s", fname.c_str(), strerror(errno));
+    close(fd);  // the mapping stays valid
+    madvise(m, mapSize, MADV_SEQUENTIAL);
+    mapBase = (const char*) m;
+
+    const FlatTraceHeader* hdr = (const FlatTraceHeader*) mapBase;
+    if (hdr->version != FLAT_TRACE_VERSION) panic("Trace file %s has version %d, expected %d", fname.c_str(), hdr->version, FLAT_TRACE_VERSION);
+    if (hdr->format != TRACE_FLAT && hdr->format != TRACE_FLATZ) panic("Trace file %s has invalid format %d", fname.c_str(), hdr->format);
+    if (!hdr->finished) panic("Trace file %s unfinished (halted simulation?)", fname.c_str());
+
+    format = (TraceFormat) hdr->format;
+    numRecords = hdr->numRecords;
+    numChildren = hdr->numChildren;
+    decodeBuf = (format == TRACE_FLATZ)? gm_calloc<PackedAccessRecord>(hdr->blockRecords) : nullptr;
+
+    buf = nullptr;
+    curFrameRecord = 0;
+    cur = 0;
+    max = 0;
+    nextBlock = mapBase + sizeof(FlatTraceHeader);
+    nextFlatBlock();
+}
+
 void AccessTraceReader::nextChunk() {
     assert(cur == max);
+    if (format != TRACE_HDF5) {
+        nextFlatBlock();
+        return;
+    }
+
     curFrameRecord += max;
 
     if (curFrameRecord < numRecords) {
         cur = 0;
         max = MIN(PT_CHUNKSIZE, numRecords - curFrameRecord);
+        lockH5();
         hid_t fid = H5Fopen(fname.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
         if (fid == H5I_INVALID_HID) panic("Could not open HDF5 file %s", fname.c_str());
         hid_t table = H5PTopen(fid, "accs");
@@ -80,13 +211,81 @@ void AccessTraceReader::nextChunk() {
         H5PTread_packets(table, curFrameRecord, max, buf);
         H5PTclose(table);
         H5Fclose(fid);
+        unlockH5();
     } else {
         assert_msg(curFrameRecord == numRecords, "%ld %ld", curFrameRecord, numRecords);  // aaand we're done
     }
 }
 
+void AccessTraceReader::nextFlatBlock() {
+    curFrameRecord += max;
+    if (curFrameRecord >= numRecords) {
+        assert_msg(curFrameRecord == numRecords, "%ld %ld", curFrameRecord, numRecords);
+        return;
+    }
+
+    const FlatTraceHeader* hdr = (const FlatTraceHeader*) mapBase;
+    const char* mapEnd = mapBase + mapSize;
+    if (nextBlock + sizeof(FlatTraceBlock) > mapEnd) panic("Trace file %s is truncated", fname.c_str());
+    const FlatTraceBlock* blk = (const FlatTraceBlock*) nextBlock;
+    const char* payload = nextBlock + sizeof(FlatTraceBlock);
+    if (payload + blk->bytes > mapEnd || !blk->numRecords || blk->numRecords > hdr->blockRecords) {
+        panic("Trace file %s is corrupted (block at offset %ld)", fname.c_str(), nextBlock - mapBase);
+    }
+    nextBlock = payload + blk->bytes;
+
+    cur = 0;
+    max = blk->numRecords;
+    if (format == TRACE_FLAT) {
+        assert(blk->bytes == max*sizeof(PackedAccessRecord));
+        buf = (PackedAccessRecord*) payload;  // read straight from the mapping
+    } else {
+        const uint8_t* p = (const uint8_t*) payload;
+        uint64_t lineAddr = 0;
+        uint64_t reqCycle = 0;
+        for (uint32_t i = 0; i < max; i++) {
+            uint64_t dAddr, dCycle, lat, childType;
+            p = getVarint(p, dAddr);
+            p = getVarint(p, dCycle);
+            p = getVarint(p, lat);
+            p = getVarint(p, childType);
+            lineAddr += unzigzag(dAddr);
+            reqCycle += unzigzag(dCycle);
+            decodeBuf[i] = {lineAddr, reqCycle, (uint32_t) lat, (uint16_t) (childType >> 2), (uint16_t) (childType & 3)};
+        }
+        if ((const char*)p > nextBlock) panic("Trace file %s is corrupted (block at offset %ld)", fname.c_str(), (const char*)blk - mapBase);
+        buf = decodeBuf;
+    }
+}
+
+/* Writer */
+
+AccessTraceWriter::AccessTraceWriter(g_string _fname, uint32_t _numChildren, TraceFormat _format, uint32_t _numBufs, lock_t* _h5Lock)
+    : numBufs(_numBufs), fname(_fname), format(_format), numChildren(_numChildren), h5Lock(_h5Lock)
+{
+    if (format == TRACE_HDF5 && numBufs != 1) panic("HDF5 trace %s can only have one buffer, %d requested", fname.c_str(), numBufs);
+    assert(numBufs);
 
-AccessTraceWriter::AccessTraceWriter(g_string _fname, uint32_t numChildren) : fname(_fname) {
+    max = (format == TRACE_HDF5)? PT_CHUNKSIZE : FLAT_BLOCK_RECORDS;
+    bufs = gm_calloc<TraceBuffer*>(numBufs);
+    for (uint32_t b = 0; b < numBufs; b++) {
+        TraceBuffer* tb = new TraceBuffer();
+        tb->recs = gm_calloc<PackedAccessRecord>(max);
+        tb->cur = 0;
+        tb->encBuf = (format == TRACE_FLATZ)? gm_calloc<uint8_t>(max*FLATZ_MAX_RECORD_BYTES) : nullptr;
+        bufs[b] = tb;
+    }
+
+    if (format == TRACE_HDF5) {
+        lockH5();
+        initHdf5();
+        unlockH5();
+    } else {
+        initFlat();
+    }
+}
+
+void AccessTraceWriter::initHdf5() {
     // Create record structure
     hid_t accType = H5Tenum_create(H5T_NATIVE_USHORT);
     uint16_t val;
@@ -144,33 +343,124 @@ AccessTraceWriter::AccessTraceWriter(g_string _fname, uint32_t numChildren) : fn
 
     H5Fclose(fid);
 
-    // Initialize buffer
-    buf = gm_calloc<PackedAccessRecord>(PT_CHUNKSIZE);
-    cur = 0;
-    max = PT_CHUNKSIZE;
-    assert((uint32_t)(((char*) &buf[1]) - ((char*) &buf[0])) == sizeof(PackedAccessRecord));
+    assert((uint32_t)(((char*) &bufs[0]->recs[1]) - ((char*) &bufs[0]->recs[0])) == sizeof(PackedAccessRecord));
 }
 
-void AccessTraceWriter::dump(bool cont) {
+void AccessTraceWriter::initFlat() {
+    fileEnd = sizeof(FlatTraceHeader);
+    flatRecords = 0;
+    flatBlocks = 0;
+    int fd = open(fname.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (fd < 0) panic("Could not create trace file %s: %s", fname.c_str(), strerror(errno));
+    close(fd);
+    writeFlatHeader(false);
+}
+
+void AccessTraceWriter::writeFlatHeader(bool finished) {
+    FlatTraceHeader hdr;
+    hdr.magic = FLAT_TRACE_MAGIC;
+    hdr.version = FLAT_TRACE_VERSION;
+    hdr.format = format;
+    hdr.numChildren = numChildren;
+    hdr.finished = finished;
+    hdr.numRecords = flatRecords;
+    hdr.blockRecords = max;
+    hdr.numBlocks = flatBlocks;
+
+    int fd = open(fname.c_str(), O_WRONLY);
+    if (fd < 0) panic("Could not open trace file %s: %s", fname.c_str(), strerror(errno));
+    pwriteAll(fd, &hdr, sizeof(hdr), 0, fname.c_str());
+    close(fd);
+}
+
+void AccessTraceWriter::flush(TraceBuffer* tb) {
+    if (!tb->cur) return;
+    if (format == TRACE_HDF5) {
+        lockH5();
+        appendHdf5(tb);
+        unlockH5();
+    } else {
+        appendFlat(tb);
+    }
+    tb->cur = 0;
+}
+
+void AccessTraceWriter::appendHdf5(TraceBuffer* tb) {
     hid_t fid = H5Fopen(fname.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
     if (fid == H5I_INVALID_HID) panic("Could not open HDF5 file %s", fname.c_str());
     hid_t table = H5PTopen(fid, "accs");
     if (table == H5I_INVALID_HID) panic("Could not open HDF5 packet table");
-    herr_t err = H5PTappend(table, cur, buf);
+    herr_t err = H5PTappend(table, tb->cur, tb->recs);
     assert(err >= 0);
+    H5PTclose(table);
+    H5Fclose(fid);
+}
+
+// Called by the thread that owns tb, concurrently with other buffers' flushes.
+// The file is reopened every time because the writer may be shared by several
+// processes, like the HDF5 writer does.
+void AccessTraceWriter::appendFlat(TraceBuffer* tb) {
+    const void* payload;
+    uint32_t bytes;
+    if (format == TRACE_FLAT) {
+        payload = tb->recs;
+        bytes = tb->cur*sizeof(PackedAccessRecord);
+    } else {
+        uint8_t* p = tb->encBuf;
+        uint64_t lineAddr = 0;
+        uint64_t reqCycle = 0;
+        for (uint32_t i = 0; i < tb->cur; i++) {
+            const PackedAccessRecord& pr = tb->recs[i];
+            p = putVarint(p, zigzag(pr.lineAddr - lineAddr));
+            p = putVarint(p, zigzag(pr.reqCycle - reqCycle));
+            p = putVarint(p, pr.latency);
+            p = putVarint(p, (((uint64_t)pr.childId) << 2) | pr.type);
+            lineAddr = pr.lineAddr;
+            reqCycle = pr.reqCycle;
+        }
+        while ((p - tb->encBuf) & 7) *p++ = 0;
+        payload = tb->encBuf;
+        bytes = p - tb->encBuf;
+    }
+
+    FlatTraceBlock blk = {tb->cur, bytes};
+    uint64_t offset = __sync_fetch_and_add(&fileEnd, sizeof(blk) + bytes);
+    int fd = open(fname.c_str(), O_WRONLY);
+    if (fd < 0) panic("Could not open trace file %s: %s", fname.c_str(), strerror(errno));
+    pwriteAll(fd, &blk, sizeof(blk), offset, fname.c_str());
+    pwriteAll(fd, payload, bytes, offset + sizeof(blk), fname.c_str());
+    close(fd);
+
+    __sync_fetch_and_add(&flatRecords, tb->cur);
+    __sync_fetch_and_add(&flatBlocks, 1);
+}
+
+void AccessTraceWriter::dump(bool cont) {
+    for (uint32_t b = 0; b < numBufs; b++) flush(bufs[b]);
 
     if (!cont) {
-        hid_t fAttr = H5Aopen(fid, "finished", H5P_DEFAULT);
-        uint32_t finished = 1;
-        H5Awrite(fAttr, H5T_NATIVE_UINT, &finished);
-        H5Aclose(fAttr);
+        if (format == TRACE_HDF5) {
+            lockH5();
+            hid_t fid = H5Fopen(fname.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+            if (fid == H5I_INVALID_HID) panic("Could not open HDF5 file %s", fname.c_str());
+            hid_t fAttr = H5Aopen(fid, "finished", H5P_DEFAULT);
+            uint32_t finished = 1;
+            H5Awrite(fAttr, H5T_NATIVE_UINT, &finished);
+            H5Aclose(fAttr);
+            H5Fclose(fid);
+            unlockH5();
+        } else {
+            writeFlatHeader(true);
+        }
 
-        gm_free(buf);
-        buf = nullptr;
+        for (uint32_t b = 0; b < numBufs; b++) {
+            gm_free(bufs[b]->recs);
+            if (bufs[b]->encBuf) gm_free(bufs[b]->encBuf);
+            delete bufs[b];
+        }
+        gm_free(bufs);
+        bufs = nullptr;
+        numBufs = 0;
         max = 0;
     }
-
-    cur = 0;
-    H5PTclose(table);
-    H5Fclose(fid);
 }
@@ -27,9 +27,29 @@
 #define ACCESS_TRACING_H_
 
 #include "g_std/g_string.h"
+#include "locks.h"
 #include "memory_hierarchy.h"
 
-/* HDF5-based classes read and write address traces in a consistent format */
+/* Classes to read and write address traces in a consistent format. Traces are
+ * stored either in HDF5 (deflate-compressed, the default) or in a flat binary
+ * format that is much cheaper to produce and replay:
+ *
+ *  - The file is a FlatTraceHeader followed by blocks, each a FlatTraceBlock
+ *    and its payload. Blocks are self-contained, so writers can append them
+ *    independently and readers can walk the file in place.
+ *  - TRACE_FLAT payloads are PackedAccessRecord arrays, so the reader mmaps the
+ *    file and returns records straight from the mapping (no copies).
+ *  - TRACE_FLATZ payloads are varint-encoded, with addresses and cycles stored
+ *    as zigzag deltas from the previous record in the block. Readers decode a
+ *    block at a time into a small buffer. Traces typically shrink 3-5x.
+ *
+ * Readers detect the format of the file they open.
+ */
+
+enum TraceFormat {TRACE_HDF5, TRACE_FLAT, TRACE_FLATZ};
+
+TraceFormat ParseTraceFormat(const char* str);
+const char* TraceFormatName(TraceFormat fmt);
 
 struct AccessRecord {
     Address lineAddr;
@@ -47,6 +67,24 @@ struct PackedAccessRecord {
     uint16_t type;  // could be uint8_t, but causes corruption in HDF5? (wtf...)
 } /*__attribute__((packed))*/;  // 24 bytes --> no packing needed
 
+#define FLAT_TRACE_MAGIC 0x4352545aU  // "ZTRC"
+#define FLAT_TRACE_VERSION 1
+
+struct FlatTraceHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t format;       // TRACE_FLAT or TRACE_FLATZ
+    uint32_t numChildren;
+    uint32_t finished;     // 0 until the writer is done, like the HDF5 attribute
+    uint64_t numRecords;
+    uint32_t blockRecords; // max records per block
+    uint32_t numBlocks;
+};  // 32 bytes
+
+struct FlatTraceBlock {
+    uint32_t numRecords;
+    uint32_t bytes;  // payload size, padded to 8 bytes so raw records stay aligned
+};
 
 class AccessTraceReader {
     private:
@@ -59,12 +97,25 @@ class AccessTraceReader {
         uint64_t numRecords;
         uint32_t numChildren; //i.e., how many parallel streams does this file contain?
 
+        TraceFormat format;
+
+        // Flat formats: the whole file is mapped, nextBlock points to the block after buf's
+        const char* mapBase;
+        size_t mapSize;
+        const char* nextBlock;
+        PackedAccessRecord* decodeBuf;  // TRACE_FLATZ only
+
+        lock_t* h5Lock;  // held around HDF5 calls if non-null
+
     public:
-        AccessTraceReader(std::string fname);
+        // h5Lock serializes HDF5 calls with other threads that use the library; not needed by standalone tools
+        AccessTraceReader(std::string fname, lock_t* h5Lock = nullptr);
+        ~AccessTraceReader();
 
         inline bool empty() const {return (cur == max);}
         uint32_t getNumChildren() const {return numChildren;}
         uint64_t getNumRecords() const {return numRecords;}
+        TraceFormat getFormat() const {return format;}
 
         inline AccessRecord read() {
             assert(cur < max);
@@ -75,28 +126,73 @@ class AccessTraceReader {
         }
 
     private:
+        void openHdf5();
+        void openFlat();
         void nextChunk();
+        void nextFlatBlock();
+
+        void lockH5() { if (h5Lock) futex_lock(h5Lock); }
+        void unlockH5() { if (h5Lock) futex_unlock(h5Lock); }
 };
 
+/* Writers have one or more buffers. With the HDF5 format there is a single
+ * buffer and callers must serialize writes. With the flat formats, each
+ * buffer can be written by a different thread without locking; full buffers
+ * are appended as blocks at atomically reserved file offsets. Records from
+ * different buffers interleave at block granularity, so the trace is not
+ * sorted across buffers (use sorttrace).
+ */
 class AccessTraceWriter : public GlobAlloc {
     private:
-        PackedAccessRecord* buf;
-        uint32_t cur;
+        struct TraceBuffer : public GlobAlloc {
+            PackedAccessRecord* recs;
+            uint32_t cur;
+            uint8_t* encBuf;  // TRACE_FLATZ only
+        };
+
+        TraceBuffer** bufs;
+        uint32_t numBufs;
         uint32_t max;
         g_string fname;
+        TraceFormat format;
+        uint32_t numChildren;
 
-    public:
-        AccessTraceWriter(g_string fname, uint32_t numChildren);
+        // Flat formats; in the global heap, since buffers may be flushed from any process
+        volatile uint64_t fileEnd;
+        volatile uint64_t flatRecords;
+        volatile uint32_t flatBlocks;
+
+        lock_t* h5Lock;  // held around HDF5 calls if non-null, see AccessTraceReader
 
-        inline void write(AccessRecord& acc) {
-            buf[cur++] = {acc.lineAddr, acc.reqCycle, acc.latency, (uint16_t) acc.childId, (uint8_t) acc.type};
-            if (unlikely(cur == max)) {
-                dump(true);
-                assert(cur < max);
+    public:
+        AccessTraceWriter(g_string fname, uint32_t numChildren, TraceFormat format = TRACE_HDF5, uint32_t numBufs = 1, lock_t* h5Lock = nullptr);
+
+        inline void write(const AccessRecord& acc, uint32_t b = 0) {
+            assert(b < numBufs);
+            TraceBuffer* tb = bufs[b];
+            tb->recs[tb->cur++] = {acc.lineAddr, acc.reqCycle, acc.latency, (uint16_t) acc.childId, (uint8_t) acc.type};
+            if (unlikely(tb->cur == max)) {
+                flush(tb);
+                assert(tb->cur < max);
             }
         }
 
+        uint32_t getNumBuffers() const {return numBufs;}
+        TraceFormat getFormat() const {return format;}
+
+        // Flushes all buffers; if !cont, marks the trace finished and frees them
         void dump(bool cont);
+
+    private:
+        void initHdf5();
+        void initFlat();
+        void flush(TraceBuffer* tb);
+        void appendHdf5(TraceBuffer* tb);
+        void appendFlat(TraceBuffer* tb);
+        void writeFlatHeader(bool finished);
+
+        void lockH5() { if (h5Lock) futex_lock(h5Lock); }
+        void unlockH5() { if (h5Lock) futex_unlock(h5Lock); }
 };
 
 #endif  // _ACCESS_TRACING_H
@@ -0,0 +1,115 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADDR_INTERLEAVE_H_
+#define ADDR_INTERLEAVE_H_
+
+#include "bithacks.h"
+#include "galloc.h"
+#include "log.h"
+#include "memory_hierarchy.h"
+
+/* Address interleaving policies across memory controllers. A policy maps a
+ * global line address to the controller that owns it, and to a dense line
+ * address within that controller. The mapping must be a bijection, so that
+ * each controller sees a contiguous address space.
+ *
+ * Used by SplitAddrMemory, both to route accesses and to give the NoC the
+ * coordinates of the controller that owns a line.
+ */
+class AddrInterleave : public GlobAlloc {
+    protected:
+        const uint32_t numCtrls;
+
+    public:
+        explicit AddrInterleave(uint32_t _numCtrls) : numCtrls(_numCtrls) {
+            assert(numCtrls > 0);
+        }
+        virtual ~AddrInterleave() {}
+
+        virtual uint32_t getCtrl(Address lineAddr) const = 0;
+        virtual Address getCtrlAddr(Address lineAddr) const = 0;
+};
+
+/* Round-robin interleaving of fixed-size blocks of lines. Blocks of 1 line
+ * reproduce the classic addr % numCtrls mapping; larger blocks interleave at
+ * page or DRAM-row granularity, keeping row-buffer locality within a controller.
+ */
+class BlockInterleave : public AddrInterleave {
+    protected:
+        const uint32_t blockBits; //log2(lines per block)
+        const Address blockMask;
+
+        Address getBlock(Address lineAddr) const { return lineAddr >> blockBits; }
+
+    public:
+        BlockInterleave(uint32_t _numCtrls, uint32_t linesPerBlock)
+            : AddrInterleave(_numCtrls), blockBits(ilog2(linesPerBlock)), blockMask(linesPerBlock - 1)
+        {
+            if (!isPow2(linesPerBlock)) panic("Interleaving granularity must be a power of 2 lines, %d given", linesPerBlock);
+        }
+
+        uint32_t getCtrl(Address lineAddr) const {
+            return getBlock(lineAddr) % numCtrls;
+        }
+
+        Address getCtrlAddr(Address lineAddr) const {
+            return ((getBlock(lineAddr) / numCtrls) << blockBits) | (lineAddr & blockMask);
+        }
+};
+
+/* Block interleaving with the controller index permuted by an XOR-fold of the
+ * upper block address bits, so strided streams that would all hit the same
+ * controller under round-robin interleaving are spread across controllers.
+ * Within each group of numCtrls consecutive blocks the permutation is fixed,
+ * so getCtrlAddr() is the same as BlockInterleave's.
+ */
+class XorHashInterleave : public BlockInterleave {
+    private:
+        const uint32_t ctrlBits; //width of each folded field
+
+        uint32_t fold(Address upper) const {
+            uint32_t res = 0;
+            while (upper) {
+                res ^= upper & ((1ul << ctrlBits) - 1);
+                upper >>= ctrlBits;
+            }
+            return res;
+        }
+
+    public:
+        XorHashInterleave(uint32_t _numCtrls, uint32_t linesPerBlock)
+            : BlockInterleave(_numCtrls, linesPerBlock), ctrlBits(MAX(1u, ilog2(_numCtrls - 1) + 1)) {}
+
+        uint32_t getCtrl(Address lineAddr) const {
+            Address block = getBlock(lineAddr);
+            uint32_t low = block % numCtrls;
+            uint32_t h = fold(block / numCtrls);
+            // XOR is only a permutation of [0, numCtrls) for pow2 numCtrls; otherwise rotate
+            return isPow2(numCtrls)? (low ^ (h & (numCtrls - 1))) : (low + h) % numCtrls;
+        }
+};
+
+#endif  // ADDR_INTERLEAVE_H_
@@ -2,6 +2,7 @@
 #include "booksim_net_ctrl.h"
 #include <map>
 #include <string>
+#include <typeinfo>
 #include "event_recorder.h"
 #include "tick_event.h"
 #include "timing_event.h"
@@ -44,20 +45,158 @@ class BookSimAccEvent : public TimingEvent {
 
         bool getLlcEvent() const { return llcEvent;}
 
+        BookSimNetwork* getNoc() const { return noc; }
+
+        // Injection cycle and zero-load latency of packet pid, which this event has in flight
+        // (node is where it was delivered, multicast packets are delivered to several nodes)
+        virtual uint64_t getPacketStartCycle(uint64_t pid, uint32_t node) const { return sCycle; }
+        virtual uint32_t getPacketZll(uint64_t pid, uint32_t node) const { return getZll(); }
+
+        // Called by the network once packet pid has been delivered to node
+        virtual void packetDone(uint64_t pid, uint32_t node, uint64_t cycle) {
+            release();
+            done(cycle);
+        }
+};
+
+// Stands in for a T->R pair of BookSimAccEvents when nothing on the other side
+// of the NoC recorded timing events (e.g., a hit in the parent or an invalidation
+// that stops at the child). The response packet is only injected once the request
+// has been delivered, so an access costs a single fixed-size event instead of two
+// events plus their child link.
+class BookSimRoundTripEvent : public BookSimAccEvent {
+    private:
+        uint32_t legZll;    // zero-load latency of each of the two packets
+        uint32_t midDelay;  // cycles between delivering the request and injecting the response
+        bool respLeg;
+
+    public:
+        BookSimRoundTripEvent(BookSimNetwork* _noc, bool _write, Address _addr, int32_t domain, bool llcEvent, bool isInval,
+                doubleCoordinates<int> reqCoord, uint32_t _legZll, uint32_t _midDelay)
+            : BookSimAccEvent(_noc, _write, _addr, domain, llcEvent, isInval), legZll(_legZll), midDelay(_midDelay), respLeg(false)
+        {
+            setCoord(reqCoord);
+            // Whole round trip, so that minStartCycle + zll matches the cycle the R event would have finished
+            setZll(2*legZll + midDelay);
+        }
+
+        uint32_t getPacketZll(uint64_t pid, uint32_t node) const { return legZll; }
+
+        void packetDone(uint64_t pid, uint32_t node, uint64_t cycle) {
+            release();
+            if (!respLeg) {
+                respLeg = true;
+                doubleCoordinates<int> c = getCoord();
+                setCoord({c.dest, c.src});
+                requeue(cycle + midDelay);
+            } else {
+                done(cycle);
+            }
+        }
+
+        static bool isRoundTrip(TimingEvent* ev) {
+            return typeid(*ev) == typeid(BookSimRoundTripEvent);
+        }
 };
 
-BookSimNetwork::BookSimNetwork(const char* _name, int _id, InterconnectInterface* _interface, int _cpuFreq){
+// Round trips to several NoC children in one event, for invalidations of widely
+// shared lines (see BookSimNetwork::invalidateBatch()). All requests go out as a
+// batch when the event starts; each child's response is injected by the network
+// midDelay cycles after its request arrives, and the event finishes with the
+// last response. Replaces N round-trip events plus root and sync DelayEvents.
+class BookSimInvFanoutEvent : public BookSimAccEvent {
+    public:
+        struct Leg {
+            coordinates<int> child;
+            uint32_t node;      // NoC node of child
+            uint64_t pid;       // packet in flight, shared by all the request legs if multicast
+            uint64_t sCycle;
+            uint32_t zll;       // zero-load latency of each of the two packets
+            uint32_t midDelay;  // cycles between delivering the request and injecting the response
+            bool respLeg;
+        };
+
+    private:
+        coordinates<int> parent;
+        Leg* legs;
+        uint32_t numLegs;
+        uint32_t legsDone;
+
+    public:
+        BookSimInvFanoutEvent(BookSimNetwork* _noc, Address _addr, bool llcEvent, coordinates<int> _parent, uint32_t _numLegs, EventRecorder* evRec)
+            : BookSimAccEvent(_noc, false, _addr, _noc->getDomain(), llcEvent, true), parent(_parent), numLegs(_numLegs), legsDone(0)
+        {
+            legs = static_cast<Leg*>(evRec->alloc(numLegs*sizeof(Leg)));
+        }
+
+        Leg& getLeg(uint32_t l) { return legs[l]; }
+
+        void simulate(uint64_t startCycle) {
+            coordinates<int> dsts[numLegs];
+            uint64_t pids[numLegs];
+            for (uint32_t l = 0; l < numLegs; l++) {
+                dsts[l] = legs[l].child;
+                legs[l].sCycle = startCycle;
+                legs[l].respLeg = false;
+            }
+            getNoc()->injectBatch(this, parent, dsts, numLegs, pids);
+            for (uint32_t l = 0; l < numLegs; l++) legs[l].pid = pids[l];
+            hold();
+        }
+
+        uint64_t getPacketStartCycle(uint64_t pid, uint32_t node) const { return legs[findLeg(pid, node)].sCycle; }
+        uint32_t getPacketZll(uint64_t pid, uint32_t node) const { return legs[findLeg(pid, node)].zll; }
+
+        void packetDone(uint64_t pid, uint32_t node, uint64_t cycle) {
+            release();
+            uint32_t l = findLeg(pid, node);
+            if (!legs[l].respLeg) {
+                legs[l].respLeg = true;
+                legs[l].pid = NO_PACKET;
+                getNoc()->scheduleInvResp(this, l, cycle + legs[l].midDelay);
+                hold();
+            } else if (++legsDone < numLegs) {
+                hold();
+            } else {
+                // legs come from the slab too, and would keep it live after the event is freed
+                slab::freeElem((void*)legs, numLegs*sizeof(Leg));
+                legs = nullptr;
+                done(cycle);
+            }
+        }
+
+        // Called by the network when the response of leg l is due
+        void injectResp(uint32_t l, uint64_t cycle) {
+            legs[l].sCycle = cycle;
+            legs[l].pid = getNoc()->injectPacket(this, {legs[l].child, parent});
+        }
+
+    private:
+        static const uint64_t NO_PACKET = -1L;
+
+        uint32_t findLeg(uint64_t pid, uint32_t node) const {
+            for (uint32_t l = 0; l < numLegs; l++) {
+                if (legs[l].pid == pid && (legs[l].respLeg || legs[l].node == node)) return l;
+            }
+            panic("Fanout event has no leg with packet %ld in flight to node %d", pid, node);
+        }
+};
+
+BookSimNetwork::BookSimNetwork(const char* _name, int _id, InterconnectInterface* _interface, int _cpuFreq, bool _compactEvents, uint32_t _domain){
     nocIf = _interface;
+    ownerProc = procIdx;
     cpuFreq = _cpuFreq;
     nocFreq = nocIf->getNocFrequency();
-    nocSpeedup = nocFreq/cpuFreq; // int on purpose
+    nocClock = ClockDomain(cpuFreq, nocFreq);
     hopDelay = nocIf->getHopDelay();
     packetSize = nocIf->getPacketSize();
     name = _name;
     id = _id;
     numChildren = 0;
-    meshDim = gX;
+    meshDim = nocIf->GetContext()->x;
+    domain = _domain;
     isLlnoc = false;
+    compactEvents = _compactEvents;
 
     futex_init(&netLockAcc);
     futex_init(&netLockInv);
@@ -84,6 +223,11 @@ void BookSimNetwork::initStats(AggregateStat* parentStat) {
     remoteReqs.init("remote", "Remote requests"); nocStats->append(&remoteReqs);
     profTotalRdLat.init("rdlat", "Total latency experienced by read requests"); nocStats->append(&profTotalRdLat);
     profTotalWrLat.init("wrlat", "Total latency experienced by write requests"); nocStats->append(&profTotalWrLat);
+    profEvBytes.init("evBytes", "Bytes of timing events allocated for NoC accesses and invalidations"); nocStats->append(&profEvBytes);
+    profInjected.init("inj", "Injected packets"); nocStats->append(&profInjected);
+    profMcastInjected.init("mcastInj", "Injected multicast packets"); nocStats->append(&profMcastInjected);
+    profInvBatches.init("invBatches", "Batched invalidations with more than one child"); nocStats->append(&profInvBatches);
+    profInvBatchLegs.init("invBatchLegs", "Children invalidated by batched invalidations"); nocStats->append(&profInvBatchLegs);
 #ifdef _SANITY_CHECK_
     nocGETS.init("nocGETS", "nocGETS"); nocStats->append(&nocGETS);
     nocGETX.init("nocGETX", "nocGETX"); nocStats->append(&nocGETX);
@@ -157,14 +301,13 @@ uint64_t BookSimNetwork::access(MemReq& req) {
             assert((trInv.startEvent)->getIsInval());
         }
 
-        // zll needs to be devided by nocSpeedup
+        // zll needs to be converted to core cycles
         // Although in reality, the NoC calculates zll to be C cycles, zsim might operate in a different freq,
         // So from its point of view, the packet will need C/N cycles if for example the CPU is N times slower
-        // nocSpeedup = nocFreq/cpuFreq
         // TODO: Remove the addition of "+2" to account for the cycles added by booksim to inject to the first R
         int hops = abs(dst.x-src.x) + abs(dst.y-src.y);
         int zll =(hops + 1)*hopDelay + packetSize-1 + 2;
-        zll = zll*cpuFreq/nocFreq;
+        zll = nocClock.devToSys(zll);
 
         respCycle = req.cycle + zll;
 
@@ -203,67 +346,74 @@ uint64_t BookSimNetwork::access(MemReq& req) {
         doubleCoordinates<int> coordT = {src,dst};
         doubleCoordinates<int> coordR = {dst,src};
 
-        // First create a Transmit and a Receive event for accessing the memory.
-        // The two events will be put before and after the DRAMSim event.
-        BookSimAccEvent* nocEvT = new (zinfo->eventRecorders[req.srcId]) BookSimAccEvent(this, isWrite, addr, domain, isLlnoc);
-        nocEvT->setMinStartCycle(req.cycle);
-        nocEvT->setCoord(coordT); 
-        nocEvT->setZll(zll);
-        respCycle += nextLevelLat; 
+        uint64_t evBytes = evRec->getAllocatedBytes();
+        BookSimAccEvent* nocEvT;
+        if (tr.startEvent == nullptr && compactEvents) {
+            // Nothing was recorded past the NoC, so a single event covers both trips
+            nocEvT = new (evRec) BookSimRoundTripEvent(this, isWrite, addr, domain, isLlnoc, false, coordT, zll, nextLevelLat);
+            nocEvT->setMinStartCycle(req.cycle);
+            respCycle += nextLevelLat;
+        } else {
+            // First create a Transmit and a Receive event for accessing the memory.
+            // The two events will be put before and after the DRAMSim event.
+            nocEvT = new (zinfo->eventRecorders[req.srcId]) BookSimAccEvent(this, isWrite, addr, domain, isLlnoc);
+            nocEvT->setMinStartCycle(req.cycle);
+            nocEvT->setCoord(coordT); 
+            nocEvT->setZll(zll);
+            respCycle += nextLevelLat; 
         
-        BookSimAccEvent* nocEvR = new (zinfo->eventRecorders[req.srcId]) BookSimAccEvent(this, isWrite, addr, domain, isLlnoc);
-        nocEvR->setMinStartCycle(respCycle);
-        nocEvR->setCoord(coordR);
-        nocEvR->setZll(zll);
-
-        // Then create two more events for simulating the L2-L3 access.
-        // The difference now is that before we had a simulation for the DRAM, but now we have just a latency for L3.
-        // So this time we need to set the postdelay of the first transmit event to delay it for the amount of time
-        // that L2 would normally need.
-        // Also, we need to take into account the difference between the CPU's and the NoC's clock.
-        // If the NoC is N time faster that the CPU, then the packet would be N times faster to arrive.
-        // This would normally be calculated in the NoC as a zll, so now we just devide the delay by the nocSpeedup  
-        if (tr.startEvent != nullptr){
-            if(tr.startEvent->getIsInval()){
-                // this means that have a single invalidation request waiting in the recorders.
-                // The two noc requests should sandwitch that request
+            BookSimAccEvent* nocEvR = new (zinfo->eventRecorders[req.srcId]) BookSimAccEvent(this, isWrite, addr, domain, isLlnoc);
+            nocEvR->setMinStartCycle(respCycle);
+            nocEvR->setCoord(coordR);
+            nocEvR->setZll(zll);
+
+            // Then create two more events for simulating the L2-L3 access.
+            // The difference now is that before we had a simulation for the DRAM, but now we have just a latency for L3.
+            // So this time we need to set the postdelay of the first transmit event to delay it for the amount of time
+            // that L2 would normally need.
+            // Also, we need to take into account the difference between the CPU's and the NoC's clock.
+            // If the NoC is N time faster that the CPU, then the packet would be N times faster to arrive.
+            // This would normally be calculated in the NoC as a zll, so now we just convert the delay with nocClock
+            if (tr.startEvent != nullptr){
+                if(tr.startEvent->getIsInval()){
+                    // this means that have a single invalidation request waiting in the recorders.
+                    // The two noc requests should sandwitch that request
                 
-                // nocEvR->name += "IsInval"; 
-                // nocEvT->name += "IsInval"; 
-                nocEvR->setIsInval(true);
-                nocEvT->setIsInval(true);
+                    nocEvR->setIsInval(true);
+                    nocEvT->setIsInval(true);
 
 
-                TimingEvent *firstEv = tr.startEvent;
-                TimingEvent *lastEv = tr.startEvent->getChildLeftDescendant();
+                    TimingEvent *firstEv = tr.startEvent;
+                    TimingEvent *lastEv = tr.startEvent->getChildLeftDescendant();
 
-                nocEvT->setPostDelay(firstEv->getMinStartCycle() - req.cycle - zll);
-                nocEvT->addChild(firstEv,evRec);
-                lastEv->addChild(nocEvR,evRec);
+                    nocEvT->setPostDelay(firstEv->getMinStartCycle() - req.cycle - zll);
+                    nocEvT->addChild(firstEv,evRec);
+                    lastEv->addChild(nocEvR,evRec);
                 
-                lastEv->setPostDelay(nocEvR->getMinStartCycle() - lastEv->getMinStartCycle() - lastEv->getZll());
-            }else{
-                TimingEvent *firstEv = tr.startEvent;
-                TimingEvent *lastEv = tr.startEvent;
+                    lastEv->setPostDelay(nocEvR->getMinStartCycle() - lastEv->getMinStartCycle() - lastEv->getZll());
+                }else{
+                    TimingEvent *firstEv = tr.startEvent;
+                    TimingEvent *lastEv = tr.startEvent;
                 
-                if(firstEv->getNumChildren() > 0){
-                    // calculate the time between the cycle the request arrives in L3 (req.cycle)
-                    // and the cycle the request arrives at L2 (firstEv->getMinStartCycle).
-                    // This is how much we need to delay the event simulating the delay of the cache.
-                    // From that, sub zll since when we enqueue the next request is based on
-                    // the doneCycle + postDelay and doneCycle will hopefully be minCylce + zll
-                    nocEvT->setPostDelay(firstEv->getMinStartCycle()-req.cycle-zll);
-                }
-                lastEv = lastEv->getChildLeftDescendant();
+                    if(firstEv->getNumChildren() > 0 || BookSimRoundTripEvent::isRoundTrip(firstEv)){
+                        // calculate the time between the cycle the request arrives in L3 (req.cycle)
+                        // and the cycle the request arrives at L2 (firstEv->getMinStartCycle).
+                        // This is how much we need to delay the event simulating the delay of the cache.
+                        // From that, sub zll since when we enqueue the next request is based on
+                        // the doneCycle + postDelay and doneCycle will hopefully be minCylce + zll
+                        nocEvT->setPostDelay(firstEv->getMinStartCycle()-req.cycle-zll);
+                    }
+                    lastEv = lastEv->getChildLeftDescendant();
                 
 
-                (nocEvT)->addChild(firstEv, evRec);
-                lastEv->addChild(nocEvR, evRec);
+                    (nocEvT)->addChild(firstEv, evRec);
+                    lastEv->addChild(nocEvR, evRec);
+                }
+            }
+            else {
+                nocEvT->setPostDelay(nextLevelLat);
+                (nocEvT)->addChild(nocEvR, evRec);
             }
-        }
-        else {
-            nocEvT->setPostDelay(nextLevelLat);
-            (nocEvT)->addChild(nocEvR, evRec);
         }
 
         // if this is the llnoc, by now I have created the chain with the dramsim access
@@ -283,6 +433,7 @@ uint64_t BookSimNetwork::access(MemReq& req) {
             TimingRecord noctr = {addr, req.cycle, respCycle + zll, type, nocEvT, nocEvT};
             evRec->pushRecord(noctr);
         }
+        profEvBytes.inc(evRec->getAllocatedBytes() - evBytes);
 
         respCycle += zll; // count again zll for the trip back
         endAccess(req);
@@ -293,38 +444,64 @@ uint64_t BookSimNetwork::access(MemReq& req) {
 
 uint32_t BookSimNetwork::tick(uint64_t cycle) {
 
-    nocCurCycle = nocIf->getNocCurCycle();
-    if (cpuFreq == nocFreq){
-	    nocIf->Step();
-        nocIf->setNocCurCycle(++nocCurCycle);
-        return 1; 
+    // Inject the invalidation responses that are due
+    while (!pendingInvResps.empty() && pendingInvResps.begin()->first <= cycle) {
+        auto it = pendingInvResps.begin();
+        it->second.first->injectResp(it->second.second, cycle);
+        pendingInvResps.erase(it);
     }
 
-    nocCount += nocFreq;
-
-    while (cpuCount < nocCount){
-        cpuCount += cpuFreq;
+    // Run every NoC cycle that begins during this core cycle. Ticks stay
+    // per core cycle (even with a slower NoC) so that invalidation responses
+    // scheduled by weave events are always injected on their cycle.
+    checkOwner();
+    nocCurCycle = nocIf->getNocCurCycle();
+    uint64_t nocTarget = nocClock.devCyclesBefore(cycle + 1);
+    assert(nocCurCycle <= nocTarget);
+    for (uint64_t steps = nocTarget - nocCurCycle; steps; steps--) {
         nocIf->Step();
         nocIf->setNocCurCycle(++nocCurCycle);
     }
 
-    if (cpuCount == nocCount){
-        cpuCount = 0;
-        nocCount = 0;
-    }
-
     return 1;
 }
 
 void BookSimNetwork::enqueue(BookSimAccEvent* ev, uint64_t cycle) { 
-    doubleCoordinates<int> coord = ev->getCoord();
-    int _source = meshDim*(coord.src.x) + coord.src.y;
-    int _dest = meshDim*(coord.dest.x) + coord.dest.y;
-    uint64_t curPid = nocIf->ManuallyGeneratePacket(_source, _dest, packetSize, -1, ev->getAddr(), ev->getLlcEvent(), this);
-    inflightRequests.insert(std::pair<int,BookSimAccEvent*>(curPid, ev));
+    injectPacket(ev, ev->getCoord());
     ev->hold();
 }
 
+uint64_t BookSimNetwork::injectPacket(BookSimAccEvent* ev, doubleCoordinates<int> coord) {
+    checkOwner();
+    int _source = getNode(coord.src);
+    int _dest = getNode(coord.dest);
+    uint64_t curPid = nocIf->ManuallyGeneratePacket(_source, _dest, packetSize, -1, ev->getAddr(), ev->getLlcEvent(), this);
+    inflightRequests.insert(std::pair<uint64_t,BookSimAccEvent*>(curPid, ev));
+    profInjected.inc();
+    return curPid;
+}
+
+// A single multicast packet if booksim can replicate it in the routers, else back-to-back unicast packets
+void BookSimNetwork::injectBatch(BookSimAccEvent* ev, coordinates<int> src, const coordinates<int>* dsts, uint32_t num, uint64_t* pids) {
+    checkOwner();
+    if (num > 1 && nocIf->SupportsMulticast()) {
+        int nodes[num];
+        for (uint32_t i = 0; i < num; i++) nodes[i] = getNode(dsts[i]);
+        uint64_t curPid = nocIf->ManuallyGenerateMulticastPacket(getNode(src), nodes, num, packetSize, -1, ev->getAddr(), ev->getLlcEvent(), this);
+        inflightRequests.insert(std::pair<uint64_t,BookSimAccEvent*>(curPid, ev));
+        inflightMcastDests.insert(std::pair<uint64_t,uint32_t>(curPid, num));
+        profInjected.inc();
+        profMcastInjected.inc();
+        for (uint32_t i = 0; i < num; i++) pids[i] = curPid;
+    } else {
+        for (uint32_t i = 0; i < num; i++) pids[i] = injectPacket(ev, {src, dsts[i]});
+    }
+}
+
+void BookSimNetwork::scheduleInvResp(BookSimInvFanoutEvent* ev, uint32_t leg, uint64_t cycle) {
+    pendingInvResps.insert(std::make_pair(cycle, std::make_pair(ev, leg)));
+}
+
 void BookSimNetwork::setChildren(const g_vector<BaseCache*>& _children, zsimNetwork* network){
             children.resize(_children.size());
             for (uint32_t c = 0; c < _children.size(); c++) {
@@ -333,25 +510,91 @@ void BookSimNetwork::setChildren(const g_vector<BaseCache*>& _children, zsimNetw
             }
         };
 
+int BookSimNetwork::getZll(coordinates<int> src, coordinates<int> dst) const {
+    int hops = abs(dst.x-src.x) + abs(dst.y-src.y);
+    int zll =(hops + 1)*hopDelay + packetSize-1 + 2;
+    return nocClock.devToSys(zll);
+}
+
 uint64_t BookSimNetwork::invalidate(const InvReq& req){
+    futex_lock(&netLockInv);
+    uint64_t respCycle = invalidateChild(req);
+    futex_unlock(&netLockInv); 
+    return respCycle;
+}
 
+/* Invalidates a set of children that share a line. With compact events, the
+ * whole set is one fan-out event whose requests are injected as a batch, and
+ * the record is built in a single pass; otherwise, each child gets its own T/R
+ * chain between a root and a sync DelayEvent, as with separate invalidate() calls.
+ */
+uint64_t BookSimNetwork::invalidateBatch(const InvReq& req, const uint32_t* nocChildIds, uint32_t num){
+    assert(num);
     futex_lock(&netLockInv);
+
+    EventRecorder* evRec = zinfo->eventRecorders[req.srcId];
+    uint64_t maxCycle = req.cycle;
+    if (!compactEvents || num == 1) {
+        for (uint32_t i = 0; i < num; i++) {
+            InvReq childReq = req;
+            childReq.nocChildId = nocChildIds[i];
+            maxCycle = MAX(maxCycle, invalidateChild(childReq));
+        }
+
+        if (num > 1) {
+            // The sync event fires once the slowest child responds
+            TimingRecord tr = evRec->popRecord();
+            assert(tr.startEvent->getNumChildren() > 1);
+            TimingEvent* syncEv = tr.startEvent->getChildLeftDescendant();
+            syncEv->setMinStartCycle(maxCycle);
+            evRec->pushRecord(tr);
+        }
+    } else {
+        TimingRecord tr = evRec->popRecord();
+        uint64_t evBytes = evRec->getAllocatedBytes();
+
+        coordinates<int> src = parents[0]->getCoord();
+        BookSimInvFanoutEvent* fanoutEv = new (evRec) BookSimInvFanoutEvent(this, req.lineAddr, isLlnoc, src, num, evRec);
+        for (uint32_t i = 0; i < num; i++) {
+            BookSimInvFanoutEvent::Leg& leg = fanoutEv->getLeg(i);
+            leg.child = children[nocChildIds[i]]->getCoord();
+            leg.node = getNode(leg.child);
+            leg.zll = getZll(src, leg.child);
+
+            InvReq request = req;
+            request.cycle = req.cycle + leg.zll;
+            request.nocReq = false;
+            request.nocChildId = nocChildIds[i];
+            uint64_t childLat = children[nocChildIds[i]]->invalidate(request);
+            leg.midDelay = childLat - request.cycle;
+            maxCycle = MAX(maxCycle, childLat + leg.zll);
+        }
+        fanoutEv->setMinStartCycle(req.cycle);
+        fanoutEv->setZll(maxCycle - req.cycle);  // so that minStartCycle + zll is the cycle the last response arrives
+
+        TimingRecord noctr = {req.lineAddr, req.cycle, maxCycle, GETX, fanoutEv, fanoutEv}; // put GETX to stop it from complaining
+        if (tr.startEvent != nullptr) mergeInvRecord(evRec, noctr, tr, fanoutEv, req.cycle);
+        evRec->pushRecord(noctr);
+        profEvBytes.inc(evRec->getAllocatedBytes() - evBytes);
+    }
+
+    if (num > 1) {
+        profInvBatches.inc();
+        profInvBatchLegs.inc(num);
+    }
+    futex_unlock(&netLockInv);
+    return maxCycle;
+}
+
+uint64_t BookSimNetwork::invalidateChild(const InvReq& req){
     uint64_t respCycle = req.cycle;
 
     coordinates<int> src = parents[0]->getCoord();
     coordinates<int> dst = children[req.nocChildId]->getCoord();
     doubleCoordinates<int> coordInvT = {src,dst};
     doubleCoordinates<int> coordInvR = {dst,src};
-    int hops = abs(dst.x-src.x) + abs(dst.y-src.y);
-    int zll =(hops + 1)*hopDelay + packetSize-1 + 2;
-    zll = zll*cpuFreq/nocFreq;
-
+    int zll = getZll(src, dst);
 
-    BookSimAccEvent* nocEvInvT = new (zinfo->eventRecorders[req.srcId]) BookSimAccEvent(this, 0, req.lineAddr, 0, isLlnoc, true);
-    
-    nocEvInvT->setMinStartCycle(respCycle); // the packet is injected when the nocs parent calls the inval function
-    nocEvInvT->setCoord(coordInvT);
-    nocEvInvT->setZll(zll);
 
     respCycle += zll;
 
@@ -366,74 +609,89 @@ uint64_t BookSimNetwork::invalidate(const InvReq& req){
 
     EventRecorder* evRec = zinfo->eventRecorders[req.srcId]; 
     TimingRecord tr = evRec->popRecord();
+    uint64_t evBytes = evRec->getAllocatedBytes();
 
     // increase again the time and create the R event at the time the cache invalidation finishes
     respCycle += prevLevelLat;
 
-    BookSimAccEvent* nocEvInvR = new (zinfo->eventRecorders[req.srcId]) BookSimAccEvent(this, 0, request.lineAddr, 0, isLlnoc, true);
-    
-    nocEvInvR->setMinStartCycle(respCycle); // the packet is injected when the nocs parent calls the inval function
-    nocEvInvR->setCoord(coordInvR);
-    nocEvInvR->setZll(zll);
+    BookSimAccEvent* nocEvInvT;
+    TimingEvent* nocEvInvR; // last event of this invalidation chain
+    if (compactEvents) {
+        nocEvInvT = new (evRec) BookSimRoundTripEvent(this, 0, req.lineAddr, domain, isLlnoc, true, coordInvT, zll, prevLevelLat);
+        nocEvInvT->setMinStartCycle(req.cycle);
+        nocEvInvR = nocEvInvT;
+    } else {
+        nocEvInvT = new (evRec) BookSimAccEvent(this, 0, req.lineAddr, domain, isLlnoc, true);
+        nocEvInvT->setMinStartCycle(req.cycle); // the packet is injected when the nocs parent calls the inval function
+        nocEvInvT->setCoord(coordInvT);
+        nocEvInvT->setZll(zll);
+
+        BookSimAccEvent* retEv = new (evRec) BookSimAccEvent(this, 0, request.lineAddr, domain, isLlnoc, true);
+        retEv->setMinStartCycle(respCycle);
+        retEv->setCoord(coordInvR);
+        retEv->setZll(zll);
+
+        nocEvInvT->addChild(retEv,evRec);
+        nocEvInvT->setPostDelay(prevLevelLat);
+        nocEvInvR = retEv;
+    }
 
     respCycle += zll; 
 
-    nocEvInvT->addChild(nocEvInvR,evRec);
-    nocEvInvT->setPostDelay(prevLevelLat);
-
-
     TimingRecord noctr = {request.lineAddr, req.cycle, respCycle, GETX, nocEvInvT, nocEvInvT}; // put GETX to stop it from complaining 
 
     // tr might contain another invalidation event introduced by the same noc for a different child
     if(tr.startEvent != nullptr){
-        assert(tr.startEvent->getNumChildren() > 0); // if there is a event here, it should be an invalidation/delay event, so it has to have children
-        if(tr.startEvent->getNumChildren() == 1){ // this is just the second event 
-            DelayEvent* rootDelayEv = new (evRec) DelayEvent(0);
-            DelayEvent* syncDelayEv = new (evRec) DelayEvent(0);
-            TimingEvent* prevNocEvInvR = tr.startEvent->getChildLeftDescendant();
-            
-            rootDelayEv->setIsInval(true);
-            syncDelayEv->setIsInval(true);
-
-
-            rootDelayEv->setMinStartCycle(req.cycle);
-
-            
-            // make both chains children of the root event, and parents of the sync event            
-            rootDelayEv->addChild(tr.startEvent, evRec);
-            rootDelayEv->addChild(nocEvInvT, evRec);
-            nocEvInvR    ->addChild(syncDelayEv, evRec);
-            prevNocEvInvR->addChild(syncDelayEv, evRec);
+        mergeInvRecord(evRec, noctr, tr, nocEvInvR, req.cycle);
+    }
 
+    evRec->pushRecord(noctr);
+    profEvBytes.inc(evRec->getAllocatedBytes() - evBytes);
+    return respCycle;
+}
 
-            rootDelayEv->setMinStartCycle(req.cycle);
+// Makes the invalidation chain in noctr (which ends in lastEv) run in parallel with the earlier invalidations in tr
+void BookSimNetwork::mergeInvRecord(EventRecorder* evRec, TimingRecord& noctr, const TimingRecord& tr, TimingEvent* lastEv, uint64_t cycle){
+    TimingEvent* firstEv = noctr.startEvent;
+    // if there is a event here, it is either a single T/R chain (or fan-out) or the root delay event of previous invalidations
+    bool prevIsChain = typeid(*tr.startEvent) != typeid(DelayEvent);
+    assert(prevIsChain || tr.startEvent->getNumChildren() > 1);
+    if(prevIsChain){ // this is just the second event 
+        DelayEvent* rootDelayEv = new (evRec) DelayEvent(0);
+        DelayEvent* syncDelayEv = new (evRec) DelayEvent(0);
+        TimingEvent* prevLastEv = tr.startEvent->getChildLeftDescendant();
+        
+        rootDelayEv->setIsInval(true);
+        syncDelayEv->setIsInval(true);
 
-            noctr.startEvent = rootDelayEv;
-            noctr.endEvent = rootDelayEv;
-        }
-        else{
-            // there are already a root and sync delay events waiting 
-            assert(tr.startEvent->getMinStartCycle() == nocEvInvT->getMinStartCycle()); // all invalidations start at the same cycle
-            TimingEvent* prevSyncDelayEvent = tr.startEvent->getChildLeftDescendant();
+        rootDelayEv->setMinStartCycle(cycle);
 
-            tr.startEvent->addChild(nocEvInvT, evRec); // add the T invalidation event to the root event
-            nocEvInvR->addChild(prevSyncDelayEvent, evRec); // find the sync delay event and set it ass a child of the R invalidation event
+        // make both chains children of the root event, and parents of the sync event            
+        rootDelayEv->addChild(tr.startEvent, evRec);
+        rootDelayEv->addChild(firstEv, evRec);
+        lastEv    ->addChild(syncDelayEv, evRec);
+        prevLastEv->addChild(syncDelayEv, evRec);
 
-            noctr.startEvent = tr.startEvent;
-            noctr.endEvent = tr.startEvent;
-        }
+        noctr.startEvent = rootDelayEv;
+        noctr.endEvent = rootDelayEv;
     }
+    else{
+        // there are already a root and sync delay events waiting 
+        assert(tr.startEvent->getMinStartCycle() == firstEv->getMinStartCycle()); // all invalidations start at the same cycle
+        TimingEvent* prevSyncDelayEvent = tr.startEvent->getChildLeftDescendant();
 
-    evRec->pushRecord(noctr);
-    futex_unlock(&netLockInv); 
-    return respCycle;
+        tr.startEvent->addChild(firstEv, evRec); // add the T invalidation event to the root event
+        lastEv->addChild(prevSyncDelayEvent, evRec); // find the sync delay event and set it ass a child of the R invalidation event
 
+        noctr.startEvent = tr.startEvent;
+        noctr.endEvent = tr.startEvent;
+    }
 }
 
 void BookSimNetwork::noc_read_return_cb(uint32_t id, uint64_t pid, uint64_t latency) {
     futex_lock(&cb_lock);
 
-    uint64_t curCycle = (nocIf->getNocCurCycle())*cpuFreq/nocFreq;  
+    uint64_t curCycle = nocClock.devToSys(nocIf->getNocCurCycle());
     std::unordered_map<uint64_t, BookSimAccEvent*>::iterator it = inflightRequests.find(pid);
 
     if(it == inflightRequests.end()){
@@ -441,9 +699,9 @@ void BookSimNetwork::noc_read_return_cb(uint32_t id, uint64_t pid, uint64_t late
         assert(0);
     }
     BookSimAccEvent* ev = it->second;  
-    uint32_t lat = curCycle - ev->sCycle;
+    uint32_t lat = curCycle - ev->getPacketStartCycle(pid, id);
     
-    assert((uint32_t) ev->getZll() <= lat);
+    assert(ev->getPacketZll(pid, id) <= lat);
 
     if (ev->isWrite()) {
         profWrites.inc();
@@ -455,9 +713,15 @@ void BookSimNetwork::noc_read_return_cb(uint32_t id, uint64_t pid, uint64_t late
 
     futex_unlock(&cb_lock);
 
-    ev->release();
-    ev->done(curCycle);
-    inflightRequests.erase(it);
+    // id is the node the packet was delivered to; multicast packets stay in flight until every destination got theirs
+    std::unordered_map<uint64_t, uint32_t>::iterator mit = inflightMcastDests.find(pid);
+    if (mit == inflightMcastDests.end()) {
+        inflightRequests.erase(it);
+    } else if (--mit->second == 0) {
+        inflightMcastDests.erase(mit);
+        inflightRequests.erase(it);
+    }
+    ev->packetDone(pid, id, curCycle);
 }
 
 void BookSimNetwork::noc_write_return_cb(uint32_t id, uint64_t pid, uint64_t latency) {
@@ -11,14 +11,28 @@
 #include "stats.h"
 #include <iostream>
 #include "interconnect_interface.hpp"
+#include "clock_domain.h"
 #include "coord.h"
+#include "zsim.h"
 
 class SplitAddrMemory;
 class BookSimAccEvent;
-
+class BookSimInvFanoutEvent;
+class EventRecorder;
+class TimingEvent;
+struct TimingRecord;
+
+// BookSim state (nocIf and everything under it, plus inflightRequests and
+// pendingInvResps) lives in the private heap of the process that ran SimInit.
+// All processes still share that one NoC: packets are only injected, stepped
+// and called back from weave-phase events, which zsim simulates exclusively in
+// that process's contention threads. Bound-phase code (access/invalidate),
+// which runs in every process, must only use the cached scalars below
+// (hopDelay, packetSize, meshDim...) and record events; never call nocIf there.
 class BookSimNetwork : public BaseCache { 
     private:
         InterconnectInterface* nocIf;
+        uint32_t ownerProc; // process whose heap holds the booksim state
         g_string name;
         int id;
         bool isLocal;
@@ -28,8 +42,13 @@ class BookSimNetwork : public BaseCache {
         g_vector<BaseCache*> children;
         int numChildren;
         bool isLlnoc; // true if the noc interface is connected to LLC
+        bool compactEvents; // use a single round-trip event for T/R pairs with nothing in between
 
         std::unordered_map<uint64_t,BookSimAccEvent*> inflightRequests;
+        std::unordered_map<uint64_t,uint32_t> inflightMcastDests;  // multicast pid -> destinations it has not reached yet
+
+        // Response legs of batched invalidations, injected by tick() once due: cycle -> (event, leg)
+        std::multimap<uint64_t, std::pair<BookSimInvFanoutEvent*, uint32_t>> pendingInvResps;
 
         uint64_t nocCurCycle; //processor cycle, used in callbacks
 
@@ -37,8 +56,8 @@ class BookSimNetwork : public BaseCache {
         // int flitsPerPacket = 5;
         int meshDim;       
 
-        int nocFreq, cpuFreq, nocSpeedup;
-        int nocCount, cpuCount; 
+        int nocFreq, cpuFreq;
+        ClockDomain nocClock; // core cycles <-> NoC cycles
 
         int packetSize;
         int hopDelay;
@@ -56,15 +75,21 @@ class BookSimNetwork : public BaseCache {
         Counter localReqs, remoteReqs;
         Counter profTotalRdLat;
         Counter profTotalWrLat;
+        Counter profEvBytes;
+        Counter profInjected;
+        Counter profMcastInjected;
+        Counter profInvBatches, profInvBatchLegs;
 #ifdef _SANITY_CHECK_
         Counter nocGETS, nocGETX, nocPUTS, nocPUTX;
 #endif
         PAD();
 
     public:
-        BookSimNetwork(const char* _name, int _id, InterconnectInterface* _interface, int _cpuClk);
+        BookSimNetwork(const char* _name, int _id, InterconnectInterface* _interface, int _cpuClk, bool _compactEvents = true, uint32_t _domain = 0);
         void enqueueTickEvent();
         const char* getName() {return name.c_str();}
+        InterconnectInterface* getInterface() const {return nocIf;}
+        uint32_t getDomain() const {return domain;}
         int getMemId() {
             return id;
         }
@@ -99,8 +124,20 @@ class BookSimNetwork : public BaseCache {
         void setChildren(const g_vector<BaseCache*>& _children, zsimNetwork* network);
         inline int getNumChildren() {return numChildren;}
         uint64_t invalidate(const InvReq& req);
+        uint64_t invalidateBatch(const InvReq& req, const uint32_t* nocChildIds, uint32_t num);
+
+        // Packet injection for timing events; the event gets packetDone(pid, cycle) on delivery
+        uint64_t injectPacket(BookSimAccEvent* ev, doubleCoordinates<int> coord);
+        void injectBatch(BookSimAccEvent* ev, coordinates<int> src, const coordinates<int>* dsts, uint32_t num, uint64_t* pids);
+        void scheduleInvResp(BookSimInvFanoutEvent* ev, uint32_t leg, uint64_t cycle);
+
+        void DisplayStats(){checkOwner(); nocIf->DisplayStats();}
 
-        void DisplayStats(){nocIf->DisplayStats();}
+        // Live stats (see live_stats.h)
+        uint64_t getInjectedFlits() const {return profInjected.get()*packetSize;}
+        uint64_t getEjectedFlits() const {return (profReads.get() + profWrites.get())*packetSize;}
+        uint64_t getDeliveredPackets() const {return profReads.get() + profWrites.get();}
+        uint64_t getTotalPacketLatency() const {return profTotalRdLat.get() + profTotalWrLat.get();}
 
         void setLlnoc(bool _isLlnoc){isLlnoc = _isLlnoc;}
 
@@ -116,6 +153,19 @@ class BookSimNetwork : public BaseCache {
         void startAccess(MemReq& req);
         void endAccess(MemReq& req);
 
+        int getZll(coordinates<int> src, coordinates<int> dst) const;
+        int getNode(coordinates<int> c) const { return meshDim*c.x + c.y; }
+
+        inline void checkOwner() const {
+            // Not an assert: a stray call from another process must fail in release builds too
+            if (unlikely(procIdx != ownerProc)) panic("BookSimNetwork %s used from process %d, but its booksim state lives in process %d",
+                    name.c_str(), procIdx, ownerProc);
+        }
+
+        // Both expect netLockInv to be held
+        uint64_t invalidateChild(const InvReq& req);
+        void mergeInvRecord(EventRecorder* evRec, TimingRecord& noctr, const TimingRecord& tr, TimingEvent* lastEv, uint64_t cycle);
+
         void noc_read_return_cb(uint32_t id, uint64_t pid, uint64_t latency);
         void noc_write_return_cb(uint32_t id, uint64_t pid, uint64_t latency);
 };
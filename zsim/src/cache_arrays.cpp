@@ -24,8 +24,59 @@
  */
 
 #include "cache_arrays.h"
+#include <immintrin.h>
 #include "hash.h"
 #include "repl_policies.h"
+#include "simd.h"
+
+/* Tag matching. Lines are never duplicated within a set, but empty lines all
+ * have tag 0, so every version returns the first match to behave identically.
+ */
+
+static int32_t matchTagsScalar(const Address* tags, uint32_t n, Address lineAddr) {
+    for (uint32_t i = 0; i < n; i++) {
+        if (tags[i] == lineAddr) return i;
+    }
+    return -1;
+}
+
+__attribute__((target("avx2")))
+static int32_t matchTagsAVX2(const Address* tags, uint32_t n, Address lineAddr) {
+    __m256i key = _mm256_set1_epi64x(lineAddr);
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i c0 = _mm256_cmpeq_epi64(key, _mm256_loadu_si256((const __m256i*)&tags[i]));
+        __m256i c1 = _mm256_cmpeq_epi64(key, _mm256_loadu_si256((const __m256i*)&tags[i+4]));
+        uint32_t mask = _mm256_movemask_pd(_mm256_castsi256_pd(c0)) | (_mm256_movemask_pd(_mm256_castsi256_pd(c1)) << 4);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    if (i + 4 <= n) {
+        __m256i c = _mm256_cmpeq_epi64(key, _mm256_loadu_si256((const __m256i*)&tags[i]));
+        uint32_t mask = _mm256_movemask_pd(_mm256_castsi256_pd(c));
+        if (mask) return i + __builtin_ctz(mask);
+        i += 4;
+    }
+    for (; i < n; i++) {
+        if (tags[i] == lineAddr) return i;
+    }
+    return -1;
+}
+
+__attribute__((target("avx512f")))
+static int32_t matchTagsAVX512(const Address* tags, uint32_t n, Address lineAddr) {
+    __m512i key = _mm512_set1_epi64(lineAddr);
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __mmask8 mask = _mm512_cmpeq_epi64_mask(key, _mm512_loadu_si512((const void*)&tags[i]));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    if (i < n) {  // masked load, does not touch tags past n
+        __mmask8 valid = (1 << (n - i)) - 1;
+        __mmask8 mask = _mm512_mask_cmpeq_epi64_mask(valid, key, _mm512_maskz_loadu_epi64(valid, (const void*)&tags[i]));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return -1;
+}
 
 /* Set-associative array implementation */
 
@@ -34,18 +85,26 @@ SetAssocArray::SetAssocArray(uint32_t _numLines, uint32_t _assoc, ReplPolicy* _r
     numSets = numLines/assoc;
     setMask = numSets - 1;
     assert_msg(isPow2(numSets), "must have a power of 2 # sets, but you specified %d", numSets);
+
+    // Vectors only pay off with whole registers' worth of tags
+    SimdLevel simdLevel = simd::getLevel();
+    if (simdLevel == SIMD_AVX512 && assoc >= 8) {
+        matchTags = matchTagsAVX512;
+    } else if (simdLevel >= SIMD_AVX2 && assoc >= 4) {
+        matchTags = matchTagsAVX2;
+    } else {
+        matchTags = matchTagsScalar;
+    }
 }
 
 int32_t SetAssocArray::lookup(const Address lineAddr, const MemReq* req, bool updateReplacement) {
     uint32_t set = hf->hash(0, lineAddr) & setMask;
     uint32_t first = set*assoc;
-    for (uint32_t id = first; id < first + assoc; id++) {
-        if (array[id] ==  lineAddr) {
-            if (updateReplacement) rp->update(id, req);
-            return id;
-        }
-    }
-    return -1;
+    int32_t way = matchTags(&array[first], assoc, lineAddr);
+    if (way < 0) return -1;
+    uint32_t id = first + way;
+    if (updateReplacement) rp->update(id, req);
+    return id;
 }
 
 uint32_t SetAssocArray::preinsert(const Address lineAddr, const MemReq* req, Address* wbLineAddr) { //TODO: Give out valid bit of wb cand?
@@ -103,8 +162,10 @@ int32_t ZArray::lookup(const Address lineAddr, const MemReq* req, bool updateRep
      */
     if (unlikely(!lineAddr)) panic("ZArray::lookup called with lineAddr==0 -- your app just segfaulted");
 
+    uint64_t hashes[ways];  // all ways at once, vectorized in H3HashFamily
+    hf->hashAll(lineAddr, ways, hashes);
     for (uint32_t w = 0; w < ways; w++) {
-        uint32_t lineId = lookupArray[w*numSets + (hf->hash(w, lineAddr) & setMask)];
+        uint32_t lineId = lookupArray[w*numSets + (hashes[w] & setMask)];
         if (array[lineId] == lineAddr) {
             if (updateReplacement) {
                 rp->update(lineId, req);
@@ -125,8 +186,10 @@ uint32_t ZArray::preinsert(const Address lineAddr, const MemReq* req, Address* w
     //info("Replacement for incoming 0x%lx", lineAddr);
 
     //Seeds
+    uint64_t hashes[ways];
+    hf->hashAll(lineAddr, ways, hashes);
     for (uint32_t w = 0; w < ways; w++) {
-        uint32_t pos = w*numSets + (hf->hash(w, lineAddr) & setMask);
+        uint32_t pos = w*numSets + (hashes[w] & setMask);
         uint32_t lineId = lookupArray[pos];
         candidates[w].set(pos, lineId, -1);
         all_valid &= (array[lineId] != 0);
@@ -138,8 +201,9 @@ uint32_t ZArray::preinsert(const Address lineAddr, const MemReq* req, Address* w
         uint32_t fringeId = candidates[fringeStart].lineId;
         Address fringeAddr = array[fringeId];
         assert(fringeAddr);
+        hf->hashAll(fringeAddr, ways, hashes);
         for (uint32_t w = 0; w < ways; w++) {
-            uint32_t hval = hf->hash(w, fringeAddr) & setMask;
+            uint32_t hval = hashes[w] & setMask;
             uint32_t pos = w*numSets + hval;
             uint32_t lineId = lookupArray[pos];
 
@@ -54,6 +54,9 @@ class CacheArray : public GlobAlloc {
 class ReplPolicy;
 class HashFamily;
 
+// Returns the index of the first of n tags that matches lineAddr, or -1
+typedef int32_t (*TagMatchFn)(const Address* tags, uint32_t n, Address lineAddr);
+
 /* Set-associative cache array */
 class SetAssocArray : public CacheArray {
     protected:
@@ -64,6 +67,7 @@ class SetAssocArray : public CacheArray {
         uint32_t numSets;
         uint32_t assoc;
         uint32_t setMask;
+        TagMatchFn matchTags;  // scalar or SIMD, chosen at construction
 
     public:
         SetAssocArray(uint32_t _numLines, uint32_t _assoc, ReplPolicy* _rp, HashFamily* _hf);
@@ -0,0 +1,166 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Cache lookup microbenchmark. Replays the line addresses of an access trace
+ * (see TracingCache) through SetAssocArray and ZArray with each SIMD level this
+ * machine supports, with and without H3 tables, checks that every variant
+ * produces the same hits and line ids as the scalar code, and reports how long
+ * lookups and replacements took.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <time.h>
+#include <vector>
+#include "access_tracing.h"
+#include "cache_arrays.h"
+#include "galloc.h"
+#include "hash.h"
+#include "log.h"
+#include "repl_policies.h"
+#include "simd.h"
+
+// LRU without a coherence controller (all lines are valid once inserted)
+class BenchLRUReplPolicy : public ReplPolicy {
+    private:
+        uint64_t timestamp;
+        uint64_t* array;
+
+    public:
+        explicit BenchLRUReplPolicy(uint32_t numLines) : timestamp(1) {
+            array = gm_calloc<uint64_t>(numLines);
+        }
+
+        ~BenchLRUReplPolicy() {
+            gm_free(array);
+        }
+
+        void update(uint32_t id, const MemReq* req) {
+            array[id] = timestamp++;
+        }
+
+        void replaced(uint32_t id) {
+            array[id] = 0;
+        }
+
+        template <typename C> inline uint32_t rank(const MemReq* req, C cands) {
+            uint32_t bestCand = -1;
+            uint64_t bestScore = (uint64_t)-1L;
+            for (auto ci = cands.begin(); ci != cands.end(); ci.inc()) {
+                if (array[*ci] < bestScore) {
+                    bestCand = *ci;
+                    bestScore = array[*ci];
+                }
+            }
+            return bestCand;
+        }
+
+        DECL_RANK_BINDINGS;
+};
+
+struct BenchResult {
+    uint64_t hits;
+    uint64_t checksum;  // over returned line ids, to catch any divergence
+    uint64_t ns;
+};
+
+static uint64_t getNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000000000L + ts.tv_nsec;
+}
+
+static BenchResult replay(bool zarray, bool h3Tables, uint32_t numLines, uint32_t ways, uint32_t cands, const std::vector<Address>& addrs) {
+    uint32_t setBits = 31 - __builtin_clz(numLines/ways);
+    HashFamily* hf = new H3HashFamily(zarray? ways : 1, setBits, 0xCAC7EAFFA1, h3Tables);
+    BenchLRUReplPolicy* rp = new BenchLRUReplPolicy(numLines);
+    CacheArray* array = zarray? (CacheArray*) new ZArray(numLines, ways, cands, rp, hf) : (CacheArray*) new SetAssocArray(numLines, ways, rp, hf);
+
+    BenchResult res = {0, 0, 0};
+    uint64_t start = getNs();
+    for (Address lineAddr : addrs) {
+        int32_t lineId = array->lookup(lineAddr, nullptr, true);
+        if (lineId == -1) {
+            Address wbLineAddr;
+            lineId = array->preinsert(lineAddr, nullptr, &wbLineAddr);
+            array->postinsert(lineAddr, nullptr, lineId);
+        } else {
+            res.hits++;
+        }
+        res.checksum = res.checksum*31 + lineId;
+    }
+    res.ns = getNs() - start;
+
+    delete array;
+    delete rp;
+    delete hf;
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    InitLog("[B] ");
+    if (argc < 2 || argc > 5) {
+        info("Usage: %s <trace> [<lines> [<ways> [<zcandidates>]]]", argv[0]);
+        exit(1);
+    }
+    uint32_t numLines = (argc > 2)? atoi(argv[2]) : 32768;
+    uint32_t ways = (argc > 3)? atoi(argv[3]) : 16;
+    uint32_t cands = (argc > 4)? atoi(argv[4]) : 52;
+
+    gm_init((256 << 20) + 64*(size_t)numLines);
+
+    std::vector<Address> addrs;
+    AccessTraceReader tr(argv[1]);
+    addrs.reserve(tr.getNumRecords());
+    while (!tr.empty()) {
+        AccessRecord acc = tr.read();
+        if (acc.lineAddr) addrs.push_back(acc.lineAddr);  // ZArray does not take line 0
+    }
+    if (addrs.empty()) panic("%s has no accesses", argv[1]);
+    info("%ld accesses, %d lines, %d ways, %d candidates", addrs.size(), numLines, ways, cands);
+
+    SimdLevel maxLevel = simd::getLevel();
+    for (bool zarray : {false, true}) {
+        const char* arrayName = zarray? "ZArray" : "SetAssocArray";
+        BenchResult base = {0, 0, 0};
+        for (bool h3Tables : {false, true}) {
+            for (uint32_t l = SIMD_NONE; l <= maxLevel; l++) {
+                simd::maxLevel() = (SimdLevel)l;
+                BenchResult res = replay(zarray, h3Tables, numLines, ways, cands, addrs);
+                const char* variant = h3Tables? "tables" : "matrix";
+                if (l == SIMD_NONE && !h3Tables) {
+                    base = res;
+                } else if (res.hits != base.hits || res.checksum != base.checksum) {
+                    panic("%s: %s/%s results differ from scalar (%ld vs %ld hits)", arrayName, simd::getLevelName((SimdLevel)l), variant, res.hits, base.hits);
+                }
+                info("%14s %7s %s: %ld hits, %.2f ns/access, %.2fx vs scalar", arrayName, simd::getLevelName((SimdLevel)l), variant,
+                        res.hits, ((double)res.ns)/addrs.size(), ((double)base.ns)/res.ns);
+            }
+        }
+    }
+    return 0;
+}
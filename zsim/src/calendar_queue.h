@@ -0,0 +1,178 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALENDAR_QUEUE_H_
+#define CALENDAR_QUEUE_H_
+
+#include <stdint.h>
+#include "bithacks.h"
+#include "log.h"
+
+/* Hierarchical calendar queue (multi-level timing wheel), an alternative to
+ * PrioQueue for domains whose events are often far in the future.
+ *
+ * Cycles are split in 6-bit digits. Level l holds the events that match the
+ * current cycle in every digit above l but differ in digit l, bucketed by that
+ * digit, so every event in level l comes before every event in level l+1, and
+ * slots within a level are in order. Enqueues are O(1) for any horizon (no far
+ * map). When level 0 runs dry, the first populated slot of the lowest
+ * non-empty level is cascaded down; each element cascades at most once per
+ * level, so dequeues are amortized O(1). Same-cycle elements come out in
+ * strict LIFO order (pqbench checks this). PrioQueue is only LIFO for elements
+ * that never went through its far map, because migrated far elements go on top
+ * of newer near ones. So the two queues can order same-cycle elements differently.
+ *
+ * firstCycle() does not cascade, since the domain may still enqueue elements
+ * before the first one; it scans the first slot instead and caches the result.
+ *
+ * T needs a next pointer and a privCycle field, which the queue sets on enqueue.
+ */
+template <typename T>
+class CalendarQueue {
+    static const uint32_t LEVELS = 11;  // 11*6 bits cover all 64-bit cycles
+
+    struct CQLevel {
+        T* slots[64];
+        uint64_t occ; // bit i is 1 if slots[i] is populated
+    };
+
+    CQLevel levels[LEVELS];
+    uint32_t levelOcc; // bit l is 1 if levels[l] is populated
+
+    uint64_t curCycle; // no element is earlier than this
+    uint64_t elems;
+
+    mutable uint64_t minCycle; // cached result of firstCycle() when level 0 is empty
+    mutable bool minValid;
+
+    public:
+        CalendarQueue() {
+            for (uint32_t l = 0; l < LEVELS; l++) {
+                for (uint32_t i = 0; i < 64; i++) levels[l].slots[i] = nullptr;
+                levels[l].occ = 0;
+            }
+            levelOcc = 0;
+            curCycle = 0;
+            elems = 0;
+            minCycle = 0;
+            minValid = false;
+        }
+
+        void enqueue(T* obj, uint64_t cycle) {
+            assert(cycle >= curCycle);
+            assert(!obj->next);
+            obj->privCycle = cycle;
+            insert(obj, cycle);
+            if (minValid && cycle < minCycle) minCycle = cycle;
+            elems++;
+        }
+
+        T* dequeue(uint64_t& deqCycle) {
+            assert(elems);
+            cascade();
+            CQLevel& l0 = levels[0];
+            uint32_t pos = __builtin_ctzl(l0.occ);
+            T* res = l0.slots[pos];
+            l0.slots[pos] = res->next;
+            if (!res->next) {
+                l0.occ ^= 1L << pos;
+                if (!l0.occ) levelOcc ^= 1;
+            }
+            res->next = nullptr;
+            elems--;
+            minValid = false;
+
+            deqCycle = (curCycle & ~63UL) | pos;
+            curCycle = deqCycle;
+            return res;
+        }
+
+        inline uint64_t size() const {
+            return elems;
+        }
+
+        inline uint64_t firstCycle() const {
+            assert(elems);
+            if (levelOcc & 1) return (curCycle & ~63UL) | __builtin_ctzl(levels[0].occ);
+            if (!minValid) {
+                const CQLevel& lvl = levels[__builtin_ctz(levelOcc)];
+                const T* obj = lvl.slots[__builtin_ctzl(lvl.occ)];
+                minCycle = obj->privCycle;
+                for (obj = obj->next; obj; obj = obj->next) minCycle = MIN(minCycle, obj->privCycle);
+                minValid = true;
+            }
+            return minCycle;
+        }
+
+    private:
+        inline void insert(T* obj, uint64_t cycle) {
+            uint64_t diff = cycle ^ curCycle;
+            uint32_t l = diff? (63 - __builtin_clzl(diff))/6 : 0;
+            uint32_t pos = (cycle >> (6*l)) & 63;
+            CQLevel& lvl = levels[l];
+            obj->next = lvl.slots[pos];
+            lvl.slots[pos] = obj;
+            lvl.occ |= 1L << pos;
+            levelOcc |= 1 << l;
+        }
+
+        // Moves elements down until level 0 holds the earliest ones
+        inline void cascade() {
+            while (!(levelOcc & 1)) {
+                assert(levelOcc);
+                uint32_t l = __builtin_ctz(levelOcc);
+                CQLevel& lvl = levels[l];
+                uint32_t pos = __builtin_ctzl(lvl.occ);
+                T* list = lvl.slots[pos];
+                lvl.slots[pos] = nullptr;
+                lvl.occ ^= 1L << pos;
+                if (!lvl.occ) levelOcc ^= 1 << l;
+
+                // Jump to the start of the slot; its elements now land in lower levels
+                uint32_t shift = 6*(l+1);
+                uint64_t upper = (shift < 64)? ((curCycle >> shift) << shift) : 0;
+                curCycle = upper | (((uint64_t)pos) << (6*l));
+
+                // Slots are LIFO lists, so reinsert oldest-first to keep same-cycle elements LIFO
+                T* rev = nullptr;
+                while (list) {
+                    T* obj = list;
+                    list = obj->next;
+                    obj->next = rev;
+                    rev = obj;
+                }
+                while (rev) {
+                    T* obj = rev;
+                    rev = obj->next;
+                    obj->next = nullptr;
+                    uint64_t cycle = obj->privCycle;
+                    assert(cycle >= curCycle);
+                    insert(obj, cycle);
+                }
+            }
+        }
+};
+
+#endif  // CALENDAR_QUEUE_H_
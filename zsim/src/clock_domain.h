@@ -0,0 +1,81 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CLOCK_DOMAIN_H_
+#define CLOCK_DOMAIN_H_
+
+#include <stdint.h>
+#include "log.h"
+
+/* Rational crossing between the system (core) clock and a device clock, such
+ * as the NoC or a memory controller's scheduler. Both frequencies are reduced
+ * by their gcd once, and every conversion is computed from absolute cycle
+ * counts, so non-integer ratios (e.g., 2.4GHz cores and a 3.2GHz NoC) neither
+ * drift nor truncate the period to an integer number of system cycles.
+ *
+ * Device cycle d begins during system cycle devToSys(d) = floor(d*sys/dev).
+ * A device ticked from a TickEvent runs devCyclesBefore(c+1) - devCyclesBefore(c)
+ * cycles in system cycle c, and its next tick is at nextTick(c).
+ */
+class ClockDomain {
+    private:
+        uint64_t sysFreq, devFreq; // reduced
+
+        // floor(x*n/d) and ceil(x*n/d) without overflowing on x*n (n, d are reduced frequencies)
+        static inline uint64_t mulDiv(uint64_t x, uint64_t n, uint64_t d) {
+            return (x/d)*n + (x%d)*n/d;
+        }
+        static inline uint64_t mulDivCeil(uint64_t x, uint64_t n, uint64_t d) {
+            return (x/d)*n + ((x%d)*n + d - 1)/d;
+        }
+
+    public:
+        ClockDomain() : sysFreq(1), devFreq(1) {}
+
+        ClockDomain(uint64_t _sysFreq, uint64_t _devFreq) {
+            assert_msg(_sysFreq && _devFreq, "Clock domain frequencies must be non-zero (sys %ld dev %ld)", _sysFreq, _devFreq);
+            uint64_t a = _sysFreq, b = _devFreq;
+            while (b) { uint64_t t = a % b; a = b; b = t; }
+            sysFreq = _sysFreq/a;
+            devFreq = _devFreq/a;
+        }
+
+        bool isUnit() const { return sysFreq == devFreq; }
+
+        // Truncating conversions of cycle counts or timestamps
+        inline uint64_t sysToDev(uint64_t sysCycles) const { return mulDiv(sysCycles, devFreq, sysFreq); }
+        inline uint64_t devToSys(uint64_t devCycles) const { return mulDiv(devCycles, sysFreq, devFreq); }
+
+        // Device cycles that begin strictly before sysCycle, ceil(sysCycle*dev/sys)
+        inline uint64_t devCyclesBefore(uint64_t sysCycle) const { return mulDivCeil(sysCycle, devFreq, sysFreq); }
+
+        // First system cycle >= sysCycle in which a device cycle begins
+        inline uint64_t tickAtOrAfter(uint64_t sysCycle) const { return devToSys(devCyclesBefore(sysCycle)); }
+
+        // First system cycle > sysCycle in which a device cycle begins
+        inline uint64_t nextTick(uint64_t sysCycle) const { return tickAtOrAfter(sysCycle + 1); }
+};
+
+#endif  // CLOCK_DOMAIN_H_
@@ -265,6 +265,20 @@ void MESITopCC::setGrandChildren(const g_vector<BaseCache*>& _grandChildren){
     }
 }
 
+void MESITopCC::initStats(AggregateStat* parentStat) {
+    AggregateStat* dirStat = new AggregateStat();
+    dirStat->init("dir", "Directory stats");
+    auto dirBytesFn = [this]() { return getDirectoryBytes(); };
+    auto dirBytesStat = makeLambdaStat(dirBytesFn);
+    dirBytesStat->init("bytes", "Directory footprint in bytes, including overflowed sharer sets");
+    dirStat->append(dirBytesStat);
+    sharers.initStats(dirStat);
+    parentStat->append(dirStat);
+}
+
+uint64_t MESITopCC::getDirectoryBytes() const {
+    return numLines*sizeof(Entry) + sharers.getBytes();
+}
 
 uint64_t MESITopCC::sendInvalidates(Address lineAddr, uint32_t lineId, InvType type, bool* reqWriteback, uint64_t cycle, uint32_t srcId, bool nocReq, uint32_t nocChildId) {
 
@@ -278,41 +292,30 @@ uint64_t MESITopCC::sendInvalidates(Address lineAddr, uint32_t lineId, InvType t
 
     uint64_t maxCycle = cycle; //keep maximum cycle only, we assume all invals are sent in parallel
     if (!e->isEmpty()) {
-        uint32_t numChildren = children.size();
+        uint32_t sharerIds[MAX_CACHE_CHILDREN];
         uint32_t sentInvs = 0;
         if(!nocReq){
-            for (uint32_t c = 0; c < numChildren; c++) {
-                if (e->sharers[c]) {
-                    InvReq req = {lineAddr, type, reqWriteback, cycle, srcId};
-                    uint64_t respCycle = children[c]->invalidate(req);
-                    respCycle += childrenRTTs[c];
-                    maxCycle = MAX(respCycle, maxCycle);
-                    if (type == INV) e->sharers[c] = false;
-                    sentInvs++;
-                }
+            uint32_t numIds = sharers.getSharers(lineId, children.size(), sharerIds);
+            for (uint32_t i = 0; i < numIds; i++) {
+                uint32_t c = sharerIds[i];
+                InvReq req = {lineAddr, type, reqWriteback, cycle, srcId};
+                uint64_t respCycle = children[c]->invalidate(req);
+                respCycle += childrenRTTs[c];
+                maxCycle = MAX(respCycle, maxCycle);
+                if (type == INV) sharers.removeSharer(lineId, c);
+                sentInvs++;
             }
         } else {
-            for(int g = 0; g < numGrandChildren; g++) {
-                if (e->sharers[g]) {
-                    InvReq req = {lineAddr, type, reqWriteback, cycle, srcId};
-                    req.nocChildId = g;
-                    uint64_t respCycle = children[0]->invalidate(req); // assuming I only have one NoC child
-                    maxCycle = MAX(respCycle, maxCycle);
-                    if (type == INV) e->sharers[g] = false;
-                    sentInvs++;
+            uint32_t numIds = sharers.getSharers(lineId, numGrandChildren, sharerIds);
+            if (numIds) {
+                // The NoC fans out to every sharer at once; assuming I only have one NoC child
+                InvReq req = {lineAddr, type, reqWriteback, cycle, srcId};
+                uint64_t respCycle = children[0]->invalidateBatch(req, sharerIds, numIds);
+                maxCycle = MAX(respCycle, maxCycle);
+                if (type == INV) {
+                    for (uint32_t i = 0; i < numIds; i++) sharers.removeSharer(lineId, sharerIds[i]);
                 }
-            }
-
-            // If there were more than one invalidations, it means there are two delay events, a root and a sync, 
-            // the second of which needs to have its minStartCycle set 
-            if(sentInvs > 1){
-                EventRecorder* evRec = zinfo->eventRecorders[srcId]; 
-                TimingRecord tr = evRec->popRecord();
-                assert(tr.startEvent->getNumChildren() > 1);
-                
-                TimingEvent* syncEv = tr.startEvent->getChildLeftDescendant();
-                syncEv->setMinStartCycle(maxCycle);
-                evRec->pushRecord(tr);
+                sentInvs = numIds;
             }
         }
 
@@ -334,6 +337,9 @@ uint64_t MESITopCC::sendInvalidates(Address lineAddr, uint32_t lineId, InvType t
 uint64_t MESITopCC::processEviction(Address wbLineAddr, uint32_t lineId, bool* reqWriteback, uint64_t cycle, uint32_t srcId, bool nocReq, uint32_t nocChildId) {
     if (nonInclusiveHack) {
         // Don't invalidate anything, just clear our entry
+        uint32_t sharerIds[MAX_CACHE_CHILDREN];
+        uint32_t numIds = sharers.getSharers(lineId, MAX_CACHE_CHILDREN, sharerIds);
+        for (uint32_t i = 0; i < numIds; i++) sharers.removeSharer(lineId, sharerIds[i]);
         array[lineId].clear();
         return cycle;
     } else {
@@ -350,7 +356,7 @@ uint64_t MESITopCC::processAccess(Address lineAddr, uint32_t lineId, AccessType
         case PUTX:
             assert(e->isExclusive());
             if (flags & MemReq::PUTX_KEEPEXCL) {
-                assert(e->sharers[childId]);
+                assert(sharers.isSharer(lineId, childId));
                 assert(*childState == M);
                 *childState = E; //they don't hold dirty data anymore
                 break; //don't remove from sharer set. It'll keep exclusive perms.
@@ -358,11 +364,11 @@ uint64_t MESITopCC::processAccess(Address lineAddr, uint32_t lineId, AccessType
             //note NO break in general
         case PUTS:
             if(!nocReq){
-                assert(e->sharers[childId]);
-                e->sharers[childId] = false;                  
+                assert(sharers.isSharer(lineId, childId));
+                sharers.removeSharer(lineId, childId);                  
             }
             else{
-                e->sharers[nocChildId] = false;
+                sharers.removeSharer(lineId, nocChildId);
             }
             e->numSharers--;
             *childState = I;
@@ -372,16 +378,16 @@ uint64_t MESITopCC::processAccess(Address lineAddr, uint32_t lineId, AccessType
                 //Give in E state
                 e->exclusive = true;
                 if(!nocReq){
-                    e->sharers[childId] = true;
+                    sharers.addSharer(lineId, childId);
                 }
                 else{
-                    e->sharers[srcId] = true;
+                    sharers.addSharer(lineId, srcId);
                 }
                 e->numSharers = 1;
                 *childState = E;
             } else {
                 //Give in S state
-                assert(e->sharers[childId] == false);
+                assert(!sharers.isSharer(lineId, childId));
 
                 if (e->isExclusive()) {
                     //Downgrade the exclusive sharer
@@ -391,10 +397,10 @@ uint64_t MESITopCC::processAccess(Address lineAddr, uint32_t lineId, AccessType
                 assert_msg(!e->isExclusive(), "Can't have exclusivity here. isExcl=%d excl=%d numSharers=%d", e->isExclusive(), e->exclusive, e->numSharers);
 
                 if(!nocReq){
-                    e->sharers[childId] = true;
+                    sharers.addSharer(lineId, childId);
                 }
                 else{
-                    e->sharers[srcId] = true;
+                    sharers.addSharer(lineId, srcId);
                 }
                 e->numSharers++;
                 e->exclusive = false; //dsm: Must set, we're explicitly non-exclusive
@@ -406,16 +412,16 @@ uint64_t MESITopCC::processAccess(Address lineAddr, uint32_t lineId, AccessType
 
             // If child is in sharers list (this is an upgrade miss), take it out
             if(!nocReq){
-                if (e->sharers[childId]) {
+                if (sharers.isSharer(lineId, childId)) {
                     assert_msg(!e->isExclusive(), "Spurious GETX, childId=%d numSharers=%d isExcl=%d excl=%d", childId, e->numSharers, e->isExclusive(), e->exclusive);
-                    e->sharers[childId] = false;
+                    sharers.removeSharer(lineId, childId);
                     e->numSharers--;
                 }
             }
             else{
-                if (e->sharers[srcId]) {
+                if (sharers.isSharer(lineId, srcId)) {
                     // assert_msg(!e->isExclusive(), "Spurious GETX, childId=%d numSharers=%d isExcl=%d excl=%d", childId, e->numSharers, e->isExclusive(), e->exclusive);
-                    e->sharers[srcId] = false;
+                    sharers.removeSharer(lineId, srcId);
                     e->numSharers--;
                 }
             }
@@ -425,10 +431,10 @@ uint64_t MESITopCC::processAccess(Address lineAddr, uint32_t lineId, AccessType
 
             // Set current sharer, mark exclusive
             if(!nocReq){
-                e->sharers[childId] = true;
+                sharers.addSharer(lineId, childId);
             } else{
                 // I do this because the childId will always be 0 with noc1-L3 
-                e->sharers[srcId] = true;
+                sharers.addSharer(lineId, srcId);
             }
             e->numSharers++;
             e->exclusive = true;
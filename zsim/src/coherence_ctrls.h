@@ -33,6 +33,7 @@
 #include "locks.h"
 #include "memory_hierarchy.h"
 #include "pad.h"
+#include "sharer_directory.h"
 #include "stats.h"
 #include "network.h"
 
@@ -201,14 +202,12 @@ class MESIBottomCC : public GlobAlloc {
 class MESITopCC : public GlobAlloc {
     private:
         struct Entry {
-            uint32_t numSharers;
-            std::bitset<MAX_CACHE_CHILDREN> sharers;
+            uint16_t numSharers;
             bool exclusive;
 
             void clear() {
                 exclusive = false;
                 numSharers = 0;
-                sharers.reset();
             }
 
             bool isEmpty() {
@@ -220,6 +219,7 @@ class MESITopCC : public GlobAlloc {
             }
         };
 
+        SharerDirectory sharers;  // callers keep Entry::numSharers up to date
 
         const char* name;
 
@@ -238,7 +238,7 @@ class MESITopCC : public GlobAlloc {
         PAD();
 
     public:
-        MESITopCC(uint32_t _numLines, bool _nonInclusiveHack) : numLines(_numLines), nonInclusiveHack(_nonInclusiveHack) {
+        MESITopCC(uint32_t _numLines, bool _nonInclusiveHack, uint32_t _dirPtrs = 0) : sharers(_numLines, _dirPtrs), numLines(_numLines), nonInclusiveHack(_nonInclusiveHack) {
             array = gm_calloc<Entry>(numLines);
             for (uint32_t i = 0; i < numLines; i++) {
                 array[i].clear();
@@ -283,8 +283,12 @@ class MESITopCC : public GlobAlloc {
             return array[lineId].numSharers;
         }
 
+        void initStats(AggregateStat* parentStat);
+
     private:
         uint64_t sendInvalidates(Address lineAddr, uint32_t lineId, InvType type, bool* reqWriteback, uint64_t cycle, uint32_t srcId, bool nocReq, uint32_t nocChildId);
+
+        uint64_t getDirectoryBytes() const;
 };
 
 static inline bool CheckForMESIRace(AccessType& type, MESIState* state, MESIState initialState) {
@@ -324,12 +328,13 @@ class MESICC : public CC {
         uint32_t numLines;
         bool isLLC;
         bool nonInclusiveHack;
+        uint32_t dirPtrs;  // 0 for a full-map directory
         g_string name;
 
     public:
         //Initialization
-        MESICC(uint32_t _numLines, bool _isLLC, bool _nonInclusiveHack, g_string& _name) : tcc(nullptr), bcc(nullptr),
-            numLines(_numLines), isLLC(_isLLC), nonInclusiveHack(_nonInclusiveHack), name(_name) {}
+        MESICC(uint32_t _numLines, bool _isLLC, bool _nonInclusiveHack, g_string& _name, uint32_t _dirPtrs = 0) : tcc(nullptr), bcc(nullptr),
+            numLines(_numLines), isLLC(_isLLC), nonInclusiveHack(_nonInclusiveHack), dirPtrs(_dirPtrs), name(_name) {}
 
         void setParents(uint32_t childId, const g_vector<MemObject*>& parents, zsimNetwork* network) {
             bcc = new MESIBottomCC(numLines, childId, isLLC, nonInclusiveHack);
@@ -347,7 +352,7 @@ class MESICC : public CC {
 
 
         void setChildren(const g_vector<BaseCache*>& children, zsimNetwork* network) {
-            tcc = new MESITopCC(numLines, nonInclusiveHack);
+            tcc = new MESITopCC(numLines, nonInclusiveHack, dirPtrs);
             tcc->init(children, network, name.c_str());
         }
 
@@ -370,7 +375,7 @@ class MESICC : public CC {
         }
 
         void initStats(AggregateStat* cacheStat) {
-            //no tcc stats
+            tcc->initStats(cacheStat);
             bcc->initStats(cacheStat);
         }
 
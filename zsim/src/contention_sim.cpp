@@ -66,15 +66,18 @@ ContentionSim::ContentionSim(uint32_t _numDomains, uint32_t _numSimThreads) {
     lastLimit = 0;
     inCSim = false;
 
-#ifdef _WITH_BOOKSIM_
-    topNoc = gm_calloc<BookSimNetwork>(1);
-#endif
 
     domains = gm_calloc<DomainData>(numDomains);
     simThreads = gm_calloc<SimThreadData>(numSimThreads);
 
     for (uint32_t i = 0; i < numDomains; i++) {
-        new (&domains[i].pq) PrioQueue<TimingEvent, PQ_BLOCKS>();
+        new (&domains[i].pq) DomainQueue();
+#if RECORD_PQ_OPS
+        std::stringstream ss;
+        ss << zinfo->outputDir << "/pqops-" << i << ".bin";
+        domains[i].pq.opLog = fopen(ss.str().c_str(), "w");
+        if (!domains[i].pq.opLog) panic("Could not open %s", ss.str().c_str());
+#endif
         domains[i].curCycle = 0;
         futex_init(&domains[i].pqLock);
     }
@@ -104,6 +107,11 @@ ContentionSim::ContentionSim(uint32_t _numDomains, uint32_t _numSimThreads) {
     lastCrossing = gm_calloc<CrossingEventInfo>(numDomains*numDomains*MAX_THREADS); //TODO: refine... this allocs too much
 }
 
+void ContentionSim::setCalendarQueue(uint32_t domain) {
+    assert(domain < numDomains);
+    domains[domain].pq.useCalendar();
+}
+
 void ContentionSim::postInit() {
     for (uint32_t i = 0; i < zinfo->numCores; i++) {
         TimingCore* tcore = dynamic_cast<TimingCore*>(zinfo->cores[i]);
@@ -299,7 +307,7 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
     if (thDomains == 1) {
         DomainData& domain = domains[simThreads[thid].firstDomain];
         domain.profTime.start();
-        PrioQueue<TimingEvent, PQ_BLOCKS>& pq = domain.pq;
+        DomainQueue& pq = domain.pq;
         while (pq.size() && pq.firstCycle() < limit) {
             uint64_t domCycle = domain.curCycle;
             uint64_t cycle;
@@ -367,7 +375,7 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
             while (domPq.size()) {
                 DomainData* domain = domPq.top();
                 domPq.pop();
-                PrioQueue<TimingEvent, PQ_BLOCKS>& pq = domain->pq;
+                DomainQueue& pq = domain->pq;
                 if (!pq.size() || pq.firstCycle() > limit) {
                     numFinished++;
                     domain->curCycle = limit;
@@ -388,7 +396,7 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
             while (stalledQueue.size()) {
                 DomainData* domain = stalledQueue.back();
                 stalledQueue.pop_back();
-                PrioQueue<TimingEvent, PQ_BLOCKS>& pq = domain->pq;
+                DomainQueue& pq = domain->pq;
                 if (!pq.size() || pq.firstCycle() > limit) {
                     numFinished++;
                     domain->curCycle = limit;
@@ -418,5 +426,8 @@ void ContentionSim::finish() {
     assert(!terminate);
     terminate = true;
     __sync_synchronize();
+#if RECORD_PQ_OPS
+    for (uint32_t i = 0; i < numDomains; i++) fclose(domains[i].pq.opLog);
+#endif
 }
 
@@ -28,8 +28,10 @@
 
 #include <functional>
 #include <stdint.h>
+#include <stdio.h>
 #include <vector>
 #include "bithacks.h"
+#include "calendar_queue.h"
 #include "event_recorder.h"
 #include "g_std/g_vector.h"
 #include "galloc.h"
@@ -48,6 +50,10 @@
 #define PROFILE_CROSSINGS 0
 //#define PROFILE_CROSSINGS 1
 
+//Set to 1 to log every domain queue enqueue/dequeue to pqops-<domain>.bin in the output dir, for replay with pqbench
+#define RECORD_PQ_OPS 0
+//#define RECORD_PQ_OPS 1
+
 class TimingEvent;
 class DelayEvent;
 class CrossingEvent;
@@ -67,8 +73,56 @@ class ContentionSim : public GlobAlloc {
 
         CrossingEventInfo* lastCrossing; //indexed by [srcId*doms*doms + srcDom*doms + dstDom]
 
+        //Each domain uses either the windowed PrioQueue (default) or a CalendarQueue, which has no far map.
+        //Only the queue in use is allocated; exactly one of pq and cq is non-null.
+        struct DomainQueue {
+            PrioQueue<TimingEvent, PQ_BLOCKS>* pq;
+            CalendarQueue<TimingEvent>* cq;
+#if RECORD_PQ_OPS
+            FILE* opLog; //enqueue cycles, dequeue cycles with the MSB set
+#endif
+
+            DomainQueue() : cq(nullptr) {
+                pq = new (gm_malloc<PrioQueue<TimingEvent, PQ_BLOCKS>>()) PrioQueue<TimingEvent, PQ_BLOCKS>();
+            }
+
+            //Must be called before anything is enqueued
+            void useCalendar() {
+                assert(pq && !pq->size());
+                pq->~PrioQueue();
+                gm_free(pq);
+                pq = nullptr;
+                cq = new (gm_malloc<CalendarQueue<TimingEvent>>()) CalendarQueue<TimingEvent>();
+            }
+
+            inline void enqueue(TimingEvent* ev, uint64_t cycle) {
+#if RECORD_PQ_OPS
+                fwrite(&cycle, sizeof(uint64_t), 1, opLog);
+#endif
+                if (cq) cq->enqueue(ev, cycle);
+                else pq->enqueue(ev, cycle);
+            }
+
+            inline TimingEvent* dequeue(uint64_t& deqCycle) {
+                TimingEvent* ev = cq? cq->dequeue(deqCycle) : pq->dequeue(deqCycle);
+#if RECORD_PQ_OPS
+                uint64_t rec = deqCycle | (1UL << 63);
+                fwrite(&rec, sizeof(uint64_t), 1, opLog);
+#endif
+                return ev;
+            }
+
+            inline uint64_t size() const {
+                return cq? cq->size() : pq->size();
+            }
+
+            inline uint64_t firstCycle() const {
+                return cq? cq->firstCycle() : pq->firstCycle();
+            }
+        };
+
         struct DomainData : public GlobAlloc {
-            PrioQueue<TimingEvent, PQ_BLOCKS> pq;
+            DomainQueue pq;
 
             PAD();
 
@@ -132,15 +186,18 @@ class ContentionSim : public GlobAlloc {
 
     public:
 #ifdef _WITH_BOOKSIM_
-        BookSimNetwork* topNoc;
+        g_vector<BookSimNetwork*> nocs; // the network that ticks each interconnect, the LLC's first
 #endif
        ContentionSim(uint32_t _numDomains, uint32_t _numSimThreads);
 
         void initStats(AggregateStat* parentStat);
 
+        //Switches a domain to a CalendarQueue; must be called before anything is enqueued
+        void setCalendarQueue(uint32_t domain);
+
 #ifdef _WITH_BOOKSIM_
         void displayNocStats(){
-            topNoc->DisplayStats();
+            for (BookSimNetwork* noc : nocs) noc->DisplayStats();
         }
 #endif
 
@@ -155,7 +212,7 @@ class ContentionSim : public GlobAlloc {
         void finish();
 
 #ifdef _WITH_BOOKSIM_
-        void setTopNoc(BookSimNetwork* _topNoc){topNoc = _topNoc;}
+        void addNoc(BookSimNetwork* noc){nocs.push_back(noc);}
 #endif
     
         uint64_t getLastLimit() {return lastLimit;}
@@ -977,12 +977,13 @@ MemControllerBase::MemControllerBase(g_string _memCfg, uint32_t _cacheLineSize,
     // Calculate Frequency
     sysFreqKHz = _sysFreqMHz * 1000;
     memFreqKHz = 1e9 / mParam->tCK / 1e3;
+    memClock = ClockDomain(sysFreqKHz, memFreqKHz);
     info("MemControllerBase: sysFreq = %ld KHz memFreq = %ld KHz", sysFreqKHz, memFreqKHz);
 
     if (mParam->schedulerQueueCount != 0) {
-        //Processor tick, memory ticks only every Nth cycle where N is proc:mem freq ratio
-        // for Memory Scheduler
-        nextSysTick = std::max((uint64_t)1, memToSysCycle(1));
+        // for Memory Scheduler: tick on each sysCycle where a memCycle begins
+        // (memClock.nextTick), which need not be a fixed number of sysCycles
+        nextSysTick = 0;
     } else {
         // for periodic performance report
         // for avoiding tick scheduler limitation
@@ -1020,10 +1021,11 @@ MemControllerBase::MemControllerBase(g_string _memCfg, uint32_t _cacheLineSize,
         sches[i] = new MemSchedulerDefault(i, mParam, chnls[i]);
     }
 
+    tickEv = nullptr;
     if (mParam->schedulerQueueCount != 0) {
-        TickEvent<MemControllerBase >* tickEv = new TickEvent<MemControllerBase >(this, domain);
+        tickEv = new TickEvent<MemControllerBase >(this, domain);
         tickEv->queue(0); //start the sim at time 0
-        info("MemControllerBase::tick() will be call in each %ld sysCycle", nextSysTick);
+        info("MemControllerBase::tick() will be called on each memCycle");
     }
 
     addrTraceLog = nullptr;
@@ -1059,6 +1061,10 @@ void MemControllerBase::enqueue(MemAccessEventBase* ev, uint64_t cycle) {
     // Write Queue Hit Check
     uint32_t channel = ReturnChannel(ev->getAddr());
     bool bRet = sches[channel]->CheckSetEvent(ev);
+    if (!tickEv->isActive() && sches[channel]->HasPendingEvents()) {
+        // Resume ticking at the first tick boundary the scheduler would have seen
+        tickEv->wake(memClock.tickAtOrAfter(cycle));
+    }
     if (ev->getType() == READ) {
         if (bRet)
             ev->done(cycle - minLatency[0] + mParam->controllerLatency);
@@ -1077,6 +1083,15 @@ uint32_t MemControllerBase::tick(uint64_t sysCycle) {
     // for memory scheduler
     if (mParam->schedulerQueueCount != 0) {
         TickScheduler(sysCycle);
+
+        // Idle ticks are no-ops (refreshes and power-down are computed on each
+        // access), so park the tick event until the next enqueue()
+        bool pending = false;
+        for (uint32_t i = 0; i < mParam->channelCount && !pending; i++) {
+            pending = sches[i]->HasPendingEvents();
+        }
+        if (!pending) return 0;
+        return memClock.nextTick(sysCycle) - sysCycle;
     }
 
     return nextSysTick;
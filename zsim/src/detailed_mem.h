@@ -26,6 +26,7 @@
 #ifndef DETAILED_MEM_H_
 #define DETAILED_MEM_H_
 
+#include "clock_domain.h"
 #include "detailed_mem_params.h"
 #include "g_std/g_string.h"
 #include "memory_hierarchy.h"
@@ -38,6 +39,8 @@
 // FIXME(dsm): This enum should not be our here, esp with such generic names!
 enum MemAccessType { READ, WRITE, NUM_ACCESS_TYPES};
 
+template <class T> class TickEvent;
+
 // DRAM rank base class
 class MemRankBase : public GlobAlloc {
     protected:
@@ -214,6 +217,9 @@ class MemSchedulerBase : public GlobAlloc {
         //
         // FIXME(dsm): refpointer? pointeref? Hmmm...
         virtual bool GetEvent(MemAccessEventBase*& ev, Address& addr, MemAccessType& type) = 0;
+
+        // True if GetEvent() may return something; the controller stops ticking while no scheduler has pending events
+        virtual bool HasPendingEvents() const = 0;
 };
 
 class MemSchedulerDefault : public MemSchedulerBase {
@@ -233,6 +239,7 @@ class MemSchedulerDefault : public MemSchedulerBase {
         MemSchedulerDefault(uint32_t id, MemParam* mParam, MemChannelBase* mChnl);
         ~MemSchedulerDefault();
         bool CheckSetEvent(MemAccessEventBase* ev);
+        bool HasPendingEvents() const { return !rdQueue.empty() || !wrQueue.empty(); }
         bool GetEvent(MemAccessEventBase*& ev, Address& addr, MemAccessType& type);
 };
 
@@ -250,11 +257,13 @@ class MemControllerBase : public MemObject {
 
         uint64_t sysFreqKHz;
         uint64_t memFreqKHz;
+        ClockDomain memClock; // sys cycles <-> mem cycles
 
         uint64_t lastPhaseCycle;
         uint64_t lastAccessedCycle;
-        uint64_t nextSysTick;
+        uint64_t nextSysTick; // period of report-only ticks (no scheduler)
         uint64_t reportPeriodCycle;
+        TickEvent<MemControllerBase>* tickEv; // nullptr if there is no scheduler
 
         // latency
         uint32_t minLatency[NUM_ACCESS_TYPES];
@@ -271,10 +280,10 @@ class MemControllerBase : public MemObject {
         virtual uint64_t CalcDQTermAcc(uint64_t acc_dq, uint64_t memCycle, uint64_t lastMemCycle);
         virtual void TickScheduler(uint64_t sysCycle);
 
-        inline uint64_t sysToMemCycle(uint64_t sysCycle) { return sysCycle*memFreqKHz/sysFreqKHz; }
+        inline uint64_t sysToMemCycle(uint64_t sysCycle) { return memClock.sysToDev(sysCycle); }
         inline uint64_t sysToMicroSec(uint64_t sysCycle) { return sysCycle*1000/sysFreqKHz; }
         inline uint64_t usecToSysCycle(uint64_t usec)    { return usec*sysFreqKHz/1000; }
-        inline uint64_t memToSysCycle(uint64_t memCycle) { return memCycle*sysFreqKHz/memFreqKHz; }
+        inline uint64_t memToSysCycle(uint64_t memCycle) { return memClock.devToSys(memCycle); }
         inline uint64_t memToMicroSec(uint64_t memCycle) { return memCycle*1000/memFreqKHz; }
 
         // profiles
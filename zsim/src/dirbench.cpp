@@ -0,0 +1,174 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Directory microbenchmark. Drives SharerDirectory with a synthetic sharing
+ * pattern (most lines are private to one or two sharers, 1/16 of the lines are
+ * read by all of them), first checking every mode against a plain bit-vector
+ * model, then timing each mode and reporting its footprint. Sharer ids stand
+ * for children or, in NoC-attached caches, grandchildren srcIds; the directory
+ * treats both the same way.
+ */
+
+#include <bitset>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include "galloc.h"
+#include "log.h"
+#include "sharer_directory.h"
+
+static const uint32_t modes[] = {0, 2, 4, 8};  // dirPtrs; 0 is the full map
+
+struct BenchResult {
+    uint64_t invs;      // sharers returned on writes
+    uint64_t checksum;  // over returned sharer ids, to catch any divergence
+    uint64_t peakOvfLines;
+    uint64_t bytes;     // at the end of the run
+    uint64_t ns;
+};
+
+static uint64_t getNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000000000L + ts.tv_nsec;
+}
+
+static inline uint64_t nextRand(uint64_t& s) {  // xorshift64, same sequence on every libc
+    s ^= s << 13;
+    s ^= s >> 7;
+    s ^= s << 17;
+    return s;
+}
+
+/* One op per round: 1/8 are writes, which invalidate all sharers and leave the
+ * writer as the only one; the rest are reads, which add a sharer. Reads to
+ * shared lines come from any id, reads to private lines from one of two ids.
+ */
+struct Op {
+    uint32_t lineId;
+    uint32_t id;
+    bool write;
+};
+
+static inline Op nextOp(uint64_t& s, uint32_t numLines, uint32_t numIds) {
+    uint64_t r = nextRand(s);
+    Op op;
+    op.lineId = r % numLines;
+    op.write = ((r >> 32) & 7) == 0;
+    uint32_t idRand = r >> 40;
+    op.id = (op.lineId % 16 == 0)? idRand % numIds : (op.lineId + (idRand & 1)) % numIds;
+    return op;
+}
+
+static void check(uint32_t dirPtrs, uint32_t numLines, uint32_t numIds, uint64_t rounds) {
+    SharerDirectory* dir = new SharerDirectory(numLines, dirPtrs);
+    std::vector< std::bitset<MAX_CACHE_CHILDREN> > model(numLines);
+    uint32_t ids[MAX_CACHE_CHILDREN];
+    uint64_t s = 0xD1BE4C4;
+    for (uint64_t i = 0; i < rounds; i++) {
+        Op op = nextOp(s, numLines, numIds);
+        if (dir->isSharer(op.lineId, op.id) != model[op.lineId][op.id]) {
+            panic("dirPtrs %d: round %ld, line %d, id %d: isSharer differs from the model", dirPtrs, i, op.lineId, op.id);
+        }
+        if (op.write) {
+            uint32_t num = dir->getSharers(op.lineId, numIds, ids);
+            uint32_t expected = 0;
+            for (uint32_t c = 0; c < numIds; c++) {
+                if (!model[op.lineId][c]) continue;
+                if (expected >= num || ids[expected] != c) panic("dirPtrs %d: round %ld, line %d: sharers differ from the model", dirPtrs, i, op.lineId);
+                expected++;
+            }
+            if (expected != num) panic("dirPtrs %d: round %ld, line %d: %d sharers, model has %d", dirPtrs, i, op.lineId, num, expected);
+            for (uint32_t j = 0; j < num; j++) dir->removeSharer(op.lineId, ids[j]);
+            model[op.lineId].reset();
+        }
+        dir->addSharer(op.lineId, op.id);
+        model[op.lineId][op.id] = true;
+    }
+    // Removing every sharer must release all overflowed sets
+    for (uint32_t l = 0; l < numLines; l++) {
+        for (uint32_t c = 0; c < numIds; c++) dir->removeSharer(l, c);
+    }
+    if (dir->getOverflowLines()) panic("dirPtrs %d: %ld lines still overflowed on an empty directory", dirPtrs, dir->getOverflowLines());
+    delete dir;
+}
+
+static BenchResult replay(uint32_t dirPtrs, uint32_t numLines, uint32_t numIds, uint64_t rounds) {
+    SharerDirectory* dir = new SharerDirectory(numLines, dirPtrs);
+    uint32_t ids[MAX_CACHE_CHILDREN];
+    uint64_t s = 0xD1BE4C4;
+    BenchResult res = {0, 0, 0, 0, 0};
+    uint64_t start = getNs();
+    for (uint64_t i = 0; i < rounds; i++) {
+        Op op = nextOp(s, numLines, numIds);
+        if (op.write) {
+            uint32_t num = dir->getSharers(op.lineId, numIds, ids);
+            for (uint32_t j = 0; j < num; j++) {
+                dir->removeSharer(op.lineId, ids[j]);
+                res.checksum = res.checksum*31 + ids[j];
+            }
+            res.invs += num;
+        }
+        dir->addSharer(op.lineId, op.id);
+        if ((i & 0xffff) == 0 && dir->getOverflowLines() > res.peakOvfLines) res.peakOvfLines = dir->getOverflowLines();
+    }
+    res.ns = getNs() - start;
+    res.bytes = dir->getBytes();
+    delete dir;
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    InitLog("[B] ");
+    if (argc > 4) {
+        info("Usage: %s [<lines> [<sharers> [<rounds>]]]", argv[0]);
+        exit(1);
+    }
+    uint32_t numLines = (argc > 1)? atoi(argv[1]) : 131072;
+    uint32_t numIds = (argc > 2)? atoi(argv[2]) : 64;
+    uint64_t rounds = (argc > 3)? atol(argv[3]) : 20000000;
+    if (!numLines || !numIds || numIds > MAX_CACHE_CHILDREN) panic("Need at least one line and 1-%d sharers", MAX_CACHE_CHILDREN);
+
+    gm_init((64 << 20) + 40*(size_t)numLines);
+    info("%d lines, %d sharers, %ld rounds", numLines, numIds, rounds);
+
+    for (uint32_t dirPtrs : modes) check(dirPtrs, numLines, numIds, rounds/10);
+    info("All modes match the bit-vector model");
+
+    BenchResult base = {0, 0, 0, 0, 0};
+    for (uint32_t dirPtrs : modes) {
+        BenchResult res = replay(dirPtrs, numLines, numIds, rounds);
+        if (!dirPtrs) {
+            base = res;
+        } else if (res.invs != base.invs || res.checksum != base.checksum) {
+            panic("dirPtrs %d: invalidations differ from the full map (%ld vs %ld)", dirPtrs, res.invs, base.invs);
+        }
+        info("dirPtrs %d: %.2f MB sharer storage, %ld peak overflowed lines, %.1f ns/op, %.2fx vs full map",
+                dirPtrs, res.bytes/1048576.0, res.peakOvfLines, ((double)res.ns)/rounds, ((double)base.ns)/res.ns);
+    }
+    return 0;
+}
@@ -24,7 +24,6 @@
  */
 
 #include "dramsim_mem_ctrl.h"
-#include <map>
 #include <string>
 #include "event_recorder.h"
 #include "tick_event.h"
@@ -44,8 +43,9 @@ class DRAMSimAccEvent : public TimingEvent {
 
     public:
         uint64_t sCycle;
+        DRAMSimAccEvent* nextInflight; //next in-flight request to the same address
 
-        DRAMSimAccEvent(DRAMSimMemory* _dram, bool _write, Address _addr, int32_t domain) :  TimingEvent(0, 0, domain), dram(_dram), write(_write), addr(_addr) {}
+        DRAMSimAccEvent(DRAMSimMemory* _dram, bool _write, Address _addr, int32_t domain) :  TimingEvent(0, 0, domain), dram(_dram), write(_write), addr(_addr), nextInflight(nullptr) {}
 
         bool isWrite() const {
             return write;
@@ -63,9 +63,10 @@ class DRAMSimAccEvent : public TimingEvent {
 
 
 DRAMSimMemory::DRAMSimMemory(string& dramTechIni, string& dramSystemIni, string& outputDir, string& traceName,
-        uint32_t capacityMB, uint64_t cpuFreqHz, uint32_t _minLatency, uint32_t _domain, const g_string& _name)
+        uint32_t capacityMB, uint64_t cpuFreqHz, uint32_t _minLatency, uint32_t _domain, const g_string& _name, bool _idleSkip)
 {
     curCycle = 0;
+    idleSkip = _idleSkip;
     minLatency = _minLatency;
     // NOTE: this will alloc DRAM on the heap and not the glob_heap, make sure only one process ever handles this
     dramCore = getMemorySystemInstance(dramTechIni, dramSystemIni, outputDir, traceName, capacityMB);
@@ -76,8 +77,9 @@ DRAMSimMemory::DRAMSimMemory(string& dramTechIni, string& dramSystemIni, string&
     dramCore->RegisterCallbacks(read_cb, write_cb, nullptr);
 
     domain = _domain;
-    TickEvent<DRAMSimMemory>* tickEv = new TickEvent<DRAMSimMemory>(this, domain);
+    tickEv = new TickEvent<DRAMSimMemory>(this, domain);
     tickEv->queue(0);  // start the sim at time 0
+    inflightRequests.reserve(1024);
 
     name = _name;
 #ifdef _SANITY_CHECK_
@@ -142,13 +144,25 @@ uint64_t DRAMSimMemory::access(MemReq& req) {
 uint32_t DRAMSimMemory::tick(uint64_t cycle) {
     dramCore->update();
     curCycle++;
-    return 1;
+    // NOTE: DRAMSim cannot advance its clock in one step, so while parked its
+    // clock stops (no refreshes are simulated), and it resumes where it was
+    return (idleSkip && inflightRequests.empty())? 0 : 1;
 }
 
 void DRAMSimMemory::enqueue(DRAMSimAccEvent* ev, uint64_t cycle) {
     //info("[%s] %s access to %lx added at %ld, %ld inflight reqs", getName(), ev->isWrite()? "Write" : "Read", ev->getAddr(), cycle, inflightRequests.size());
+    if (!tickEv->isActive()) {
+        curCycle = cycle;  // skip the idle cycles
+        tickEv->wake(cycle);
+    }
     dramCore->addTransaction(ev->isWrite(), ev->getAddr());
-    inflightRequests.insert(std::pair<Address, DRAMSimAccEvent*>(ev->getAddr(), ev));
+    InflightFifo& fifo = inflightRequests[ev->getAddr()];
+    if (fifo.head) {
+        fifo.tail->nextInflight = ev;
+    } else {
+        fifo.head = ev;
+    }
+    fifo.tail = ev;
     ev->hold();
 }
 
@@ -156,9 +170,15 @@ void DRAMSimMemory::DRAM_read_return_cb(uint32_t id, uint64_t addr, uint64_t mem
 #ifdef _SANITY_CHECK_
     futex_lock(&cb_lock);
 #endif
-    std::multimap<uint64_t, DRAMSimAccEvent*>::iterator it = inflightRequests.find(addr);
+    std::unordered_map<uint64_t, InflightFifo>::iterator it = inflightRequests.find(addr);
     assert((it != inflightRequests.end()));
-    DRAMSimAccEvent* ev = it->second;
+    DRAMSimAccEvent* ev = it->second.head;
+    if (ev->nextInflight) {
+        it->second.head = ev->nextInflight;
+        ev->nextInflight = nullptr;
+    } else {
+        inflightRequests.erase(it);
+    }
 
     uint32_t lat = curCycle+1 - ev->sCycle;
     if (ev->isWrite()) {
@@ -173,8 +193,7 @@ void DRAMSimMemory::DRAM_read_return_cb(uint32_t id, uint64_t addr, uint64_t mem
 #endif
     ev->release();
     ev->done(curCycle+1);
-    inflightRequests.erase(it);
-    //info("[%s] %s access to %lx DONE at %ld (%ld cycles), %ld inflight reqs", getName(), it->second->isWrite()? "Write" : "Read", it->second->getAddr(), curCycle, curCycle-it->second->sCycle, inflightRequests.size());
+    //info("[%s] %s access to %lx DONE at %ld (%ld cycles), %ld inflight reqs", getName(), ev->isWrite()? "Write" : "Read", ev->getAddr(), curCycle, curCycle-ev->sCycle, inflightRequests.size());
 }
 
 void DRAMSimMemory::DRAM_write_return_cb(uint32_t id, uint64_t addr, uint64_t memCycle) {
@@ -187,7 +206,7 @@ void DRAMSimMemory::DRAM_write_return_cb(uint32_t id, uint64_t addr, uint64_t me
 using std::string;
 
 DRAMSimMemory::DRAMSimMemory(string& dramTechIni, string& dramSystemIni, string& outputDir, string& traceName,
-        uint32_t capacityMB, uint64_t cpuFreqHz, uint32_t _minLatency, uint32_t _domain, const g_string& _name)
+        uint32_t capacityMB, uint64_t cpuFreqHz, uint32_t _minLatency, uint32_t _domain, const g_string& _name, bool _idleSkip)
 {
     panic("Cannot use DRAMSimMemory, zsim was not compiled with DRAMSim");
 }
@@ -26,8 +26,9 @@
 #ifndef DRAMSIM_MEM_CTRL_H_
 #define DRAMSIM_MEM_CTRL_H_
 
-#include <map>
 #include <string>
+#include <unordered_map>
+#include "addr_interleave.h"
 #include "g_std/g_string.h"
 #include "memory_hierarchy.h"
 #include "pad.h"
@@ -39,6 +40,7 @@ namespace DRAMSim {
 };
 
 class DRAMSimAccEvent;
+template <class T> class TickEvent;
 
 class DRAMSimMemory : public MemObject { //one DRAMSim controller
     private:
@@ -48,10 +50,19 @@ class DRAMSimMemory : public MemObject { //one DRAMSim controller
 
         DRAMSim::MultiChannelMemorySystem* dramCore;
 
-        std::multimap<uint64_t, DRAMSimAccEvent*> inflightRequests;
+        // In-flight requests by address, oldest first (DRAMSim returns same-address requests in order)
+        struct InflightFifo {
+            DRAMSimAccEvent* head;
+            DRAMSimAccEvent* tail;
+        };
+        std::unordered_map<uint64_t, InflightFifo> inflightRequests;
 
         uint64_t curCycle; //processor cycle, used in callbacks
 
+        // If set, stop ticking DRAMSim while there are no requests in flight
+        TickEvent<DRAMSimMemory>* tickEv;
+        bool idleSkip;
+
 
         // NoC router address
         coordinates<int> coord;
@@ -71,7 +82,7 @@ class DRAMSimMemory : public MemObject { //one DRAMSim controller
 
     public:
         DRAMSimMemory(std::string& dramTechIni, std::string& dramSystemIni, std::string& outputDir, std::string& traceName, uint32_t capacityMB,
-                uint64_t cpuFreqHz,  uint32_t _minLatency, uint32_t _domain, const g_string& _name);
+                uint64_t cpuFreqHz,  uint32_t _minLatency, uint32_t _domain, const g_string& _name, bool _idleSkip = false);
 
         const char* getName() {return name.c_str();}
 
@@ -98,18 +109,21 @@ class DRAMSimMemory : public MemObject { //one DRAMSim controller
 //DRAMSIM does not support non-pow2 channels, so:
 // - Encapsulate multiple DRAMSim controllers
 // - Fan out addresses interleaved across banks, and change the address to a "memory address"
+//   (the interleaving policy is pluggable, see addr_interleave.h)
 class SplitAddrMemory : public MemObject {
     private:
         const g_vector<MemObject*> mems;
         const g_string name;
         g_vector<MemObject*> parents;
+        const AddrInterleave* interleave;
     public:
-        SplitAddrMemory(const g_vector<MemObject*>& _mems, const char* _name) : mems(_mems), name(_name) {}
+        SplitAddrMemory(const g_vector<MemObject*>& _mems, const char* _name, const AddrInterleave* _interleave)
+            : mems(_mems), name(_name), interleave(_interleave) {}
 
         uint64_t access(MemReq& req) {
             Address addr = req.lineAddr;
-            uint32_t mem = addr % mems.size();
-            Address ctrlAddr = addr/mems.size();
+            uint32_t mem = interleave->getCtrl(addr);
+            Address ctrlAddr = interleave->getCtrlAddr(addr);
             req.lineAddr = ctrlAddr;
             uint64_t respCycle = mems[mem]->access(req);
             req.lineAddr = addr;
@@ -139,8 +153,7 @@ class SplitAddrMemory : public MemObject {
 
         // Returns the network coordinates of the correct memory controller based on the request's address 
         coordinates<int> getCoord(MemReq& req){
-                uint32_t mem = req.lineAddr % mems.size();  // TODO: more tests...
-                return mems[mem]->getCoord();
+                return mems[interleave->getCtrl(req.lineAddr)]->getCoord();
         };
 
 };
@@ -30,6 +30,7 @@
 #include "memory_hierarchy.h"
 #include "pad.h"
 #include "slab_alloc.h"
+#include "stats.h"
 
 class TimingEvent;
 
@@ -78,6 +79,11 @@ class EventRecorder : public GlobAlloc {
             return slabAlloc.alloc(sz);
         }
 
+        // Total bytes ever handed out by this recorder's slabs
+        uint64_t getAllocatedBytes() const {
+            return slabAlloc.getAllocatedBytes();
+        }
+
         //Event recording interface
 
         void pushRecord(const TimingRecord& rec) {
@@ -124,6 +130,28 @@ class EventRecorder : public GlobAlloc {
         inline CrossingStack& getCrossingStack() {
             return crossingStack;
         }
+
+        void initStats(AggregateStat* parentStat) {
+            AggregateStat* slabStats = new AggregateStat();
+            slabStats->init("evRec", "Event recorder slab allocator stats");
+            const slab::SlabAlloc* sa = &slabAlloc;
+            appendStat(slabStats, "allocBytes", "Bytes of events allocated", [sa]() { return sa->getAllocatedBytes(); });
+            appendStat(slabStats, "liveSlabs", "Slabs currently in use", [sa]() { return (uint64_t)sa->getLiveSlabs(); });
+            appendStat(slabStats, "peakBytes", "Peak bytes in live slabs", [sa]() { return sa->getPeakLiveBytes(); });
+            appendStat(slabStats, "heapBytes", "Bytes of slabs obtained from the global heap", [sa]() { return sa->getFootprintBytes(); });
+            appendStat(slabStats, "frees", "Slabs freed", [sa]() { return sa->getSlabFrees(); });
+            appendStat(slabStats, "remoteFrees", "Slabs freed by a thread other than the allocating one", [sa]() { return sa->getRemoteFrees(); });
+            appendStat(slabStats, "lockCont", "Contended acquisitions of the slab freelist lock", [sa]() { return sa->getContendedLocks(); });
+            parentStat->append(slabStats);
+        }
+
+    private:
+        template <typename F>
+        static void appendStat(AggregateStat* parentStat, const char* name, const char* desc, F f) {
+            LambdaStat<F>* stat = new LambdaStat<F>(f);
+            stat->init(name, desc);
+            parentStat->append(stat);
+        }
 };
 
 #endif  // EVENT_RECORDER_H_
@@ -29,6 +29,7 @@
 #include <stdlib.h>
 #include <string>
 #include <sys/ipc.h>
+#include <sys/mman.h>
 #include <sys/shm.h>
 
 #include "log.h"  // NOLINT must precede dlmalloc, which defines assert if undefined
@@ -109,11 +110,11 @@ int gm_init(size_t segmentSize) {
     return gm_shmid;
 }
 
-void gm_attach(int shmid) {
+void gm_attach(int shmid, bool readOnly) {
     assert(GM == nullptr);
     assert(gm_shmid == 0);
     gm_shmid = shmid;
-    GM = static_cast<gm_segment*>(shmat(gm_shmid, GM_BASE_ADDR, 0));
+    GM = static_cast<gm_segment*>(shmat(gm_shmid, GM_BASE_ADDR, readOnly? SHM_RDONLY : 0));
     if (GM != GM_BASE_ADDR) {
         warn("shmid %d \n", shmid);
         panic("gm_attach failed allocation");
@@ -151,6 +152,19 @@ void* __gm_memalign(size_t blocksize, size_t bytes) {
     return ptr;
 }
 
+#define GM_HUGEPAGE_SIZE (1ul << 21)
+
+void* gm_hugepage_alloc(size_t bytes) {
+    void* ptr = __gm_memalign(GM_HUGEPAGE_SIZE, bytes);
+    // Shared memory only gets THP if /sys/kernel/mm/transparent_hugepage/shmem_enabled allows it;
+    // if the kernel refuses, we still have a perfectly usable (aligned) allocation
+    static bool warned = false;
+    if (madvise(ptr, bytes, MADV_HUGEPAGE) && !warned) {
+        warned = true;
+        warn("gm_hugepage_alloc(): madvise(MADV_HUGEPAGE) failed, falling back to regular pages");
+    }
+    return ptr;
+}
 
 void gm_free(void* ptr) {
     assert(GM);
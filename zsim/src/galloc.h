@@ -31,7 +31,7 @@
 
 int gm_init(size_t segmentSize);
 
-void gm_attach(int shmid);
+void gm_attach(int shmid, bool readOnly = false);  // read-only attaches are meant for monitors
 
 // C-style interface
 void* gm_malloc(size_t size);
@@ -40,6 +40,9 @@ void* __gm_memalign(size_t blocksize, size_t bytes);  // deprecated, only used i
 char* gm_strdup(const char* str);
 void gm_free(void* ptr);
 
+// 2MB-aligned allocation, advised to be backed by (transparent) huge pages
+void* gm_hugepage_alloc(size_t bytes);
+
 // C++-style alloc interface (preferred)
 template <typename T> T* gm_malloc() {return static_cast<T*>(gm_malloc(sizeof(T)));}
 template <typename T> T* gm_malloc(size_t objs) {return static_cast<T*>(gm_malloc(sizeof(T)*objs));}
@@ -24,12 +24,16 @@
  */
 
 #include "hash.h"
+#include <immintrin.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include "log.h"
 #include "mtrand.h"
 
-H3HashFamily::H3HashFamily(uint32_t numFunctions, uint32_t outputBits, uint64_t randSeed) : numFuncs(numFunctions) {
+// Half of a typical 32KB L1D, the other half is for the data being hashed
+#define H3_TABLE_MAX_BYTES (16*1024)
+
+H3HashFamily::H3HashFamily(uint32_t numFunctions, uint32_t outputBits, uint64_t randSeed, bool allowTables) : numFuncs(numFunctions) {
     MTRand rnd(randSeed);
 
     if (outputBits <= 8) {
@@ -59,10 +63,58 @@ H3HashFamily::H3HashFamily(uint32_t numFunctions, uint32_t outputBits, uint64_t
             hMatrix[ii*words + jj] = val;
         }
     }
+
+    useAVX2 = simd::getLevel() >= SIMD_AVX2;
+    padFuncs = (numFuncs + 3) & ~3;
+    hMatrixT = nullptr;
+    if (useAVX2) {
+        hMatrixT = gm_calloc<uint64_t>(words*padFuncs);
+        for (uint32_t ii = 0; ii < numFuncs; ii++) {
+            for (uint32_t jj = 0; jj < words; jj++) hMatrixT[jj*padFuncs + ii] = hMatrix[ii*words + jj];
+        }
+    }
+
+    tables = nullptr;
+    uint32_t entryBytes = 8 >> resShift;
+    if (allowTables && numFuncs*8*256*entryBytes <= H3_TABLE_MAX_BYTES) {
+        switch (resShift) {
+            case 0: buildTables<uint64_t>(); break;
+            case 1: buildTables<uint32_t>(); break;
+            case 2: buildTables<uint16_t>(); break;
+            case 3: buildTables<uint8_t>(); break;
+        }
+    }
 }
 
 H3HashFamily::~H3HashFamily() {
     gm_free(hMatrix);
+    if (hMatrixT) gm_free(hMatrixT);
+    if (tables) gm_free(tables);
+}
+
+template <typename E> void H3HashFamily::buildTables() {
+    E* t = gm_calloc<E>(numFuncs*8*256);
+    for (uint32_t id = 0; id < numFuncs; id++) {
+        for (uint32_t b = 0; b < 8; b++) {
+            for (uint32_t v = 0; v < 256; v++) {
+                t[(id*8 + b)*256 + v] = matrixHash(id, ((uint64_t)v) << (8*b));
+            }
+        }
+    }
+    tables = t;
+}
+
+uint64_t H3HashFamily::hash(uint32_t id, uint64_t val) {
+    assert(id >= 0 && id < numFuncs);
+    if (tables) {
+        switch (resShift) {
+            case 0: return tableHash<uint64_t>(id, val);
+            case 1: return tableHash<uint32_t>(id, val);
+            case 2: return tableHash<uint16_t>(id, val);
+            case 3: return tableHash<uint8_t>(id, val);
+        }
+    }
+    return matrixHash(id, val);
 }
 
 /* NOTE: This is fairly well hand-optimized. Go to the commit logs to see the speedup of this function. Main things:
@@ -77,7 +129,7 @@ H3HashFamily::~H3HashFamily() {
  *     res = (res << 1) | (res >> 63);
  * }
  */
-uint64_t H3HashFamily::hash(uint32_t id, uint64_t val) {
+uint64_t H3HashFamily::matrixHash(uint32_t id, uint64_t val) {
     uint64_t res = 0;
     assert(id >= 0 && id < numFuncs);
 
@@ -123,6 +175,63 @@ uint64_t H3HashFamily::hash(uint32_t id, uint64_t val) {
     return res;
 }
 
+void H3HashFamily::hashAll(uint64_t val, uint32_t num, uint64_t* res) {
+    assert(num <= numFuncs);
+    if (tables) {
+        for (uint32_t i = 0; i < num; i++) res[i] = hash(i, val);
+    } else if (useAVX2) {
+        hashAllAVX2(val, num, res);
+    } else {
+        for (uint32_t i = 0; i < num; i++) res[i] = hash(i, val);
+    }
+}
+
+/* Same computation as matrixHash(), with one function per 64-bit lane, so results
+ * are bit-identical. AVX2 has no 64-bit rotate, so we build it from shifts.
+ */
+#define ROTL256(v, k) _mm256_or_si256(_mm256_slli_epi64(v, k), _mm256_srli_epi64(v, 64 - (k)))
+
+__attribute__((target("avx2")))
+void H3HashFamily::hashAllAVX2(uint64_t val, uint32_t num, uint64_t* res) {
+    __m256i v = _mm256_set1_epi64x(val);
+    uint32_t maxBits = 64 >> resShift;
+    for (uint32_t id = 0; id < num; id += 4) {
+        __m256i r = _mm256_setzero_si256();
+        for (uint32_t x = 0; x < maxBits; x += 8) {
+            const uint64_t* m = &hMatrixT[x*padFuncs + id];
+            __m256i r0 = _mm256_and_si256(v, _mm256_loadu_si256((const __m256i*)(m)));
+            __m256i r1 = _mm256_and_si256(v, _mm256_loadu_si256((const __m256i*)(m + padFuncs)));
+            __m256i r2 = _mm256_and_si256(v, _mm256_loadu_si256((const __m256i*)(m + 2*padFuncs)));
+            __m256i r3 = _mm256_and_si256(v, _mm256_loadu_si256((const __m256i*)(m + 3*padFuncs)));
+
+            __m256i r4 = _mm256_and_si256(v, _mm256_loadu_si256((const __m256i*)(m + 4*padFuncs)));
+            __m256i r5 = _mm256_and_si256(v, _mm256_loadu_si256((const __m256i*)(m + 5*padFuncs)));
+            __m256i r6 = _mm256_and_si256(v, _mm256_loadu_si256((const __m256i*)(m + 6*padFuncs)));
+            __m256i r7 = _mm256_and_si256(v, _mm256_loadu_si256((const __m256i*)(m + 7*padFuncs)));
+
+            __m256i a = _mm256_xor_si256(_mm256_xor_si256(r0, ROTL256(r1, 1)), _mm256_xor_si256(ROTL256(r2, 2), ROTL256(r3, 3)));
+            __m256i b = _mm256_xor_si256(_mm256_xor_si256(ROTL256(r4, 4), ROTL256(r5, 5)), _mm256_xor_si256(ROTL256(r6, 6), ROTL256(r7, 7)));
+            r = _mm256_xor_si256(r, _mm256_xor_si256(a, b));
+            r = ROTL256(r, 8);
+        }
+
+        // Fold bits to match output (see hash())
+        if (resShift >= 1) r = _mm256_xor_si256(r, _mm256_srli_epi64(r, 32));
+        if (resShift >= 2) r = _mm256_xor_si256(r, _mm256_srli_epi64(r, 16));
+        if (resShift >= 3) r = _mm256_xor_si256(r, _mm256_srli_epi64(r, 8));
+
+        if (id + 4 <= num) {
+            _mm256_storeu_si256((__m256i*)&res[id], r);
+        } else {
+            uint64_t tmp[4];
+            _mm256_storeu_si256((__m256i*)tmp, r);
+            for (uint32_t i = id; i < num; i++) res[i] = tmp[i - id];
+        }
+    }
+}
+
+#undef ROTL256
+
 #if _WITH_POLARSSL_
 
 #include "polarssl/sha1.h"
@@ -28,6 +28,7 @@
 
 #include <stdint.h>
 #include "galloc.h"
+#include "simd.h"
 
 class HashFamily : public GlobAlloc {
     public:
@@ -35,6 +36,11 @@ class HashFamily : public GlobAlloc {
         virtual ~HashFamily() {}
 
         virtual uint64_t hash(uint32_t id, uint64_t val) = 0;
+
+        // Computes functions 0..num-1 on val, res[i] = hash(i, val)
+        virtual void hashAll(uint64_t val, uint32_t num, uint64_t* res) {
+            for (uint32_t i = 0; i < num; i++) res[i] = hash(i, val);
+        }
 };
 
 class H3HashFamily : public HashFamily {
@@ -42,10 +48,38 @@ class H3HashFamily : public HashFamily {
         const uint32_t numFuncs;
         uint32_t resShift;
         uint64_t* hMatrix;
+
+        // hashAll() computes several functions at once with AVX2. It uses a
+        // transposed copy of hMatrix, row x holds word x of every function
+        // (padded to a multiple of 4 functions) so lanes load contiguously.
+        bool useAVX2;
+        uint32_t padFuncs;
+        uint64_t* hMatrixT;
+
+        // H3 is linear over GF(2), so each function is also the XOR of eight
+        // 256-entry tables, one per input byte. Entries keep the low 64 >> resShift
+        // bits, the ones callers use. Tables are only built if they fit in
+        // H3_TABLE_MAX_BYTES, otherwise they'd thrash the L1 and the matrix
+        // multiply is faster. nullptr if not in use.
+        void* tables;
+
     public:
-        H3HashFamily(uint32_t numFunctions, uint32_t outputBits, uint64_t randSeed = 123132127);
+        H3HashFamily(uint32_t numFunctions, uint32_t outputBits, uint64_t randSeed = 123132127, bool allowTables = true);
         virtual ~H3HashFamily();
         uint64_t hash(uint32_t id, uint64_t val);
+        void hashAll(uint64_t val, uint32_t num, uint64_t* res);
+
+    private:
+        uint64_t matrixHash(uint32_t id, uint64_t val);
+        void hashAllAVX2(uint64_t val, uint32_t num, uint64_t* res);
+
+        template <typename E> inline uint64_t tableHash(uint32_t id, uint64_t val) const {
+            const E* t = static_cast<const E*>(tables) + id*8*256;
+            return (t[val & 0xff] ^ t[256 + ((val >> 8) & 0xff)] ^ t[512 + ((val >> 16) & 0xff)] ^ t[768 + ((val >> 24) & 0xff)]) ^
+                (t[1024 + ((val >> 32) & 0xff)] ^ t[1280 + ((val >> 40) & 0xff)] ^ t[1536 + ((val >> 48) & 0xff)] ^ t[1792 + (val >> 56)]);
+        }
+
+        template <typename E> void buildTables();
 };
 
 class SHA1HashFamily : public HashFamily {
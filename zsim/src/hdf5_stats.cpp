@@ -27,16 +27,74 @@
 #include <hdf5.h>
 #include <hdf5_hl.h>
 #include <iostream>
+#include <unistd.h>
 #include <vector>
+#include "g_std/g_vector.h"
 #include "galloc.h"
+#include "locks.h"
 #include "log.h"
+#include "pin.H"
 #include "stats.h"
 #include "zsim.h"
 
+// Asynchronous backends flush the file every this many buffer writes (and on every unbuffered dump)
+#define ASYNC_FLUSH_WRITES 8
+
+class HDF5BackendImpl;
+
+// The HDF5 library is not thread-safe. zinfo->hdf5Lock serializes all its uses:
+// the writer thread, synchronous backends, and access traces (see access_tracing.h)
+static inline void lockH5() { futex_lock(&zinfo->hdf5Lock); }
+static inline void unlockH5() { futex_unlock(&zinfo->hdf5Lock); }
+
+/* Background thread that performs the HDF5 writes of all asynchronous backends.
+ * There is a single one, and it holds zinfo->hdf5Lock while it writes. Like the contention
+ * simulation threads, it lives in process 0, which outlives all others. The
+ * writer and its backends are in the global heap (zinfo->hdf5Writer), so any
+ * process can hand it buffers, and it waits on a futex in shared memory.
+ */
+class HDF5Writer : public GlobAlloc {
+    private:
+        g_vector<HDF5BackendImpl*> backends;
+        volatile uint32_t wakeups; //futex word, bumped on every wake()
+
+    public:
+        HDF5Writer() {
+            wakeups = 0;
+            PIN_SpawnInternalThread(ThreadTrampoline, this, 1024*1024, nullptr);
+        }
+
+        // Caller must hold the HDF5 lock
+        void registerBackend(HDF5BackendImpl* backend) {
+            backends.push_back(backend);
+        }
+
+        // Writes what the backends handed off and closes their files; they must not dump again
+        void close();
+
+        void wake() {
+            __sync_fetch_and_add(&wakeups, 1);
+            syscall(SYS_futex, &wakeups, FUTEX_WAKE, 1, nullptr, nullptr, 0); //not FUTEX_PRIVATE, dumpers may be in other processes
+        }
+
+    private:
+        static void ThreadTrampoline(void* arg) {
+            static_cast<HDF5Writer*>(arg)->threadLoop();
+        }
+
+        void threadLoop();
+};
+
 /** Implements the HDF5 backend. Creates one big table in the file, and writes one row per dump.
  * NOTE: Because dump may be called from multiple processes, we close and open the HDF5 file every dump.
  * This is inefficient, but dumps are not that common anyhow, and we get the ability to read hdf5 files mid-simulation.
- * (alternatively, we could have an extra thread exclusively dedicated to writing stats).
+ *
+ * Asynchronous backends avoid this: dump() only copies the values of the leaf stats, in a flat list built at
+ * initialization, into one of two snapshot buffers in the global heap. Full buffers are handed to the
+ * HDF5Writer thread, which walks the stats tree to turn each snapshot into a record (summing regular
+ * aggregates), keeps the file open for the whole run and flushes it periodically. The dumping thread only
+ * waits if the writer falls two buffers behind, or on unbuffered (final) dumps, which must be on disk when
+ * dump() returns.
  */
 class HDF5BackendImpl : public GlobAlloc {
     private:
@@ -44,14 +102,34 @@ class HDF5BackendImpl : public GlobAlloc {
         AggregateStat* rootStat;
         bool skipVectors;
         bool sumRegularAggregates;
+        bool async;
+        HDF5Writer* writer; //nullptr if sync
 
-        uint64_t* dataBuf; //buffered record data
-        uint64_t* curPtr; //points to next element to write in dump
+        uint64_t* dataBuf; //buffered record data; filled by dump() if sync, by the writer thread if async
+        uint64_t* curPtr; //points to next element to write in dumpWalk
         uint64_t recordSize; // in bytes
         uint32_t recordsPerWrite; //how many records to buffer; determines chunk size as well
 
         uint32_t bufferedRecords; //number of records buffered (dumped w/o being written), <= recordsPerWrite
 
+        // Async snapshots: the leaf stats in dumpWalk order, and snapshotSize values per dump
+        struct Leaf {
+            ScalarStat* scalar;
+            VectorStat* vector; //non-null if scalar is null
+        };
+        g_vector<Leaf> leaves;
+        uint64_t snapshotSize;
+        uint64_t* snapBufs[2]; //recordsPerWrite snapshots each
+        const uint64_t* snapPtr; //if non-null, dumpWalk reads values from this snapshot instead of the stats
+
+        // Async handoff. Buffer handedOff % 2 is being filled; the writer appends buffers [written, handedOff)
+        volatile uint64_t handedOff;
+        volatile uint64_t written;
+        volatile uint32_t bufRecords[2];
+        volatile bool bufFlush[2];
+        hid_t fileID; //kept open by async backends, only touched by the writer after init
+        uint32_t writesSinceFlush;
+
         // Always have a single function to determine when to skip a stat to avoid inconsistencies in the code
         bool skipStat(Stat* s) {
             return skipVectors && dynamic_cast<VectorStat*>(s);
@@ -82,16 +160,43 @@ class HDF5BackendImpl : public GlobAlloc {
                     }
                 }
             } else if (ScalarStat* ss = dynamic_cast<ScalarStat*>(s)) {
-                *(curPtr++) = ss->get();
+                *(curPtr++) = snapPtr? *(snapPtr++) : ss->get();
             } else if (VectorStat* vs = dynamic_cast<VectorStat*>(s)) {
                 for (uint32_t i = 0; i < vs->size(); i++) {
-                    *(curPtr++) = vs->count(i);
+                    *(curPtr++) = snapPtr? *(snapPtr++) : vs->count(i);
                 }
             } else {
                 panic("Unrecognized stat type");
             }
         }
 
+        // Builds the list of leaf stats that async dumps snapshot, in dumpWalk order
+        void collectLeaves(Stat* s) {
+            if (skipStat(s)) return;
+            if (AggregateStat* as = dynamic_cast<AggregateStat*>(s)) {
+                for (uint32_t i = 0; i < as->size(); i++) collectLeaves(as->get(i));
+            } else if (ScalarStat* ss = dynamic_cast<ScalarStat*>(s)) {
+                leaves.push_back({ss, nullptr});
+                snapshotSize++;
+            } else if (VectorStat* vs = dynamic_cast<VectorStat*>(s)) {
+                leaves.push_back({nullptr, vs});
+                snapshotSize += vs->size();
+            } else {
+                panic("Unrecognized stat type");
+            }
+        }
+
+        // Copies the current value of every leaf stat; this is all async dumps do on the simulation thread
+        void snapshot(uint64_t* snap) {
+            for (const Leaf& l : leaves) {
+                if (l.scalar) {
+                    *(snap++) = l.scalar->get();
+                } else {
+                    for (uint32_t i = 0; i < l.vector->size(); i++) *(snap++) = l.vector->count(i);
+                }
+            }
+        }
+
         //Note this is a local vector, b/c it's only used at initialization.
         std::vector<hid_t> uniqueTypes;
 
@@ -188,9 +293,17 @@ class HDF5BackendImpl : public GlobAlloc {
         }
 
     public:
-        HDF5BackendImpl(const char* _filename, AggregateStat* _rootStat, size_t _bytesPerWrite, bool _skipVectors, bool _sumRegularAggregates) :
-            filename(_filename), rootStat(_rootStat), skipVectors(_skipVectors), sumRegularAggregates(_sumRegularAggregates)
+        HDF5BackendImpl(const char* _filename, AggregateStat* _rootStat, size_t _bytesPerWrite, bool _skipVectors, bool _sumRegularAggregates, bool _async) :
+            filename(_filename), rootStat(_rootStat), skipVectors(_skipVectors), sumRegularAggregates(_sumRegularAggregates), async(_async)
         {
+            if (async) {
+                if (!zinfo->hdf5Writer) zinfo->hdf5Writer = new HDF5Writer();
+                writer = zinfo->hdf5Writer;
+            } else {
+                writer = nullptr;
+            }
+            lockH5(); //the writer may be appending to other files
+
             // Create stats file
             info("HDF5 backend: Opening %s", filename);
             hid_t fileID = H5Fcreate(filename, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
@@ -217,15 +330,38 @@ class HDF5BackendImpl : public GlobAlloc {
             dataBuf = static_cast<uint64_t*>(gm_malloc(bufSize));
             curPtr = dataBuf;
 
+            snapshotSize = 0;
+            snapPtr = nullptr;
+            if (async) {
+                collectLeaves(rootStat);
+                for (uint32_t b = 0; b < 2; b++) snapBufs[b] = gm_calloc<uint64_t>(recordsPerWrite*snapshotSize);
+            } else {
+                snapBufs[0] = snapBufs[1] = nullptr;
+            }
+
             bufferedRecords = 0;
+            handedOff = 0;
+            written = 0;
+            writesSinceFlush = 0;
 
-            info("HDF5 backend: Created table, %ld bytes/record, %d records/write", recordSize, recordsPerWrite);
-            H5Fclose(fileID);
+            info("HDF5 backend: Created table, %ld bytes/record, %d records/write%s", recordSize, recordsPerWrite, async? ", async writes" : "");
+            if (async) {
+                this->fileID = fileID;
+                writer->registerBackend(this);
+            } else {
+                H5Fclose(fileID);
+            }
+            unlockH5();
         }
 
         ~HDF5BackendImpl() {}
 
         void dump(bool buffered) {
+            if (async) {
+                dumpAsync(buffered);
+                return;
+            }
+
             // Copy stats to data buffer
             dumpWalk(rootStat);
             bufferedRecords++;
@@ -234,26 +370,111 @@ class HDF5BackendImpl : public GlobAlloc {
 
             // Write to table if needed
             if (bufferedRecords == recordsPerWrite || !buffered) {
+                lockH5();
                 hid_t fileID = H5Fopen(filename, H5F_ACC_RDWR, H5P_DEFAULT);
 
                 size_t fieldOffsets[] = {0};
                 size_t fieldSizes[] = {recordSize};
                 H5TBappend_records(fileID, "stats", bufferedRecords, recordSize, fieldOffsets, fieldSizes, dataBuf);
                 H5Fclose(fileID);
+                unlockH5();
 
                 //Rewind
                 bufferedRecords = 0;
                 curPtr = dataBuf;
             }
         }
+
+        // Called by the writer thread with the HDF5 lock held
+        void writePending() {
+            while (written != handedOff) {
+                uint32_t b = written % 2;
+
+                // Turn the snapshots into records
+                curPtr = dataBuf;
+                for (uint32_t r = 0; r < bufRecords[b]; r++) {
+                    snapPtr = snapBufs[b] + r*snapshotSize;
+                    dumpWalk(rootStat);
+                    assert(snapPtr == snapBufs[b] + (r+1)*snapshotSize);
+                }
+                snapPtr = nullptr;
+                assert(curPtr == dataBuf + bufRecords[b]*recordSize/sizeof(uint64_t));
+
+                size_t fieldOffsets[] = {0};
+                size_t fieldSizes[] = {recordSize};
+                H5TBappend_records(fileID, "stats", bufRecords[b], recordSize, fieldOffsets, fieldSizes, dataBuf);
+                if (bufFlush[b] || ++writesSinceFlush == ASYNC_FLUSH_WRITES) {
+                    H5Fflush(fileID, H5F_SCOPE_LOCAL);
+                    writesSinceFlush = 0;
+                }
+                __sync_synchronize();
+                written++;
+            }
+        }
+
+        // Called with the HDF5 lock held, once the final dump is done
+        void closeFile() {
+            writePending();
+            H5Fclose(fileID);
+            fileID = H5I_INVALID_HID;
+        }
+
+    private:
+        void dumpAsync(bool buffered) {
+            assert_msg(fileID != H5I_INVALID_HID, "HDF5 (%s): dump after the file was closed", filename);
+            uint32_t b = handedOff % 2;
+            if (bufferedRecords == 0) {
+                // Wait until the writer is done with the buffer we're about to fill
+                while (handedOff - written > 1) usleep(100);
+            }
+
+            snapshot(snapBufs[b] + bufferedRecords*snapshotSize);
+            bufferedRecords++;
+
+            if (bufferedRecords == recordsPerWrite || !buffered) {
+                bufRecords[b] = bufferedRecords;
+                bufFlush[b] = !buffered;
+                __sync_synchronize();
+                handedOff++;
+                writer->wake();
+
+                //Switch to the other buffer
+                bufferedRecords = 0;
+
+                if (!buffered) {
+                    while (written != handedOff) usleep(100);
+                }
+            }
+        }
 };
 
+void HDF5Writer::close() {
+    lockH5();
+    for (HDF5BackendImpl* backend : backends) backend->closeFile();
+    backends.clear();
+    unlockH5();
+}
 
-HDF5Backend::HDF5Backend(const char* filename, AggregateStat* rootStat, size_t bytesPerWrite, bool skipVectors, bool sumRegularAggregates) {
-    backend = new HDF5BackendImpl(filename, rootStat, bytesPerWrite, skipVectors, sumRegularAggregates);
+void HDF5Writer::threadLoop() {
+    while (true) {
+        uint32_t seen = wakeups;
+        lockH5();
+        for (HDF5BackendImpl* backend : backends) backend->writePending();
+        unlockH5();
+        //Sleep unless someone handed off more buffers while we were writing
+        syscall(SYS_futex, &wakeups, FUTEX_WAIT, seen, nullptr, nullptr, 0);
+    }
+}
+
+
+HDF5Backend::HDF5Backend(const char* filename, AggregateStat* rootStat, size_t bytesPerWrite, bool skipVectors, bool sumRegularAggregates, bool async) {
+    backend = new HDF5BackendImpl(filename, rootStat, bytesPerWrite, skipVectors, sumRegularAggregates, async);
 }
 
 void HDF5Backend::dump(bool buffered) {
     backend->dump(buffered);
 }
 
+void CloseAsyncHDF5Stats() {
+    if (zinfo->hdf5Writer) zinfo->hdf5Writer->close();
+}
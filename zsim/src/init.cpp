@@ -47,6 +47,7 @@
 #include "galloc.h"
 #include "hash.h"
 #include "ideal_arrays.h"
+#include "live_stats.h"
 #include "locks.h"
 #include "log.h"
 #include "mem_ctrls.h"
@@ -62,6 +63,7 @@
 #include "profile_stats.h"
 #include "repl_policies.h"
 #include "scheduler.h"
+#include "simd.h"
 #include "simple_core.h"
 #include "stats.h"
 #include "stats_filter.h"
@@ -83,6 +85,18 @@
 
 extern void EndOfPhaseActions(); //in zsim.cpp
 
+#ifdef _WITH_BOOKSIM_
+// Interconnect shared by every NoC group that does not configure its own
+static InterconnectInterface* nocInterface = nullptr;
+
+static InterconnectInterface* NewInterconnect(const char* nocInitFile) {
+    InterconnectInterface* icnt = InterconnectInterface::New(nocInitFile);
+    icnt->CreateInterconnect();
+    icnt->Init();
+    return icnt;
+}
+#endif
+
 /* zsim should be initialized in a deterministic and logical order, to avoid re-reading config vars
  * all over the place and give a predictable global state to constructors. Ideally, this should just
  * follow the layout of zinfo, top-down.
@@ -139,7 +153,8 @@ BaseCache* BuildCacheBank(Config& config, const string& prefix, g_string& name,
             //STL hash function
             size_t seed = _Fnv_hash_bytes(prefix.c_str(), prefix.size()+1, 0xB4AC5B);
             //info("%s -> %lx", prefix.c_str(), seed);
-            hf = new H3HashFamily(numHashes, setBits, 0xCAC7EAFFA1 + seed /*make randSeed depend on prefix*/);
+            bool h3Tables = config.get<bool>(prefix + "array.h3Tables", true); //byte-wise tables if they fit in the L1
+            hf = new H3HashFamily(numHashes, setBits, 0xCAC7EAFFA1 + seed /*make randSeed depend on prefix*/, h3Tables);
         } else if (hashType == "SHA1") {
             hf = new SHA1HashFamily(numHashes);
         } else {
@@ -271,7 +286,10 @@ BaseCache* BuildCacheBank(Config& config, const string& prefix, g_string& name,
     if (isTerminal) {
         cc = new MESITerminalCC(numLines, isLLC, name);
     } else {
-        cc = new MESICC(numLines, isLLC, nonInclusiveHack, name);
+        //Directory format: 0 for a full sharer bit vector per line, N for N sharer pointers per line (with exact overflow)
+        uint32_t dirPointers = config.get<uint32_t>(prefix + "dirPointers", 0);
+        if (dirPointers > 8) panic("%s: dirPointers must be 0 (full directory) or up to 8 pointers, got %d", name.c_str(), dirPointers);
+        cc = new MESICC(numLines, isLLC, nonInclusiveHack, name, dirPointers);
     }
     rp->setCC(cc);
     if (!isTerminal) {
@@ -285,7 +303,8 @@ BaseCache* BuildCacheBank(Config& config, const string& prefix, g_string& name,
         } else if (type == "Tracing") {
             g_string traceFile = config.get<const char*>(prefix + "traceFile","");
             if (traceFile.empty()) traceFile = g_string(zinfo->outputDir) + "/" + name + ".trace";
-            cache = new TracingCache(numLines, cc, array, rp, accLat, invLat, traceFile, name);
+            TraceFormat traceFormat = ParseTraceFormat(config.get<const char*>(prefix + "traceFormat", "HDF5"));
+            cache = new TracingCache(numLines, cc, array, rp, accLat, invLat, traceFile, traceFormat, name);
         } else {
             panic("Invalid cache type %s", type.c_str());
         }
@@ -364,7 +383,8 @@ MemObject* BuildMemoryController(Config& config, uint32_t lineSize, uint32_t fre
         string dramSystemIni = config.get<const char*>("sys.mem.systemIni");
         string outputDir = config.get<const char*>("sys.mem.outputDir");
         string traceName = config.get<const char*>("sys.mem.traceName");
-        mem = new DRAMSimMemory(dramTechIni, dramSystemIni, outputDir, traceName, capacity, cpuFreqHz, latency, domain, name);
+        bool idleSkip = config.get<bool>("sys.mem.idleSkip", false);  // stop ticking DRAMSim while idle (stops its refreshes too)
+        mem = new DRAMSimMemory(dramTechIni, dramSystemIni, outputDir, traceName, capacity, cpuFreqHz, latency, domain, name, idleSkip);
     } else if (type == "Detailed") {
         // FIXME(dsm): Don't use a separate config file... see DDRMemory
         g_string mcfg = config.get<const char*>("sys.mem.paramFile", "");
@@ -375,6 +395,65 @@ MemObject* BuildMemoryController(Config& config, uint32_t lineSize, uint32_t fre
     return mem;
 }
 
+AddrInterleave* BuildAddrInterleave(Config& config, uint32_t lineSize, uint32_t numCtrls) {
+    string type = config.get<const char*>("sys.mem.interleave", "Line");
+
+    // Page interleaving defaults to 4KB blocks (use the DRAM row size for row interleaving)
+    uint32_t blockBytes = config.get<uint32_t>("sys.mem.interleaveBytes", (type == "Page")? 4096 : lineSize);
+    if (blockBytes < lineSize || blockBytes % lineSize) panic("sys.mem.interleaveBytes (%d) must be a multiple of the line size (%d)", blockBytes, lineSize);
+    uint32_t linesPerBlock = blockBytes / lineSize;
+
+    AddrInterleave* interleave = nullptr;
+    if (type == "Line") {
+        interleave = new BlockInterleave(numCtrls, 1);
+    } else if (type == "Page") {
+        interleave = new BlockInterleave(numCtrls, linesPerBlock);
+    } else if (type == "XorHash") {
+        interleave = new XorHashInterleave(numCtrls, linesPerBlock);
+    } else {
+        panic("Invalid memory interleaving policy %s", type.c_str());
+    }
+    info("Memory: %s interleaving across %d controllers, %d-line blocks", type.c_str(), numCtrls, (type == "Line")? 1 : linesPerBlock);
+    return interleave;
+}
+
+#ifdef _WITH_BOOKSIM_
+// Places memory controllers on a rows x cols mesh without a netcoord list.
+// Accesses are interleaved, so every node talks to every controller: greedily
+// pick the node with the lowest total distance to all nodes (fewest average
+// hops), never reusing a row or column while one is free so that XY-routed
+// memory traffic does not pile up on the same links.
+static std::vector<coordinates<int>> SpreadMemCoords(uint32_t numCtrls, int rows, int cols) {
+    if (numCtrls > (uint32_t)(rows*cols)) panic("Cannot place %d memory controllers on a %dx%d mesh", numCtrls, rows, cols);
+    std::vector<coordinates<int>> coords;
+    std::vector<bool> usedRow(rows, false), usedCol(cols, false), usedNode(rows*cols, false);
+    for (uint32_t c = 0; c < numCtrls; c++) {
+        bool spread = c < (uint32_t)std::min(rows, cols);
+        int best = -1;
+        int64_t bestCost = 0;
+        for (int x = 0; x < rows; x++) {
+            for (int y = 0; y < cols; y++) {
+                if (usedNode[x*cols + y] || (spread && (usedRow[x] || usedCol[y]))) continue;
+                int64_t cost = 0;
+                for (int i = 0; i < rows; i++) cost += cols*std::abs(x - i);
+                for (int j = 0; j < cols; j++) cost += rows*std::abs(y - j);
+                if (best == -1 || cost < bestCost) {
+                    best = x*cols + y;
+                    bestCost = cost;
+                }
+            }
+        }
+        assert(best != -1);
+        coordinates<int> coord = {best / cols, best % cols};
+        usedNode[best] = true;
+        usedRow[coord.x] = true;
+        usedCol[coord.y] = true;
+        coords.push_back(coord);
+    }
+    return coords;
+}
+#endif
+
 typedef vector<vector<BaseCache*>> CacheGroup;
 #ifdef _WITH_BOOKSIM_
 typedef vector<vector<BookSimNetwork*>> NocGroup;
@@ -468,7 +547,7 @@ CacheGroup* BuildCacheGroup(Config& config, const string& name, bool isTerminal,
 
 
 #ifdef _WITH_BOOKSIM_
-NocGroup* BuildNocGroup(Config& config, const string& name, InterconnectInterface* nocInterface) {
+NocGroup* BuildNocGroup(Config& config, const string& name) {
     NocGroup* ngp = new NocGroup;
     NocGroup& ng = *ngp;
     string prefix = "sys.noc." + name + ".";
@@ -478,6 +557,18 @@ NocGroup* BuildNocGroup(Config& config, const string& name, InterconnectInterfac
 
     uint32_t instances   = config.get<uint32_t>(prefix + "instances", 1); 
     uint32_t banks       = config.get<uint32_t>(prefix + "interfaces", 1); 
+    bool compactEvents   = config.get<bool>(prefix + "compactEvents", true); // single round-trip event when nothing lies past the NoC
+    uint32_t domain      = config.get<uint32_t>(prefix + "domain", 0);
+    if (domain >= zinfo->numDomains) panic("%s: domain %d out of range (%d domains)", name.c_str(), domain, zinfo->numDomains);
+
+    // A group with its own nocSystemIni simulates a separate interconnect, with its own topology and clock
+    InterconnectInterface* icnt = nocInterface;
+    if (config.exists(prefix + "nocSystemIni")) {
+        icnt = NewInterconnect(config.get<const char*>(prefix + "nocSystemIni"));
+        if (!icnt->GetContext()->random_streams) {
+            warn("%s: random_streams is off, so its interconnect draws from booksim's process-wide generator and its results depend on the other interconnects", name.c_str());
+        }
+    }
     ng.resize(instances);
 
     for (vector<BookSimNetwork*>& mo : ng){
@@ -494,7 +585,7 @@ NocGroup* BuildNocGroup(Config& config, const string& name, InterconnectInterfac
                 ss += + "b" + to_string(j);
             }
 
-            BookSimNetwork * noc = new BookSimNetwork(ss.c_str() , nocId++, nocInterface, (int) zinfo->freqMHz);
+            BookSimNetwork * noc = new BookSimNetwork(ss.c_str() , nocId++, icnt, (int) zinfo->freqMHz, compactEvents, domain);
             ng[i][j] = noc;
         }
     }
@@ -628,21 +719,46 @@ static void InitSystem(Config& config) {
 
 #ifdef _WITH_BOOKSIM_
     unordered_map<string, NocGroup*> nMap;
+    std::unordered_map<InterconnectInterface*, BookSimNetwork*> tickingNocs; //interconnect -> the noc that ticks it
     fringe.push_back(llnoc);
     while (!fringe.empty()) {
         string group = fringe.front();
         fringe.pop_front();
         if (nMap.count(group)) panic("The noc 'tree' has a loop at %s", group.c_str());
         if(std::find(nocGroupNames.begin(), nocGroupNames.end(), group) != nocGroupNames.end()){
-            nMap[group] = BuildNocGroup(config, group, nocInterface);
+            nMap[group] = BuildNocGroup(config, group);
+            if (zinfo->liveStats) for (auto& nocs : *nMap[group]) for (BookSimNetwork* noc : nocs) zinfo->liveStats->addNoc(noc);
+
+            // queue a tick event ONLY for the first noc of each interconnect, which will be responsible for ticking it
+            BookSimNetwork* first = (*nMap[group])[0][0];
+            auto it = tickingNocs.find(first->getInterface());
+            if (it == tickingNocs.end()) {
+                tickingNocs[first->getInterface()] = first;
+                first->enqueueTickEvent();
+                zinfo->contentionSim->addNoc(first);
+            } else if (it->second->getDomain() != first->getDomain()) {
+                // All injections into an interconnect must come from the domain that ticks it
+                panic("%s: domain %d differs from domain %d of %s, which ticks the same interconnect; give it its own nocSystemIni",
+                        group.c_str(), first->getDomain(), it->second->getDomain(), it->second->getName());
+            }
         } 
         for (auto& childVec : childMap[group]) fringe.insert(fringe.end(), childVec.begin(), childVec.end());
     }
-    
-    // queue a tick event ONLY for one noc which will be responsible for ticking booksim
-    (*nMap[llnoc])[0][0]->enqueueTickEvent();
+
+    // Interconnects ticked from different domains are stepped by different contention threads; without
+    // random streams, their draws would race on booksim's process-wide generator
+    bool multiDomain = false;
+    for (auto& tn : tickingNocs) multiDomain |= (tn.second->getDomain() != tickingNocs.begin()->second->getDomain());
+    if (multiDomain) {
+        for (auto& tn : tickingNocs) {
+            if (!tn.first->GetContext()->random_streams) {
+                panic("%s: its interconnect is ticked from domain %d while other interconnects are ticked from other domains; "
+                        "set random_streams = 1 in its booksim config", tn.second->getName(), tn.second->getDomain());
+            }
+        }
+    }
+
     (*nMap[llnoc])[0][0]->setLlnoc(true);
-    zinfo->contentionSim->setTopNoc((nMap[llnoc])[0][0][0]);
 #endif
 
 
@@ -666,13 +782,21 @@ static void InitSystem(Config& config) {
     mems.resize(memControllers);
 
 #ifdef _WITH_BOOKSIM_
-    // Read the memory controller coordinates from zsim's config file
-    bool connectedToNoc = config.exists("sys.mem.netcoord");
+    // Read the memory controller coordinates from zsim's config file, or place them
+    // automatically if sys.mem.netPlacement is given instead
+    bool placeOnNoc = !config.exists("sys.mem.netcoord") && config.exists("sys.mem.netPlacement");
+    bool connectedToNoc = config.exists("sys.mem.netcoord") || placeOnNoc;
     std::vector<coordinates<int>> memCoord;
     std::string netCoord = "";
     std::string coordStr;
 
-    if(connectedToNoc){
+    if (placeOnNoc) {
+        string placement = config.get<const char*>("sys.mem.netPlacement");
+        if (placement != "Spread") panic("Invalid memory controller placement %s", placement.c_str());
+        const BookSimContext* llnocCtx = (*nMap[llnoc])[0][0]->getInterface()->GetContext();
+        memCoord = SpreadMemCoords(memControllers, llnocCtx->y, llnocCtx->x);  // node = x*X + y (see BookSimNetwork::getNode())
+        for (uint32_t i = 0; i < memControllers; i++) info("mem-%d placed at NoC node (%d, %d)", i, memCoord[i].x, memCoord[i].y);
+    } else if(connectedToNoc){
         netCoord = config.get<const char*>("sys.mem.netcoord");
         std::stringstream ss(netCoord);
         while (std::getline(ss, coordStr, ' ')) {
@@ -718,7 +842,8 @@ static void InitSystem(Config& config) {
     if (memControllers > 1) {
         bool splitAddrs = config.get<bool>("sys.mem.splitAddrs", true);
         if (splitAddrs) {
-            MemObject* splitter = new SplitAddrMemory(mems, "mem-splitter");
+            AddrInterleave* interleave = BuildAddrInterleave(config, zinfo->lineSize, memControllers);
+            MemObject* splitter = new SplitAddrMemory(mems, "mem-splitter", interleave);
             mems.resize(1);
             mems[0] = splitter;
         }
@@ -1175,10 +1300,12 @@ static void InitSystem(Config& config) {
         //FIXME: For now, we assume we are driving a single-bank LLC
         string traceFile = config.get<const char*>("sim.traceFile");
         string retraceFile = config.get<const char*>("sim.retraceFile", ""); //leave empty to not retrace
-        zinfo->traceDriver = new TraceDriver(traceFile, retraceFile, proxies,
+        TraceFormat retraceFormat = ParseTraceFormat(config.get<const char*>("sim.retraceFormat", "HDF5"));
+        zinfo->traceDriver = new TraceDriver(traceFile, retraceFile, retraceFormat, proxies,
                 config.get<bool>("sim.useSkews", true), // incorporate skews in to playback and simulator results, not only the output trace
                 config.get<bool>("sim.playPuts", true),
-                config.get<bool>("sim.playAllGets", true));
+                config.get<bool>("sim.playAllGets", true),
+                config.get<uint32_t>("sim.traceThreads", 1)); // >1 replays children in parallel
         zinfo->traceDriver->initStats(zinfo->rootStat);
     }
 
@@ -1237,11 +1364,14 @@ static void PostInitStats(bool perProcessDir, Config& config) {
     const char* cmpStatsFile = gm_strdup((pathStr + "zsim-cmp.h5").c_str());
     const char* statsFile = gm_strdup((pathStr + "zsim.out").c_str());
 
+    // If set, HDF5 stats are written by a background thread and files stay open until the end of the run
+    bool asyncStats = config.get<bool>("sim.asyncStats", false);
+
     if (zinfo->statsPhaseInterval) {
         const char* periodicStatsFilter = config.get<const char*>("sim.periodicStatsFilter", "");
         AggregateStat* prStat = (!strlen(periodicStatsFilter))? zinfo->rootStat : FilterStats(zinfo->rootStat, periodicStatsFilter);
         if (!prStat) panic("No stats match sim.periodicStatsFilter regex (%s)! Set interval to 0 to avoid periodic stats", periodicStatsFilter);
-        zinfo->periodicStatsBackend = new HDF5Backend(pStatsFile, prStat, (1 << 20) /* 1MB chunks */, zinfo->skipStatsVectors, zinfo->compactPeriodicStats);
+        zinfo->periodicStatsBackend = new HDF5Backend(pStatsFile, prStat, (1 << 20) /* 1MB chunks */, zinfo->skipStatsVectors, zinfo->compactPeriodicStats, asyncStats);
         zinfo->periodicStatsBackend->dump(true); //must have a first sample
 
         class PeriodicStatsDumpEvent : public Event {
@@ -1259,7 +1389,7 @@ static void PostInitStats(bool perProcessDir, Config& config) {
         zinfo->periodicStatsBackend = nullptr;
     }
 
-    zinfo->eventualStatsBackend = new HDF5Backend(evStatsFile, zinfo->rootStat, (1 << 17) /* 128KB chunks */, zinfo->skipStatsVectors, false /* don't sum regular aggregates*/);
+    zinfo->eventualStatsBackend = new HDF5Backend(evStatsFile, zinfo->rootStat, (1 << 17) /* 128KB chunks */, zinfo->skipStatsVectors, false /* don't sum regular aggregates*/, asyncStats);
     zinfo->eventualStatsBackend->dump(true); //must have a first sample
     zinfo->statsBackends->push_back(zinfo->eventualStatsBackend);
 
@@ -1277,7 +1407,7 @@ static void PostInitStats(bool perProcessDir, Config& config) {
     }
 
     // Convenience stats
-    StatsBackend* compactStats = new HDF5Backend(cmpStatsFile, zinfo->rootStat, 0 /* no aggregation, this is just 1 record */, zinfo->skipStatsVectors, true); //don't dump a first sample.
+    StatsBackend* compactStats = new HDF5Backend(cmpStatsFile, zinfo->rootStat, 0 /* no aggregation, this is just 1 record */, zinfo->skipStatsVectors, true, asyncStats); //don't dump a first sample.
     StatsBackend* textStats = new TextBackend(statsFile, zinfo->rootStat);
     zinfo->statsBackends->push_back(compactStats);
     zinfo->statsBackends->push_back(textStats);
@@ -1301,6 +1431,7 @@ static void InitGlobalStats() {
 
 void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
     zinfo = gm_calloc<GlobSimInfo>();
+    futex_init(&zinfo->hdf5Lock);
     zinfo->outputDir = gm_strdup(outputDir);
     zinfo->statsBackends = new g_vector<StatsBackend*>();
 
@@ -1308,10 +1439,7 @@ void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
 
 #ifdef _WITH_BOOKSIM_
     const char* nocInitFile = config.get<const char*>("sys.noc.nocSystemIni");
-    nocInterface = InterconnectInterface::New(nocInitFile);
-    
-    nocInterface->CreateInterconnect();
-    nocInterface->Init();
+    nocInterface = NewInterconnect(nocInitFile);
 #endif
 
 
@@ -1351,6 +1479,16 @@ void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
     zinfo->numDomains = config.get<uint32_t>("sim.domains", 1);
     uint32_t numSimThreads = config.get<uint32_t>("sim.contentionThreads", MAX((uint32_t)1, zinfo->numDomains/2)); //gives a bit of parallelism, TODO tune
     zinfo->contentionSim = new ContentionSim(zinfo->numDomains, numSimThreads);
+    //Domains that use a calendar queue (multi-level timing wheel) instead of the windowed PrioQueue, e.g., "0 3" or "all"
+    string calendarDomains = config.get<const char*>("sim.calendarDomains", "");
+    if (calendarDomains == "all") {
+        for (uint32_t d = 0; d < zinfo->numDomains; d++) zinfo->contentionSim->setCalendarQueue(d);
+    } else {
+        for (uint32_t d : ParseList<uint32_t>(calendarDomains)) {
+            if (d >= zinfo->numDomains) panic("sim.calendarDomains: domain %d out of range (%d domains)", d, zinfo->numDomains);
+            zinfo->contentionSim->setCalendarQueue(d);
+        }
+    }
     zinfo->contentionSim->initStats(zinfo->rootStat);
     zinfo->eventRecorders = gm_calloc<EventRecorder*>(zinfo->numCores);
 
@@ -1426,6 +1564,25 @@ void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
 
     zinfo->pinCmd = new PinCmd(&config, nullptr /*don't pass config file to children --- can go either way, it's optional*/, outputDir, shmid);
 
+    //Event recorder slabs from huge pages (must be set before cores build their recorders)
+    slab::hugePageSlabs() = config.get<bool>("sim.hugePageSlabs", false);
+
+    //SIMD tag matching and hashing in cache arrays (auto-detected, can be capped for debugging or A/B runs)
+    string maxSimd = config.get<const char*>("sim.maxSimd", "avx512");
+    if (maxSimd == "none") {
+        simd::maxLevel() = SIMD_NONE;
+    } else if (maxSimd == "avx2") {
+        simd::maxLevel() = SIMD_AVX2;
+    } else if (maxSimd == "avx512") {
+        simd::maxLevel() = SIMD_AVX512;
+    } else {
+        panic("sim.maxSimd must be none, avx2, or avx512 (got %s)", maxSimd.c_str());
+    }
+    info("Using %s SIMD code paths", simd::getLevelName(simd::getLevel()));
+
+    //Live stats for external monitors (harness heartbeat, zsimtop)
+    zinfo->liveStats = config.get<bool>("sim.liveStats", true)? new LiveStats(zinfo->numCores) : nullptr;
+
     //Caches, cores, memory controllers
     InitSystem(config);
 
@@ -0,0 +1,73 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "live_stats.h"
+#include <time.h>
+#include "core.h"
+#include "profile_stats.h"
+#include "zsim.h"
+
+#ifdef _WITH_BOOKSIM_
+#include "booksim_net_ctrl.h"
+#endif
+
+void LiveStats::update() {
+    seq++;
+    __sync_synchronize();
+
+    snap.phase = zinfo->numPhases;
+    snap.cycles = zinfo->globPhaseCycles;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    snap.updateTimeNs = ts.tv_sec*1000000000L + ts.tv_nsec;
+
+    snap.boundNs = zinfo->profSimTime->count(PROF_BOUND);
+    snap.weaveNs = zinfo->profSimTime->count(PROF_WEAVE);
+    snap.ffNs = zinfo->profSimTime->count(PROF_FF);
+
+    uint64_t totalInstrs = 0;
+    for (uint32_t i = 0; i < numCores; i++) {
+        coreInstrs[i] = zinfo->cores[i]->getInstrs();
+        totalInstrs += coreInstrs[i];
+    }
+    snap.totalInstrs = totalInstrs;
+
+#ifdef _WITH_BOOKSIM_
+    snap.nocInjectedFlits = 0;
+    snap.nocEjectedFlits = 0;
+    snap.nocPackets = 0;
+    snap.nocTotalLatency = 0;
+    for (BookSimNetwork* noc : nocs) {
+        snap.nocInjectedFlits += noc->getInjectedFlits();
+        snap.nocEjectedFlits += noc->getEjectedFlits();
+        snap.nocPackets += noc->getDeliveredPackets();
+        snap.nocTotalLatency += noc->getTotalPacketLatency();
+    }
+#endif
+
+    __sync_synchronize();
+    seq++;
+}
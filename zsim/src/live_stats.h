@@ -0,0 +1,109 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIVE_STATS_H_
+#define LIVE_STATS_H_
+
+/* Live statistics for external monitors (the harness heartbeat, zsimtop).
+ *
+ * A small block in the global heap is updated at the end of every phase, after
+ * the weave phase, so values are always consistent across cores. Monitors
+ * attach the global heap read-only (gm_attach(shmid, true)), find the block
+ * through zinfo->liveStats, and copy it out with read(), which retries if it
+ * races with an update (seqlock), so they never stall the simulation.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "g_std/g_vector.h"
+#include "galloc.h"
+
+#ifdef _WITH_BOOKSIM_
+class BookSimNetwork;
+#endif
+
+struct LiveStatsSnapshot {
+    uint64_t phase;
+    uint64_t cycles;
+    uint64_t updateTimeNs;  // wall clock (CLOCK_REALTIME) of the update
+    uint64_t boundNs;
+    uint64_t weaveNs;
+    uint64_t ffNs;
+    uint64_t totalInstrs;
+    uint64_t nocInjectedFlits;
+    uint64_t nocEjectedFlits;
+    uint64_t nocPackets;  // delivered
+    uint64_t nocTotalLatency;  // cycles, summed over delivered packets
+
+    double getIpc(uint32_t numCores) const {
+        return cycles? ((double)totalInstrs)/(cycles*numCores) : 0.0;
+    }
+
+    double getAvgPacketLatency() const {
+        return nocPackets? ((double)nocTotalLatency)/nocPackets : 0.0;
+    }
+};
+
+class LiveStats : public GlobAlloc {
+    private:
+        volatile uint64_t seq;  // odd while an update is in progress
+        LiveStatsSnapshot snap;
+        uint32_t numCores;
+        uint64_t* coreInstrs;
+
+#ifdef _WITH_BOOKSIM_
+        g_vector<BookSimNetwork*> nocs;
+#endif
+
+    public:
+        explicit LiveStats(uint32_t _numCores) : seq(0), numCores(_numCores) {
+            memset(&snap, 0, sizeof(snap));
+            coreInstrs = gm_calloc<uint64_t>(numCores);
+        }
+
+#ifdef _WITH_BOOKSIM_
+        void addNoc(BookSimNetwork* noc) { nocs.push_back(noc); }
+#endif
+
+        // Called at the end of each phase, see EndOfPhaseActions()
+        void update();
+
+        uint32_t getNumCores() const { return numCores; }
+
+        // Reader side; instrs must have room for getNumCores() elements, or be nullptr
+        void read(LiveStatsSnapshot* res, uint64_t* instrs) const {
+            while (true) {
+                uint64_t start = seq;
+                if (start & 1) continue;
+                __sync_synchronize();
+                *res = *const_cast<const LiveStatsSnapshot*>(&snap);
+                if (instrs) memcpy(instrs, coreInstrs, numCores*sizeof(uint64_t));
+                __sync_synchronize();
+                if (seq == start) return;
+            }
+        }
+};
+
+#endif  // LIVE_STATS_H_
@@ -156,6 +156,11 @@ class BaseCache : public MemObject {
         virtual int getNumChildren() = 0; 
         virtual int getNumParents() = 0; 
         virtual uint64_t invalidate(const InvReq& req) = 0;
+
+        // Invalidates several NoC children at once (req.nocChildId is ignored), see BookSimNetwork
+        virtual uint64_t invalidateBatch(const InvReq& req, const uint32_t* nocChildIds, uint32_t num) {
+            panic("invalidateBatch() is only supported by NoC interfaces");
+        }
 };
 
 #endif  // MEMORY_HIERARCHY_H_
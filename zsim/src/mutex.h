@@ -41,6 +41,10 @@ class mutex : public GlobAlloc {
             futex_lock(&futex);
         }
 
+        bool trylock() {
+            return futex == 0 && __sync_bool_compare_and_swap(&futex, 0, 1);
+        }
+
         void unlock() {
             futex_unlock(&futex);
         }
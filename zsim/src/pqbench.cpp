@@ -0,0 +1,215 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Replays domain queue operation logs (pqops-<domain>.bin, produced with
+ * RECORD_PQ_OPS in contention_sim.h) against PrioQueue and CalendarQueue,
+ * checks that both dequeue the same cycles as the original run, and reports
+ * how long each one took.
+ *
+ * It also checks same-cycle order against a strict LIFO model (the last
+ * element enqueued for a cycle comes out first). CalendarQueue must match it
+ * exactly. PrioQueue only does for elements that never went through its far
+ * map, so its mismatches are just reported. With -synth instead of a file, it
+ * generates a log with many same-cycle elements, near and far.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "bithacks.h"
+#include "calendar_queue.h"
+#include "galloc.h"
+#include "log.h"
+#include "prio_queue.h"
+
+#define PQ_BLOCKS 1024  // same as ContentionSim
+#define DEQ_BIT (1UL << 63)
+
+struct BenchElem {
+    BenchElem* next;
+    uint64_t privCycle;
+};
+
+static inline uint64_t nextRand(uint64_t& s) {  // xorshift64, same sequence on every libc
+    s ^= s << 13;
+    s ^= s >> 7;
+    s ^= s << 17;
+    return s;
+}
+
+/* Enqueues cluster on a few cycles, 4096 apart and up to 80K cycles ahead, so
+ * many elements share a cycle, and some of them are beyond PrioQueue's blocks
+ * (PQ_BLOCKS*64 cycles) or several CalendarQueue levels up.
+ */
+static std::vector<uint64_t> synthOps(uint64_t numOps) {
+    std::vector<uint64_t> ops;
+    std::multimap<uint64_t, uint32_t> live;  // only cycles matter here
+    uint64_t s = 0x9E3779B97F4A7C15UL;
+    uint64_t curCycle = 0;
+    while (ops.size() < numOps) {
+        uint64_t r = nextRand(s);
+        if (live.size() < 1024 || r % 2) {
+            uint64_t cycle;
+            if ((r >> 8) % 4 == 0) {
+                cycle = curCycle + (r >> 16) % 4;
+            } else {
+                cycle = (curCycle/4096 + 1 + (r >> 16) % 20)*4096 + (r >> 32) % 2;
+            }
+            live.insert(std::make_pair(cycle, 0));
+            ops.push_back(cycle);
+        } else {
+            curCycle = live.begin()->first;
+            live.erase(live.begin());
+            ops.push_back(curCycle | DEQ_BIT);
+        }
+    }
+    return ops;
+}
+
+// Returns how many dequeues did not return the element a strict LIFO queue would
+template <typename Q>
+static uint64_t checkOrder(Q& q, const std::vector<uint64_t>& ops) {
+    std::vector<BenchElem> elems(ops.size());
+    std::map<uint64_t, std::vector<BenchElem*>> model;
+    uint64_t used = 0;
+    uint64_t mismatches = 0;
+    for (uint64_t op : ops) {
+        if (op & DEQ_BIT) {
+            uint64_t cycle;
+            BenchElem* e = q.dequeue(cycle);
+            std::vector<BenchElem*>& sameCycle = model.begin()->second;
+            if (cycle != model.begin()->first) panic("dequeued cycle %ld, expected %ld", cycle, model.begin()->first);
+            if (e != sameCycle.back()) {
+                mismatches++;
+                // Follow the queue, so a single swap does not cascade into more mismatches
+                for (uint32_t i = 0; i < sameCycle.size(); i++) {
+                    if (sameCycle[i] == e) {
+                        sameCycle.erase(sameCycle.begin() + i);
+                        break;
+                    }
+                }
+            } else {
+                sameCycle.pop_back();
+            }
+            if (sameCycle.empty()) model.erase(model.begin());
+        } else {
+            BenchElem* e = &elems[used++];
+            e->next = nullptr;
+            q.enqueue(e, op);
+            model[op].push_back(e);
+        }
+    }
+    return mismatches;
+}
+
+static uint64_t getNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000000000L + ts.tv_nsec;
+}
+
+// Follows the access pattern of ContentionSim::simulatePhaseThread: peek, dequeue, peek
+template <typename Q>
+static uint64_t replay(Q& q, const std::vector<uint64_t>& ops, const char* qName) {
+    std::vector<BenchElem*> freeElems;
+    uint64_t maxLive = 0;
+    uint64_t start = getNs();
+    for (uint64_t op : ops) {
+        if (op & DEQ_BIT) {
+            uint64_t expCycle = op & ~DEQ_BIT;
+            if (q.firstCycle() != expCycle) panic("%s: firstCycle %ld, expected %ld", qName, q.firstCycle(), expCycle);
+            uint64_t cycle;
+            BenchElem* e = q.dequeue(cycle);
+            if (cycle != expCycle) panic("%s: dequeued cycle %ld, expected %ld", qName, cycle, expCycle);
+            freeElems.push_back(e);
+            if (q.size()) q.firstCycle();
+        } else {
+            BenchElem* e;
+            if (freeElems.empty()) {
+                e = new BenchElem;
+            } else {
+                e = freeElems.back();
+                freeElems.pop_back();
+            }
+            e->next = nullptr;
+            q.enqueue(e, op);
+            maxLive = MAX(maxLive, q.size());
+        }
+    }
+    uint64_t ns = getNs() - start;
+    info("%s: %ld ops, %ld max elems, %ld left, %.2f ns/op", qName, ops.size(), maxLive, q.size(), ((double)ns)/ops.size());
+    return ns;
+}
+
+int main(int argc, char *argv[]) {
+    InitLog("[B] ");
+    if (argc < 2) {
+        info("Usage: %s <pqops-file>|-synth [<repetitions>]", argv[0]);
+        exit(1);
+    }
+    uint32_t reps = (argc > 2)? atoi(argv[2]) : 1;
+
+    std::vector<uint64_t> ops;
+    if (strcmp(argv[1], "-synth") == 0) {
+        ops = synthOps(4000000);
+    } else {
+        FILE* f = fopen(argv[1], "r");
+        if (!f) panic("Could not open %s", argv[1]);
+        uint64_t op;
+        while (fread(&op, sizeof(uint64_t), 1, f) == 1) ops.push_back(op);
+        fclose(f);
+        if (ops.empty()) panic("%s has no operations", argv[1]);
+    }
+
+    gm_init(256 << 20);  // PrioQueue's far map lives in the global heap
+
+    PrioQueue<BenchElem, PQ_BLOCKS>* opq = new PrioQueue<BenchElem, PQ_BLOCKS>();
+    info("PrioQueue: %ld dequeues out of strict LIFO order", checkOrder(*opq, ops));
+    delete opq;
+    CalendarQueue<BenchElem>* ocq = new CalendarQueue<BenchElem>();
+    uint64_t cqMismatches = checkOrder(*ocq, ops);
+    if (cqMismatches) panic("CalendarQueue: %ld dequeues out of strict LIFO order", cqMismatches);
+    info("CalendarQueue: same-cycle elements dequeued in strict LIFO order");
+    delete ocq;
+
+    uint64_t pqNs = 0;
+    uint64_t cqNs = 0;
+    for (uint32_t r = 0; r < reps; r++) {
+        // Both queues are large, keep them off the stack
+        PrioQueue<BenchElem, PQ_BLOCKS>* pq = new PrioQueue<BenchElem, PQ_BLOCKS>();
+        pqNs += replay(*pq, ops, "PrioQueue");
+        delete pq;
+
+        CalendarQueue<BenchElem>* cq = new CalendarQueue<BenchElem>();
+        cqNs += replay(*cq, ops, "CalendarQueue");
+        delete cq;
+    }
+    info("Total: PrioQueue %.3f s, CalendarQueue %.3f s, speedup %.2fx", pqNs/1e9, cqNs/1e9, ((double)pqNs)/cqNs);
+    return 0;
+}
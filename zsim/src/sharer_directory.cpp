@@ -0,0 +1,121 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sharer_directory.h"
+#include "log.h"
+
+SharerDirectory::SharerDirectory(uint32_t _numLines, uint32_t _dirPtrs) : numLines(_numLines), dirPtrs(_dirPtrs) {
+    fullSharers = nullptr;
+    ptrs = nullptr;
+    if (dirPtrs) {
+        assert(MAX_CACHE_CHILDREN < DIR_PTR_OVERFLOW);
+        ptrs = gm_calloc<uint16_t>(numLines*dirPtrs);
+        for (uint32_t i = 0; i < numLines*dirPtrs; i++) ptrs[i] = DIR_PTR_NONE;
+    } else {
+        fullSharers = gm_calloc<SharerBits>(numLines);  // all-zero is an empty bitset
+    }
+}
+
+void SharerDirectory::initStats(AggregateStat* dirStat) {
+    auto ovfLinesFn = [this]() { return getOverflowLines(); };
+    auto ovfLinesStat = makeLambdaStat(ovfLinesFn);
+    ovfLinesStat->init("ovfLines", "Lines currently overflowing their sharer pointers");
+    dirStat->append(ovfLinesStat);
+    profDirOverflows.init("ovfs", "Sharer pointer overflows");
+    dirStat->append(&profDirOverflows);
+}
+
+uint64_t SharerDirectory::getBytes() const {
+    if (dirPtrs) {
+        // Approximate overflow cost as one map node per line
+        return numLines*dirPtrs*sizeof(uint16_t) + overflowSharers.size()*(sizeof(SharerBits) + 2*sizeof(void*) + sizeof(uint32_t));
+    } else {
+        return numLines*sizeof(SharerBits);
+    }
+}
+
+void SharerDirectory::addSharerPtr(uint32_t lineId, uint32_t id) {
+    uint16_t* p = &ptrs[lineId*dirPtrs];
+    if (p[0] == DIR_PTR_OVERFLOW) {
+        overflowSharers[lineId][id] = true;
+        return;
+    }
+
+    // Insertion sort; pointers are few, and sorted ids make invalidations go out in the same order as with a full map
+    uint32_t i = 0;
+    while (i < dirPtrs && p[i] < id) i++;
+    if (i < dirPtrs && p[i] == id) return;
+    if (p[dirPtrs-1] == DIR_PTR_NONE) {
+        for (uint32_t j = dirPtrs-1; j > i; j--) p[j] = p[j-1];
+        p[i] = id;
+        return;
+    }
+
+    // Out of pointers, move to the overflow bit vector
+    SharerBits& bits = overflowSharers[lineId];
+    bits.reset();
+    for (uint32_t j = 0; j < dirPtrs; j++) bits[p[j]] = true;
+    bits[id] = true;
+    p[0] = DIR_PTR_OVERFLOW;
+    profDirOverflows.inc();
+}
+
+void SharerDirectory::removeSharerPtr(uint32_t lineId, uint32_t id) {
+    uint16_t* p = &ptrs[lineId*dirPtrs];
+    if (p[0] == DIR_PTR_OVERFLOW) {
+        SharerBits& bits = overflowSharers[lineId];
+        bits[id] = false;
+        if (bits.none()) {
+            overflowSharers.erase(lineId);
+            for (uint32_t j = 0; j < dirPtrs; j++) p[j] = DIR_PTR_NONE;
+        }
+        return;
+    }
+
+    uint32_t i = 0;
+    while (i < dirPtrs && p[i] < id) i++;
+    if (i == dirPtrs || p[i] != id) return;
+    for (uint32_t j = i; j < dirPtrs-1; j++) p[j] = p[j+1];
+    p[dirPtrs-1] = DIR_PTR_NONE;
+}
+
+uint32_t SharerDirectory::getSharers(uint32_t lineId, uint32_t limit, uint32_t* ids) {
+    uint32_t num = 0;
+    const SharerBits* bits = nullptr;
+    if (!dirPtrs) {
+        bits = &fullSharers[lineId];
+    } else {
+        const uint16_t* p = &ptrs[lineId*dirPtrs];
+        if (p[0] == DIR_PTR_OVERFLOW) {
+            bits = &overflowSharers[lineId];
+        } else {
+            for (uint32_t i = 0; i < dirPtrs && p[i] < limit; i++) ids[num++] = p[i];
+            return num;
+        }
+    }
+    // Skips empty words instead of testing bit by bit
+    for (size_t c = bits->_Find_first(); c < limit; c = bits->_Find_next(c)) ids[num++] = c;
+    return num;
+}
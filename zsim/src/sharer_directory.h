@@ -0,0 +1,106 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHARER_DIRECTORY_H_
+#define SHARER_DIRECTORY_H_
+
+#include <bitset>
+#include "constants.h"
+#include "g_std/g_unordered_map.h"
+#include "galloc.h"
+#include "stats.h"
+
+/* Sharer sets of a MESITopCC directory, kept apart from its entries so each mode only pays for what it uses.
+ * - Full directory (dirPtrs == 0): one bit vector per line.
+ * - Limited-pointer directory: dirPtrs sorted sharer ids per line, terminated
+ *   by DIR_PTR_NONE. Lines with more sharers set the first pointer to
+ *   DIR_PTR_OVERFLOW and keep an exact bit vector in overflowSharers until
+ *   they lose all sharers, so invalidations stay precise.
+ * Not thread-safe; the owning controller serializes accesses.
+ */
+class SharerDirectory : public GlobAlloc {
+    private:
+        typedef std::bitset<MAX_CACHE_CHILDREN> SharerBits;
+
+        static const uint16_t DIR_PTR_NONE = 0xffff;
+        static const uint16_t DIR_PTR_OVERFLOW = 0xfffe;
+
+        uint32_t numLines;
+        uint32_t dirPtrs;
+        SharerBits* fullSharers;
+        uint16_t* ptrs;
+        g_unordered_map<uint32_t, SharerBits> overflowSharers;
+
+        Counter profDirOverflows;
+
+    public:
+        SharerDirectory(uint32_t _numLines, uint32_t _dirPtrs);
+
+        /* Adding an existing sharer or removing an absent one is a no-op */
+        inline bool isSharer(uint32_t lineId, uint32_t id) {
+            if (!dirPtrs) return fullSharers[lineId][id];
+            const uint16_t* p = &ptrs[lineId*dirPtrs];
+            if (p[0] == DIR_PTR_OVERFLOW) return overflowSharers[lineId][id];
+            for (uint32_t i = 0; i < dirPtrs && p[i] <= id; i++) {
+                if (p[i] == id) return true;
+            }
+            return false;
+        }
+
+        inline void addSharer(uint32_t lineId, uint32_t id) {
+            if (!dirPtrs) {
+                fullSharers[lineId][id] = true;
+            } else {
+                addSharerPtr(lineId, id);
+            }
+        }
+
+        inline void removeSharer(uint32_t lineId, uint32_t id) {
+            if (!dirPtrs) {
+                fullSharers[lineId][id] = false;
+            } else {
+                removeSharerPtr(lineId, id);
+            }
+        }
+
+        // Writes the sharers of lineId below limit to ids in ascending order (same order as the full directory); returns how many
+        uint32_t getSharers(uint32_t lineId, uint32_t limit, uint32_t* ids);
+
+        // Sharer storage only, including overflowed sharer sets
+        uint64_t getBytes() const;
+
+        uint64_t getOverflowLines() const {
+            return overflowSharers.size();
+        }
+
+        // Appends ovfLines and ovfs to dirStat
+        void initStats(AggregateStat* dirStat);
+
+    private:
+        void addSharerPtr(uint32_t lineId, uint32_t id);
+        void removeSharerPtr(uint32_t lineId, uint32_t id);
+};
+
+#endif  // SHARER_DIRECTORY_H_
@@ -0,0 +1,68 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIMD_H_
+#define SIMD_H_
+
+/* Runtime selection of SIMD code paths. zsim is compiled for a conservative
+ * -march (see SConstruct), so wider-vector versions of hot functions are
+ * compiled with target attributes and picked at initialization through CPUID.
+ */
+
+#include <stdint.h>
+
+enum SimdLevel {SIMD_NONE, SIMD_AVX2, SIMD_AVX512};
+
+namespace simd {
+
+// Caps the level returned by getLevel(). Set once during initialization,
+// before any cache array or hash function is built.
+inline SimdLevel& maxLevel() {
+    static SimdLevel level = SIMD_AVX512;
+    return level;
+}
+
+// Highest level supported by both the CPU and the OS (which must save the
+// wider registers on context switches), capped by maxLevel()
+inline SimdLevel getLevel() {
+    __builtin_cpu_init();
+    SimdLevel level = SIMD_NONE;
+    if (__builtin_cpu_supports("avx2")) level = SIMD_AVX2;
+    if (__builtin_cpu_supports("avx512f")) level = SIMD_AVX512;
+    return (level < maxLevel())? level : maxLevel();
+}
+
+inline const char* getLevelName(SimdLevel level) {
+    switch (level) {
+        case SIMD_NONE: return "none";
+        case SIMD_AVX2: return "avx2";
+        case SIMD_AVX512: return "avx512";
+    }
+    return "???";
+}
+
+}  // namespace simd
+
+#endif  // SIMD_H_
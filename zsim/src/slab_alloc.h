@@ -38,13 +38,20 @@
 #include <deque>
 #include <stddef.h>
 #include <stdint.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include "g_std/g_vector.h"
+#include "galloc.h"
 #include "log.h"
 #include "mutex.h"
 
 #define SLAB_SIZE (1<<16)  // 64KB; must be a power of two
 #define SLAB_MASK (~(SLAB_SIZE - 1))
 
+// With huge pages, slabs are carved out of 2MB chunks of the global heap
+#define SLAB_HUGE_CHUNK (1<<21)
+#define SLABS_PER_HUGE_CHUNK (SLAB_HUGE_CHUNK/SLAB_SIZE)
+
 // Uncomment to immediately scrub slabs (to 0) and freed elems (to -1).
 // This makes use-after-free errors obvious.
 //#define DEBUG_SLAB_ALLOC
@@ -53,6 +60,13 @@ namespace slab {
 
 class SlabAlloc;
 
+// Whether newly constructed allocators back their slabs with huge pages. Set
+// once during initialization, before any EventRecorder is built.
+inline bool& hugePageSlabs() {
+    static bool useHugePages = false;
+    return useHugePages;
+}
+
 struct Slab {  // POD type (no constructor)
     SlabAlloc* allocator;
     volatile uint32_t liveElems;
@@ -96,10 +110,22 @@ class SlabAlloc {
         Slab* curSlab;
         g_vector<Slab*> freeList;
         uint32_t liveSlabs;
+        uint64_t allocBytes;  // cumulative, unsynced like alloc()
         mutex freeLock;  // used because slab frees may be concurrent
+        bool hugePages;
+
+        // Telemetry; all but allocBytes are only updated with freeLock held
+        uint32_t peakLiveSlabs;
+        uint64_t heapSlabs;  // slabs ever obtained from the global heap
+        uint64_t slabFrees;
+        uint64_t remoteFrees;  // slabs freed by a thread other than the one that last allocated
+        uint64_t contendedLocks;
+        pid_t allocTid;
 
     public:
-        SlabAlloc() : curSlab(nullptr), liveSlabs(0) {
+        SlabAlloc() : curSlab(nullptr), liveSlabs(0), allocBytes(0), hugePages(hugePageSlabs()),
+            peakLiveSlabs(0), heapSlabs(0), slabFrees(0), remoteFrees(0), contendedLocks(0), allocTid(0)
+        {
             allocSlab();
         }
 
@@ -112,30 +138,69 @@ class SlabAlloc {
                 assert(ptr);
             }
             assert((((uintptr_t)ptr) & SLAB_MASK) == (uintptr_t)curSlab);
+            allocBytes += sz;
             return ptr;
         }
 
         template <typename T> T* alloc() { return (T*)alloc(sizeof(T)); }
 
+        uint64_t getAllocatedBytes() const { return allocBytes; }
+        uint32_t getLiveSlabs() const { return liveSlabs; }
+        uint64_t getPeakLiveBytes() const { return ((uint64_t)peakLiveSlabs)*SLAB_SIZE; }
+        uint64_t getFootprintBytes() const { return heapSlabs*SLAB_SIZE; }
+        uint64_t getSlabFrees() const { return slabFrees; }
+        uint64_t getRemoteFrees() const { return remoteFrees; }
+        uint64_t getContendedLocks() const { return contendedLocks; }
+        bool usesHugePages() const { return hugePages; }
+
     private:
+        void lockFreeList() {
+            if (!freeLock.trylock()) {
+                freeLock.lock();
+                contendedLocks++;
+            }
+        }
+
+        static pid_t getTid() {
+            return syscall(SYS_gettid);
+        }
+
         void allocSlab() {
-            scoped_mutex sm(freeLock);
-            if (!freeList.empty()) {
+            lockFreeList();
+            if (freeList.empty()) {
+                if (hugePages) {
+                    // Grab a whole huge page worth of slabs; all but one go to the freeList
+                    assert(sizeof(Slab) * SLABS_PER_HUGE_CHUNK == SLAB_HUGE_CHUNK);
+                    Slab* chunk = static_cast<Slab*>(gm_hugepage_alloc(SLAB_HUGE_CHUNK));
+                    for (uint32_t i = SLABS_PER_HUGE_CHUNK - 1; i > 0; i--) {
+                        chunk[i].init(this);
+                        freeList.push_back(&chunk[i]);
+                    }
+                    chunk[0].init(this);
+                    curSlab = &chunk[0];
+                    heapSlabs += SLABS_PER_HUGE_CHUNK;
+                } else {
+                    assert(sizeof(Slab) == SLAB_SIZE);
+                    curSlab = gm_memalign<Slab>(sizeof(Slab));
+                    curSlab->init(this);  // NOTE: Slab is POD
+                    heapSlabs++;
+                }
+                assert((((uintptr_t)curSlab) & SLAB_MASK) == (uintptr_t)curSlab);
+            } else {
                 curSlab = freeList.back();
                 freeList.pop_back();
                 assert(curSlab);
-            } else {
-                assert(sizeof(Slab) == SLAB_SIZE);
-                curSlab = gm_memalign<Slab>(sizeof(Slab));
-                assert((((uintptr_t)curSlab) & SLAB_MASK) == (uintptr_t)curSlab);
-                curSlab->init(this);  // NOTE: Slab is POD
             }
             liveSlabs++;
+            if (liveSlabs > peakLiveSlabs) peakLiveSlabs = liveSlabs;
+            allocTid = getTid();
+            freeLock.unlock();
             //info("allocated slab %p, %d live, %ld in freeList", curSlab, liveSlabs, freeList.size());
         }
 
         void freeSlab(Slab* s) {
-            scoped_mutex sm(freeLock);
+            pid_t tid = getTid();
+            lockFreeList();
             //info("freeing slab %p, %d live, %ld in freeList", s, liveSlabs, freeList.size());
             s->clear();
 #ifdef DEBUG_SLAB_ALLOC
@@ -145,7 +210,10 @@ class SlabAlloc {
                 freeList.push_back(s);
                 liveSlabs--;
             }
+            slabFrees++;
+            if (tid != allocTid) remoteFrees++;
             assert(liveSlabs);  // at least curSlab
+            freeLock.unlock();
         }
 
         friend struct Slab;
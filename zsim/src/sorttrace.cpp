@@ -23,41 +23,44 @@
  * this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
-/* Simple program to sort a trace. It reads in the trace sequntially until it
- * has seen at least one access from every thread, then dumps the sorted trace
- * out. This may consume large amounts of memory if traces are largely
- * imbalanced. A simple way to fix this would be to dump N separate traces,
- * then join them together --- that's more I/O though.
+/* Simple program to sort a trace. By default, it reads in the trace sequntially
+ * until it has seen at least one access from every thread, then dumps the
+ * sorted trace out. This may consume large amounts of memory if traces are
+ * largely imbalanced, and assumes each child's accesses are already in order.
+ *
+ * With -j or -m, it does a parallel external merge sort instead, which handles
+ * traces of any size and order: it reads chunks that fit the memory budget,
+ * sorts each chunk in parallel slices and writes every slice as a temporary
+ * Flat-format run, then merges the runs with a heap. Runs are merged at most
+ * MERGE_FAN_IN at a time, in as many passes as needed, so only that many runs
+ * are ever mapped at once. The sort is stable, so same-cycle records keep their
+ * trace order.
  */
 
+#include <algorithm>
 #include <deque>
 #include <queue>
 #include <stdio.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 #include "access_tracing.h"
+#include "bithacks.h"
 #include "galloc.h"
 
 using namespace std;
 
+#define MERGE_FAN_IN 64  // max runs open at once while merging
+
 void printProgress(uint64_t read, uint64_t written, uint64_t total) {
     printf("Read %3ld%% / Written %3ld%%\r", read*100/total, written*100/total);
     fflush(stdout);
 }
 
-int main(int argc, const char* argv[]) {
-    InitLog(""); //no log header
-    if (argc != 3) {
-        info("Sorts an access trace");
-        info("Usage: %s <input_trace> <output_trace>", argv[0]);
-        exit(1);
-    }
-
-    gm_init(32<<20 /*32 MB --- should be enough*/);
-
-    AccessTraceReader* tr = new AccessTraceReader(argv[1]);
+static void streamingSort(AccessTraceReader* tr, AccessTraceWriter* tw) {
     uint32_t numChildren = tr->getNumChildren();
-    AccessTraceWriter* tw = new AccessTraceWriter(argv[2], numChildren);
-
     deque<AccessRecord>* accs[numChildren];  // null if the child has no accesses
     for (uint32_t i = 0; i < numChildren; i++) accs[i] = nullptr;
     priority_queue< pair<int64_t, uint32_t> > heads; //(negative cycle, child); we use negative cycles because priority_queue sorts from largest to smallest
@@ -108,10 +111,161 @@ int main(int argc, const char* argv[]) {
     printf("\n");
     assert(readRecords == writtenRecords);
     assert(readRecords == totalRecords);
+}
+
+static string runName(const string& prefix, uint32_t run) {
+    return prefix + ".run" + to_string(run);
+}
+
+// Sorts chunk in numThreads slices in parallel, writing each slice as a run; needs numThreads <= chunk.size()
+static void sortChunk(vector<PackedAccessRecord>& chunk, uint32_t numThreads, uint32_t numChildren, const string& prefix, uint32_t firstRun) {
+    assert(numThreads <= chunk.size());
+    vector<thread> threads;
+    for (uint32_t t = 0; t < numThreads; t++) {
+        uint64_t start = chunk.size()*t/numThreads;
+        uint64_t end = chunk.size()*(t+1)/numThreads;
+        threads.push_back(thread([&, t, start, end]() {
+            stable_sort(chunk.begin() + start, chunk.begin() + end,
+                    [](const PackedAccessRecord& a, const PackedAccessRecord& b) { return a.reqCycle < b.reqCycle; });
+            AccessTraceWriter* rw = new AccessTraceWriter(runName(prefix, firstRun + t).c_str(), numChildren, TRACE_FLAT);
+            for (uint64_t i = start; i < end; i++) {
+                const PackedAccessRecord& pr = chunk[i];
+                AccessRecord acc = {pr.lineAddr, pr.reqCycle, pr.latency, pr.childId, (AccessType) pr.type};
+                rw->write(acc);
+            }
+            rw->dump(false);
+            delete rw;
+        }));
+    }
+    for (thread& th : threads) th.join();
+}
+
+// Merges runs [firstRun, endRun) into out and deletes them. Runs are in trace order, so breaking ties by run keeps the sort stable.
+// If readRecords is non-null, prints progress against totalRecords.
+static uint64_t mergeRuns(const string& prefix, uint32_t firstRun, uint32_t endRun, AccessTraceWriter* out, const uint64_t* readRecords, uint64_t totalRecords) {
+    uint32_t numRuns = endRun - firstRun;
+    assert(numRuns <= MERGE_FAN_IN);
+    vector<AccessTraceReader*> runs(numRuns);
+    vector<AccessRecord> heads(numRuns);
+    priority_queue< pair<int64_t, int64_t> > pq; //(negative cycle, negative run), see streamingSort
+    for (uint32_t r = 0; r < numRuns; r++) {
+        string fname = runName(prefix, firstRun + r);
+        runs[r] = new AccessTraceReader(fname);
+        unlink(fname.c_str());  // the mapping outlives the file
+        assert(!runs[r]->empty());
+        heads[r] = runs[r]->read();
+        pq.push(make_pair(-heads[r].reqCycle, -(int64_t)r));
+    }
+
+    uint64_t writtenRecords = 0;
+    while (!pq.empty()) {
+        uint32_t r = -pq.top().second;
+        pq.pop();
+        out->write(heads[r]);
+        writtenRecords++;
+        if (readRecords && (writtenRecords % (1024*1024)) == 0) printProgress(*readRecords, writtenRecords, totalRecords);
+        if (runs[r]->empty()) {
+            delete runs[r];
+            runs[r] = nullptr;
+        } else {
+            heads[r] = runs[r]->read();
+            pq.push(make_pair(-heads[r].reqCycle, -(int64_t)r));
+        }
+    }
+    return writtenRecords;
+}
+
+static void externalSort(AccessTraceReader* tr, AccessTraceWriter* tw, uint32_t numThreads, uint64_t memBytes, const string& prefix) {
+    uint32_t numChildren = tr->getNumChildren();
+    uint64_t totalRecords = tr->getNumRecords();
+    // stable_sort needs as much scratch space as the slice it sorts, so chunks take half the budget
+    uint64_t chunkRecords = MAX(memBytes/(2*sizeof(PackedAccessRecord)), (uint64_t)numThreads);
+    info("Sorting %ld records, %d threads, chunks of %ld records", totalRecords, numThreads, chunkRecords);
+
+    // Phase 1: sorted runs
+    uint32_t numRuns = 0;
+    uint64_t readRecords = 0;
+    vector<PackedAccessRecord> chunk;
+    chunk.reserve(MIN(chunkRecords, totalRecords));
+    while (!tr->empty()) {
+        chunk.clear();
+        while (!tr->empty() && chunk.size() < chunkRecords) {
+            AccessRecord acc = tr->read();
+            chunk.push_back({acc.lineAddr, acc.reqCycle, acc.latency, (uint16_t) acc.childId, (uint16_t) acc.type});
+        }
+        readRecords += chunk.size();
+        printProgress(readRecords, 0, totalRecords);
+        uint32_t chunkRuns = MIN((uint64_t)numThreads, chunk.size());
+        sortChunk(chunk, chunkRuns, numChildren, prefix, numRuns);
+        numRuns += chunkRuns;
+    }
+    vector<PackedAccessRecord>().swap(chunk);  // free the chunk before merging
+    assert(readRecords == totalRecords);
+
+    // Phase 2: merge passes of up to MERGE_FAN_IN consecutive runs each, until one pass can write the output
+    uint32_t firstRun = 0;
+    uint32_t pass = 0;
+    while (numRuns - firstRun > MERGE_FAN_IN) {
+        uint32_t passEnd = numRuns;
+        info("Merge pass %d: %d runs", pass++, passEnd - firstRun);
+        for (uint32_t r = firstRun; r < passEnd; r += MERGE_FAN_IN) {
+            AccessTraceWriter* rw = new AccessTraceWriter(runName(prefix, numRuns).c_str(), numChildren, TRACE_FLAT);
+            mergeRuns(prefix, r, MIN(r + MERGE_FAN_IN, passEnd), rw, nullptr, 0);
+            rw->dump(false);
+            delete rw;
+            numRuns++;
+        }
+        firstRun = passEnd;
+    }
+
+    uint64_t writtenRecords = mergeRuns(prefix, firstRun, numRuns, tw, &readRecords, totalRecords);
+    printProgress(readRecords, writtenRecords, totalRecords);
+    printf("\n");
+    assert(writtenRecords == totalRecords);
+}
+
+static void usage(const char* prog) {
+    info("Sorts an access trace");
+    info("Usage: %s [-j <threads>] [-m <MB>] [-t <tmp_prefix>] <input_trace> <output_trace> [HDF5|Flat|FlatZ (default: input format)]", prog);
+    info("  -j, -m: external merge sort with this many threads (default: all cores) and memory budget (default: 1024 MB)");
+    info("  -t: prefix of the temporary runs (default: output_trace)");
+    exit(1);
+}
+
+int main(int argc, char* argv[]) {
+    InitLog(""); //no log header
+
+    bool external = false;
+    uint32_t numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    uint64_t memMBytes = 1024;
+    const char* tmpPrefix = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:m:t:")) != -1) {
+        switch (opt) {
+            case 'j': numThreads = atoi(optarg); external = true; break;
+            case 'm': memMBytes = atol(optarg); external = true; break;
+            case 't': tmpPrefix = optarg; break;
+            default: usage(argv[0]);
+        }
+    }
+    int nargs = argc - optind;
+    if (nargs != 2 && nargs != 3) usage(argv[0]);
+    if (!numThreads || !memMBytes) usage(argv[0]);
+    const char* inFile = argv[optind];
+    const char* outFile = argv[optind + 1];
+
+    gm_init(64<<20 /*64 MB --- should be enough, even with a run writer per thread*/);
+
+    AccessTraceReader* tr = new AccessTraceReader(inFile);
+    uint32_t numChildren = tr->getNumChildren();
+    TraceFormat outFormat = (nargs == 3)? ParseTraceFormat(argv[optind + 2]) : tr->getFormat();
+    AccessTraceWriter* tw = new AccessTraceWriter(outFile, numChildren, outFormat);
+
+    if (external) externalSort(tr, tw, numThreads, memMBytes << 20, tmpPrefix? tmpPrefix : outFile);
+    else streamingSort(tr, tw);
 
     delete tr;
     tw->dump(false); //flushes it
     delete tw;
     return 0;
 }
-
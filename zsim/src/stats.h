@@ -410,8 +410,11 @@ class HDF5Backend : public StatsBackend {
         HDF5BackendImpl* backend;
 
     public:
-        HDF5Backend(const char* filename, AggregateStat* rootStat, size_t bytesPerWrite, bool skipVectors, bool sumRegularAggregates);
+        HDF5Backend(const char* filename, AggregateStat* rootStat, size_t bytesPerWrite, bool skipVectors, bool sumRegularAggregates, bool async = false);
         virtual void dump(bool buffered);
 };
 
+// Writes out and closes the files of asynchronous HDF5 backends; call after the final dumps
+void CloseAsyncHDF5Stats();
+
 #endif  // STATS_H_
@@ -52,15 +52,27 @@ class TickEvent : public TimingEvent, public GlobAlloc { //this one should be al
             zinfo->contentionSim->enqueueSynced(this, startCycle);
         }
 
+        // If obj->tick() returns 0, the event parks itself until obj calls wake()
         void simulate(uint64_t startCycle) {
             uint32_t delay = obj->tick(startCycle);
             if (delay) {
                 requeue(startCycle+delay);
             } else {
                 active = false;
+                hold();
             }
         }
 
+        // Re-arms a parked event; must be called from obj's domain in the weave phase
+        void wake(uint64_t cycle) {
+            if (active) return;
+            active = true;
+            release();
+            requeue(cycle);
+        }
+
+        bool isActive() const { return active; }
+
         using GlobAlloc::operator new; //grrrrrrrrr
         using GlobAlloc::operator delete;
 };
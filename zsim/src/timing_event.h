@@ -69,7 +69,6 @@ class TimingEvent {
         uint64_t privCycle; //only touched by ContentionSim
 
     public:
-        g_string name;
         TimingEvent* next; //used by PrioQueue --- PRIVATE
     private:
         EventState state;
@@ -261,7 +260,7 @@ class TimingEvent {
         virtual std::string str() { std::string res; return res; }
 
         friend std::ostream& operator<<(std::ostream& os, const TimingEvent& te){
-            os << "{ privCycle = " << te.privCycle << ", name = " << te.name << ", next = " << te.next <<
+            os << "{ privCycle = " << te.privCycle << ", type = " << typeid(te).name() << ", next = " << te.next <<
             ", addr = " << te.addr << ", state = " << te.state << ", cycle = " << te.cycle << 
             ", minStartCycle = " << te.minStartCycle << " { child = " << te.child << 
             ", children = " << te.children << " } , domain = " << te.domain << ", numChildren = " << te.numChildren <<
@@ -342,6 +341,7 @@ class TimingEvent {
     friend class ContentionSim;
     friend class DelayEvent; //DelayEvent is, for now, the only child of TimingEvent that should do anything other than implement simulate
     friend class CrossingEvent;
+    template <typename T> friend class CalendarQueue; //uses privCycle to cascade
 };
 
 class DelayEvent : public TimingEvent {
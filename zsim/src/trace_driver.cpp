@@ -23,17 +23,26 @@
  * this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <sched.h>
 #include <sstream>
 #include "trace_driver.h"
 #include "zsim.h"
 
-TraceDriver::TraceDriver(std::string filename, std::string retraceFilename, std::vector<TraceDriverProxyCache*>& proxies, bool _useSkews, bool _playPuts, bool _playAllGets)
-    : tr(filename), numChildren(proxies.size()), useSkews(_useSkews), playPuts(_playPuts), playAllGets(_playAllGets)
+TraceDriver::TraceDriver(std::string filename, std::string retraceFilename, TraceFormat retraceFormat, std::vector<TraceDriverProxyCache*>& proxies, bool _useSkews, bool _playPuts, bool _playAllGets, uint32_t _numThreads)
+    : tr(filename, &zinfo->hdf5Lock), filename(filename), numChildren(proxies.size()), useSkews(_useSkews), playPuts(_playPuts), playAllGets(_playAllGets)
 {
     assert(numChildren > 0);
-    assert(!useSkews || numChildren == 1);
+    numThreads = MIN(_numThreads, numChildren);
+    assert(numThreads > 0);
+    if (useSkews && numThreads != numChildren) panic("useSkews needs a single child, or one thread per child (%d children, %d threads)", numChildren, numThreads);
     if (tr.getNumChildren() != numChildren) panic("Number of proxy caches (%d) does not match with streams in the trace file (%d)", numChildren, tr.getNumChildren());
     children = new ChildInfo[numChildren];
+    for (uint32_t c = 0; c < numChildren; c++) {
+        children[c].skew = 0;
+        children[c].lastReqCycle = 0;
+        children[c].reqLineAddr = -1L;
+        futex_init(&children[c].lock);
+    }
     futex_init(&lock);
     lastAcc.childId = -1;
     parent = proxies[0]->getParent();
@@ -41,11 +50,35 @@ TraceDriver::TraceDriver(std::string filename, std::string retraceFilename, std:
 
     if (retraceFilename != "") { //we're doing retracing with the new skews
         g_string fname(retraceFilename.c_str());
-        atw = new AccessTraceWriter(fname, numChildren);
+        //Flat retraces get a buffer per worker; HDF5 ones are written under lock
+        uint32_t numBufs = (retraceFormat == TRACE_HDF5)? 1 : numThreads;
+        atw = new AccessTraceWriter(fname, numChildren, retraceFormat, numBufs, &zinfo->hdf5Lock);
         zinfo->traceWriters->push_back(atw);
     } else {
         atw = nullptr;
     }
+
+    if (numThreads > 1) {
+        workers = new WorkerInfo[numThreads];
+        liveWorkers = numThreads;
+        joinedWorkers = 0;
+        for (uint32_t w = 0; w < numThreads; w++) {
+            workers[w].tr = new AccessTraceReader(filename, &zinfo->hdf5Lock);
+            workers[w].done = !readNextAccess(w);
+            if (workers[w].done) liveWorkers--;
+        }
+        barrier = new Barrier(numThreads, this);
+        futex_init(&barrierLock);
+        futex_init(&phaseDoneLock);
+        futex_init(&phaseStartLock);
+        futex_lock(&phaseDoneLock);
+        futex_lock(&phaseStartLock);
+        firstPhase = true;
+        info("Trace driver replaying %d children with %d threads", numChildren, numThreads);
+    } else {
+        workers = nullptr;
+        barrier = nullptr;
+    }
 }
 
 void TraceDriver::initStats(AggregateStat* parentStat) {
@@ -76,26 +109,37 @@ void TraceDriver::setParent(MemObject* _parent) {
 
 uint64_t TraceDriver::invalidate(uint32_t childId, Address lineAddr, InvType type, bool* reqWriteback, uint64_t reqCycle, uint32_t srcId) {
     assert(childId < numChildren);
-    std::unordered_map<Address, MESIState>& cStore = children[childId].cStore;
-    std::unordered_map<Address, MESIState>::iterator it = cStore.find(lineAddr);
-    assert((it != cStore.end()));
-    *reqWriteback = (it->second == M);
+    ChildInfo& child = children[childId];
+    if (numThreads > 1) futex_lock(&child.lock);
+    MESIState* state = child.cStore.find(lineAddr);
+    assert(state);
+    *reqWriteback = (*state == M);
+    if (child.reqLineAddr == lineAddr) child.reqState = (type == INVX)? S : I;
     if (type == INVX) {
-        it->second = S;
-        children[childId].profInvx.inc();
+        *state = S;
+        child.profInvx.inc();
     } else {
-        cStore.erase(it);
+        child.cStore.erase(lineAddr);
         if (srcId == childId) {
-            children[childId].profSelfInv.inc();
+            child.profSelfInv.inc();
         } else {
-            children[childId].profCrossInv.inc();
+            child.profCrossInv.inc();
         }
     }
+    if (numThreads > 1) futex_unlock(&child.lock);
     return 0;
 }
 
 //Returns false if done, true otherwise
 bool TraceDriver::executePhase() {
+    if (numThreads > 1) {
+        //Let the workers run this phase, and wait until they all finish it
+        if (!firstPhase) futex_unlock(&phaseStartLock);
+        firstPhase = false;
+        futex_lock(&phaseDoneLock);
+        return liveWorkers > 0;
+    }
+
     uint64_t limit = zinfo->globPhaseCycles + zinfo->phaseLength;
 
     //Load valid access
@@ -111,7 +155,7 @@ bool TraceDriver::executePhase() {
 
     //Run until we reach the cycle limit or run out of phases
     while (acc.reqCycle < limit) {
-        executeAccess(acc);
+        executeAccess(acc, 0);
         if (tr.empty()) return false;
         acc = tr.read();
         if (useSkews) acc.reqCycle += children[acc.childId].skew;
@@ -121,62 +165,133 @@ bool TraceDriver::executePhase() {
     return true;
 }
 
-void TraceDriver::executeAccess(AccessRecord acc) {
+void TraceDriver::workerLoop(uint32_t w) {
+    assert(numThreads > 1 && w < numThreads);
+    futex_lock(&barrierLock);
+    joinedWorkers++;
+    barrier->join(w, &barrierLock);
+    while (joinedWorkers < numThreads) sched_yield(); //don't let the first phase end before every worker has joined
+
+    while (true) {
+        replayPhase(w, zinfo->globPhaseCycles + zinfo->phaseLength);
+        futex_lock(&barrierLock);
+        barrier->sync(w, &barrierLock);
+    }
+}
+
+//Called with barrierLock held, must not release it
+void TraceDriver::callback() {
+    futex_unlock(&phaseDoneLock); //wake up the main thread...
+    futex_lock(&phaseStartLock); //...and wait for it to finish the end-of-phase actions
+}
+
+void TraceDriver::replayPhase(uint32_t w, uint64_t limit) {
+    WorkerInfo& wi = workers[w];
+    if (wi.done) return;
+    while (wi.nextAcc.reqCycle < limit) {
+        executeAccess(wi.nextAcc, w);
+        if (!readNextAccess(w)) {
+            wi.done = true;
+            __sync_fetch_and_sub(&liveWorkers, 1);
+            return;
+        }
+    }
+}
+
+//Reads the next access of one of this worker's children, returns false if there are none left
+bool TraceDriver::readNextAccess(uint32_t w) {
+    WorkerInfo& wi = workers[w];
+    while (!wi.tr->empty()) {
+        AccessRecord acc = wi.tr->read();
+        if (acc.childId % numThreads != w) continue;
+        if (useSkews) acc.reqCycle += children[acc.childId].skew;
+        wi.nextAcc = acc;
+        return true;
+    }
+    return false;
+}
+
+void TraceDriver::executeAccess(AccessRecord acc, uint32_t w) {
     assert(acc.childId < numChildren);
-    std::unordered_map<Address, MESIState>& cStore = children[acc.childId].cStore;
+    ChildInfo& child = children[acc.childId];
+    LineStateTable& cStore = child.cStore;
+    lock_t* childLock = (numThreads > 1)? &child.lock : nullptr;
+    if (childLock) futex_lock(childLock);
 
+    //NOTE: Parent accesses can invalidate lines of this child, which moves entries in cStore, so we never pass pointers
+    //into it; requests use the child's in-flight slot, and the parent re-locks childLock before returning
+    MESIState& state = child.reqState;
+    child.reqLineAddr = acc.lineAddr;
     int64_t lat = 0;
     switch (acc.type) {
         case PUTS:
         case PUTX:
             {
-                if (!playPuts) return;
-                std::unordered_map<Address, MESIState>::iterator it = cStore.find(acc.lineAddr);
-                if (it == cStore.end()) return; //we don't currently have this line, skip
-                MemReq req = {acc.lineAddr, acc.type, acc.childId, &it->second, acc.reqCycle, nullptr, it->second, acc.childId};
+                MESIState* it = playPuts? cStore.find(acc.lineAddr) : nullptr;
+                if (!it) { //not playing PUTs, or we don't currently have this line, skip
+                    child.reqLineAddr = -1L;
+                    if (childLock) futex_unlock(childLock);
+                    return;
+                }
+                state = *it;
+                MemReq req = {acc.lineAddr, acc.type, acc.childId, &state, acc.reqCycle, childLock, state, acc.childId};
                 lat = parent->access(req) - acc.reqCycle; //note that PUT latency does not affect driver latency
-                assert(it->second == I);
-                cStore.erase(it);
+                assert(state == I);
+                cStore.erase(acc.lineAddr); //may be gone already, if the PUT raced with an invalidation
             }
             break;
         case GETS:
         case GETX:
             {
-                std::unordered_map<Address, MESIState>::iterator it = cStore.find(acc.lineAddr);
-                MESIState state = I;
-                if (it != cStore.end()) {
-                    if (!((it->second == S) && (acc.type == GETX))) { //we have the line, and it's not an upgrade miss, we can't replay this access directly
+                MESIState* it = cStore.find(acc.lineAddr);
+                state = I;
+                if (it) {
+                    if (!((*it == S) && (acc.type == GETX))) { //we have the line, and it's not an upgrade miss, we can't replay this access directly
                         if (playAllGets) { //issue a PUT
-                            MemReq req = {acc.lineAddr, (it->second == M)? PUTX : PUTS, acc.childId, &it->second, acc.reqCycle, nullptr, it->second, acc.childId};
+                            state = *it;
+                            MemReq req = {acc.lineAddr, (state == M)? PUTX : PUTS, acc.childId, &state, acc.reqCycle, childLock, state, acc.childId};
                             parent->access(req);
-                            assert(it->second == I);
+                            assert(state == I);
+                            cStore.erase(acc.lineAddr);
                         } else {
+                            child.reqLineAddr = -1L;
+                            if (childLock) futex_unlock(childLock);
                             return; //skip
                         }
                     } else {
-                        state = it->second;
+                        state = *it;
                     }
                 }
-                MemReq req = {acc.lineAddr, acc.type, acc.childId, &state, acc.reqCycle, nullptr, state, acc.childId};
+                MemReq req = {acc.lineAddr, acc.type, acc.childId, &state, acc.reqCycle, childLock, state, acc.childId};
                 uint64_t respCycle = parent->access(req);
                 lat = respCycle - acc.reqCycle;
-                children[acc.childId].profLat.inc(lat);
-                children[acc.childId].skew += ((int64_t)lat - acc.latency);
+                child.profLat.inc(lat);
+                child.skew += ((int64_t)lat - acc.latency);
                 assert(state != I);
-                cStore[acc.lineAddr] = state;
+                cStore.set(acc.lineAddr, state);
             }
             break;
         default:
             panic("Unknown access type %d, trace is probably corrupted", acc.type);
     }
 
-    children[acc.childId].lastReqCycle = acc.reqCycle;
+    child.reqLineAddr = -1L;
+    child.lastReqCycle = acc.reqCycle;
+    if (childLock) futex_unlock(childLock);
+
     if (atw) {
         AccessRecord wAcc = acc;
         // We always want the outout trace to be skewed regardless... otherwise it does not make sense to produce an output trace
-        if (!useSkews) wAcc.reqCycle += children[acc.childId].skew;
+        if (!useSkews) wAcc.reqCycle += child.skew;
         wAcc.latency = lat;
-        atw->write(wAcc);
+        if (atw->getNumBuffers() > 1) {
+            atw->write(wAcc, w);
+        } else if (numThreads > 1) {
+            futex_lock(&lock);
+            atw->write(wAcc);
+            futex_unlock(&lock);
+        } else {
+            atw->write(wAcc);
+        }
     }
 }
-
@@ -26,20 +26,123 @@
 #ifndef __TRACE_DRIVER_H__
 #define __TRACE_DRIVER_H__
 
-#include <unordered_map>
 #include <vector>
 #include "access_tracing.h"
+#include "barrier.h"
+#include "bithacks.h"
 #include "g_std/g_string.h"
 #include "stats.h"
 
-/* Basic class for trace-driven simulation. Shares the cache interface (invalidate), but it is not a cache in any sense --- it just reads in a single trace and replays it */
+/* Compact open-addressing map from line address to MESI state, used to track
+ * the lines each child holds. Linear probing on a power-of-2 flat array with
+ * backward-shift deletion (no tombstones), so lookups touch one or two cache
+ * lines and there are no per-line allocations. Grows at 50% occupancy.
+ * Pointers returned by find() are invalidated by set() and erase().
+ */
+class LineStateTable {
+    private:
+        struct Entry {
+            Address lineAddr;
+            MESIState state;
+        };
+
+        static const Address EMPTY = (Address)-1L;
+
+        Entry* entries;
+        uint32_t shift;  // 64 - log2(capacity)
+        uint64_t mask;
+        uint64_t elems;
+
+        inline uint64_t home(Address lineAddr) const { return (lineAddr * 0x9E3779B97F4A7C15UL) >> shift; }
+
+    public:
+        LineStateTable() : entries(nullptr), elems(0) { alloc(1024); }
+        ~LineStateTable() { delete[] entries; }
+
+        inline MESIState* find(Address lineAddr) {
+            for (uint64_t pos = home(lineAddr); ; pos = (pos + 1) & mask) {
+                if (entries[pos].lineAddr == lineAddr) return &entries[pos].state;
+                if (entries[pos].lineAddr == EMPTY) return nullptr;
+            }
+        }
+
+        inline void set(Address lineAddr, MESIState state) {
+            assert(lineAddr != EMPTY);
+            uint64_t pos = home(lineAddr);
+            while (entries[pos].lineAddr != lineAddr && entries[pos].lineAddr != EMPTY) pos = (pos + 1) & mask;
+            entries[pos].state = state;
+            if (entries[pos].lineAddr == EMPTY) {
+                entries[pos].lineAddr = lineAddr;
+                if (++elems*2 > mask + 1) grow();
+            }
+        }
+
+        inline bool erase(Address lineAddr) {
+            uint64_t pos = home(lineAddr);
+            while (entries[pos].lineAddr != lineAddr) {
+                if (entries[pos].lineAddr == EMPTY) return false;
+                pos = (pos + 1) & mask;
+            }
+            // Shift back later entries of the probe sequence that would become unreachable
+            uint64_t hole = pos;
+            for (uint64_t next = (hole + 1) & mask; entries[next].lineAddr != EMPTY; next = (next + 1) & mask) {
+                uint64_t h = home(entries[next].lineAddr);
+                if (((next - h) & mask) >= ((next - hole) & mask)) {
+                    entries[hole] = entries[next];
+                    hole = next;
+                }
+            }
+            entries[hole].lineAddr = EMPTY;
+            elems--;
+            return true;
+        }
+
+        uint64_t size() const { return elems; }
+
+    private:
+        void alloc(uint64_t capacity) {
+            entries = new Entry[capacity];
+            for (uint64_t i = 0; i < capacity; i++) entries[i].lineAddr = EMPTY;
+            mask = capacity - 1;
+            shift = 64 - ilog2(capacity);
+        }
+
+        void grow() {
+            Entry* old = entries;
+            uint64_t oldCapacity = mask + 1;
+            alloc(2*oldCapacity);
+            elems = 0;
+            for (uint64_t i = 0; i < oldCapacity; i++) {
+                if (old[i].lineAddr != EMPTY) set(old[i].lineAddr, old[i].state);
+            }
+            delete[] old;
+        }
+};
+
+/* Basic class for trace-driven simulation. Shares the cache interface (invalidate), but it is not a cache in any sense --- it just reads in a single trace and replays it.
+ *
+ * By default, the main thread replays the whole trace serially. With several
+ * threads, children are striped across worker threads, each of which reads the
+ * trace on its own (skipping other workers' children) and replays its
+ * children's accesses concurrently in the bound phase. Workers synchronize
+ * at the end of each phase through a Barrier, whose callback hands control to
+ * the main thread for the end-of-phase actions. As with cores, each child has
+ * a lock that the parent releases while it handles the child's access, so
+ * invalidations from other workers' accesses can reach the child.
+ */
 
 class TraceDriverProxyCache;
 
-class TraceDriver {
+class TraceDriver : public Callee {
     private:
         struct ChildInfo {
-            std::unordered_map<Address, MESIState> cStore; //holds current sets of lines for each child. Needs to support an arbitrary set, hence the hash table
+            LineStateTable cStore; //holds current sets of lines for each child
+            lock_t lock; //only used with several threads
+            //State of the line of the access in flight (reqLineAddr, -1 if none). The parent releases lock while it
+            //handles the access, and cStore entries can move, so requests point here instead; like a cache's
+            //array entry, invalidate() keeps it current under lock, which lets the parent see races
+            Address reqLineAddr;
+            MESIState reqState;
             int64_t skew;
             uint64_t lastReqCycle;
             //Counter bypassedGETS;
@@ -50,11 +153,18 @@ class TraceDriver {
             Counter profInvx;
         };
 
+        struct WorkerInfo {
+            AccessTraceReader* tr;
+            AccessRecord nextAcc; //valid unless done
+            bool done;
+        };
+
         ChildInfo* children;
-        lock_t lock; //NOTE: not needed for now
+        lock_t lock; //serializes HDF5 retrace writes with several threads
         AccessTraceReader tr;
+        std::string filename;
         uint32_t numChildren;
-        bool useSkews; //If false, replays the trace using its request cycles. If true, it skews the simulated child. Can only be true with a single child.
+        bool useSkews; //If false, replays the trace using its request cycles. If true, it skews the simulated child. Can only be true with a single child, or with one thread per child.
         bool playPuts; //If true, issues PUTS/PUTX requests as they appear in the trace. If false, it just issues the GETS/X requests, leaving it up to the parent to decide when to evict something (NOTE: if the parent is running OPT, it knows better!)
         bool playAllGets; //If true, if we have a get to an address that we already have, issue a put immediately before.
         MemObject* parent;
@@ -64,18 +174,39 @@ class TraceDriver {
         //Last access, childId == -1 if invalid, acts as 1-elem buffer
         AccessRecord lastAcc;
 
+        //Parallel replay
+        uint32_t numThreads;
+        WorkerInfo* workers;
+        Barrier* barrier;
+        lock_t barrierLock; //plays the role of the scheduler lock for the barrier
+        lock_t phaseDoneLock; //unlocked by the barrier callback when all workers finish the phase
+        lock_t phaseStartLock; //unlocked by the main thread after the end-of-phase actions
+        volatile uint32_t liveWorkers; //workers with accesses left
+        volatile uint32_t joinedWorkers;
+        bool firstPhase;
+
     public:
-        TraceDriver(std::string filename, std::string retracefile, std::vector<TraceDriverProxyCache*>& proxies, bool _useSkews, bool _playPuts, bool _playAllGets);
+        TraceDriver(std::string filename, std::string retracefile, TraceFormat retraceFormat, std::vector<TraceDriverProxyCache*>& proxies, bool _useSkews, bool _playPuts, bool _playAllGets, uint32_t _numThreads);
         void initStats(AggregateStat* parentStat);
         void setParent(MemObject* _parent);
 
         uint64_t invalidate(uint32_t childId, Address lineAddr, InvType type, bool* reqWriteback, uint64_t reqCycle, uint32_t srcId);
 
-        //Returns false if done, true otherwise
+        //Returns false if done, true otherwise. Called by the main thread
         bool executePhase();
 
+        //With several threads, the caller spawns getNumThreads() threads that run workerLoop(0..numThreads-1)
+        uint32_t getNumThreads() const {return numThreads;}
+        uint64_t getNumLines(uint32_t childId) const {return children[childId].cStore.size();}
+        void workerLoop(uint32_t w);
+
+        //Barrier callback, runs on the last worker to finish the phase
+        void callback();
+
     private:
-        inline void executeAccess(AccessRecord acc);
+        inline void executeAccess(AccessRecord acc, uint32_t w);
+        void replayPhase(uint32_t w, uint64_t limit);
+        bool readNextAccess(uint32_t w);
 };
 
 
@@ -0,0 +1,271 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* TraceDriver checks. First, fuzzes LineStateTable against unordered_map and
+ * reports how long each one took. Then replays a random trace through the
+ * TraceDriver with 1, 2, 4 and 8 threads on top of a mock directory that
+ * follows the childLock protocol of MESICC (and widens the window where the
+ * child's lock is released), panicking on any request that does not match
+ * the directory's view of the child, and checks the final line states.
+ */
+
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#include "access_tracing.h"
+#include "coherence_ctrls.h"
+#include "galloc.h"
+#include "locks.h"
+#include "log.h"
+#include "trace_driver.h"
+#include "zsim.h"
+
+GlobSimInfo* zinfo;
+
+static uint64_t getNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000000000L + ts.tv_nsec;
+}
+
+static void fuzzLineStateTable(uint64_t ops, uint64_t keys) {
+    LineStateTable lst;
+    std::unordered_map<Address, MESIState> ref;
+    std::vector<uint32_t> rnd(ops);
+    srand(42);
+    for (uint64_t i = 0; i < ops; i++) rnd[i] = rand();
+
+    uint64_t start = getNs();
+    for (uint64_t i = 0; i < ops; i++) {
+        Address lineAddr = (rnd[i] >> 4) % keys;
+        switch (rnd[i] & 3) {
+            case 0:
+            case 1:
+                {
+                    MESIState* s = lst.find(lineAddr);
+                    auto it = ref.find(lineAddr);
+                    if ((s == nullptr) != (it == ref.end()) || (s && *s != it->second)) panic("find(0x%lx) mismatch at op %ld", lineAddr, i);
+                }
+                break;
+            case 2:
+                lst.set(lineAddr, (MESIState)(1 + (rnd[i] >> 2) % 3));
+                ref[lineAddr] = (MESIState)(1 + (rnd[i] >> 2) % 3);
+                break;
+            default:
+                if (lst.erase(lineAddr) != (ref.erase(lineAddr) == 1)) panic("erase(0x%lx) mismatch at op %ld", lineAddr, i);
+        }
+        if (lst.size() != ref.size()) panic("size mismatch at op %ld: %ld vs %ld", i, lst.size(), ref.size());
+    }
+    uint64_t bothNs = getNs() - start;
+
+    //Time each one alone on the same operations
+    start = getNs();
+    uint64_t found = 0;
+    for (uint64_t i = 0; i < ops; i++) {
+        Address lineAddr = (rnd[i] >> 4) % keys;
+        if ((rnd[i] & 3) < 2) found += lst.find(lineAddr) != nullptr;
+        else if ((rnd[i] & 3) == 2) lst.set(lineAddr, S);
+        else lst.erase(lineAddr);
+    }
+    uint64_t lstNs = getNs() - start;
+    start = getNs();
+    for (uint64_t i = 0; i < ops; i++) {
+        Address lineAddr = (rnd[i] >> 4) % keys;
+        if ((rnd[i] & 3) < 2) found -= ref.find(lineAddr) != ref.end();
+        else if ((rnd[i] & 3) == 2) ref[lineAddr] = S;
+        else ref.erase(lineAddr);
+    }
+    uint64_t refNs = getNs() - start;
+    if (found) panic("LineStateTable and unordered_map disagree on lookups");
+    info("LineStateTable matches unordered_map over %ld ops on %ld lines (%.1f s); %.2f vs %.2f ns/op",
+            ops, keys, bothNs/1e9, ((double)lstNs)/ops, ((double)refNs)/ops);
+}
+
+/* Directory with the same locking as MESICC: the child's lock is released
+ * while the request waits for the directory, and re-acquired before returning.
+ * Invalidations reach other children through their proxies while the
+ * directory lock is held.
+ */
+class MockDirectory : public MemObject {
+    private:
+        struct DirEntry {
+            uint64_t sharers;
+            bool exclusive;
+        };
+        std::unordered_map<Address, DirEntry> dir;
+        std::vector<TraceDriverProxyCache*> proxies;
+        lock_t dirLock;
+
+    public:
+        uint64_t races;
+
+        explicit MockDirectory(std::vector<TraceDriverProxyCache*>& _proxies) : proxies(_proxies), races(0) {
+            futex_init(&dirLock);
+        }
+
+        const char* getName() {return "mockdir";}
+        void setParents(uint32_t childId, const g_vector<MemObject*>& parents, zsimNetwork* network) {}
+        void setCoord(const coordinates<int> coord) {}
+        coordinates<int> getCoord() {return coordinates<int>();}
+        coordinates<int> getCoord(MemReq& req) {return coordinates<int>();}
+
+        uint64_t access(MemReq& req) {
+            if (req.childLock) {
+                futex_unlock(req.childLock);
+                sched_yield(); //let other workers invalidate this child meanwhile
+            }
+            futex_lock(&dirLock);
+            if (*req.state != req.initialState) races++;
+            bool skip = CheckForMESIRace(req.type, req.state, req.initialState);
+            uint64_t bit = 1UL << req.childId;
+            DirEntry& e = dir[req.lineAddr];
+            if (!skip) {
+                switch (req.type) {
+                    case PUTS:
+                    case PUTX:
+                        if (!(e.sharers & bit)) panic("PUT for 0x%lx from child %d, which is not a sharer", req.lineAddr, req.childId);
+                        e.sharers &= ~bit;
+                        e.exclusive = false;
+                        *req.state = I;
+                        break;
+                    case GETS:
+                        if (e.sharers & bit) panic("GETS for 0x%lx from child %d, which already is a sharer", req.lineAddr, req.childId);
+                        if (e.exclusive) invalidateSharers(req, e, INVX);
+                        e.exclusive = !e.sharers;
+                        e.sharers |= bit;
+                        *req.state = e.exclusive? E : S;
+                        break;
+                    case GETX:
+                        if ((*req.state == S) != ((e.sharers & bit) != 0)) {
+                            panic("GETX for 0x%lx from child %d in %s, directory has it as %s", req.lineAddr, req.childId,
+                                    MESIStateName(*req.state), (e.sharers & bit)? "sharer" : "non-sharer");
+                        }
+                        invalidateSharers(req, e, INV);
+                        e.sharers = bit;
+                        e.exclusive = true;
+                        *req.state = M;
+                        break;
+                    default:
+                        panic("Unexpected access type %d", req.type);
+                }
+            }
+            futex_unlock(&dirLock);
+            if (req.childLock) futex_lock(req.childLock);
+            return req.cycle + 10;
+        }
+
+        //Checks that the driver holds exactly the lines the directory has it as a sharer of, leaving everything invalid
+        void drain(TraceDriver* drv) {
+            for (auto& de : dir) {
+                for (uint32_t c = 0; c < proxies.size(); c++) {
+                    if (!(de.second.sharers & (1UL << c))) continue;
+                    bool wb = false;
+                    InvReq inv = {de.first, INV, &wb, 0, c, false, 0};
+                    proxies[c]->invalidate(inv);
+                }
+                de.second.sharers = 0;
+            }
+            for (uint32_t c = 0; c < proxies.size(); c++) {
+                if (drv->getNumLines(c)) panic("Child %d holds %ld lines the directory does not know about", c, drv->getNumLines(c));
+            }
+        }
+
+    private:
+        void invalidateSharers(const MemReq& req, DirEntry& e, InvType type) {
+            for (uint32_t c = 0; c < proxies.size(); c++) {
+                if (c == req.childId || !(e.sharers & (1UL << c))) continue;
+                bool wb = false;
+                InvReq inv = {req.lineAddr, type, &wb, req.cycle, req.childId, false, 0};
+                proxies[c]->invalidate(inv);
+                if (type == INV) e.sharers &= ~(1UL << c);
+            }
+        }
+};
+
+static void replay(const char* traceFile, uint32_t numChildren, uint32_t numThreads) {
+    std::vector<TraceDriverProxyCache*> proxies;
+    for (uint32_t c = 0; c < numChildren; c++) {
+        g_string name(("child-" + std::to_string(c)).c_str());
+        proxies.push_back(new TraceDriverProxyCache(name));
+    }
+    MockDirectory* dir = new MockDirectory(proxies);
+    g_vector<MemObject*> parents(1, dir);
+    for (uint32_t c = 0; c < numChildren; c++) proxies[c]->setParents(c, parents, nullptr);
+
+    zinfo->globPhaseCycles = 0;
+    TraceDriver* drv = new TraceDriver(traceFile, "", TRACE_HDF5, proxies, false, true, true, numThreads);
+    drv->setParent(dir);
+    for (uint32_t w = 0; w < drv->getNumThreads() && drv->getNumThreads() > 1; w++) {
+        std::thread(&TraceDriver::workerLoop, drv, w).detach(); //workers are parked on the barrier once the trace ends
+    }
+
+    uint64_t start = getNs();
+    while (drv->executePhase()) zinfo->globPhaseCycles += zinfo->phaseLength;
+    uint64_t ns = getNs() - start;
+
+    dir->drain(drv);
+    info("%d threads: replayed in %.2f s, %ld races with invalidations, final states match the directory", numThreads, ns/1e9, dir->races);
+}
+
+int main(int argc, char *argv[]) {
+    InitLog("[B] ");
+    if (argc > 3) {
+        info("Usage: %s [<accesses> [<lines>]]", argv[0]);
+        exit(1);
+    }
+    uint64_t accesses = (argc > 1)? atol(argv[1]) : 400000;
+    uint64_t lines = (argc > 2)? atol(argv[2]) : 512;
+    const uint32_t numChildren = 8;
+
+    gm_init(256 << 20);
+    zinfo = gm_calloc<GlobSimInfo>();
+    zinfo->phaseLength = 1000;
+    zinfo->traceWriters = new g_vector<AccessTraceWriter*>();
+
+    fuzzLineStateTable(5000000, 4096);
+
+    //Random trace over a few lines, so children share and race on most of them
+    std::string traceFile = "tracedriverbench-" + std::to_string(getpid()) + ".trace";
+    AccessTraceWriter* atw = new AccessTraceWriter(g_string(traceFile.c_str()), numChildren, TRACE_FLAT);
+    srand(7);
+    for (uint64_t i = 0; i < accesses; i++) {
+        uint32_t r = rand();
+        AccessType types[] = {GETS, GETS, GETX, PUTS, PUTX};
+        AccessRecord acc = {(Address)(1 + (r >> 8) % lines), i/4, 10, (uint32_t)(r % numChildren), types[(r >> 4) % 5]};
+        atw->write(acc);
+    }
+    atw->dump(false);
+
+    for (uint32_t numThreads : {1, 2, 4, 8}) replay(traceFile.c_str(), numChildren, numThreads);
+    unlink(traceFile.c_str());
+    return 0;
+}
@@ -26,8 +26,8 @@
 #include "tracing_cache.h"
 #include "zsim.h"
 
-TracingCache::TracingCache(uint32_t _numLines, CC* _cc, CacheArray* _array, ReplPolicy* _rp, uint32_t _accLat, uint32_t _invLat, g_string& _tracefile, g_string& _name) :
-    Cache(_numLines, _cc, _array, _rp, _accLat, _invLat, _name), tracefile(_tracefile)
+TracingCache::TracingCache(uint32_t _numLines, CC* _cc, CacheArray* _array, ReplPolicy* _rp, uint32_t _accLat, uint32_t _invLat, g_string& _tracefile, TraceFormat _traceFormat, g_string& _name) :
+    Cache(_numLines, _cc, _array, _rp, _accLat, _invLat, _name), tracefile(_tracefile), traceFormat(_traceFormat)
 {
     futex_init(&traceLock);
 }
@@ -35,17 +35,24 @@ TracingCache::TracingCache(uint32_t _numLines, CC* _cc, CacheArray* _array, Repl
 void TracingCache::setChildren(const g_vector<BaseCache*>& children, zsimNetwork* network) {
     Cache::setChildren(children, network);
     //We need to initialize the trace writer here because it needs the number of children
-    atw = new AccessTraceWriter(tracefile, children.size());
+    //Flat traces get a buffer per core, plus a shared one for requests without a core (e.g., from a TraceDriver)
+    uint32_t numBufs = (traceFormat == TRACE_HDF5)? 1 : zinfo->numCores + 1;
+    atw = new AccessTraceWriter(tracefile, children.size(), traceFormat, numBufs, &zinfo->hdf5Lock);
     zinfo->traceWriters->push_back(atw); //register it so that it gets flushed when the simulation ends
 }
 
 uint64_t TracingCache::access(MemReq& req) {
     uint64_t respCycle = Cache::access(req);
-    futex_lock(&traceLock);
     uint32_t lat = respCycle - req.cycle;
     AccessRecord acc = {req.lineAddr, req.cycle, lat, req.childId, req.type};
-    atw->write(acc);
-    futex_unlock(&traceLock);
+    uint32_t sharedBuf = atw->getNumBuffers() - 1;
+    if (req.srcId < sharedBuf) {
+        atw->write(acc, req.srcId);  // only the thread running core srcId issues these, no need to lock
+    } else {
+        futex_lock(&traceLock);
+        atw->write(acc, sharedBuf);
+        futex_unlock(&traceLock);
+    }
     return respCycle;
 }
 
@@ -32,11 +32,12 @@
 class TracingCache : public Cache {
     private:
         g_string tracefile;
+        TraceFormat traceFormat;
         AccessTraceWriter* atw;
-        lock_t traceLock;
+        lock_t traceLock;  // serializes writes to the shared buffer (all of them with HDF5 traces)
 
     public:
-        TracingCache(uint32_t _numLines, CC* _cc, CacheArray* _array, ReplPolicy* _rp, uint32_t _accLat, uint32_t _invLat, g_string& _tracefile, g_string& _name);
+        TracingCache(uint32_t _numLines, CC* _cc, CacheArray* _array, ReplPolicy* _rp, uint32_t _accLat, uint32_t _invLat, g_string& _tracefile, TraceFormat _traceFormat, g_string& _name);
         void setChildren(const g_vector<BaseCache*>& children, zsimNetwork* network);
         uint64_t access(MemReq& req);
 };
@@ -52,6 +52,7 @@
 #include "event_queue.h"
 #include "galloc.h"
 #include "init.h"
+#include "live_stats.h"
 #include "log.h"
 #include "pin.H"
 #include "pin_cmd.h"
@@ -154,6 +155,7 @@ VOID FakeRDTSCPost(THREADID tid, REG* eax, REG* edx);
 
 VOID VdsoInstrument(INS ins);
 VOID FFThread(VOID* arg);
+VOID TraceDriverThread(VOID* arg);
 
 /* Indirect analysis calls to work around PIN's synchronization
  *
@@ -494,6 +496,7 @@ VOID EndOfPhaseActions() {
     zinfo->contentionSim->simulatePhase(zinfo->globPhaseCycles + zinfo->phaseLength);
     zinfo->eventQueue->tick();
     zinfo->profSimTime->transition(PROF_BOUND);
+    if (zinfo->liveStats) zinfo->liveStats->update();
 }
 
 
@@ -1123,6 +1126,7 @@ VOID SimEnd() {
 
         for (StatsBackend* backend : *(zinfo->statsBackends)) backend->dump(false /*unbuffered, write out*/);
         for (AccessTraceWriter* t : *(zinfo->traceWriters)) t->dump(false);  // flushes trace writer
+        CloseAsyncHDF5Stats();
 
         if (zinfo->sched) zinfo->sched->notifyTermination();
     }
@@ -1375,6 +1379,12 @@ VOID FFThread(VOID* arg) {
 }
 
 
+// Trace-driven simulation worker, see TraceDriver
+VOID TraceDriverThread(VOID* arg) {
+    zinfo->traceDriver->workerLoop((uint32_t)(uintptr_t)arg);
+}
+
+
 /* Internal Exception Handler */
 //When firing a debugger was an easy affair, this was not an issue. Now it's not so easy, so let's try to at least capture the backtrace and print it out
 
@@ -1569,6 +1579,10 @@ int main(int argc, char *argv[]) {
     // Start trace-driven or exec-driven sim
     if (zinfo->traceDriven) {
         info("Running trace-driven simulation");
+        uint32_t driverThreads = zinfo->traceDriver->getNumThreads();
+        if (driverThreads > 1) {
+            for (uint32_t w = 0; w < driverThreads; w++) PIN_SpawnInternalThread(TraceDriverThread, (VOID*)(uintptr_t)w, 1024*1024, nullptr);
+        }
         while (!zinfo->terminationConditionMet && zinfo->traceDriver->executePhase()) {
             // info("Phase done");
             EndOfPhaseActions();
@@ -58,11 +58,13 @@ class EventQueue;
 class ContentionSim;
 class EventRecorder;
 class PinCmd;
+class LiveStats;
 class PortVirtualizer;
 class VectorCounter;
 class AccessTraceWriter;
 class TraceDriver;
 class InterconnectInterface;
+class HDF5Writer;
 template <typename T> class g_vector;
 
 struct ClockDomainInfo {
@@ -152,9 +154,13 @@ struct GlobSimInfo {
     g_vector<StatsBackend*>* statsBackends; // used for termination dumps
     StatsBackend* periodicStatsBackend;
     StatsBackend* eventualStatsBackend;
+    HDF5Writer* hdf5Writer; //writes async HDF5 stats; created by the first async backend, nullptr if none
+    lock_t hdf5Lock; //the HDF5 library is not thread-safe, so every HDF5 call (stats and traces) is made with this held
     ProcessStats* processStats;
     ProcStats* procStats;
 
+    LiveStats* liveStats; //nullptr if disabled; read by monitors, see live_stats.h
+
     TimeBreakdownStat* profSimTime;
     VectorCounter* profHeartbeats; //global b/c number of processes cannot be inferred at init time; we just size to max
 
@@ -42,6 +42,7 @@
 #include "constants.h"
 #include "debug_harness.h"
 #include "galloc.h"
+#include "live_stats.h"
 #include "log.h"
 #include "pin_cmd.h"
 #include "version.h" //autogenerated, in build dir, see SConstruct
@@ -200,6 +201,7 @@ void debugSigHandler(int signum, siginfo_t* siginfo, void* dummy) {
 static time_t startTime;
 static time_t lastHeartbeatTime;
 static uint64_t lastCycles = 0;
+static int gmShmid = 0; //printed so that monitors (zsimtop) can attach
 
 static void printHeartbeat(GlobSimInfo* zinfo) {
     uint64_t cycles = zinfo->numPhases*zinfo->phaseLength;
@@ -225,6 +227,17 @@ static void printHeartbeat(GlobSimInfo* zinfo) {
     hb << "Stats since last heartbeat (" << heartbeatSecs << "s):" << std:: endl;
     hb << " " << (cycles-lastCycles)/heartbeatSecs << " cycles/s" << std::endl;
 
+    if (zinfo->liveStats) {
+        LiveStatsSnapshot ls;
+        zinfo->liveStats->read(&ls, nullptr);
+        hb << "Live stats (global segment shmid " << gmShmid << "):" << std::endl;
+        hb << " " << ls.getIpc(zinfo->numCores) << " IPC/core" << std::endl;
+        hb << " " << ls.totalInstrs << " instrs" << std::endl;
+        hb << " " << ls.boundNs/1e9 << " s bound, " << ls.weaveNs/1e9 << " s weave" << std::endl;
+        hb << " " << ls.nocInjectedFlits << " NoC flits injected, " << ls.nocEjectedFlits << " ejected" << std::endl;
+        hb << " " << ls.getAvgPacketLatency() << " cycles avg NoC packet latency" << std::endl;
+    }
+
     lastHeartbeatTime = curTime;
     lastCycles = cycles;
 }
@@ -360,6 +373,7 @@ int main(int argc, char *argv[]) {
     uint32_t gmSize = conf.get<uint32_t>("sim.gmMBytes", (1<<10) /*default 1024MB*/);
     info("Creating global segment, %d MBs", gmSize);
     int shmid = gm_init(((size_t)gmSize) << 20 /*MB to Bytes*/);
+    gmShmid = shmid;
     info("Global segment shmid = %d", shmid);
     //fprintf(stderr, "%sGlobal segment shmid = %d\n", logHeader, shmid); //hack to print shmid on both streams
     //fflush(stderr);
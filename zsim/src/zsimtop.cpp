@@ -0,0 +1,83 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Small utility to monitor a running simulation through its live stats. Attaches
+ * to the global heap read-only, so it cannot disturb the simulation.
+ */
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "galloc.h"
+#include "live_stats.h"
+#include "log.h"
+#include "zsim.h"
+
+int main(int argc, char *argv[]) {
+    InitLog("[T] ");
+    if (argc < 2 || argc > 4) {
+        info("Usage: %s <shmid> [<interval secs>] [-c (per-core instrs)]", argv[0]);
+        exit(1);
+    }
+
+    int shmid = atoi(argv[1]);
+    uint32_t interval = (argc >= 3 && argv[2][0] != '-')? atoi(argv[2]) : 1;
+    bool perCore = strcmp(argv[argc-1], "-c") == 0;
+    if (interval == 0) interval = 1;
+
+    gm_attach(shmid, true /*read-only*/);
+    while (!gm_isready()) sched_yield();
+    const GlobSimInfo* zinfo = static_cast<const GlobSimInfo*>(gm_get_glob_ptr());
+    const LiveStats* live = zinfo->liveStats;
+    if (!live) panic("Live stats are disabled in this simulation (sim.liveStats = false)");
+
+    uint32_t numCores = live->getNumCores();
+    uint64_t* instrs = static_cast<uint64_t*>(calloc(numCores, sizeof(uint64_t)));
+
+    LiveStatsSnapshot last;
+    live->read(&last, nullptr);
+    printf("%10s %14s %8s %8s %10s %10s %14s %14s %10s\n", "phase", "cycles", "IPC", "intIPC", "bound(s)", "weave(s)", "nocInjFlits", "nocEjFlits", "pktLat");
+    while (true) {
+        sleep(interval);
+        LiveStatsSnapshot cur;
+        live->read(&cur, perCore? instrs : nullptr);
+
+        // Interval IPC, so stalled or crawling runs stand out
+        uint64_t dCycles = cur.cycles - last.cycles;
+        double intIpc = dCycles? ((double)(cur.totalInstrs - last.totalInstrs))/(dCycles*numCores) : 0.0;
+
+        printf("%10ld %14ld %8.3f %8.3f %10.1f %10.1f %14ld %14ld %10.1f\n", cur.phase, cur.cycles, cur.getIpc(numCores), intIpc,
+                cur.boundNs/1e9, cur.weaveNs/1e9, cur.nocInjectedFlits, cur.nocEjectedFlits, cur.getAvgPacketLatency());
+        if (perCore) {
+            for (uint32_t i = 0; i < numCores; i++) printf(" c%d: %ld", i, instrs[i]);
+            printf("\n");
+        }
+        fflush(stdout);
+        last = cur;
+    }
+    return 0;
+}